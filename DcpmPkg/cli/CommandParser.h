@@ -110,6 +110,7 @@
 #define SENSOR_TARGET                        L"-sensor"                  //!< 'sensor' target name
 #define ERROR_TARGET                         L"-error"                   //!< 'error' target name
 #define CEL_TARGET                         L"-cel"                   //!< 'cel' target name
+#define TRANSPORT_TARGET                     L"-transport"               //!< 'transport' target name
 #define DEBUG_TARGET                         L"-debug"                   //!< 'debug' target name
 #define REGISTER_TARGET                      L"-register"                //!< 'register' target name
 #define FIRMWARE_TARGET                      L"-firmware"                //!< 'firmware' target name
@@ -236,6 +237,9 @@
 #define PROPERTY_VALUE_RECOMMENDED        L"RECOMMENDED"
 #define CATEGORY_PROPERTY                 L"Category"
 #define DBG_LOG_LEVEL                     L"DBG_LOG_LEVEL"
+#define DIMM_DISPATCH_WORKERS             L"DIMM_DISPATCH_WORKERS"
+#define INVENTORY_CACHE_ENABLED           L"INVENTORY_CACHE_ENABLED"
+#define STARTUP_PROFILE                   L"STARTUP_PROFILE"
 #define CREATE_SUPP_NAME                  L"Name"
 #define PROPERTY_ERROR_UNKNOWN                      L"Reason for failure unknown"
 #define PROPERTY_ERROR_DEFAULT_DIMM_NOT_PROVIDED    L"Default DimmID Type not provided"
@@ -315,6 +319,9 @@
                                         UNITS_OPTION_TIB
 #define HELP_TEXT_PERSISTENT_MEM_TYPE   L"AppDirect|AppDirectNotInterleaved"
 #define HELP_DBG_LOG_LEVEL              L"log level"
+#define HELP_DIMM_DISPATCH_WORKERS      L"max PMem modules worked on in parallel"
+#define HELP_INVENTORY_CACHE_ENABLED    L"0|1"
+#define HELP_STARTUP_PROFILE            L"OFF|STDERR|file path"
 #define HELP_TEXT_PERFORMANCE_CAT       L"Performance Metrics"
 
 #define HELP_TEXT_AVG_PWR_REPORTING_TIME_CONSTANT_PROPERTY          L"<100, 12000>"
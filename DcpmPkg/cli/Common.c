@@ -303,6 +303,118 @@ Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
+
+#ifdef OS_BUILD
+/**
+  Retrieve a populated array and count of the functional DCPMMs named in a
+  dimm target string, without initializing the other DCPMMs from FW. The
+  caller is responsible for freeing the returned array.
+
+  Nothing is printed on failure, callers fall back to GetAllDimmList which
+  reports invalid and duplicated targets.
+
+  @param[in] pNvmDimmConfigProtocol A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] pDimmString The dimm target string, as for GetDimmIdsFromString.
+  @param[in] dimmInfoCategories Categories that will be populated in
+             the DIMM_INFO struct.
+  @param[out] ppDimms A pointer to the dimm list, sorted by DimmID.
+  @param[out] pDimmCount A pointer to the number of DCPMMs in the list.
+
+  @retval EFI_SUCCESS  the dimm list was returned properly
+  @retval EFI_INVALID_PARAMETER one or more parameters are NULL, or a DCPMM is targeted twice
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+  @retval EFI_NOT_FOUND a target does not match a functional DCPMM
+**/
+EFI_STATUS
+GetTargetedDimmList(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     CHAR16 *pDimmString,
+  IN     DIMM_INFO_CATEGORIES dimmInfoCategories,
+  OUT DIMM_INFO **ppDimms,
+  OUT UINT32 *pDimmCount
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  CHAR16 **ppDimmIdTokensStr = NULL;
+  UINT32 TokenCount = 0;
+  UINT64 DimmHandle = 0;
+  UINT16 *pPids = NULL;
+  UINT32 Index = 0;
+  UINT32 Index2 = 0;
+  NVDIMM_ENTRY();
+
+  if (pNvmDimmConfigProtocol == NULL || pDimmString == NULL || ppDimms == NULL || pDimmCount == NULL) {
+    NVDIMM_CRIT("NULL input parameter.\n");
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  *ppDimms = NULL;
+  *pDimmCount = 0;
+
+  ppDimmIdTokensStr = StrSplit(pDimmString, L',', &TokenCount);
+  if (ppDimmIdTokensStr == NULL || TokenCount == 0) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  pPids = AllocateZeroPool(sizeof(*pPids) * TokenCount);
+  *ppDimms = AllocateZeroPool(sizeof(**ppDimms) * TokenCount);
+  if (pPids == NULL || *ppDimms == NULL) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto FinishError;
+  }
+
+  // Resolve the targets like GetDimmIdsFromString: numbers are device
+  // handles, anything else is a UID
+  for (Index = 0; Index < TokenCount; Index++) {
+    if (GetU64FromString(ppDimmIdTokensStr[Index], &DimmHandle)) {
+      if (DimmHandle > MAX_UINT32) {
+        ReturnCode = EFI_INVALID_PARAMETER;
+        goto FinishError;
+      }
+      ReturnCode = pNvmDimmConfigProtocol->GetDimmPid(pNvmDimmConfigProtocol, NULL, (UINT32)DimmHandle, &pPids[Index]);
+    } else {
+      ReturnCode = pNvmDimmConfigProtocol->GetDimmPid(pNvmDimmConfigProtocol, ppDimmIdTokensStr[Index], 0, &pPids[Index]);
+    }
+    if (EFI_ERROR(ReturnCode)) {
+      goto FinishError;
+    }
+
+    for (Index2 = 0; Index2 < Index; Index2++) {
+      if (pPids[Index2] == pPids[Index]) {
+        ReturnCode = EFI_INVALID_PARAMETER;
+        goto FinishError;
+      }
+    }
+  }
+
+  for (Index = 0; Index < TokenCount; Index++) {
+    ReturnCode = pNvmDimmConfigProtocol->GetDimm(pNvmDimmConfigProtocol, pPids[Index], dimmInfoCategories, &((*ppDimms)[Index]));
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_DBG("Failed to retrieve DIMM 0x%x", pPids[Index]);
+      goto FinishError;
+    }
+  }
+
+  ReturnCode = BubbleSort((VOID*)*ppDimms, TokenCount, sizeof(**ppDimms), CompareDimmIdInDimmInfo);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_DBG("Dimms list may not be sorted");
+    goto FinishError;
+  }
+
+  *pDimmCount = TokenCount;
+  goto Finish;
+
+FinishError:
+  FREE_POOL_SAFE(*ppDimms);
+Finish:
+  FreeStringArray(ppDimmIdTokensStr, TokenCount);
+  FREE_POOL_SAFE(pPids);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+#endif
 /**
   Parse the string and return the array of unsigned integers
 
@@ -329,6 +329,37 @@ GetAllDimmList(
   OUT UINT32 *pDimmCount
 );
 
+#ifdef OS_BUILD
+/**
+  Retrieve a populated array and count of the functional DCPMMs named in a
+  dimm target string, without initializing the other DCPMMs from FW. The
+  caller is responsible for freeing the returned array.
+
+  Nothing is printed on failure, callers fall back to GetAllDimmList which
+  reports invalid and duplicated targets.
+
+  @param[in] pNvmDimmConfigProtocol A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] pDimmString The dimm target string, as for GetDimmIdsFromString.
+  @param[in] dimmInfoCategories Categories that will be populated in
+             the DIMM_INFO struct.
+  @param[out] ppDimms A pointer to the dimm list, sorted by DimmID.
+  @param[out] pDimmCount A pointer to the number of DCPMMs in the list.
+
+  @retval EFI_SUCCESS  the dimm list was returned properly
+  @retval EFI_INVALID_PARAMETER one or more parameters are NULL, or a DCPMM is targeted twice
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+  @retval EFI_NOT_FOUND a target does not match a functional DCPMM
+**/
+EFI_STATUS
+GetTargetedDimmList(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     CHAR16 *pDimmString,
+  IN     DIMM_INFO_CATEGORIES dimmInfoCategories,
+  OUT DIMM_INFO **ppDimms,
+  OUT UINT32 *pDimmCount
+);
+#endif
+
 /**
   Parse the string and return the array of unsigned integers
 
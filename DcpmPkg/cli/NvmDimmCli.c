@@ -65,6 +65,7 @@
 #include "LoadSessionCommand.h"
 #ifdef OS_BUILD
 #include "os_efi_shell_parameters_protocol.h"
+#include "ShowTransportCommand.h"
 #include <Protocol/Driver/DriverBinding.h>
 #else
 #include <Protocol/DriverBinding.h>
@@ -84,6 +85,8 @@ extern int cov_dumpData(void);
 #include "DumpSupportCommand.h"
 #include <stdio.h>
 extern void nvm_current_cmd(struct Command Command);
+extern int nvm_cli_lock(BOOLEAN exclusive);
+extern void nvm_cli_unlock(BOOLEAN exclusive);
 extern BOOLEAN ConfigIsDdrtProtocolDisabled();
 extern BOOLEAN ConfigIsLargePayloadDisabled();
 extern int g_fast_path;
@@ -343,6 +346,8 @@ UefiMain(
   UINT32 NextId = 0;
 #ifdef OS_BUILD
   BOOLEAN IsVersionCommand = FALSE;
+  BOOLEAN IsExclusiveCommand = FALSE;
+  BOOLEAN IsLocked = FALSE;
 #else
   SHELL_FILE_HANDLE StdIn = NULL;
 #ifndef MDEPKG_NDEBUG
@@ -636,8 +641,16 @@ UefiMain(
 #ifdef OS_BUILD
         // different handling of returncodes for version command so it works for regular users
         IsVersionCommand = (StrnCmp(Command.verb, VERSION_VERB, VERB_LEN) == 0);
+        // Only the show commands run alongside other processes reading the PMem modules
+        IsExclusiveCommand = !IsVersionCommand && (StrnCmp(Command.verb, SHOW_VERB, VERB_LEN) != 0);
+        IsLocked = (NVM_SUCCESS == nvm_cli_lock(IsExclusiveCommand));
+        if (!IsLocked && !IsVersionCommand) {
+          Print(GetSingleNvmStatusCodeMessage(gNvmDimmCliHiiHandle, NVM_ERR_BUSY_DEVICE));
+          Print(FORMAT_NL);
+          Rc = EFI_NOT_READY;
+        }
 
-        if (!Command.ExcludeDriverBinding && !g_fast_path) {
+        if (IsLocked && !Command.ExcludeDriverBinding && !g_fast_path) {
           Rc = NvmDimmDriverDriverBindingStart(&gNvmDimmDriverDriverBinding, FakeBindHandle, NULL);
           if (EFI_ERROR(Rc) && !IsVersionCommand) {
             NVDIMM_ERR("Issue with driver initialization");
@@ -653,9 +666,12 @@ UefiMain(
           Rc = ExecuteCmd(&Command);
         }
 #ifdef OS_BUILD
-        if (!Command.ExcludeDriverBinding && !g_fast_path) {
+        if (IsLocked && !Command.ExcludeDriverBinding && !g_fast_path) {
           NvmDimmDriverDriverBindingStop(&gNvmDimmDriverDriverBinding, FakeBindHandle, 0, NULL);
         }
+        if (IsLocked) {
+          nvm_cli_unlock(IsExclusiveCommand);
+        }
 #endif
       }
       if (EFI_ERROR(Rc)) {
@@ -934,6 +950,13 @@ RegisterCommands(
     goto done;
   }
 
+#ifdef OS_BUILD
+  Rc = RegisterShowTransportCommand();
+  if (EFI_ERROR(Rc)) {
+    goto done;
+  }
+#endif
+
 #ifndef OS_BUILD
   /* Debug Utility commands */
   Rc = registerShowSmbiosCommand();
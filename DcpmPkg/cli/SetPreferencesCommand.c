@@ -25,6 +25,10 @@ extern EFI_RUNTIME_SERVICES  *gRT;
  **/
 #define MIN_LOG_LEVEL_VALUE 0
 #define MAX_LOG_LEVEL_VALUE 4
+#define MIN_DISPATCH_WORKERS_VALUE 0
+#define MAX_DISPATCH_WORKERS_VALUE 16   // FW_DISPATCH_MAX_WORKERS
+#define MIN_INVENTORY_CACHE_VALUE 0
+#define MAX_INVENTORY_CACHE_VALUE 1
 
 /**
   Command syntax definition
@@ -52,6 +56,9 @@ struct Command SetPreferencesCommand =
     {APP_DIRECT_SETTINGS_PROPERTY, L"", HELP_TEXT_APPDIRECT_SETTINGS, FALSE, ValueRequired},
 #ifdef OS_BUILD
     {DBG_LOG_LEVEL, L"", HELP_DBG_LOG_LEVEL, FALSE, ValueRequired},
+    {DIMM_DISPATCH_WORKERS, L"", HELP_DIMM_DISPATCH_WORKERS, FALSE, ValueRequired},
+    {INVENTORY_CACHE_ENABLED, L"", HELP_INVENTORY_CACHE_ENABLED, FALSE, ValueRequired},
+    {STARTUP_PROFILE, L"", HELP_STARTUP_PROFILE, FALSE, ValueRequired},
 #endif
   },
   L"Set user preferences.",                  //!< help
@@ -405,6 +412,34 @@ SetPreferences(
 
   TempReturnCode = MatchCliReturnCode(pCommandStatus->GeneralStatus);
   KEEP_ERROR(ReturnCode, TempReturnCode);
+
+  SetPreferenceStr(pCmd, DIMM_DISPATCH_WORKERS, "Dispatch workers setting not provided", MIN_DISPATCH_WORKERS_VALUE, MAX_DISPATCH_WORKERS_VALUE, pCommandStatus);
+
+  TempReturnCode = MatchCliReturnCode(pCommandStatus->GeneralStatus);
+  KEEP_ERROR(ReturnCode, TempReturnCode);
+
+  SetPreferenceStr(pCmd, INVENTORY_CACHE_ENABLED, "Inventory cache setting not provided", MIN_INVENTORY_CACHE_VALUE, MAX_INVENTORY_CACHE_VALUE, pCommandStatus);
+
+  TempReturnCode = MatchCliReturnCode(pCommandStatus->GeneralStatus);
+  KEEP_ERROR(ReturnCode, TempReturnCode);
+
+  // Not a number, OFF, STDERR or the file the profile is appended to
+  if ((TempReturnCode = ContainsProperty(pCmd, STARTUP_PROFILE)) != EFI_NOT_FOUND) {
+    TempReturnCode = GetPropertyValue(pCmd, STARTUP_PROFILE, &pTypeValue);
+    if (EFI_ERROR(TempReturnCode) || StrLen(pTypeValue) == 0) {
+      KEEP_ERROR(ReturnCode, EFI_INVALID_PARAMETER);
+      NVDIMM_WARN("Startup profile setting not provided");
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_SET_PREFERENCE_ERROR, STARTUP_PROFILE, L"", ReturnCode, PROPERTY_ERROR_UNKNOWN);
+    } else {
+      TempReturnCode = SET_STR_VARIABLE_NV(STARTUP_PROFILE, gNvmDimmVariableGuid, pTypeValue);
+      if (!EFI_ERROR(TempReturnCode)) {
+        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_SET_PREFERENCE_SUCCESS, STARTUP_PROFILE, pTypeValue);
+      } else {
+        KEEP_ERROR(ReturnCode, TempReturnCode);
+        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_SET_PREFERENCE_ERROR, STARTUP_PROFILE, pTypeValue, ReturnCode, PROPERTY_ERROR_SET_FAILED_UNKNOWN);
+      }
+    }
+  }
 #endif
 
 Finish:
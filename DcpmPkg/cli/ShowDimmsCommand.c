@@ -448,6 +448,7 @@ ShowDimms(
   BOOLEAN ShowAll = FALSE;
   BOOLEAN ShowTableView = FALSE;
   BOOLEAN ContainSocketTarget = FALSE;
+  BOOLEAN TargetedDimmList = FALSE;
   COMMAND_STATUS *pCommandStatus = NULL;
   CHAR16 *pAttributeStr = NULL;
   CHAR16 *pCapacityStr = NULL;
@@ -465,8 +466,8 @@ ShowDimms(
   PRINT_CONTEXT *pPrinterCtx = NULL;
   CHAR16 *pPath = NULL;
   BOOLEAN volatile DimmIsOkToDisplay[MAX_DIMMS];
-  BOOLEAN IsMixedSku;
-  BOOLEAN IsSkuViolation;
+  BOOLEAN IsMixedSku = FALSE;
+  BOOLEAN IsSkuViolation = FALSE;
   DIMM_INFO_CATEGORIES DimmCategories = DIMM_INFO_CATEGORY_NONE;
   BOOLEAN FIS_2_0 = FALSE;
   CHAR16 *pStr = NULL;
@@ -565,21 +566,38 @@ ShowDimms(
     DimmCategories = DIMM_INFO_CATEGORY_ALL;
   }
 
-  // Populate the list of DIMM_INFO structures with relevant information
-  ReturnCode = GetAllDimmList(pNvmDimmConfigProtocol, pCmd, DimmCategories, &pDimms, &DimmCount);
-  if (EFI_ERROR(ReturnCode) || (pDimms == NULL)) {
-    NVDIMM_WARN("Failed to populate the list of DIMM_INFO structures");
-    goto Finish;
+#ifdef OS_BUILD
+  /**
+    Explicit DIMM targets are resolved from NFIT so that only they are
+    initialized from FW. Anything else, including invalid targets,
+    non-functional DIMMs and the MixedSKU attribute, which needs every DIMM,
+    goes through the full list below.
+  **/
+  if (!ContainSocketTarget && NULL != pCmd->targets[0].pTargetValueStr && StrLen(pCmd->targets[0].pTargetValueStr) > 0 &&
+      !pDispOptions->AllOptionSet &&
+      !(pDispOptions->DisplayOptionSet && ContainsValue(pDispOptions->pDisplayValues, MIXED_SKU_STR))) {
+    TargetedDimmList = !EFI_ERROR(GetTargetedDimmList(pNvmDimmConfigProtocol, GetTargetValue(pCmd, DIMM_TARGET),
+      DimmCategories, &pDimms, &DimmCount));
   }
+#endif
 
-  ReturnCode = IsDimmsMixedSkuCfg(pPrinterCtx, pNvmDimmConfigProtocol, &IsMixedSku, &IsSkuViolation);
-  if (EFI_ERROR(ReturnCode)) {
-    goto Finish;
-  }
+  if (!TargetedDimmList) {
+    // Populate the list of DIMM_INFO structures with relevant information
+    ReturnCode = GetAllDimmList(pNvmDimmConfigProtocol, pCmd, DimmCategories, &pDimms, &DimmCount);
+    if (EFI_ERROR(ReturnCode) || (pDimms == NULL)) {
+      NVDIMM_WARN("Failed to populate the list of DIMM_INFO structures");
+      goto Finish;
+    }
 
-  if (IsMixedSku) {
-    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, WARNING_DIMMS_SKU_MIXED);
-    NVDIMM_WARN("Mixed SKU detected. Driver functionalities limited.");
+    ReturnCode = IsDimmsMixedSkuCfg(pPrinterCtx, pNvmDimmConfigProtocol, &IsMixedSku, &IsSkuViolation);
+    if (EFI_ERROR(ReturnCode)) {
+      goto Finish;
+    }
+
+    if (IsMixedSku) {
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, WARNING_DIMMS_SKU_MIXED);
+      NVDIMM_WARN("Mixed SKU detected. Driver functionalities limited.");
+    }
   }
 
   /** if a specific DIMM pid was passed in, set it **/
@@ -143,6 +143,24 @@ ShowPreferences(
   if (!EFI_ERROR(ReturnCode)) {
     PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath,  DBG_LOG_LEVEL, tempStr);
   }
+
+  TempStrLen = PROPERTY_VALUE_LEN;
+  ReturnCode = GET_VARIABLE_STR(DIMM_DISPATCH_WORKERS, gNvmDimmConfigProtocolGuid, &TempStrLen, tempStr);
+  if (!EFI_ERROR(ReturnCode)) {
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath,  DIMM_DISPATCH_WORKERS, tempStr);
+  }
+
+  TempStrLen = PROPERTY_VALUE_LEN;
+  ReturnCode = GET_VARIABLE_STR(INVENTORY_CACHE_ENABLED, gNvmDimmConfigProtocolGuid, &TempStrLen, tempStr);
+  if (!EFI_ERROR(ReturnCode)) {
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath,  INVENTORY_CACHE_ENABLED, tempStr);
+  }
+
+  TempStrLen = PROPERTY_VALUE_LEN;
+  ReturnCode = GET_VARIABLE_STR(STARTUP_PROFILE, gNvmDimmConfigProtocolGuid, &TempStrLen, tempStr);
+  if (!EFI_ERROR(ReturnCode)) {
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath,  STARTUP_PROFILE, tempStr);
+  }
 #endif
 
 Finish:
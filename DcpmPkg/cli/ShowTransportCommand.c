@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <Library/BaseMemoryLib.h>
+#include "ShowTransportCommand.h"
+#include "NvmDimmCli.h"
+#include "NvmInterface.h"
+#include "Debug.h"
+#include "Convert.h"
+#include <os_efi_api.h>
+
+#define DS_ROOT_PATH                      L"/TransportList"
+#define DS_TRANSPORT_PATH                 L"/TransportList/Transport"
+#define DS_TRANSPORT_INDEX_PATH           L"/TransportList/Transport[%d]"
+
+ /**
+   show -transport syntax definition
+ **/
+struct Command ShowTransportCommandSyntax =
+{
+  SHOW_VERB,                                                           //!< verb
+  {                                                                    //!< options
+    {VERBOSE_OPTION_SHORT, VERBOSE_OPTION, L"", L"",HELP_VERBOSE_DETAILS_TEXT, FALSE, ValueEmpty},
+    { OUTPUT_OPTION_SHORT, OUTPUT_OPTION, L"", OUTPUT_OPTION_HELP, HELP_OPTIONS_DETAILS_TEXT,FALSE, ValueRequired }
+  },
+  {
+    {TRANSPORT_TARGET, L"", L"", TRUE, ValueEmpty},
+    {DIMM_TARGET, L"", HELP_TEXT_DIMM_IDS, FALSE, ValueOptional}
+  },
+  {{L"", L"", L"", FALSE, ValueOptional}},                            //!< properties
+  L"Show FW command latency and retry statistics per " PMEM_MODULE_STR L", opcode and transport.", //!< help
+  ShowTransportCommand,                                               //!< run function
+  TRUE
+};
+
+// Table heading names
+#define OPCODE_STR          L"Opcode"
+#define SUBOPCODE_STR       L"SubOpcode"
+#define TRANSPORT_STR       L"Transport"
+#define COUNT_STR           L"Count"
+#define ERRORS_STR          L"Errors"
+#define RETRIES_STR         L"Retries"
+#define AVG_LATENCY_STR     L"AvgLatency(us)"
+#define MAX_LATENCY_STR     L"MaxLatency(us)"
+#define P99_LATENCY_STR     L"P99Latency(us)"
+#define HISTOGRAM_STR       L"LatencyHistogram"
+#define FW_CMD_POOL_STATS_STR \
+  L"FW command pool: %lld requests, %lld reused, %lld bytes allocated, %lld bytes cleared\n"
+
+/*
+*  SHOW TRANSPORT ATTRIBUTES (10 columns)
+*   DimmID | Opcode | SubOpcode | Transport | Count | Errors | Retries | AvgLatency(us) | MaxLatency(us) | P99Latency(us)
+*   =====================================================================================================================
+*   0x0001 | X      | X         | X         | X     | X      | X       | X              | X              | X
+*   ...
+*/
+PRINTER_TABLE_ATTRIB ShowTransportTableAttributes =
+{
+  {
+    {
+      DIMM_ID_STR,                                      //COLUMN HEADER
+      DIMM_MAX_STR_WIDTH,                               //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM DIMM_ID_STR      //COLUMN DATA PATH
+    },
+    {
+      OPCODE_STR,                                       //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(OPCODE_STR),              //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM OPCODE_STR       //COLUMN DATA PATH
+    },
+    {
+      SUBOPCODE_STR,                                    //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(SUBOPCODE_STR),           //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM SUBOPCODE_STR    //COLUMN DATA PATH
+    },
+    {
+      TRANSPORT_STR,                                    //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(TRANSPORT_STR),           //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM TRANSPORT_STR    //COLUMN DATA PATH
+    },
+    {
+      COUNT_STR,                                        //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(COUNT_STR),               //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM COUNT_STR        //COLUMN DATA PATH
+    },
+    {
+      ERRORS_STR,                                       //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(ERRORS_STR),              //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM ERRORS_STR       //COLUMN DATA PATH
+    },
+    {
+      RETRIES_STR,                                      //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(RETRIES_STR),             //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM RETRIES_STR      //COLUMN DATA PATH
+    },
+    {
+      AVG_LATENCY_STR,                                  //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(AVG_LATENCY_STR),         //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM AVG_LATENCY_STR  //COLUMN DATA PATH
+    },
+    {
+      MAX_LATENCY_STR,                                  //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(MAX_LATENCY_STR),         //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM MAX_LATENCY_STR  //COLUMN DATA PATH
+    },
+    {
+      P99_LATENCY_STR,                                  //COLUMN HEADER
+      TABLE_MIN_HEADER_LENGTH(P99_LATENCY_STR),         //COLUMN MAX STR WIDTH
+      DS_TRANSPORT_PATH PATH_KEY_DELIM P99_LATENCY_STR  //COLUMN DATA PATH
+    }
+  }
+};
+
+PRINTER_DATA_SET_ATTRIBS ShowTransportDataSetAttribs =
+{
+  NULL,
+  &ShowTransportTableAttributes
+};
+
+/**
+  Get the display name of a transport
+
+  @param[in] Method transport the commands were sent over
+**/
+STATIC
+CONST CHAR16 *
+GetTransportStr(
+  IN     DIMM_PASSTHRU_METHOD Method
+)
+{
+  switch (Method) {
+  case DimmPassthruSmbusSmallPayload:
+    return TRANSPORT_SMBUS_STR;
+  case DimmPassthruDdrtSmallPayload:
+    return TRANSPORT_DDRT_SMALL_PAYLOAD_STR;
+  default:
+    return TRANSPORT_DDRT_LARGE_PAYLOAD_STR;
+  }
+}
+
+/**
+  Estimate the 99th percentile latency as the upper bound of the histogram
+  bucket holding it. The slowest bucket has no bound, the maximum is used.
+
+  @param[in] pEntry transport statistics entry
+**/
+STATIC
+UINT64
+GetP99LatencyUs(
+  IN     TRANSPORT_STATS_ENTRY *pEntry
+)
+{
+  UINT64 Needed = pEntry->Count - (pEntry->Count / 100);
+  UINT64 Seen = 0;
+  UINT32 Bucket = 0;
+
+  for (Bucket = 0; Bucket < TRANSPORT_STATS_BUCKETS - 1; Bucket++) {
+    Seen += pEntry->Buckets[Bucket];
+    if (Seen >= Needed) {
+      return MIN(TRANSPORT_STATS_BUCKET_LIMIT_US(Bucket), pEntry->MaxUs);
+    }
+  }
+  return pEntry->MaxUs;
+}
+
+/**
+  Create the histogram string, listing the non-empty buckets as <limit:count
+
+  @param[in] pEntry transport statistics entry
+**/
+STATIC
+CHAR16 *
+GetLatencyHistogramStr(
+  IN     TRANSPORT_STATS_ENTRY *pEntry
+)
+{
+  CHAR16 *pReturnBuffer = NULL;
+  UINT32 Bucket = 0;
+
+  for (Bucket = 0; Bucket < TRANSPORT_STATS_BUCKETS; Bucket++) {
+    if (0 == pEntry->Buckets[Bucket]) {
+      continue;
+    }
+    if (NULL != pReturnBuffer) {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, L", ");
+    }
+    if (Bucket < TRANSPORT_STATS_BUCKETS - 1) {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, L"<%lldus:%lld",
+        TRANSPORT_STATS_BUCKET_LIMIT_US(Bucket), pEntry->Buckets[Bucket]);
+    } else {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, L">=%lldus:%lld",
+        TRANSPORT_STATS_BUCKET_LIMIT_US(Bucket - 1), pEntry->Buckets[Bucket]);
+    }
+  }
+  return pReturnBuffer;
+}
+
+/**
+  Register the show -transport command
+
+  @retval EFI_SUCCESS success
+  @retval EFI_ABORTED registering failure
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+RegisterShowTransportCommand(
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  NVDIMM_ENTRY();
+
+  ReturnCode = RegisterCommand(&ShowTransportCommandSyntax);
+
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Show the latency statistics of the FW commands sent by this process
+
+  @param[in] pCmd command from CLI
+
+  @retval EFI_SUCCESS success
+  @retval EFI_INVALID_PARAMETER pCmd is NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+ShowTransportCommand(
+  IN    struct Command *pCmd
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PRINT_CONTEXT *pPrinterCtx = NULL;
+  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
+  DIMM_INFO *pDimms = NULL;
+  UINT32 DimmCount = 0;
+  CHAR16 *pDimmsValue = NULL;
+  UINT16 *pDimmIds = NULL;
+  UINT32 DimmIdsNum = 0;
+  UINT32 DimmIndex = 0;
+  TRANSPORT_STATS_ENTRY *pEntries = NULL;
+  UINT32 EntryCount = 0;
+  UINT32 EntryIndex = 0;
+  UINT32 PrintIndex = 0;
+  CHAR16 DimmStr[MAX_DIMM_UID_LENGTH];
+  CHAR16 *pPath = NULL;
+  CHAR16 *pHistogram = NULL;
+  FW_CMD_POOL_STATS PoolStats;
+
+  NVDIMM_ENTRY();
+
+  ZeroMem(&PoolStats, sizeof(PoolStats));
+
+  if (pCmd == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    NVDIMM_DBG("pCmd parameter is NULL.\n");
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_NO_COMMAND);
+    goto Finish;
+  }
+
+  pPrinterCtx = pCmd->pPrintCtx;
+
+  ReturnCode = OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL);
+  if (EFI_ERROR(ReturnCode)) {
+    ReturnCode = EFI_NOT_FOUND;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_OPENING_CONFIG_PROTOCOL);
+    goto Finish;
+  }
+
+  ReturnCode = GetDimmList(pNvmDimmConfigProtocol, pCmd, DIMM_INFO_CATEGORY_NONE, &pDimms, &DimmCount);
+  if (EFI_ERROR(ReturnCode)) {
+    if (ReturnCode == EFI_NOT_FOUND) {
+      PRINTER_SET_MSG(pCmd->pPrintCtx, ReturnCode, CLI_INFO_NO_FUNCTIONAL_DIMMS);
+    }
+    goto Finish;
+  }
+
+  if (ContainTarget(pCmd, DIMM_TARGET)) {
+    pDimmsValue = GetTargetValue(pCmd, DIMM_TARGET);
+    ReturnCode = GetDimmIdsFromString(pCmd, pDimmsValue, pDimms, DimmCount, &pDimmIds, &DimmIdsNum);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_WARN("Target value is not a valid Dimm ID");
+      goto Finish;
+    }
+  }
+
+  // Everything sent so far, including the commands issued to build the DIMM inventory
+  ReturnCode = GetTransportStats(NULL, &EntryCount);
+  if (EFI_ERROR(ReturnCode)) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_INTERNAL_ERROR);
+    goto Finish;
+  }
+  if (EntryCount > 0) {
+    pEntries = AllocateZeroPool(sizeof(*pEntries) * EntryCount);
+    if (pEntries == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_OUT_OF_MEMORY);
+      goto Finish;
+    }
+    // Entries added since counting are left out
+    ReturnCode = GetTransportStats(pEntries, &EntryCount);
+    if (EFI_ERROR(ReturnCode) && ReturnCode != EFI_BUFFER_TOO_SMALL) {
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_INTERNAL_ERROR);
+      goto Finish;
+    }
+    ReturnCode = EFI_SUCCESS;
+  }
+
+  for (EntryIndex = 0; EntryIndex < EntryCount; EntryIndex++) {
+    for (DimmIndex = 0; DimmIndex < DimmCount; DimmIndex++) {
+      if (pDimms[DimmIndex].DimmHandle == pEntries[EntryIndex].DimmHandle) {
+        break;
+      }
+    }
+    if (DimmIndex == DimmCount ||
+        (DimmIdsNum > 0 && !ContainUint(pDimmIds, DimmIdsNum, pDimms[DimmIndex].DimmID))) {
+      continue;
+    }
+
+    ReturnCode = GetPreferredDimmIdAsString(pDimms[DimmIndex].DimmHandle, pDimms[DimmIndex].DimmUid, DimmStr, MAX_DIMM_UID_LENGTH);
+    if (EFI_ERROR(ReturnCode)) {
+      goto Finish;
+    }
+
+    PRINTER_BUILD_KEY_PATH(pPath, DS_TRANSPORT_INDEX_PATH, PrintIndex);
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, DIMM_ID_STR, DimmStr);
+    PRINTER_SET_KEY_VAL_UINT8(pPrinterCtx, pPath, OPCODE_STR, pEntries[EntryIndex].Opcode, HEX);
+    PRINTER_SET_KEY_VAL_UINT8(pPrinterCtx, pPath, SUBOPCODE_STR, pEntries[EntryIndex].SubOpcode, HEX);
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, TRANSPORT_STR, (CHAR16 *)GetTransportStr(pEntries[EntryIndex].Method));
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, COUNT_STR, pEntries[EntryIndex].Count, DECIMAL);
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, ERRORS_STR, pEntries[EntryIndex].Errors, DECIMAL);
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, RETRIES_STR, pEntries[EntryIndex].Retries, DECIMAL);
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, AVG_LATENCY_STR,
+      pEntries[EntryIndex].TotalUs / MAX(pEntries[EntryIndex].Count, 1), DECIMAL);
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, MAX_LATENCY_STR, pEntries[EntryIndex].MaxUs, DECIMAL);
+    PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, P99_LATENCY_STR, GetP99LatencyUs(&pEntries[EntryIndex]), DECIMAL);
+    pHistogram = GetLatencyHistogramStr(&pEntries[EntryIndex]);
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, HISTOGRAM_STR, pHistogram);
+    FREE_POOL_SAFE(pHistogram);
+    PrintIndex++;
+  }
+
+  // Memory churn of the FW commands behind the statistics above
+  GetFwCmdPoolStats(&PoolStats);
+  PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FW_CMD_POOL_STATS_STR,
+    PoolStats.Requests, PoolStats.Reused, PoolStats.BytesAllocated, PoolStats.BytesCleared);
+
+  //Switch text output type to display as a table
+  PRINTER_ENABLE_TEXT_TABLE_FORMAT(pPrinterCtx);
+  //Specify table attributes
+  PRINTER_CONFIGURE_DATA_ATTRIBUTES(pPrinterCtx, DS_ROOT_PATH, &ShowTransportDataSetAttribs);
+Finish:
+  PRINTER_PROCESS_SET_BUFFER(pPrinterCtx);
+  FREE_POOL_SAFE(pPath);
+  FREE_POOL_SAFE(pHistogram);
+  FREE_POOL_SAFE(pEntries);
+  FREE_POOL_SAFE(pDimms);
+  FREE_POOL_SAFE(pDimmIds);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
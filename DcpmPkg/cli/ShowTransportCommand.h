@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _SHOW_TRANSPORT_COMMAND_H_
+#define _SHOW_TRANSPORT_COMMAND_H_
+
+#include <Uefi.h>
+#include "NvmInterface.h"
+#include "Common.h"
+
+// Transport description strings
+#define TRANSPORT_DDRT_LARGE_PAYLOAD_STR      L"DDRT LP"
+#define TRANSPORT_DDRT_SMALL_PAYLOAD_STR      L"DDRT SP"
+#define TRANSPORT_SMBUS_STR                   L"SMBUS"
+
+/**
+  Register syntax of show -transport
+**/
+EFI_STATUS
+RegisterShowTransportCommand(
+);
+
+/**
+  Show the latency statistics of the FW commands sent by this process
+
+  @param[in] pCmd command from CLI
+
+  @retval EFI_SUCCESS success
+  @retval EFI_INVALID_PARAMETER pCmd is NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+ShowTransportCommand(
+  IN    struct Command *pCmd
+);
+
+#endif
@@ -210,6 +210,28 @@ EFI_STATUS
   IN     UINT16 Pid,
   IN     UINT8 PMONGroupEnable
 );
+
+/**
+  Resolve a PMem module target to its Pid without initializing the other
+  PMem modules from FW
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] pDimmUid The UID of the PMem module, NULL to look it up by handle
+  @param[in] DimmHandle The device handle of the PMem module, used if pDimmUid is NULL
+  @param[out] pPid A pointer to the Pid of the PMem module
+
+  @retval EFI_SUCCESS  The Pid of a functional PMem module was returned
+  @retval EFI_INVALID_PARAMETER pThis or pPid is NULL
+  @retval EFI_NOT_FOUND No functional PMem module matches the target
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DCPMM_CONFIG_GET_DIMM_PID) (
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     CONST CHAR16 *pDimmUid OPTIONAL,
+  IN     UINT32 DimmHandle,
+     OUT UINT16 *pPid
+);
 #endif
 
 /**
@@ -1702,6 +1724,7 @@ struct _EFI_DCPMM_CONFIG2_PROTOCOL {
 #ifdef OS_BUILD
   EFI_DCPMM_CONFIG_GET_PMON GetPMONRegisters;
   EFI_DCPMM_CONFIG_SET_PMON SetPMONRegisters;
+  EFI_DCPMM_CONFIG_GET_DIMM_PID GetDimmPid;
 #endif
   EFI_DCPMM_CONFIG_GET_UNINITIALIZED_DIMM_COUNT GetUninitializedDimmCount;
   EFI_DCPMM_CONFIG_GET_UNINITIALIZED_DIMMS GetUninitializedDimms;
@@ -8,6 +8,22 @@
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 
+/**
+  Frees the memory of an NFIT subtable index.
+
+  @param[in, out] pIndex pointer to the index.
+**/
+STATIC
+VOID
+FreeNfitIndex(
+  IN OUT NfitIndex *pIndex
+  )
+{
+  FREE_POOL_SAFE(pIndex->pSlots);
+  FREE_POOL_SAFE(pIndex->pNext);
+  pIndex->SlotBits = 0;
+}
+
 /**
   Frees the memory of parsed Nfit subtables.
 
@@ -213,6 +229,11 @@ FreeNfitSubTables(
   }
   FREE_POOL_SAFE(ParsedNfit->ppPlatformCapabilitiesTbles);
   ParsedNfit->PlatformCapabilitiesTblesNum = 0;
+
+  FreeNfitIndex(&ParsedNfit->RegionMappingsByPid);
+  FreeNfitIndex(&ParsedNfit->SpaRangeTblesByIndex);
+  FreeNfitIndex(&ParsedNfit->InterleaveTblesByIndex);
+  FreeNfitIndex(&ParsedNfit->ControlRegionTblesByIndex);
 }
 
 /**
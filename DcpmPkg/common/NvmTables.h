@@ -303,6 +303,19 @@ typedef struct {
   UINT32 Reserved_1;                  ///< Reserved
 } PlatformCapabilitiesTbl;
 
+/** NFIT index slot */
+typedef struct {
+  UINT16 Key;                           ///< Index field value of the subtable
+  UINT32 Position;                      ///< Position of the subtable in its array plus one, 0 for a free slot
+} NfitIndexSlot;
+
+/** Open addressing hash index of NFIT subtables by one of their index fields */
+typedef struct {
+  UINT32 SlotBits;                      ///< Log2 of the slot count
+  NfitIndexSlot *pSlots;                ///< Slots, pointing at the first subtable of each key
+  UINT32 *pNext;                        ///< Position plus one of the next subtable with the same key, optional
+} NfitIndex;
+
 /** NFIT ACPI data */
 typedef struct {
   NFitHeader *pFit;                                               ///< NFIT Header
@@ -322,6 +335,10 @@ typedef struct {
   FlushHintTbl **ppFlushHintTbles;                                ///< Flush Hint tables
   UINT32 PlatformCapabilitiesTblesNum;                            ///< Count of PCAT tables
   PlatformCapabilitiesTbl **ppPlatformCapabilitiesTbles;          ///< PCAT tables
+  NfitIndex RegionMappingsByPid;                                  ///< Region tables by NvDimmPhysicalId
+  NfitIndex SpaRangeTblesByIndex;                                 ///< SPA Range tables by SpaRangeDescriptionTableIndex
+  NfitIndex InterleaveTblesByIndex;                               ///< Interleave tables by InterleaveStructureIndex
+  NfitIndex ControlRegionTblesByIndex;                            ///< Control Region tables by ControlRegionDescriptorTableIndex
 } ParsedFitHeader;
 
 typedef struct {
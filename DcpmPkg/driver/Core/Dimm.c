@@ -23,7 +23,12 @@
 #include <NvmDimmDriver.h>
 #ifdef OS_BUILD
 #include <os_types.h>
+#include <os.h>
 #include <Common.h>
+#include <PbrDcpmm.h>
+#include <os_efi_api.h>
+#include <os_efi_inventory_cache.h>
+#include <os_efi_startup_profile.h>
 #endif
 
 #ifndef OS_BUILD
@@ -104,6 +109,40 @@ BOOLEAN ConfigIsDdrtProtocolDisabled()
 
   return (BOOLEAN)ddrt_protocol_disabled;
 }
+
+// Set by SetDispatchMaxWorkersOverride, survives the ini being reloaded
+STATIC UINT32 gDispatchWorkersOverride = 0;
+
+/*
+* Function overrides the ini configuration for the rest of the process, 0 goes back to it
+*/
+VOID SetDispatchMaxWorkersOverride(UINT32 Workers)
+{
+  gDispatchWorkersOverride = MIN(Workers, FW_DISPATCH_MAX_WORKERS);
+}
+
+/*
+* Function get the ini configuration on every call, so a change applies to the next dispatch
+*
+* It returns the number of DIMMs DispatchPerDimm may work on at the same time
+*/
+UINT32 ConfigDispatchMaxWorkers()
+{
+  UINT32 dispatch_workers = 0;
+  EFI_STATUS efi_status;
+  EFI_GUID guid = { 0 };
+  UINTN size;
+
+  if (gDispatchWorkersOverride != 0)
+    return gDispatchWorkersOverride;
+
+  size = sizeof(dispatch_workers);
+  efi_status = GET_VARIABLE(INI_PREFERENCES_DIMM_DISPATCH_WORKERS, guid, &size, &dispatch_workers);
+  if ((EFI_SUCCESS != efi_status) || (dispatch_workers == 0) || (dispatch_workers > FW_DISPATCH_MAX_WORKERS))
+    return FW_DISPATCH_MAX_WORKERS;
+
+  return dispatch_workers;
+}
 #endif // OS_BUILD
 
 /**
@@ -166,10 +205,173 @@ InitializeCpuCommands(
 
 
 STATIC EFI_STATUS PollOnArsDeviceBusy(IN DIMM *pDimm, IN UINT32 TimeoutSecs);
+#ifdef OS_BUILD
+STATIC EFI_STATUS InitializeDimmFromNfit(IN DIMM *pNewDimm, IN ParsedFitHeader *pFitHead,
+    IN ParsedPmttHeader *pPmttHead, IN UINT16 Pid);
+#endif
+
+#define DIMM_REGISTRY_NEXT(Slot)  (((Slot) + 1) & (DIMM_REGISTRY_BUCKETS - 1))
+
+/**
+  Hash a registry key into the slot its probing starts from
+
+  @param[in] Key The key
+
+  @retval Slot index lower than DIMM_REGISTRY_BUCKETS
+**/
+STATIC
+UINT32
+DimmRegistryHash(
+  IN     UINT32 Key
+  )
+{
+  // Fibonacci hashing, the top bits of the product are well mixed
+  return (UINT32)(Key * 2654435761U) >> (32 - DIMM_REGISTRY_BUCKET_BITS);
+}
+
+/**
+  Tell whether the DIMM has a valid NVDIMM UID, see GetDimmUid
+**/
+STATIC
+BOOLEAN
+IsDimmUidValid(
+  IN     DIMM *pDimm
+  )
+{
+  return pDimm->VendorId != 0 && pDimm->ManufacturingInfoValid != FALSE && pDimm->SerialNumber != 0;
+}
+
+/**
+  Registry key of the NVDIMM UID fields
+**/
+STATIC
+UINT32
+UidKey(
+  IN     UINT16 VendorId,
+  IN     UINT8 ManufacturingLocation,
+  IN     UINT16 ManufacturingDate,
+  IN     UINT32 SerialNumber
+  )
+{
+  return SerialNumber ^ ((UINT32)VendorId << 16) ^ ((UINT32)ManufacturingLocation << 8) ^ ManufacturingDate;
+}
+
+/**
+  Registry key of the NVDIMM UID of a DIMM, all the invalid UIDs share one
+**/
+STATIC
+UINT32
+DimmUidKey(
+  IN     DIMM *pDimm
+  )
+{
+  if (!IsDimmUidValid(pDimm)) {
+    return 0;
+  }
+  return UidKey(pDimm->VendorId, pDimm->ManufacturingLocation, pDimm->ManufacturingDate, pDimm->SerialNumber);
+}
+
+/**
+  Tell whether two DIMMs have the same NVDIMM UID, as GetDimmUid formats it
+**/
+STATIC
+BOOLEAN
+IsSameDimmUid(
+  IN     DIMM *pDimm1,
+  IN     DIMM *pDimm2
+  )
+{
+  if (!IsDimmUidValid(pDimm1) || !IsDimmUidValid(pDimm2)) {
+    return !IsDimmUidValid(pDimm1) && !IsDimmUidValid(pDimm2);
+  }
+  return pDimm1->VendorId == pDimm2->VendorId && pDimm1->SerialNumber == pDimm2->SerialNumber &&
+      pDimm1->ManufacturingLocation == pDimm2->ManufacturingLocation &&
+      pDimm1->ManufacturingDate == pDimm2->ManufacturingDate;
+}
+
+/**
+  Add a DIMM to one of the registry tables
+
+  @param[in,out] ppTable The table
+  @param[in] Key The key of pDimm in this table
+  @param[in] pDimm The DIMM to add
+**/
+STATIC
+VOID
+DimmRegistryInsert(
+  IN OUT DIMM **ppTable,
+  IN     UINT32 Key,
+  IN     DIMM *pDimm
+  )
+{
+  UINT32 Slot = DimmRegistryHash(Key);
+
+  // Never full, the registry holds at most MAX_DIMMS DIMMs
+  while (ppTable[Slot] != NULL) {
+    Slot = DIMM_REGISTRY_NEXT(Slot);
+  }
+  ppTable[Slot] = pDimm;
+}
+
+/**
+  Rebuild the registry from the DIMM list. Must be called after DIMMs are
+  added or removed and their identifiers are known. When the list is too
+  long the registry stays invalid and lookups scan the list.
+
+  @param[in,out] pDev The pmem super structure
+**/
+STATIC
+VOID
+RebuildDimmRegistry(
+  IN OUT PMEM_DEV *pDev
+  )
+{
+  DIMM_REGISTRY *pRegistry = &pDev->DimmRegistry;
+  LIST_ENTRY *pNode = NULL;
+  DIMM *pDimm = NULL;
+
+  ZeroMem(pRegistry, sizeof(*pRegistry));
+
+  LIST_FOR_EACH(pNode, &pDev->Dimms) {
+    if (pRegistry->DimmCount >= MAX_DIMMS) {
+      NVDIMM_WARN("Too many DIMMs to index, looking them up by scanning the list");
+      ZeroMem(pRegistry, sizeof(*pRegistry));
+      return;
+    }
+    pDimm = DIMM_FROM_NODE(pNode);
+    pRegistry->pByIndex[pRegistry->DimmCount++] = pDimm;
+    DimmRegistryInsert(pRegistry->pByPid, pDimm->DimmID, pDimm);
+    DimmRegistryInsert(pRegistry->pByHandle, pDimm->DeviceHandle.AsUint32, pDimm);
+    DimmRegistryInsert(pRegistry->pBySerial, pDimm->SerialNumber, pDimm);
+    DimmRegistryInsert(pRegistry->pByUid, DimmUidKey(pDimm), pDimm);
+  }
+  pRegistry->Valid = TRUE;
+}
+
+/**
+  Get the registry indexing a DIMM list
+
+  @param[in] pDimms The head of the dimm list
+
+  @retval The registry, NULL if the list is not indexed
+**/
+STATIC
+DIMM_REGISTRY *
+GetDimmRegistry(
+  IN     LIST_ENTRY *pDimms
+  )
+{
+  if (gNvmDimmData == NULL || pDimms != &gNvmDimmData->PMEMDev.Dimms ||
+      !gNvmDimmData->PMEMDev.DimmRegistry.Valid) {
+    return NULL;
+  }
+  return &gNvmDimmData->PMEMDev.DimmRegistry;
+}
 
 /**
   Get dimm by Dimm ID
-  Scan the dimm list for a dimm identified by Dimm ID
+  Look the dimm identified by Dimm ID up in the registry, or scan the
+  dimm list when it isn't indexed
 
   @param[in] DimmID: The SMBIOS Type 17 handle of the dimm
   @param[in] pDimms: The head of the dimm list
@@ -186,8 +388,21 @@ GetDimmByPid(
   DIMM *pCurDimm = NULL;
   DIMM *pTargetDimm = NULL;
   LIST_ENTRY *pCurDimmNode = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  UINT32 Slot = 0;
 
   NVDIMM_ENTRY();
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL) {
+    for (Slot = DimmRegistryHash(DimmID); pRegistry->pByPid[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      if (DimmID == pRegistry->pByPid[Slot]->DimmID) {
+        pTargetDimm = pRegistry->pByPid[Slot];
+        break;
+      }
+    }
+    goto Finish;
+  }
+
   for (pCurDimmNode = GetFirstNode(pDimms);
       !IsNull(pDimms, pCurDimmNode);
       pCurDimmNode = GetNextNode(pDimms, pCurDimmNode)) {
@@ -200,6 +415,7 @@ GetDimmByPid(
     }
   }
 
+Finish:
   NVDIMM_EXIT();
   return pTargetDimm;
 }
@@ -223,7 +439,20 @@ GetDimmByHandle(
   DIMM *pCurDimm = NULL;
   DIMM *pTargetDimm = NULL;
   LIST_ENTRY *pCurDimmNode = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  UINT32 Slot = 0;
   NVDIMM_ENTRY();
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL) {
+    for (Slot = DimmRegistryHash(DeviceHandle); pRegistry->pByHandle[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      if (DeviceHandle == pRegistry->pByHandle[Slot]->DeviceHandle.AsUint32) {
+        pTargetDimm = pRegistry->pByHandle[Slot];
+        break;
+      }
+    }
+    goto Finish;
+  }
+
   for (pCurDimmNode = GetFirstNode(pDimms);
       !IsNull(pDimms, pCurDimmNode);
       pCurDimmNode = GetNextNode(pDimms, pCurDimmNode)) {
@@ -235,6 +464,7 @@ GetDimmByHandle(
       break;
     }
   }
+Finish:
   NVDIMM_EXIT();
   return pTargetDimm;
 }
@@ -256,9 +486,22 @@ GetDimmBySerialNumber(
   DIMM *pCurDimm = NULL;
   DIMM *pTargetDimm = NULL;
   LIST_ENTRY *pCurDimmNode = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  UINT32 Slot = 0;
 
   NVDIMM_ENTRY();
 
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL) {
+    for (Slot = DimmRegistryHash(SerialNumber); pRegistry->pBySerial[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      if (pRegistry->pBySerial[Slot]->SerialNumber == SerialNumber) {
+        pTargetDimm = pRegistry->pBySerial[Slot];
+        break;
+      }
+    }
+    goto Finish;
+  }
+
   LIST_FOR_EACH(pCurDimmNode, pDimms) {
     pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
 
@@ -268,10 +511,26 @@ GetDimmBySerialNumber(
     }
   }
 
+Finish:
   NVDIMM_EXIT();
   return pTargetDimm;
 }
 
+/**
+  Tell whether a DIMM is the one described by a unique identifier structure
+**/
+STATIC
+BOOLEAN
+IsDimmUniqueIdentifierMatch(
+  IN     DIMM *pDimm,
+  IN     DIMM_UNIQUE_IDENTIFIER *pDimmUniqueId
+  )
+{
+  return (pDimm->VendorId == pDimmUniqueId->ManufacturerId) && (pDimm->SerialNumber == pDimmUniqueId->SerialNumber) &&
+      (pDimm->ManufacturingInfoValid ? ((pDimm->ManufacturingLocation == pDimmUniqueId->ManufacturingLocation) &&
+                                        (pDimm->ManufacturingDate == pDimmUniqueId->ManufacturingDate)): TRUE);
+}
+
 /**
   Get dimm by its unique identifier structure
   Scan the dimm list for a dimm identified by its
@@ -292,20 +551,33 @@ GetDimmByUniqueIdentifier(
   DIMM *pCurDimm = NULL;
   DIMM *pTargetDimm = NULL;
   LIST_ENTRY *pCurDimmNode = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  UINT32 Slot = 0;
 
   NVDIMM_ENTRY();
 
+  // The serial number is always compared, the DIMMs sharing one are few
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL) {
+    for (Slot = DimmRegistryHash(DimmUniqueId.SerialNumber); pRegistry->pBySerial[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      if (IsDimmUniqueIdentifierMatch(pRegistry->pBySerial[Slot], &DimmUniqueId)) {
+        pTargetDimm = pRegistry->pBySerial[Slot];
+        break;
+      }
+    }
+    goto Finish;
+  }
+
   LIST_FOR_EACH(pCurDimmNode, pDimms) {
     pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
 
-    if ((pCurDimm->VendorId == DimmUniqueId.ManufacturerId) && (pCurDimm->SerialNumber == DimmUniqueId.SerialNumber) &&
-        (pCurDimm->ManufacturingInfoValid ? ((pCurDimm->ManufacturingLocation == DimmUniqueId.ManufacturingLocation) &&
-                                             (pCurDimm->ManufacturingDate == DimmUniqueId.ManufacturingDate)): TRUE)) {
+    if (IsDimmUniqueIdentifierMatch(pCurDimm, &DimmUniqueId)) {
       pTargetDimm = pCurDimm;
       break;
     }
   }
 
+Finish:
   NVDIMM_EXIT();
   return pTargetDimm;
 }
@@ -331,6 +603,13 @@ GetDimmByIndex(
 
   NVDIMM_ENTRY();
 
+  if (pDev->DimmRegistry.Valid) {
+    if (DimmIndex >= 0 && (UINT32)DimmIndex < pDev->DimmRegistry.DimmCount) {
+      pTargetDimm = pDev->DimmRegistry.pByIndex[DimmIndex];
+    }
+    goto Finish;
+  }
+
   for (pCurDimmNode = GetFirstNode(&pDev->Dimms);
       !IsNull(&pDev->Dimms, pCurDimmNode);
       pCurDimmNode = GetNextNode(&pDev->Dimms, pCurDimmNode)) {
@@ -342,117 +621,371 @@ GetDimmByIndex(
     Index++;
   }
 
+Finish:
   NVDIMM_EXIT();
   return pTargetDimm;
 }
 
 /**
+  Find the next DIMM having the same NVDIMM UID as a given DIMM
 
-  Get max Dimm ID
-  Scan the dimm list for a max Dimm ID
-
-  @param[in] pDimms: The head of the dimm list
+  @param[in] pDimm The DIMM to find a duplicate of
+  @param[in] pPrevious The duplicate found by the previous call, NULL to start
 
-  @retval Max Dimm ID or 0 if not found
+  @retval DIMM struct pointer of the next duplicate
+  @retval NULL pointer if there are no more
 **/
-UINT16
-GetMaxPid(
-  IN     LIST_ENTRY *pDimms
+DIMM *
+GetNextDimmWithSameUid(
+  IN     DIMM *pDimm,
+  IN     DIMM *pPrevious OPTIONAL
   )
 {
-  UINT16 MaxPid = 0;
   DIMM *pCurDimm = NULL;
+  DIMM *pTargetDimm = NULL;
   LIST_ENTRY *pCurDimmNode = NULL;
+  LIST_ENTRY *pDimms = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  BOOLEAN PreviousPassed = (pPrevious == NULL);
+  UINT32 Slot = 0;
 
   NVDIMM_ENTRY();
 
-  if (pDimms == NULL) {
+  if (pDimm == NULL || gNvmDimmData == NULL) {
+    goto Finish;
+  }
+  pDimms = &gNvmDimmData->PMEMDev.Dimms;
+
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL) {
+    for (Slot = DimmRegistryHash(DimmUidKey(pDimm)); pRegistry->pByUid[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      pCurDimm = pRegistry->pByUid[Slot];
+      if (!PreviousPassed) {
+        PreviousPassed = (pCurDimm == pPrevious);
+        continue;
+      }
+      if (pCurDimm != pDimm && IsSameDimmUid(pDimm, pCurDimm)) {
+        pTargetDimm = pCurDimm;
+        break;
+      }
+    }
     goto Finish;
   }
 
   LIST_FOR_EACH(pCurDimmNode, pDimms) {
     pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
-    if (pCurDimm->DimmID > MaxPid) {
-      MaxPid = pCurDimm->DimmID;
+    if (!PreviousPassed) {
+      PreviousPassed = (pCurDimm == pPrevious);
+      continue;
+    }
+    if (pCurDimm != pDimm && IsSameDimmUid(pDimm, pCurDimm)) {
+      pTargetDimm = pCurDimm;
+      break;
     }
   }
 
 Finish:
   NVDIMM_EXIT();
-  return MaxPid;
+  return pTargetDimm;
 }
 
 /**
-  Print memory map list. Use for debug purposes only
+  Parse a fixed width field of lower case hexadecimal digits, as GetDimmUid
+  prints them
 
-  @param[in] pMemmap: List head containing memmap range items
+  @param[in] pString The field
+  @param[in] Digits The number of digits of the field
+  @param[out] pValue The value of the field
+
+  @retval TRUE if the field has the expected format
 **/
-VOID
-PrintDimmMemmap(
-  IN     LIST_ENTRY *pMemmap
+STATIC
+BOOLEAN
+ParseUidField(
+  IN     CONST CHAR16 *pString,
+  IN     UINT32 Digits,
+     OUT UINT32 *pValue
   )
 {
-  LIST_ENTRY *pNode = NULL;
-  MEMMAP_RANGE *pRange = NULL;
-  UINT16 Index = 0;
-
-  NVDIMM_ENTRY();
+  UINT32 Index = 0;
 
-  if (pMemmap == NULL) {
-    return;
+  *pValue = 0;
+  for (Index = 0; Index < Digits; Index++) {
+    if (pString[Index] >= L'0' && pString[Index] <= L'9') {
+      *pValue = (*pValue << 4) | (pString[Index] - L'0');
+    } else if (pString[Index] >= L'a' && pString[Index] <= L'f') {
+      *pValue = (*pValue << 4) | (pString[Index] - L'a' + 10);
+    } else {
+      return FALSE;
+    }
   }
+  return TRUE;
+}
 
-  NVDIMM_DBG("DIMM Memmap:");
+/**
+  Parse an NVDIMM UID string into the DIMM fields GetDimmUid formats it from.
+  The manufacturing location and date are only printed when
+  ManufacturingInfoValid is TRUE.
 
-  //display the memmap
-  LIST_FOR_EACH(pNode, pMemmap) {
-    pRange = MEMMAP_RANGE_FROM_NODE(pNode);
-    Index++;
-    NVDIMM_DBG("#%d %12llx - %12llx (%12llx) ", Index,
-        pRange->RangeStartDpa,
-        pRange->RangeStartDpa + pRange->RangeLength - 1,
-        pRange->RangeLength);
-    switch (pRange->RangeType) {
-    case MEMMAP_RANGE_VOLATILE:
-      NVDIMM_DBG("VOLATILE\n");
-      break;
-    case MEMMAP_RANGE_RESERVED:
-      NVDIMM_DBG("RESERVED\n");
-      break;
-    case MEMMAP_RANGE_PERSISTENT:
-      NVDIMM_DBG("PERSISTENT\n");
-      break;
-    case MEMMAP_RANGE_IS:
-      NVDIMM_DBG("INTERLEAVE SET\n");
-      break;
-    case MEMMAP_RANGE_IS_NOT_INTERLEAVED:
-      NVDIMM_DBG("IS_NOT_INTERLEAVED\n");
-      break;
-    case MEMMAP_RANGE_APPDIRECT_NAMESPACE:
-      NVDIMM_DBG("APPDIRECT NAMESPACE\n");
-      break;
-    case MEMMAP_RANGE_LAST_USABLE_DPA:
-      NVDIMM_DBG("LAST USABLE DPA\n");
-      break;
-    case MEMMAP_RANGE_FREE:
-      NVDIMM_DBG("FREE\n");
-      break;
-    default:
-      NVDIMM_DBG("UNKNOWN\n");
-      break;
+  @param[in] pDimmUid The UID string
+  @param[out] pUniqueId The fields of the UID, ManufacturerId is the VendorId
+  @param[out] pManufacturingInfo Set if the UID has the manufacturing fields
+
+  @retval TRUE if the string is a valid UID
+**/
+STATIC
+BOOLEAN
+ParseDimmUid(
+  IN     CONST CHAR16 *pDimmUid,
+     OUT DIMM_UNIQUE_IDENTIFIER *pUniqueId,
+     OUT BOOLEAN *pManufacturingInfo
+  )
+{
+  UINT32 VendorId = 0;
+  UINT32 Location = 0;
+  UINT32 Date = 0;
+  UINT32 Serial = 0;
+  UINTN Length = StrLen(pDimmUid);
+
+  ZeroMem(pUniqueId, sizeof(*pUniqueId));
+  // vvvv-ll-dddd-ssssssss or vvvv-ssssssss
+  if (Length == 21) {
+    if (!ParseUidField(pDimmUid, 4, &VendorId) || pDimmUid[4] != L'-' ||
+        !ParseUidField(pDimmUid + 5, 2, &Location) || pDimmUid[7] != L'-' ||
+        !ParseUidField(pDimmUid + 8, 4, &Date) || pDimmUid[12] != L'-' ||
+        !ParseUidField(pDimmUid + 13, 8, &Serial)) {
+      return FALSE;
     }
+    *pManufacturingInfo = TRUE;
+  } else if (Length == 13) {
+    if (!ParseUidField(pDimmUid, 4, &VendorId) || pDimmUid[4] != L'-' ||
+        !ParseUidField(pDimmUid + 5, 8, &Serial)) {
+      return FALSE;
+    }
+    *pManufacturingInfo = FALSE;
+  } else {
+    return FALSE;
   }
 
-  NVDIMM_EXIT();
+  pUniqueId->ManufacturerId = EndianSwapUint16((UINT16)VendorId);
+  pUniqueId->ManufacturingLocation = (UINT8)Location;
+  pUniqueId->ManufacturingDate = EndianSwapUint16((UINT16)Date);
+  pUniqueId->SerialNumber = EndianSwapUint32(Serial);
+  return TRUE;
 }
 
-VOID
-ShowDimmMemmap(
-  IN     DIMM *pDimm
+/**
+  Tell whether GetDimmUid formats the UID of a DIMM into the parsed string
+
+  @param[in] pDimm The DIMM
+  @param[in] pUniqueId The parsed UID, NULL for the empty string
+  @param[in] ManufacturingInfo The parsed UID has the manufacturing fields
+**/
+STATIC
+BOOLEAN
+IsDimmUidMatch(
+  IN     DIMM *pDimm,
+  IN     DIMM_UNIQUE_IDENTIFIER *pUniqueId OPTIONAL,
+  IN     BOOLEAN ManufacturingInfo
   )
 {
-  LIST_ENTRY *pMemmapList = NULL;
-
+  if (pUniqueId == NULL) {
+    return !IsDimmUidValid(pDimm);
+  }
+  if (!IsDimmUidValid(pDimm) || (pDimm->ManufacturingInfoValid == TRUE) != ManufacturingInfo) {
+    return FALSE;
+  }
+  return pDimm->VendorId == pUniqueId->ManufacturerId && pDimm->SerialNumber == pUniqueId->SerialNumber &&
+      (!ManufacturingInfo || (pDimm->ManufacturingLocation == pUniqueId->ManufacturingLocation &&
+                              pDimm->ManufacturingDate == pUniqueId->ManufacturingDate));
+}
+
+/**
+  Find the next DIMM having a given NVDIMM UID string
+  The string is parsed once and compared to the DIMM fields, a UID with the
+  manufacturing fields is looked up in the registry.
+
+  @param[in] pDimms The head of the dimm list
+  @param[in] pDimmUid The UID, as GetDimmUid formats it
+  @param[in] pPrevious The DIMM found by the previous call, NULL to start
+
+  @retval DIMM struct pointer of the next DIMM having the UID
+  @retval NULL pointer if there are no more
+**/
+DIMM *
+GetNextDimmByUid(
+  IN     LIST_ENTRY *pDimms,
+  IN     CONST CHAR16 *pDimmUid,
+  IN     DIMM *pPrevious OPTIONAL
+  )
+{
+  DIMM *pCurDimm = NULL;
+  DIMM *pTargetDimm = NULL;
+  LIST_ENTRY *pCurDimmNode = NULL;
+  DIMM_REGISTRY *pRegistry = NULL;
+  DIMM_UNIQUE_IDENTIFIER UniqueId;
+  DIMM_UNIQUE_IDENTIFIER *pUniqueId = NULL;
+  BOOLEAN ManufacturingInfo = FALSE;
+  BOOLEAN PreviousPassed = (pPrevious == NULL);
+  UINT32 Key = 0;
+  UINT32 Slot = 0;
+
+  NVDIMM_ENTRY();
+
+  if (pDimms == NULL || pDimmUid == NULL) {
+    goto Finish;
+  }
+  // GetDimmUid returns an empty string for the DIMMs without a valid UID
+  if (pDimmUid[0] != L'\0') {
+    if (!ParseDimmUid(pDimmUid, &UniqueId, &ManufacturingInfo)) {
+      goto Finish;
+    }
+    pUniqueId = &UniqueId;
+    Key = UidKey(UniqueId.ManufacturerId, UniqueId.ManufacturingLocation,
+        UniqueId.ManufacturingDate, UniqueId.SerialNumber);
+  }
+
+  // The key of a UID without the manufacturing fields is not known
+  pRegistry = GetDimmRegistry(pDimms);
+  if (pRegistry != NULL && (pUniqueId == NULL || ManufacturingInfo)) {
+    for (Slot = DimmRegistryHash(Key); pRegistry->pByUid[Slot] != NULL; Slot = DIMM_REGISTRY_NEXT(Slot)) {
+      pCurDimm = pRegistry->pByUid[Slot];
+      if (!PreviousPassed) {
+        PreviousPassed = (pCurDimm == pPrevious);
+        continue;
+      }
+      if (IsDimmUidMatch(pCurDimm, pUniqueId, ManufacturingInfo)) {
+        pTargetDimm = pCurDimm;
+        break;
+      }
+    }
+    goto Finish;
+  }
+
+  LIST_FOR_EACH(pCurDimmNode, pDimms) {
+    pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
+    if (!PreviousPassed) {
+      PreviousPassed = (pCurDimm == pPrevious);
+      continue;
+    }
+    if (IsDimmUidMatch(pCurDimm, pUniqueId, ManufacturingInfo)) {
+      pTargetDimm = pCurDimm;
+      break;
+    }
+  }
+
+Finish:
+  NVDIMM_EXIT();
+  return pTargetDimm;
+}
+
+/**
+
+  Get max Dimm ID
+  Scan the dimm list for a max Dimm ID
+
+  @param[in] pDimms: The head of the dimm list
+
+  @retval Max Dimm ID or 0 if not found
+**/
+UINT16
+GetMaxPid(
+  IN     LIST_ENTRY *pDimms
+  )
+{
+  UINT16 MaxPid = 0;
+  DIMM *pCurDimm = NULL;
+  LIST_ENTRY *pCurDimmNode = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pDimms == NULL) {
+    goto Finish;
+  }
+
+  LIST_FOR_EACH(pCurDimmNode, pDimms) {
+    pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
+    if (pCurDimm->DimmID > MaxPid) {
+      MaxPid = pCurDimm->DimmID;
+    }
+  }
+
+Finish:
+  NVDIMM_EXIT();
+  return MaxPid;
+}
+
+/**
+  Print memory map list. Use for debug purposes only
+
+  @param[in] pMemmap: List head containing memmap range items
+**/
+VOID
+PrintDimmMemmap(
+  IN     LIST_ENTRY *pMemmap
+  )
+{
+  LIST_ENTRY *pNode = NULL;
+  MEMMAP_RANGE *pRange = NULL;
+  UINT16 Index = 0;
+
+  NVDIMM_ENTRY();
+
+  if (pMemmap == NULL) {
+    return;
+  }
+
+  NVDIMM_DBG("DIMM Memmap:");
+
+  //display the memmap
+  LIST_FOR_EACH(pNode, pMemmap) {
+    pRange = MEMMAP_RANGE_FROM_NODE(pNode);
+    Index++;
+    NVDIMM_DBG("#%d %12llx - %12llx (%12llx) ", Index,
+        pRange->RangeStartDpa,
+        pRange->RangeStartDpa + pRange->RangeLength - 1,
+        pRange->RangeLength);
+    switch (pRange->RangeType) {
+    case MEMMAP_RANGE_VOLATILE:
+      NVDIMM_DBG("VOLATILE\n");
+      break;
+    case MEMMAP_RANGE_RESERVED:
+      NVDIMM_DBG("RESERVED\n");
+      break;
+    case MEMMAP_RANGE_PERSISTENT:
+      NVDIMM_DBG("PERSISTENT\n");
+      break;
+    case MEMMAP_RANGE_IS:
+      NVDIMM_DBG("INTERLEAVE SET\n");
+      break;
+    case MEMMAP_RANGE_IS_NOT_INTERLEAVED:
+      NVDIMM_DBG("IS_NOT_INTERLEAVED\n");
+      break;
+    case MEMMAP_RANGE_APPDIRECT_NAMESPACE:
+      NVDIMM_DBG("APPDIRECT NAMESPACE\n");
+      break;
+    case MEMMAP_RANGE_LAST_USABLE_DPA:
+      NVDIMM_DBG("LAST USABLE DPA\n");
+      break;
+    case MEMMAP_RANGE_FREE:
+      NVDIMM_DBG("FREE\n");
+      break;
+    default:
+      NVDIMM_DBG("UNKNOWN\n");
+      break;
+    }
+  }
+
+  NVDIMM_EXIT();
+}
+
+VOID
+ShowDimmMemmap(
+  IN     DIMM *pDimm
+  )
+{
+  LIST_ENTRY *pMemmapList = NULL;
+
   NVDIMM_ENTRY();
 
   if (pDimm == NULL) {
@@ -1068,6 +1601,7 @@ RemoveDimmInventory(
   EFI_STATUS TmpReturnCode = EFI_SUCCESS;
 
   NVDIMM_ENTRY();
+  ZeroMem(&pDev->DimmRegistry, sizeof(pDev->DimmRegistry));
   for (pCurDimmNode = GetFirstNode(&pDev->Dimms);
       !IsNull(&pDev->Dimms, pCurDimmNode) && pCurDimmNode != NULL;
       pCurDimmNode = pTempDimmNode) {
@@ -1181,6 +1715,49 @@ PopulateSmbusFields(
   ReturnCode = EFI_SUCCESS;
   return ReturnCode;
 }
+/**
+  Parameters shared by the InitializeDimmWork items of one inventory pass
+**/
+typedef struct _DIMM_INVENTORY_INIT {
+  ParsedFitHeader *pFitHead;
+  ParsedPmttHeader *pPmttHead;
+  UINT16 *pPids;                  //!< SMBIOS ID of every dispatched DIMM, by dispatch index
+} DIMM_INVENTORY_INIT;
+
+/**
+  DispatchPerDimm work item initializing one DIMM of the inventory
+
+  @param[in] pDimm The DIMM to initialize
+  @param[in] Index Position of pDimm in the dispatched list
+  @param[in] pContext Pointer to the DIMM_INVENTORY_INIT of the pass
+
+  @retval EFI_SUCCESS always, a DIMM failing to initialize is marked non-functional
+**/
+STATIC
+EFI_STATUS
+InitializeDimmWork(
+  IN     DIMM *pDimm,
+  IN     UINT32 Index,
+  IN     VOID *pContext
+  )
+{
+  DIMM_INVENTORY_INIT *pInit = (DIMM_INVENTORY_INIT *)pContext;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+#ifdef OS_BUILD
+  // Only the NFIT part here, the FW is asked once the DIMM is used
+  ReturnCode = InitializeDimmFromNfit(pDimm, pInit->pFitHead, pInit->pPmttHead, pInit->pPids[Index]);
+#else
+  ReturnCode = InitializeDimm(pDimm, pInit->pFitHead, pInit->pPmttHead, pInit->pPids[Index]);
+#endif
+  if (EFI_ERROR(ReturnCode)) {
+    // If a dimm fails to initialize for any reason, it is also non-functional
+    // for right now
+    pDimm->NonFunctional = TRUE;
+  }
+  return EFI_SUCCESS;
+}
+
 /**
   Creates the DIMM inventory
   Using the Firmware Interface Table, create an in memory representation
@@ -1203,7 +1780,13 @@ InitializeDimmInventory(
   ParsedPmttHeader *pPmttHead = NULL;
   NvDimmRegionMappingStructure **ppNvDimmRegionMappingStructures = NULL;
   DIMM *pNewDimm = NULL;
+  DIMM **ppNewDimms = NULL;
+  DIMM_INVENTORY_INIT Init;
+  UINT32 NewDimmsNum = 0;
   UINT32 Index = 0;
+  UINT32 Index2 = 0;
+
+  ZeroMem(&Init, sizeof(Init));
 
   NVDIMM_ENTRY();
   if (pDev == NULL || pDev->pFitHead == NULL || pDev->pFitHead->ppNvDimmRegionMappingStructures == NULL) {
@@ -1213,10 +1796,20 @@ InitializeDimmInventory(
 #ifndef OS_BUILD
   InitializeCpuCommands();
 #endif
+  // New DIMMs get their IDs once initialized, scan the list until then
+  pDev->DimmRegistry.Valid = FALSE;
   pFitHead = pDev->pFitHead;
   pPmttHead = pDev->pPmttHead;
   ppNvDimmRegionMappingStructures = pFitHead->ppNvDimmRegionMappingStructures;
 
+  if (pFitHead->NvDimmRegionMappingStructuresNum == 0) {
+    goto Finish;
+  }
+  CHECK_RESULT_MALLOC(ppNewDimms, AllocateZeroPool(sizeof(*ppNewDimms) * pFitHead->NvDimmRegionMappingStructuresNum), Finish);
+  CHECK_RESULT_MALLOC(Init.pPids, AllocateZeroPool(sizeof(*Init.pPids) * pFitHead->NvDimmRegionMappingStructuresNum), Finish);
+  Init.pFitHead = pFitHead;
+  Init.pPmttHead = pPmttHead;
+
   // Iterate over Region Mapping Structures (can be several per NVDIMM)
   // because they provide the NVDIMM physical ID, which is assigned by BIOS
   // and unique per boot. Could also use NFIT device handle.
@@ -1228,9 +1821,22 @@ InitializeDimmInventory(
       // The associated NVDIMM physical ID is already in the dimms list, skip it
       continue;
     }
+    // New DIMMs get their IDs once initialized, check the ones collected so far by PID
+    for (Index2 = 0; Index2 < NewDimmsNum; Index2++) {
+      if (Init.pPids[Index2] == ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId) {
+        break;
+      }
+    }
+    if (Index2 < NewDimmsNum) {
+      continue;
+    }
 
     // Create a new dimm struct for every NVDIMM, functional or not
-    CHECK_RESULT_MALLOC(pNewDimm,(DIMM *) AllocateZeroPool(sizeof(*pNewDimm)), Finish);
+    CHECK_RESULT_MALLOC(pNewDimm,(DIMM *) AllocateZeroPool(sizeof(*pNewDimm)), InitializeNewDimms);
+#ifdef OS_BUILD
+    pNewDimm->pPassThruLock = os_mutex_init(NULL);
+    pNewDimm->pApiLock = os_mutex_init(NULL);
+#endif
 
     // Assume dimm is functional
     pNewDimm->NonFunctional = FALSE;
@@ -1239,22 +1845,32 @@ InitializeDimmInventory(
     CHECK_RESULT_CONTINUE(PopulateSmbusFields(pNewDimm));
 
     // Insert into dimms list. We're only inserting a pointer so we can
-    // continue editing the dimm struct
+    // continue editing the dimm struct. The list keeps NFIT order no matter
+    // in which order the DIMMs finish initializing.
     InsertTailList(&pDev->Dimms, &pNewDimm->DimmNode);
 
-    CHECK_RESULT(InitializeDimm(pNewDimm, pFitHead, pPmttHead,
-        ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId), ErrorInitializeDimm);
+    ppNewDimms[NewDimmsNum] = pNewDimm;
+    Init.pPids[NewDimmsNum] = ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId;
+    NewDimmsNum++;
+  }
 
-    continue;
+  ReturnCode = EFI_SUCCESS;
 
-ErrorInitializeDimm:
-    // If a dimm fails to initialize for any reason, it is also non-functional
-    // for right now
-    pNewDimm->NonFunctional = TRUE;
+InitializeNewDimms:
+#ifdef OS_BUILD
+  // Only NFIT stubs are built here, nothing worth dispatching
+  for (Index = 0; Index < NewDimmsNum; Index++) {
+    InitializeDimmWork(ppNewDimms[Index], Index, &Init);
   }
+#else
+  // Talking to the DIMMs dominates, do it for all of them at once
+  DispatchPerDimm(ppNewDimms, NewDimmsNum, InitializeDimmWork, &Init, NULL);
+#endif
 
-  ReturnCode = EFI_SUCCESS;
 Finish:
+  RebuildDimmRegistry(pDev);
+  FREE_POOL_SAFE(ppNewDimms);
+  FREE_POOL_SAFE(Init.pPids);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1287,7 +1903,7 @@ FwCmdGetViralPolicy(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -1310,7 +1926,7 @@ FwCmdGetViralPolicy(
   CopyMem_S(pViralPolicyPayload, sizeof(*pViralPolicyPayload), pFwCmd->OutPayload, sizeof(*pViralPolicyPayload));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1334,7 +1950,7 @@ FwCmdGetOptionalConfigurationDataPolicy(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1358,7 +1974,7 @@ FwCmdGetOptionalConfigurationDataPolicy(
   pOptionalDataPolicyPayload->FisMinor = pDimm->FwVer.FwApiMinor;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1382,7 +1998,7 @@ FwCmdSetOptionalConfigurationDataPolicy(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -1405,7 +2021,7 @@ FwCmdSetOptionalConfigurationDataPolicy(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1432,7 +2048,7 @@ FwCmdGetSecurityInfo(
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
   NVDIMM_ENTRY();
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -1454,7 +2070,7 @@ FwCmdGetSecurityInfo(
   CopyMem_S(pSecurityPayload, sizeof(*pSecurityPayload), pFwCmd->OutPayload, sizeof(*pSecurityPayload));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1525,7 +2141,7 @@ FwCmdGetSecurityOptIn(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -1559,7 +2175,7 @@ FwCmdGetSecurityOptIn(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1590,7 +2206,7 @@ FwCmdDisableARS(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1617,7 +2233,7 @@ FwCmdDisableARS(
   NVDIMM_DBG("Finished polling long op, return val = %x", ReturnCode);
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1700,7 +2316,7 @@ FwCmdGetARS(
 
   *pDimmARSStatus = LONG_OP_STATUS_UNKNOWN;
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1726,7 +2342,7 @@ FwCmdGetARS(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1757,7 +2373,7 @@ FwCmdDeviceCharacteristics (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1790,7 +2406,7 @@ Finish:
   if (EFI_ERROR(ReturnCode) && (NULL != ppPayload)) {
     FREE_POOL_SAFE(*ppPayload);
   }
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1821,7 +2437,7 @@ FwCmdGetDimmPartitionInfo(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1842,7 +2458,7 @@ FwCmdGetDimmPartitionInfo(
   CopyMem_S(pPayload, sizeof(*pPayload), pFwCmd->OutPayload, sizeof(*pPayload));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -1928,7 +2544,7 @@ FwGetPCDFromOffsetSmallPayload(
     }
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -1960,7 +2576,7 @@ FwGetPCDFromOffsetSmallPayload(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   return ReturnCode;
 }
 /**
@@ -2002,7 +2618,7 @@ FwCmdGetPcdLargePayload(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2037,7 +2653,7 @@ FwCmdGetPcdLargePayload(
   CopyMem_S(*ppRawData, PCD_PARTITION_SIZE, pFwCmd->LargeOutputPayload, PCD_PARTITION_SIZE);
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2125,7 +2741,7 @@ FwCmdGetPlatformConfigData(
     }
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2226,7 +2842,7 @@ FwCmdGetPlatformConfigData(
     CopyMem_S(*ppRawData, PcdSize, pFwCmd->LargeOutputPayload, PcdSize);
   }
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   FREE_POOL_SAFE(pBuffer);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -2265,7 +2881,7 @@ FwCmdGetPlatformConfigDataSize (
   ZeroMem(&InputPayload, sizeof(InputPayload));
   ZeroMem(&OutputPcdSize, sizeof(OutputPcdSize));
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2296,7 +2912,7 @@ FwCmdGetPlatformConfigDataSize (
   *pPcdSize = OutputPcdSize.Size;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2463,7 +3079,7 @@ FwCmdGetPcdSmallPayload(
   if (gPCDCacheEnabled && pDimm->PcdOemPartitionSize == 0) {
     gPCDCacheEnabled = 0;
   }
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2496,7 +3112,7 @@ FwCmdGetPcdSmallPayload(
   CopyMem_S(pData, DataSize, pFwCmd->OutPayload, DataSize);
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2529,6 +3145,9 @@ GetPcdOemConfigDataUsingSmallPayload(
   UINT8 *pBuffer = NULL;
   UINT32 Offset = 0;
   UINT8 TmpBuf[PCD_GET_SMALL_PAYLOAD_DATA_SIZE];
+#ifdef OS_BUILD
+  BOOLEAN Locked = FALSE;
+#endif
   NVDIMM_ENTRY();
 
   if (pDimm == NULL || ppRawData == NULL || pRawDataSize == NULL) {
@@ -2536,6 +3155,14 @@ GetPcdOemConfigDataUsingSmallPayload(
     goto Finish;
   }
 
+#ifdef OS_BUILD
+  // API calls on other DIMMs run concurrently, the cache of this one is
+  // read, filled and cleared under its (recursive) FW command lock
+  if (pDimm->pPassThruLock != NULL) {
+    Locked = (os_mutex_lock(pDimm->pPassThruLock) != 0);
+  }
+#endif
+
 // Disable the cache when media is disabled or when the fw is busy
   if (gPCDCacheEnabled && pDimm->PcdOemPartitionSize == 0) {
     gPCDCacheEnabled = 0;
@@ -2622,6 +3249,11 @@ GetPcdOemConfigDataUsingSmallPayload(
   *pRawDataSize = OemDataSize;
 
 Finish:
+#ifdef OS_BUILD
+  if (Locked) {
+    os_mutex_unlock(pDimm->pPassThruLock);
+  }
+#endif
   if (EFI_ERROR(ReturnCode)) {
     // If error, free the buffer
     FREE_POOL_SAFE(pBuffer);
@@ -2697,7 +3329,7 @@ FwSetPCDFromOffsetSmallPayload(
     }
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2728,7 +3360,7 @@ FwSetPCDFromOffsetSmallPayload(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   return ReturnCode;
 }
 
@@ -2817,7 +3449,7 @@ FwCmdSetPlatformConfigData (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2906,7 +3538,7 @@ FwCmdSetPlatformConfigData (
 
 Finish:
   FREE_POOL_SAFE(pPartition);
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   FREE_POOL_SAFE(pOEMPartitionData);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -2939,7 +3571,7 @@ FwCmdGetAlarmThresholds (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -2969,7 +3601,7 @@ FinishAfterPayloadAlloc:
     FREE_POOL_SAFE(*ppPayloadAlarmThresholds);
   }
 FinishAfterFwCmdAlloc:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3002,7 +3634,7 @@ FwCmdSetAlarmThresholds (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3022,7 +3654,7 @@ FwCmdSetAlarmThresholds (
   }
 
 FinishAfterFwCmdAlloc:
-  FreePool(pFwCmd);
+  FreeFwCmd(pFwCmd);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3070,7 +3702,7 @@ FwCmdUpdateFw(
     goto Finish;
   }
 
-  CHECK_RESULT_MALLOC(pFwCmd, AllocateZeroPool(sizeof(*pFwCmd)), Finish);
+  CHECK_RESULT_MALLOC(pFwCmd, AllocateFwCmd(), Finish);
 
   pFwCmd->Opcode = PtUpdateFw;       //!< Firmware update category
   pFwCmd->SubOpcode = SubopUpdateFw; //!< Execute the firmware image
@@ -3184,7 +3816,7 @@ Finish:
   if (NULL != pCommandStatus && NULL != pDimm) {
     ClearNvmStatus(GetObjectStatus(pCommandStatus, pDimm->DeviceHandle.AsUint32), NVM_OPERATION_IN_PROGRESS);
   }
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3217,7 +3849,7 @@ FwCmdGetFwDebugLogSize(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3242,7 +3874,7 @@ FwCmdGetFwDebugLogSize(
   *pLogSizeInMb = pDbgSmallOutPayload->LogSize;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3291,7 +3923,7 @@ FwCmdGetFwDebugLog (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3384,7 +4016,7 @@ FwCmdGetFwDebugLog (
 
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3425,7 +4057,7 @@ FwCmdGetErrorLog (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3455,7 +4087,7 @@ FwCmdGetErrorLog (
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3491,7 +4123,7 @@ FwCmdGetCommandEffectLogCount(
     goto Finish;
   }
 
-  CHECK_RESULT_MALLOC(pFwCmd, AllocateZeroPool(sizeof(*pFwCmd)), Finish);
+  CHECK_RESULT_MALLOC(pFwCmd, AllocateFwCmd(), Finish);
 
   // Get number of CEL entries
   InputPayload.PayloadType = SmallPayload;
@@ -3518,7 +4150,7 @@ FwCmdGetCommandEffectLogCount(
   *pCount = ((PT_OUTPUT_PAYLOAD_GET_CEL_COUNT *)(pFwCmd->OutPayload))->LogEntryCount;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3560,7 +4192,7 @@ FwCmdGetCommandEffectLog(
     goto Finish;
   }
 
-  CHECK_RESULT_MALLOC(pFwCmd, AllocateZeroPool(sizeof(*pFwCmd)), Finish);
+  CHECK_RESULT_MALLOC(pFwCmd, AllocateFwCmd(), Finish);
 
   // Get command effect log count. Not necessary for large payload, but keeping
   // for easy code and it's a cheap call
@@ -3622,7 +4254,7 @@ Finish:
   if (EFI_ERROR(ReturnCode) && ppLogEntry != NULL && *ppLogEntry != NULL) {
     FREE_POOL_SAFE(*ppLogEntry);
   }
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3654,7 +4286,7 @@ FwCmdGetSmartAndHealth (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3680,7 +4312,7 @@ FwCmdGetSmartAndHealth (
   CopyMem_S(*ppPayloadSmartAndHealth, sizeof(**ppPayloadSmartAndHealth), pFwCmd->OutPayload, sizeof(**ppPayloadSmartAndHealth));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3724,7 +4356,7 @@ FwCmdGetMemoryInfoPage (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3754,7 +4386,7 @@ FwCmdGetMemoryInfoPage (
   CopyMem_S(*ppPayloadMemoryInfoPage, PageSize, pFwCmd->OutPayload, pFwCmd->OutputPayloadSize);
 
 FinishAfterFwCmdAlloc:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3787,7 +4419,7 @@ FwCmdGetFirmwareImageInfo (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3813,7 +4445,7 @@ FwCmdGetFirmwareImageInfo (
   CopyMem_S(*ppPayloadFwImage, sizeof(**ppPayloadFwImage), pFwCmd->OutPayload, sizeof(**ppPayloadFwImage));
 
 FinishError:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3846,7 +4478,7 @@ FwCmdGetPowerManagementPolicy(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3880,7 +4512,7 @@ Finish:
   if (EFI_ERROR(ReturnCode) && (NULL != ppPayloadPowerManagementPolicy)) {
     FREE_POOL_SAFE(*ppPayloadPowerManagementPolicy);
   }
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3915,7 +4547,7 @@ FwCmdGetPMONRegisters(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3938,7 +4570,7 @@ FwCmdGetPMONRegisters(
   CopyMem_S(pPayloadPMONRegisters, sizeof(*pPayloadPMONRegisters), pFwCmd->OutPayload, sizeof(*pPayloadPMONRegisters));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3973,7 +4605,7 @@ FwCmdSetPMONRegisters(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -3993,7 +4625,7 @@ FwCmdSetPMONRegisters(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -4037,7 +4669,7 @@ FwCmdGetPackageSparingPolicy (
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -4058,7 +4690,7 @@ FwCmdGetPackageSparingPolicy (
   CopyMem_S(*ppPayloadPackageSparingPolicy, sizeof(**ppPayloadPackageSparingPolicy), pFwCmd->OutPayload, sizeof(**ppPayloadPackageSparingPolicy));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd)
+  FREE_FW_CMD_SAFE(pFwCmd)
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -4090,7 +4722,7 @@ FwCmdGetLongOperationStatus(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -4119,7 +4751,7 @@ FwCmdGetLongOperationStatus(
   ReturnCode = EFI_SUCCESS;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -5134,13 +5766,7 @@ ApertureWrite(
 
 #endif //OS_BUILD
 /**
-  Create DIMM
-  Perform all functions needed for DIMM initialization this includes:
-  setting up mailbox structure
-  retrieving and recording security status
-  retrieving and recording the FW version
-  retrieving and recording partition information
-  setting up block windows
+  Initialize the DIMM fields provided by the ACPI tables
 
   @param[in] pNewDimm: input dimm structure to populate
   @param[in] pFitHead: fully populated NVM Firmware Interface Table
@@ -5148,11 +5774,11 @@ ApertureWrite(
   @param[in] Pid: SMBIOS Dimm ID of the DIMM to create
 
   @retval EFI_SUCCESS          - Success
-  @retval EFI_OUT_OF_RESOURCES - AllocateZeroPool failure
-  @retval EFI_DEVICE_ERROR     - Other errors
+  @retval EFI_DEVICE_ERROR     - The NFIT doesn't fully describe the DIMM
 **/
+STATIC
 EFI_STATUS
-InitializeDimm (
+InitializeDimmFromNfit(
   IN     DIMM *pNewDimm,
   IN     ParsedFitHeader *pFitHead,
   IN     ParsedPmttHeader *pPmttHead,
@@ -5160,18 +5786,12 @@ InitializeDimm (
   )
 {
   EFI_STATUS ReturnCode = EFI_OUT_OF_RESOURCES;
-  EFI_STATUS TempReturnCode = EFI_SUCCESS;
   UINT32 Index = 0;
   InterleaveStruct *pMbITbl = NULL;
-  InterleaveStruct *pBwITbl = NULL;
   ControlRegionTbl *pControlRegTbl = NULL;
   FlushHintTbl *pFlushHintTable = NULL;
-  PT_ID_DIMM_PAYLOAD *pPayload = NULL;
-  PT_DIMM_PARTITION_INFO_PAYLOAD *pPartitionInfoPayload = NULL;
-  PT_GET_SECURITY_PAYLOAD *pDimmSecurityPayload = NULL;
   ControlRegionTbl *pControlRegTbls[MAX_IFC_NUM];
   UINT32 ControlRegTblsNum = MAX_IFC_NUM;
-  UINT32 PcdSize = 0;
 
   ZeroMem(pControlRegTbls, sizeof(pControlRegTbls));
 
@@ -5248,28 +5868,32 @@ InitializeDimm (
     }
   }
 
-  // Populate boot status bitmask based on DDRT/SMBUS interface status
-  CHECK_RESULT(PopulateDimmBootStatusBitmaskInterfaceBits(pNewDimm, &pNewDimm->BootStatusBitmask), Finish);
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
 
-  if (pNewDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY) {
-    /**
-      Setting as non-functional is not appropriate for only DDRT down, but
-      needed temporarily to not create new defects until future changes
-      are integrated. (lots of commands currently rely on this field for
-      filtering proper/improper dimms. We'll change this going forward and
-      hopefully remove the NonFunctional field!)
-    **/
-    pNewDimm->NonFunctional = TRUE;
-  }
+/**
+  Initialize the DIMM fields provided by the identify DIMM command,
+  including the running FW version
 
-  /**
-    Populate some more boot status bitmask bits from BSR
-    Retrieving BSR is optional since we do not want to skip further initialization
-  **/
-  TempReturnCode = FwCmdGetBsr(pNewDimm, &pNewDimm->Bsr.AsUint64);
-  if (TempReturnCode == EFI_SUCCESS) {
-    PopulateDimmBootStatusBitmaskBsrBits(pNewDimm, &pNewDimm->Bsr, &pNewDimm->BootStatusBitmask);
-  }
+  @param[in] pNewDimm: input dimm structure to populate
+
+  @retval EFI_SUCCESS          - Success
+  @retval EFI_OUT_OF_RESOURCES - AllocateZeroPool failure
+  @retval RETURN_DEVICE_ERROR  - The DIMM is unmanageable
+  @retval EFI_DEVICE_ERROR     - Other errors
+**/
+STATIC
+EFI_STATUS
+InitializeDimmIdentifyFromFw(
+  IN     DIMM *pNewDimm
+  )
+{
+  EFI_STATUS ReturnCode = EFI_OUT_OF_RESOURCES;
+  PT_ID_DIMM_PAYLOAD *pPayload = NULL;
+
+  NVDIMM_ENTRY();
 
   CHECK_RESULT_MALLOC(pPayload, AllocateZeroPool(sizeof(*pPayload)), Finish);
   CHECK_RESULT(FwCmdSmallPayload(pNewDimm, PtIdentifyDimm, SubopIdentify, NULL, 0, (UINT8 *)pPayload, sizeof(*pPayload)), Finish);
@@ -5298,6 +5922,34 @@ InitializeDimm (
     goto Finish;
   }
 
+Finish:
+  FREE_POOL_SAFE(pPayload);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Initialize the DIMM fields provided by the DIMM FW that don't change
+  until the next boot or FW update: partition info and PCD partition sizes
+
+  @param[in] pNewDimm: input dimm structure to populate
+
+  @retval EFI_SUCCESS          - Success
+  @retval EFI_OUT_OF_RESOURCES - AllocateZeroPool failure
+  @retval EFI_DEVICE_ERROR     - Other errors
+**/
+STATIC
+EFI_STATUS
+InitializeDimmPartitionFieldsFromFw(
+  IN     DIMM *pNewDimm
+  )
+{
+  EFI_STATUS ReturnCode = EFI_OUT_OF_RESOURCES;
+  PT_DIMM_PARTITION_INFO_PAYLOAD *pPartitionInfoPayload = NULL;
+  UINT32 PcdSize = 0;
+
+  NVDIMM_ENTRY();
+
   pPartitionInfoPayload = AllocateZeroPool(sizeof(*pPartitionInfoPayload));
   if (pPartitionInfoPayload == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -5324,25 +5976,6 @@ InitializeDimm (
     pNewDimm->PmStart = pPartitionInfoPayload->PersistentStart;
   }
 
-  ReturnCode = GetNvDimmRegionMappingStructureForPid(pFitHead, pNewDimm->DimmID,
-    &gSpaRangeBlockDataWindowRegionGuid, FALSE, 0, &pNewDimm->pBlockDataRegionMappingStructure);
-  if (EFI_ERROR(ReturnCode) || pNewDimm->pBlockDataRegionMappingStructure == NULL) {
-    NVDIMM_WARN("No NVDIMM region table found for block window on dimm: 0x%x.", pNewDimm->DeviceHandle.AsUint32);
-    ReturnCode = EFI_SUCCESS;
-  }
-  else {
-    if (pNewDimm->pBlockDataRegionMappingStructure->SpaRangeDescriptionTableIndex != 0) {
-      ReturnCode = GetSpaRangeTable(pFitHead,
-        pNewDimm->pBlockDataRegionMappingStructure->SpaRangeDescriptionTableIndex, &pNewDimm->pBlockDataSpaTbl);
-
-      if (EFI_ERROR(ReturnCode)) {
-        NVDIMM_WARN("No spa range table found for block aperture but the index exists.");
-        ReturnCode = EFI_DEVICE_ERROR;
-        goto Finish;
-      }
-    }
-  }
-
   ReturnCode = FwCmdGetPlatformConfigDataSize(pNewDimm, PCD_OEM_PARTITION_ID, &PcdSize);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_DBG("FW CMD Error: %d", ReturnCode);
@@ -5370,6 +6003,90 @@ InitializeDimm (
   }
   pNewDimm->PcdLsaPartitionSize = PcdSize;
 
+Finish:
+  FREE_POOL_SAFE(pPartitionInfoPayload);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Initialize the DIMM fields provided by the DIMM FW
+  The fields provided by the ACPI tables must already be initialized
+  In OS the partition fields come from the inventory cache when it has
+  them for the running FW version
+
+  @param[in] pNewDimm: input dimm structure to populate
+  @param[in] pFitHead: fully populated NVM Firmware Interface Table
+
+  @retval EFI_SUCCESS          - Success
+  @retval EFI_OUT_OF_RESOURCES - AllocateZeroPool failure
+  @retval EFI_DEVICE_ERROR     - Other errors
+**/
+STATIC
+EFI_STATUS
+InitializeDimmFromFw(
+  IN     DIMM *pNewDimm,
+  IN     ParsedFitHeader *pFitHead
+  )
+{
+  EFI_STATUS ReturnCode = EFI_OUT_OF_RESOURCES;
+  EFI_STATUS TempReturnCode = EFI_SUCCESS;
+  InterleaveStruct *pBwITbl = NULL;
+  PT_GET_SECURITY_PAYLOAD *pDimmSecurityPayload = NULL;
+  BOOLEAN FromCache = FALSE;
+
+  NVDIMM_ENTRY();
+
+  // Populate boot status bitmask based on DDRT/SMBUS interface status
+  CHECK_RESULT(PopulateDimmBootStatusBitmaskInterfaceBits(pNewDimm, &pNewDimm->BootStatusBitmask), Finish);
+
+  if (pNewDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY) {
+    /**
+      Setting as non-functional is not appropriate for only DDRT down, but
+      needed temporarily to not create new defects until future changes
+      are integrated. (lots of commands currently rely on this field for
+      filtering proper/improper dimms. We'll change this going forward and
+      hopefully remove the NonFunctional field!)
+    **/
+    pNewDimm->NonFunctional = TRUE;
+  }
+
+  /**
+    Populate some more boot status bitmask bits from BSR
+    Retrieving BSR is optional since we do not want to skip further initialization
+  **/
+  TempReturnCode = FwCmdGetBsr(pNewDimm, &pNewDimm->Bsr.AsUint64);
+  if (TempReturnCode == EFI_SUCCESS) {
+    PopulateDimmBootStatusBitmaskBsrBits(pNewDimm, &pNewDimm->Bsr, &pNewDimm->BootStatusBitmask);
+  }
+
+  CHECK_RESULT(InitializeDimmIdentifyFromFw(pNewDimm), Finish);
+#ifdef OS_BUILD
+  FromCache = inventory_cache_restore(pNewDimm);
+#endif
+  if (!FromCache) {
+    CHECK_RESULT(InitializeDimmPartitionFieldsFromFw(pNewDimm), Finish);
+  }
+
+  ReturnCode = GetNvDimmRegionMappingStructureForPid(pFitHead, pNewDimm->DimmID,
+    &gSpaRangeBlockDataWindowRegionGuid, FALSE, 0, &pNewDimm->pBlockDataRegionMappingStructure);
+  if (EFI_ERROR(ReturnCode) || pNewDimm->pBlockDataRegionMappingStructure == NULL) {
+    NVDIMM_WARN("No NVDIMM region table found for block window on dimm: 0x%x.", pNewDimm->DeviceHandle.AsUint32);
+    ReturnCode = EFI_SUCCESS;
+  }
+  else {
+    if (pNewDimm->pBlockDataRegionMappingStructure->SpaRangeDescriptionTableIndex != 0) {
+      ReturnCode = GetSpaRangeTable(pFitHead,
+        pNewDimm->pBlockDataRegionMappingStructure->SpaRangeDescriptionTableIndex, &pNewDimm->pBlockDataSpaTbl);
+
+      if (EFI_ERROR(ReturnCode)) {
+        NVDIMM_WARN("No spa range table found for block aperture but the index exists.");
+        ReturnCode = EFI_DEVICE_ERROR;
+        goto Finish;
+      }
+    }
+  }
+
   pNewDimm->InaccessibleVolatileCapacity = 0;
   pNewDimm->InaccessiblePersistentCapacity = 0;
 
@@ -5404,89 +6121,305 @@ InitializeDimm (
     }
   }
 
+#ifdef OS_BUILD
+  if (!FromCache) {
+    inventory_cache_store(pNewDimm);
+  }
+#endif
+
 Finish:
-  FREE_POOL_SAFE(pPayload);
-  FREE_POOL_SAFE(pPartitionInfoPayload);
   FREE_POOL_SAFE(pDimmSecurityPayload);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
 
 /**
-  Check if the DIMM containing the specified DIMM ID is
-  manageable by our software
+  Create DIMM
+  Perform all functions needed for DIMM initialization this includes:
+  setting up mailbox structure
+  retrieving and recording security status
+  retrieving and recording the FW version
+  retrieving and recording partition information
+  setting up block windows
 
-  @param[in] UINT16 Dimm ID to check
+  @param[in] pNewDimm: input dimm structure to populate
+  @param[in] pFitHead: fully populated NVM Firmware Interface Table
+  @param[in] pPmttHead: fully populated Platform Memory Topology Table
+  @param[in] Pid: SMBIOS Dimm ID of the DIMM to create
 
-  @retval BOOLEAN whether or not dimm is manageable
+  @retval EFI_SUCCESS          - Success
+  @retval EFI_OUT_OF_RESOURCES - AllocateZeroPool failure
+  @retval EFI_DEVICE_ERROR     - Other errors
 **/
-BOOLEAN
-IsDimmIdManageable(
-  IN     UINT16 DimmID
+EFI_STATUS
+InitializeDimm (
+  IN     DIMM *pNewDimm,
+  IN     ParsedFitHeader *pFitHead,
+  IN     ParsedPmttHeader *pPmttHead,
+  IN     UINT16 Pid
   )
 {
-  DIMM *pCurDimm = NULL;
-  LIST_ENTRY *pCurDimmNode = NULL;
-  LIST_ENTRY *pDimms = &gNvmDimmData->PMEMDev.Dimms;
-  BOOLEAN Manageable = FALSE;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
 
-  for (pCurDimmNode = GetFirstNode(pDimms);
-      !IsNull(pDimms, pCurDimmNode);
-      pCurDimmNode = GetNextNode(pDimms, pCurDimmNode)) {
-    pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
-    if (DimmID == pCurDimm->DimmID) {
-      Manageable = IsDimmManageable(pCurDimm);
-        break;
-    }
-  }
+  NVDIMM_ENTRY();
 
-  return Manageable;
+  CHECK_RESULT(InitializeDimmFromNfit(pNewDimm, pFitHead, pPmttHead, Pid), Finish);
+  ReturnCode = InitializeDimmFromFw(pNewDimm, pFitHead);
+#ifdef OS_BUILD
+  pNewDimm->Hydrated = TRUE;
+#endif
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
 }
+
 /**
-Get number of manageable dimms
+  DispatchPerDimm work item initializing the FW-derived fields of one DIMM
 
-@param[in] ppDimms the Dimms array
-@param[in] DimmCount the number of Dimms in ppDimms array
+  @param[in] pDimm The DIMM to initialize
+  @param[in] Index Position of pDimm in the dispatched list, unused
+  @param[in] pContext Unused
 
-@retval UINT16 the count of manageable dimms
+  @retval EFI_SUCCESS always, see HydrateDimm
 **/
-UINT16
-GetManageableDimmsCount(
-  IN  DIMM **ppDimms,
-  IN  CONST UINT16 DimmCount
-)
+STATIC
+EFI_STATUS
+HydrateDimmWork(
+  IN     DIMM *pDimm,
+  IN     UINT32 Index,
+  IN     VOID *pContext
+  )
 {
-  UINT16 Index = 0;
-  UINT16 ManageableDimmsNum = 0;
-
-  //Count manageable dimms
-  for (Index = 0; Index < DimmCount; Index++) {
-    if (ppDimms[Index] != NULL) {
-        if (IsDimmManageable(ppDimms[Index])) {
-            ManageableDimmsNum++;
-        }
-    }
-  }
-
-  return ManageableDimmsNum;
+  return HydrateDimm(pDimm);
 }
+
 /**
-  Free dimm
-  Free the memory resources associated with a DIMM
+  Initialize the FW-derived fields of a DIMM created from NFIT only
 
-  @param[out] pDimm - the DIMM to free
+  @param[in] pDimm The DIMM to initialize
+
+  @retval EFI_SUCCESS The DIMM is initialized, functional or not
+  @retval EFI_INVALID_PARAMETER pDimm is NULL
 **/
-VOID
-FreeDimm(
-     OUT DIMM *pDimm
+EFI_STATUS
+HydrateDimm(
+  IN     DIMM *pDimm
   )
 {
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+#ifdef OS_BUILD
+  BOOLEAN Locked = FALSE;
+#endif
+
   NVDIMM_ENTRY();
+
   if (pDimm == NULL) {
-    return;
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
   }
-  FreeBlockWindow(pDimm->pBw);
+
+#ifdef OS_BUILD
+  // The lock is recursive and already serializes the FW commands sent to
+  // this DIMM. Taking it for the whole sequence makes concurrent users wait
+  // for the fields to be complete.
+  if (pDimm->pPassThruLock != NULL) {
+    Locked = (os_mutex_lock(pDimm->pPassThruLock) != 0);
+  }
+
+  if (!pDimm->Hydrated) {
+    // Set first so the FW commands below don't try to hydrate it again
+    pDimm->Hydrated = TRUE;
+    if (!pDimm->NonFunctional &&
+        EFI_ERROR(InitializeDimmFromFw(pDimm, gNvmDimmData->PMEMDev.pFitHead))) {
+      // If a dimm fails to initialize for any reason, it is also non-functional
+      // for right now
+      pDimm->NonFunctional = TRUE;
+    }
+  }
+
+  if (Locked) {
+    os_mutex_unlock(pDimm->pPassThruLock);
+  }
+#endif
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Initialize the FW-derived fields of every DIMM in the list not
+  initialized yet
+
+  @param[in] pDimms The head of the dimm list
+
+  @retval EFI_SUCCESS The DIMMs are initialized, functional or not
+  @retval EFI_INVALID_PARAMETER pDimms is NULL
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+HydrateDimms(
+  IN     LIST_ENTRY *pDimms
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+#ifdef OS_BUILD
+  LIST_ENTRY *pNode = NULL;
+  DIMM *pDimm = NULL;
+  DIMM **ppDimms = NULL;
+  UINT32 DimmCount = 0;
+  UINT32 Index = 0;
+#endif
+
+  NVDIMM_ENTRY();
+
+  CHECK_NULL_ARG(pDimms, Finish);
+
+#ifdef OS_BUILD
+  LIST_FOR_EACH(pNode, pDimms) {
+    if (!DIMM_FROM_NODE(pNode)->Hydrated) {
+      DimmCount++;
+    }
+  }
+  if (DimmCount == 0) {
+    goto Finish;
+  }
+
+  CHECK_RESULT_MALLOC(ppDimms, AllocateZeroPool(sizeof(*ppDimms) * DimmCount), Finish);
+  LIST_FOR_EACH(pNode, pDimms) {
+    pDimm = DIMM_FROM_NODE(pNode);
+    if (!pDimm->Hydrated && Index < DimmCount) {
+      ppDimms[Index++] = pDimm;
+    }
+  }
+
+  startup_profile_begin(StartupPhaseDimmHydration);
+  DispatchPerDimm(ppDimms, Index, HydrateDimmWork, NULL, NULL);
+
+  // The SKUs are known now
+  if (pDimms == &gNvmDimmData->PMEMDev.Dimms) {
+    CheckDimmSkuConsistency(&gNvmDimmData->PMEMDev);
+  }
+  startup_profile_end(StartupPhaseDimmHydration);
+#endif
+
+Finish:
+#ifdef OS_BUILD
+  FREE_POOL_SAFE(ppDimms);
+#endif
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Get dimm by Dimm ID with its FW-derived fields initialized
+
+  @param[in] DimmID: The SMBIOS Type 17 handle of the dimm
+  @param[in] pDimms: The head of the dimm list
+
+  @retval DIMM struct pointer if matching dimm has been found
+  @retval NULL pointer if not found
+**/
+DIMM *
+GetHydratedDimmByPid(
+  IN     UINT32 DimmID,
+  IN     LIST_ENTRY *pDimms
+  )
+{
+  DIMM *pDimm = GetDimmByPid(DimmID, pDimms);
+
+  if (pDimm != NULL) {
+    HydrateDimm(pDimm);
+  }
+  return pDimm;
+}
+
+/**
+  Check if the DIMM containing the specified DIMM ID is
+  manageable by our software
+
+  @param[in] UINT16 Dimm ID to check
+
+  @retval BOOLEAN whether or not dimm is manageable
+**/
+BOOLEAN
+IsDimmIdManageable(
+  IN     UINT16 DimmID
+  )
+{
+  DIMM *pCurDimm = NULL;
+  LIST_ENTRY *pCurDimmNode = NULL;
+  LIST_ENTRY *pDimms = &gNvmDimmData->PMEMDev.Dimms;
+  BOOLEAN Manageable = FALSE;
+
+  for (pCurDimmNode = GetFirstNode(pDimms);
+      !IsNull(pDimms, pCurDimmNode);
+      pCurDimmNode = GetNextNode(pDimms, pCurDimmNode)) {
+    pCurDimm = DIMM_FROM_NODE(pCurDimmNode);
+    if (DimmID == pCurDimm->DimmID) {
+      HydrateDimm(pCurDimm);
+      Manageable = IsDimmManageable(pCurDimm);
+        break;
+    }
+  }
+
+  return Manageable;
+}
+/**
+Get number of manageable dimms
+
+@param[in] ppDimms the Dimms array
+@param[in] DimmCount the number of Dimms in ppDimms array
+
+@retval UINT16 the count of manageable dimms
+**/
+UINT16
+GetManageableDimmsCount(
+  IN  DIMM **ppDimms,
+  IN  CONST UINT16 DimmCount
+)
+{
+  UINT16 Index = 0;
+  UINT16 ManageableDimmsNum = 0;
+
+  //Count manageable dimms
+  for (Index = 0; Index < DimmCount; Index++) {
+    if (ppDimms[Index] != NULL) {
+        if (IsDimmManageable(ppDimms[Index])) {
+            ManageableDimmsNum++;
+        }
+    }
+  }
+
+  return ManageableDimmsNum;
+}
+/**
+  Free dimm
+  Free the memory resources associated with a DIMM
+
+  @param[out] pDimm - the DIMM to free
+**/
+VOID
+FreeDimm(
+     OUT DIMM *pDimm
+  )
+{
+  NVDIMM_ENTRY();
+  if (pDimm == NULL) {
+    return;
+  }
+  FreeBlockWindow(pDimm->pBw);
   FREE_POOL_SAFE(pDimm->pPcdOem);
+  FREE_POOL_SAFE(pDimm->pCommandEffectLog);
+#ifdef OS_BUILD
+  if (pDimm->pPassThruLock != NULL) {
+    os_mutex_delete(pDimm->pPassThruLock, NULL);
+  }
+  if (pDimm->pApiLock != NULL) {
+    os_mutex_delete(pDimm->pApiLock, NULL);
+  }
+#endif
   FREE_POOL_SAFE(pDimm);
   NVDIMM_EXIT();
 }
@@ -6264,6 +7197,45 @@ Finish:
   return StatusCode;
 }
 
+/**
+  Compare the SKU of every DIMM with the first one and record the result
+  in DimmSkuConsistency and the MixedSKUOffender field of each DIMM.
+  DIMMs not initialized from FW yet have no SKU and are not offenders.
+
+  @param[in,out] pDev The pmem super structure
+**/
+VOID
+CheckDimmSkuConsistency(
+  IN OUT struct _PMEM_DEV *pDev
+  )
+{
+  LIST_ENTRY *pNode = NULL;
+  DIMM *pCurDimm = NULL;
+  DIMM *pFirstDimm = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pDev == NULL || IsListEmpty(&pDev->Dimms)) {
+    goto Finish;
+  }
+
+  pDev->DimmSkuConsistency = TRUE;
+  pFirstDimm = DIMM_FROM_NODE(GetFirstNode(&pDev->Dimms));
+
+  LIST_FOR_EACH(pNode, &pDev->Dimms) {
+    pCurDimm = DIMM_FROM_NODE(pNode);
+
+    pCurDimm->MixedSKUOffender = FALSE;
+    if (IsDimmSkuModeMismatch(pFirstDimm, pCurDimm) != NVM_SUCCESS) {
+      pDev->DimmSkuConsistency = FALSE;
+      pCurDimm->MixedSKUOffender = TRUE;
+    }
+  }
+
+Finish:
+  NVDIMM_EXIT();
+}
+
 /**
   Calculate a size of capacity considered Reserved. It is the aligned PM
   capacity less the mapped AD capacity
@@ -6696,7 +7668,7 @@ FwCmdFormatDimm(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (!pFwCmd) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -6713,7 +7685,7 @@ FwCmdFormatDimm(
   }
 
   Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -6744,7 +7716,7 @@ FwCmdGetDdrtIoInitInfo(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -6765,7 +7737,7 @@ FwCmdGetDdrtIoInitInfo(
   CopyMem_S(pDdrtIoInitInfo, sizeof(*pDdrtIoInitInfo), pFwCmd->OutPayload, sizeof(*pDdrtIoInitInfo));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -6801,7 +7773,7 @@ FwCmdGetCommandAccessPolicy(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -6834,7 +7806,7 @@ FwCmdGetCommandAccessPolicy(
   *pRestriction = pOutputCAP->Restriction;
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -6869,7 +7841,7 @@ FwCmdInjectError(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -6895,7 +7867,7 @@ FwCmdInjectError(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -6927,7 +7899,7 @@ FwCmdGetSystemTime(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
 
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -6949,7 +7921,7 @@ FwCmdGetSystemTime(
   CopyMem_S(pSystemTimePayload, sizeof(*pSystemTimePayload), pFwCmd->OutPayload, sizeof(*pSystemTimePayload));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -6987,7 +7959,7 @@ FwCmdGetExtendedAdrInfo(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -7008,7 +7980,7 @@ FwCmdGetExtendedAdrInfo(
   CopyMem_S(pExtendedAdrInfo, sizeof(*pExtendedAdrInfo), pFwCmd->OutPayload, sizeof(*pExtendedAdrInfo));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -7039,7 +8011,7 @@ FwCmdGetLatchSystemShutdownStateInfo(
     goto Finish;
   }
 
-  pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+  pFwCmd = AllocateFwCmd();
   if (pFwCmd == NULL) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     goto Finish;
@@ -7060,7 +8032,7 @@ FwCmdGetLatchSystemShutdownStateInfo(
   CopyMem_S(pLastSystemShutdownStateInfo, sizeof(*pLastSystemShutdownStateInfo), pFwCmd->OutPayload, sizeof(*pLastSystemShutdownStateInfo));
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -7098,7 +8070,7 @@ FwCmdSmallPayload(
 
   CHECK_NULL_ARG(pDimm, Finish);
 
-  CHECK_RESULT_MALLOC(pFwCmd, AllocateZeroPool(sizeof(*pFwCmd)), Finish);
+  CHECK_RESULT_MALLOC(pFwCmd, AllocateFwCmd(), Finish);
 
   pFwCmd->DimmID = pDimm->DimmID;
   pFwCmd->Opcode = Opcode;
@@ -7121,7 +8093,7 @@ FwCmdSmallPayload(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -7371,163 +8343,975 @@ IsFwApiVersionSupported(
 }
 
 /**
-Clears the PCD Cache on each DIMM in the global DIMM list
+Clears the PCD Cache on each DIMM in the global DIMM list
+
+@retval EFI_SUCCESS Success
+**/
+EFI_STATUS ClearPcdCacheOnDimmList(VOID)
+{
+#ifdef PCD_CACHE_ENABLED
+  DIMM *pDimm = NULL;
+  LIST_ENTRY *pDimmNode = NULL;
+
+  if (NULL != gNvmDimmData) {
+    LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
+      if (pDimmNode == NULL) {
+        // Not supposed to get a NULL pDimmNode, but just in case
+        // exit out so we can't dereference it
+        break;
+      }
+      pDimm = DIMM_FROM_NODE(pDimmNode);
+      if (NULL != pDimm) {
+#ifdef OS_BUILD
+        // Not while a Get PCD call on another thread copies it
+        if (pDimm->pPassThruLock != NULL) {
+          os_mutex_lock(pDimm->pPassThruLock);
+        }
+#endif
+        // Free memory and set to NULL so won't be used by Get PCD calls
+        FREE_POOL_SAFE(pDimm->pPcdOem);
+#ifdef OS_BUILD
+        if (pDimm->pPassThruLock != NULL) {
+          os_mutex_unlock(pDimm->pPassThruLock);
+        }
+#endif
+      }
+    }
+  }
+#endif // PCD_CACHE_ENABLED
+  return EFI_SUCCESS;
+}
+
+/**
+  Bumped whenever the FIS transport attributes change, invalidating the
+  passthru method memoized in every DIMM
+**/
+STATIC volatile UINT32 gPassThruMethodGeneration = 1;
+
+/**
+  Return what passthru method will be used to send the command.
+
+  @param[in] pDimm The DCPMM to transact with
+  @param[in] Opcode of the FW command. Used to determine if command
+             is dependent on DDRT/SMBUS interface status.
+  @param[in] SubOpcode of the FW command. Used to determine if command
+             is dependent on DDRT/SMBUS interface status.
+  @param[in] IsLargePayloadCommand Need to know if large payload interface is
+                                   even desired. If not, then it makes no sense
+                                   to write to the large payload mailbox unless
+                                   the user specifies it.
+  @param[out] Method Pointer to passthru method variable to modify
+  @retval EFI_SUCCESS Success
+  @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
+**/
+EFI_STATUS
+DeterminePassThruMethod(
+  IN     DIMM *pDimm,
+  IN     UINT8 Opcode,
+  IN     UINT8 SubOpcode,
+  IN     BOOLEAN IsLargePayloadCommand,
+     OUT DIMM_PASSTHRU_METHOD *pMethod
+  )
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
+  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS Attribs;
+  PASSTHRU_METHOD_CACHE *pCache = NULL;
+  UINT32 Generation = gPassThruMethodGeneration;
+  UINT16 BootStatusBitmask = 0;
+  BOOLEAN Cacheable = TRUE;
+
+  if (pDimm == NULL || pMethod == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  // Initialize incoming variable to a good default, just in case
+  *pMethod = DimmPassthruSmbusSmallPayload;
+
+  // The method only depends on the transport attributes and the boot status
+  // bitmask, reuse the last answer while neither has changed
+  BootStatusBitmask = pDimm->BootStatusBitmask;
+  pCache = &pDimm->PassThruMethodCache[IsLargePayloadCommand ? 1 : 0];
+  if (pCache->Generation == Generation && pCache->BootStatusBitmask == BootStatusBitmask) {
+    *pMethod = pCache->Method;
+    ReturnCode = EFI_SUCCESS;
+    pCache = NULL;
+    goto Finish;
+  }
+
+  CHECK_RESULT(OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL), Finish);
+
+  CHECK_RESULT(pNvmDimmConfigProtocol->GetFisTransportAttributes(pNvmDimmConfigProtocol, &Attribs), Finish);
+
+  // Check if the user manually specified a certain interface. If specified,
+  // go to passthru directly and don't do any auto-detection.
+  // Ignore "default" settings here, they'll be used later
+  if ((Attribs.Protocol != FisTransportAuto || Attribs.PayloadSize != FisTransportSizeAuto) &&
+      // Skip this flow if only large payload was disabled (the default setting in OS)
+      !(FisTransportAuto == Attribs.Protocol && FisTransportSizeSmallMb == Attribs.PayloadSize)) {
+    // User only specified "-ddrt"
+    if (IS_DDRT_FLAG_ENABLED(Attribs) && Attribs.PayloadSize == FisTransportSizeAuto) {
+      if (IsLargePayloadCommand) {
+        *pMethod = DimmPassthruDdrtLargePayload;
+      } else {
+        *pMethod = DimmPassthruDdrtSmallPayload;
+      }
+    } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_LARGE_PAYLOAD_FLAG_ENABLED(Attribs)) {
+      *pMethod = DimmPassthruDdrtLargePayload;
+    } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_SMALL_PAYLOAD_FLAG_ENABLED(Attribs)) {
+      *pMethod = DimmPassthruDdrtSmallPayload;
+    } else if (IS_SMBUS_FLAG_ENABLED(Attribs)) {
+      *pMethod = DimmPassthruSmbusSmallPayload;
+    } else {
+      NVDIMM_ERR("Invalid Attribs state of %d, %d detected. Exiting", Attribs.Protocol, Attribs.PayloadSize);
+      ReturnCode = EFI_INVALID_PARAMETER;
+      goto Finish;
+    }
+    goto Finish;
+  }
+
+  // Check if one of DDRT or SMBUS interfaces is ready
+  if (DIMM_DDRT_AND_SMBUS_INTERFACES_DOWN(BootStatusBitmask)) {
+    // The outcome depends on the opcode from here on, don't remember it
+    Cacheable = FALSE;
+    if (!FW_CMD_INTERFACE_INDEPENDENT(Opcode, SubOpcode)) {
+      ReturnCode = EFI_DEVICE_ERROR;
+      NVDIMM_ERR("PMem module ddrt and smbus interfaces not available. Cancelling PassThru()");
+      goto Finish;
+    }
+  }
+
+  // If caller wants to send a large payload command
+  if (TRUE == IsLargePayloadCommand &&
+      // and if no problems found with sending large payload
+      !(FisTransportSizeSmallMb == Attribs.PayloadSize ||
+      (DIMM_MEDIA_NOT_ACCESSIBLE(BootStatusBitmask)) ||
+      (BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY))) {
+
+    // Then allow them to do so
+    *pMethod = DimmPassthruDdrtLargePayload;
+
+  // Otherwise prefer small payload DDRT
+  } else if (!(BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY)) {
+    *pMethod = DimmPassthruDdrtSmallPayload;
+  } else {
+    // Otherwise last resort is small payload smbus
+    *pMethod = DimmPassthruSmbusSmallPayload;
+  }
+
+Finish:
+  if (pCache != NULL && Cacheable && !EFI_ERROR(ReturnCode)) {
+    pCache->Method = *pMethod;
+    pCache->BootStatusBitmask = BootStatusBitmask;
+    pCache->Generation = Generation;
+  }
+  return ReturnCode;
+}
+
+/**
+  Drop every memoized passthru method. Called when the FIS transport
+  attributes change.
+**/
+VOID
+InvalidatePassThruMethodCache(
+  )
+{
+  gPassThruMethodGeneration++;
+  // Generation 0 marks a DIMM that never resolved a method
+  if (gPassThruMethodGeneration == 0) {
+    gPassThruMethodGeneration++;
+  }
+}
+
+/**
+  Check if sending a large payload command over the DDRT large payload
+  mailbox is possible. Used by callers often to determine chunking behavior.
+
+  @param[in] pDimm The DCPMM to transact with
+  @param[out] pAvailable Whether large payload is available. Pointer to boolean variable
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
+**/
+EFI_STATUS
+IsLargePayloadAvailable(
+  IN     DIMM *pDimm,
+     OUT BOOLEAN *pAvailable
+  )
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  DIMM_PASSTHRU_METHOD Method = DimmPassthruDdrtLargePayload;
+
+  if (pDimm == NULL || pAvailable == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  // TRUE -> We are attempting to send a large payload command
+  // Only return true if DDRT large payload is allowed
+  CHECK_RESULT(DeterminePassThruMethod(pDimm, 0, 0, TRUE, &Method), Finish);
+  *pAvailable = DimmPassthruDdrtLargePayload == Method;
+
+Finish:
+  return ReturnCode;
+}
+
+/**
+  FW command pool. Every NVM_FW_CMD carries both 1 MiB large payload mailboxes,
+  so handing out a freshly zeroed one per command costs far more than the
+  command itself. Released commands are scrubbed (header plus the large payload
+  bytes described by their sizes) and kept for the next request.
+**/
+STATIC NVM_FW_CMD *gFwCmdPool[FW_CMD_POOL_DEPTH];
+STATIC UINT32 gFwCmdPoolCount = 0;
+STATIC FW_CMD_POOL_STATS gFwCmdPoolStats;
+#ifdef OS_BUILD
+STATIC OS_MUTEX *gFwCmdPoolLock = NULL;
+#define FW_CMD_POOL_LOCK()    os_mutex_lock(gFwCmdPoolLock)
+#define FW_CMD_POOL_UNLOCK()  os_mutex_unlock(gFwCmdPoolLock)
+#else
+#define FW_CMD_POOL_LOCK()
+#define FW_CMD_POOL_UNLOCK()
+#endif // OS_BUILD
+
+/**
+  Set up the FW command pool
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the pool lock
+**/
+EFI_STATUS
+InitializeFwCmdPool(
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+  ZeroMem(gFwCmdPool, sizeof(gFwCmdPool));
+  ZeroMem(&gFwCmdPoolStats, sizeof(gFwCmdPoolStats));
+  gFwCmdPoolCount = 0;
+#ifdef OS_BUILD
+  if (gFwCmdPoolLock == NULL) {
+    gFwCmdPoolLock = os_mutex_init(NULL);
+    if (gFwCmdPoolLock == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+    }
+  }
+#endif // OS_BUILD
+  return ReturnCode;
+}
+
+/**
+  Release every FW command kept in the pool
+**/
+VOID
+UninitializeFwCmdPool(
+  )
+{
+  UINT32 Index = 0;
+
+  FW_CMD_POOL_LOCK();
+  NVDIMM_DBG("FW command pool: %lld requests, %lld reused, %lld bytes allocated, %lld bytes cleared",
+    gFwCmdPoolStats.Requests, gFwCmdPoolStats.Reused,
+    gFwCmdPoolStats.BytesAllocated, gFwCmdPoolStats.BytesCleared);
+  for (Index = 0; Index < gFwCmdPoolCount; Index++) {
+    FREE_POOL_SAFE(gFwCmdPool[Index]);
+  }
+  gFwCmdPoolCount = 0;
+  FW_CMD_POOL_UNLOCK();
+#ifdef OS_BUILD
+  if (gFwCmdPoolLock != NULL) {
+    os_mutex_delete(gFwCmdPoolLock, NULL);
+    gFwCmdPoolLock = NULL;
+  }
+#endif // OS_BUILD
+}
+
+/**
+  Get a zeroed FW command, reusing one from the pool when possible
+
+  @retval Pointer to the FW command, NULL on allocation failure
+**/
+NVM_FW_CMD *
+AllocateFwCmd(
+  )
+{
+  NVM_FW_CMD *pFwCmd = NULL;
+
+  FW_CMD_POOL_LOCK();
+  gFwCmdPoolStats.Requests++;
+  if (gFwCmdPoolCount > 0) {
+    gFwCmdPoolCount--;
+    pFwCmd = gFwCmdPool[gFwCmdPoolCount];
+    gFwCmdPool[gFwCmdPoolCount] = NULL;
+    gFwCmdPoolStats.Reused++;
+  }
+  FW_CMD_POOL_UNLOCK();
+
+  if (pFwCmd == NULL) {
+    pFwCmd = AllocateZeroPool(sizeof(*pFwCmd));
+    if (pFwCmd != NULL) {
+      FW_CMD_POOL_LOCK();
+      gFwCmdPoolStats.BytesAllocated += sizeof(*pFwCmd);
+      FW_CMD_POOL_UNLOCK();
+    }
+  }
+
+  return pFwCmd;
+}
+
+/**
+  Return a FW command obtained from AllocateFwCmd. Only the header and the
+  large payload bytes described by the command sizes are cleared before the
+  command is kept for reuse.
+
+  @param[in] pFwCmd FW command to release
+**/
+VOID
+FreeFwCmd(
+  IN     NVM_FW_CMD *pFwCmd
+  )
+{
+  UINT32 LargeInputUsed = 0;
+  UINT32 LargeOutputUsed = 0;
+  UINT64 Cleared = 0;
+
+  if (pFwCmd == NULL) {
+    return;
+  }
+
+  LargeInputUsed = MIN(pFwCmd->LargeInputPayloadSize, sizeof(pFwCmd->LargeInputPayload));
+  LargeOutputUsed = MIN(pFwCmd->LargeOutputPayloadSize, sizeof(pFwCmd->LargeOutputPayload));
+
+  // Everything but the two large payload buffers
+  ZeroMem(pFwCmd, OFFSET_OF(NVM_FW_CMD, LargeInputPayload));
+  ZeroMem(pFwCmd->OutPayload, sizeof(pFwCmd->OutPayload));
+  ZeroMem(&pFwCmd->DimmID, sizeof(*pFwCmd) - OFFSET_OF(NVM_FW_CMD, DimmID));
+  ZeroMem(pFwCmd->LargeInputPayload, LargeInputUsed);
+  ZeroMem(pFwCmd->LargeOutputPayload, LargeOutputUsed);
+  Cleared = sizeof(*pFwCmd) - sizeof(pFwCmd->LargeInputPayload) - sizeof(pFwCmd->LargeOutputPayload) +
+    LargeInputUsed + LargeOutputUsed;
+
+  FW_CMD_POOL_LOCK();
+  gFwCmdPoolStats.BytesCleared += Cleared;
+  if (gFwCmdPoolCount < FW_CMD_POOL_DEPTH) {
+    gFwCmdPool[gFwCmdPoolCount] = pFwCmd;
+    gFwCmdPoolCount++;
+    pFwCmd = NULL;
+  }
+  FW_CMD_POOL_UNLOCK();
+
+  FREE_POOL_SAFE(pFwCmd);
+}
+
+/**
+  Get the FW command pool statistics
+
+  @param[out] pStats Pointer to the statistics structure to fill
+**/
+VOID
+GetFwCmdPoolStats(
+     OUT FW_CMD_POOL_STATS *pStats
+  )
+{
+  if (pStats == NULL) {
+    return;
+  }
+  FW_CMD_POOL_LOCK();
+  CopyMem_S(pStats, sizeof(*pStats), &gFwCmdPoolStats, sizeof(gFwCmdPoolStats));
+  FW_CMD_POOL_UNLOCK();
+}
+
+/**
+  FW response cache. Entries are keyed by DIMM handle, opcode, subopcode and
+  the exact input payload; only successful small payload responses to the
+  read-only commands accepted by IsFwResponseCacheable are stored.
+**/
+typedef struct _FW_RESPONSE_CACHE_ENTRY {
+  BOOLEAN Valid;
+  UINT32 DimmHandle;
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  UINT32 InputHash;
+  UINT32 InputPayloadSize;
+  UINT8 InputPayload[IN_PAYLOAD_SIZE];
+  UINT32 OutputPayloadSize;
+  UINT8 OutPayload[OUT_PAYLOAD_SIZE];
+  UINT8 Status;
+  UINT64 TimestampMs;
+} FW_RESPONSE_CACHE_ENTRY;
+
+STATIC FW_RESPONSE_CACHE_ENTRY gFwResponseCache[FW_RESPONSE_CACHE_ENTRIES];
+STATIC UINT32 gFwResponseCacheNext = 0;
+STATIC UINT32 gFwResponseCacheDepth = 0;
+STATIC UINT64 gFwResponseCacheTtlMs = 0;
+// Bumped on every invalidation, a response read before it is not stored
+STATIC UINT64 gFwResponseCacheGeneration = 0;
+STATIC FW_RESPONSE_CACHE_STATS gFwResponseCacheStats;
+#ifdef OS_BUILD
+STATIC OS_MUTEX *gFwResponseCacheLock = NULL;
+#define FW_RESPONSE_CACHE_LOCK()    os_mutex_lock(gFwResponseCacheLock)
+#define FW_RESPONSE_CACHE_UNLOCK()  os_mutex_unlock(gFwResponseCacheLock)
+#else
+#define FW_RESPONSE_CACHE_LOCK()
+#define FW_RESPONSE_CACHE_UNLOCK()
+#endif // OS_BUILD
+
+/**
+  Check if a FW command only reads DIMM state. Large payload mailbox transfers
+  only touch the mailbox and count as reads.
+
+  @param[in] pCmd FW command to check
+**/
+STATIC
+BOOLEAN
+IsFwCmdReadOnly(
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+  switch (pCmd->Opcode) {
+  case PtIdentifyDimm:
+  case PtGetSecInfo:
+  case PtGetFeatures:
+  case PtGetAdminFeatures:
+  case PtGetLog:
+    return TRUE;
+  case PtEmulatedBiosCommands:
+    return pCmd->SubOpcode != SubopExtVendorSpecific;
+  default:
+    return FALSE;
+  }
+}
+
+/**
+  Check if the response to a FW command can be answered from the cache.
+  Large payload transfers, long operation status, ARS, PMON, system time and
+  debug/failure analysis logs are never cached.
+
+  @param[in] pCmd FW command to check
+
+  @retval TRUE The response may be cached
+  @retval FALSE The command must always reach the DIMM
+**/
+STATIC
+BOOLEAN
+IsFwResponseCacheable(
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+  if (pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0 ||
+      pCmd->InputPayloadSize > IN_PAYLOAD_SIZE || pCmd->OutputPayloadSize > OUT_PAYLOAD_SIZE) {
+    return FALSE;
+  }
+
+  switch (pCmd->Opcode) {
+  case PtIdentifyDimm:
+    return TRUE;
+  case PtGetSecInfo:
+    return pCmd->SubOpcode == SubopGetSecState;
+  case PtGetFeatures:
+    return pCmd->SubOpcode != SubopAddressRangeScrub && pCmd->SubOpcode != SubopPMONRegisters;
+  case PtGetAdminFeatures:
+    return pCmd->SubOpcode != SubopSystemTime;
+  case PtGetLog:
+    return pCmd->SubOpcode == SubopSmartHealth || pCmd->SubOpcode == SubopFwImageInfo ||
+      pCmd->SubOpcode == SubopMemInfo || pCmd->SubOpcode == SubopErrorLog ||
+      pCmd->SubOpcode == SubopCommandEffectLog;
+  default:
+    return FALSE;
+  }
+}
+
+/**
+  Check if a cacheable FW response reports state the DIMM changes on its own:
+  sensors and health, memory info counters, error log entries, the power
+  management policy and the remaining package sparing. These are replayed for
+  at most FW_RESPONSE_CACHE_VOLATILE_TTL_MS.
+
+  @param[in] pCmd FW command to check
+**/
+STATIC
+BOOLEAN
+IsFwResponseVolatile(
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+  switch (pCmd->Opcode) {
+  case PtGetFeatures:
+    return pCmd->SubOpcode == SubopPolicyPowMgmt || pCmd->SubOpcode == SubopPolicyPackageSparing;
+  case PtGetLog:
+    return pCmd->SubOpcode == SubopSmartHealth || pCmd->SubOpcode == SubopMemInfo ||
+      pCmd->SubOpcode == SubopErrorLog;
+  default:
+    return FALSE;
+  }
+}
+
+/**
+  Drop cached responses without taking the cache lock
+
+  @param[in] DimmHandle Handle of the DIMM whose responses are dropped
+  @param[in] AllDimms Drop responses of every DIMM
+**/
+STATIC
+VOID
+InvalidateFwResponseCacheLocked(
+  IN     UINT32 DimmHandle,
+  IN     BOOLEAN AllDimms
+  )
+{
+  UINT32 Index = 0;
+
+  gFwResponseCacheGeneration++;
+  for (Index = 0; Index < FW_RESPONSE_CACHE_ENTRIES; Index++) {
+    if (gFwResponseCache[Index].Valid && (AllDimms || gFwResponseCache[Index].DimmHandle == DimmHandle)) {
+      gFwResponseCache[Index].Valid = FALSE;
+      gFwResponseCacheStats.Invalidations++;
+    }
+  }
+}
+
+/**
+  Drop the cached responses a state changing FW command may have made stale.
+  The DIMM's Command Effect Log decides: commands with no effects keep the
+  cache, security state changes and commands that quiesce IO drop every DIMM's
+  responses, anything else drops the target DIMM's responses. Without a CEL
+  entry security, FW update and factory reset commands drop everything.
+  The cache lock must be held.
+
+  @param[in] pDimm DIMM the command is sent to
+  @param[in] pCmd State changing FW command
+**/
+STATIC
+VOID
+InvalidateFwResponseCacheForCmd(
+  IN     DIMM *pDimm,
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+  COMMAND_EFFECT_LOG_ENTRY *pEntry = NULL;
+  BOOLEAN AllDimms = pCmd->Opcode == PtSetSecInfo || pCmd->Opcode == PtUpdateFw ||
+    pCmd->Opcode == PtCustomerFormat;
+  UINT32 Index = 0;
+
+  for (Index = 0; pDimm->pCommandEffectLog != NULL && Index < pDimm->CommandEffectLogCount; Index++) {
+    pEntry = &pDimm->pCommandEffectLog[Index];
+    if (pEntry->Opcode.Separated.Opcode != pCmd->Opcode ||
+        pEntry->Opcode.Separated.SubOpcode != pCmd->SubOpcode) {
+      continue;
+    }
+    if (pEntry->EffectName.Separated.NoEffects) {
+      return;
+    }
+    AllDimms = pEntry->EffectName.Separated.SecurityStateChange || pEntry->EffectName.Separated.QuiesceAllIo;
+    break;
+  }
+
+  InvalidateFwResponseCacheLocked(pDimm->DeviceHandle.AsUint32, AllDimms);
+}
+
+/**
+  FNV-1a hash of the command key
+
+  @param[in] pCmd FW command to hash
+**/
+STATIC
+UINT32
+HashFwCmdInput(
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+  UINT32 Hash = 2166136261U;
+  UINT32 Index = 0;
+
+  Hash = (Hash ^ pCmd->Opcode) * 16777619U;
+  Hash = (Hash ^ pCmd->SubOpcode) * 16777619U;
+  for (Index = 0; Index < pCmd->InputPayloadSize; Index++) {
+    Hash = (Hash ^ pCmd->InputPayload[Index]) * 16777619U;
+  }
+  return Hash;
+}
+
+/**
+  Get the current time for cache entry aging, 0 when no clock is available
+**/
+STATIC
+UINT64
+FwResponseCacheNow(
+  )
+{
+#ifdef OS_BUILD
+  return GetCurrentMilliseconds();
+#else
+  return 0;
+#endif // OS_BUILD
+}
+
+/**
+  Set up the FW response cache. The cache starts disabled.
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the cache lock
+**/
+EFI_STATUS
+InitializeFwResponseCache(
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+  ZeroMem(gFwResponseCache, sizeof(gFwResponseCache));
+  ZeroMem(&gFwResponseCacheStats, sizeof(gFwResponseCacheStats));
+  gFwResponseCacheNext = 0;
+  gFwResponseCacheDepth = 0;
+  gFwResponseCacheTtlMs = 0;
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    gFwResponseCacheLock = os_mutex_init(NULL);
+    if (gFwResponseCacheLock == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+    }
+  }
+#endif // OS_BUILD
+  return ReturnCode;
+}
+
+/**
+  Drop every cached FW response and release the cache lock
+**/
+VOID
+UninitializeFwResponseCache(
+  )
+{
+  FW_RESPONSE_CACHE_LOCK();
+  NVDIMM_DBG("FW response cache: %lld hits, %lld misses, %lld invalidations",
+    gFwResponseCacheStats.Hits, gFwResponseCacheStats.Misses, gFwResponseCacheStats.Invalidations);
+  ZeroMem(gFwResponseCache, sizeof(gFwResponseCache));
+  gFwResponseCacheDepth = 0;
+  FW_RESPONSE_CACHE_UNLOCK();
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock != NULL) {
+    os_mutex_delete(gFwResponseCacheLock, NULL);
+    gFwResponseCacheLock = NULL;
+  }
+#endif // OS_BUILD
+}
+
+/**
+  Open a FW response cache scope. While at least one scope is open, successful
+  small payload responses to read-only commands (identify, get security info and
+  most get features/admin features/log pages) are kept and replayed to later
+  identical requests. Scopes nest; the cache is flushed when the last one closes.
+  Sensor, health, memory info and error log responses are never replayed once
+  older than FW_RESPONSE_CACHE_VOLATILE_TTL_MS.
+
+  @param[in] TtlMs Maximum age of a replayed response in milliseconds,
+    0 to keep responses for the lifetime of the scope. Ignored in UEFI.
+**/
+VOID
+FwResponseCacheBegin(
+  IN     UINT64 TtlMs
+  )
+{
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
+  }
+#endif // OS_BUILD
+  FW_RESPONSE_CACHE_LOCK();
+  // The outermost scope decides how long responses live
+  if (gFwResponseCacheDepth == 0) {
+    gFwResponseCacheTtlMs = TtlMs;
+  }
+  gFwResponseCacheDepth++;
+  FW_RESPONSE_CACHE_UNLOCK();
+}
+
+/**
+  Close a FW response cache scope opened with FwResponseCacheBegin
+**/
+VOID
+FwResponseCacheEnd(
+  )
+{
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
+  }
+#endif // OS_BUILD
+  FW_RESPONSE_CACHE_LOCK();
+  if (gFwResponseCacheDepth > 0) {
+    gFwResponseCacheDepth--;
+    if (gFwResponseCacheDepth == 0) {
+      ZeroMem(gFwResponseCache, sizeof(gFwResponseCache));
+      gFwResponseCacheNext = 0;
+      gFwResponseCacheGeneration++;
+    }
+  }
+  FW_RESPONSE_CACHE_UNLOCK();
+}
+
+/**
+  Drop cached FW responses
+
+  @param[in] pDimm DIMM whose responses are dropped, NULL to drop all
+**/
+VOID
+InvalidateFwResponseCache(
+  IN     DIMM *pDimm OPTIONAL
+  )
+{
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
+  }
+#endif // OS_BUILD
+  FW_RESPONSE_CACHE_LOCK();
+  InvalidateFwResponseCacheLocked(pDimm == NULL ? 0 : pDimm->DeviceHandle.AsUint32, pDimm == NULL);
+  FW_RESPONSE_CACHE_UNLOCK();
+}
+
+/**
+  Get the FW response cache statistics
+
+  @param[out] pStats Pointer to the statistics structure to fill
+**/
+VOID
+GetFwResponseCacheStats(
+     OUT FW_RESPONSE_CACHE_STATS *pStats
+  )
+{
+  if (pStats == NULL) {
+    return;
+  }
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    ZeroMem(pStats, sizeof(*pStats));
+    return;
+  }
+#endif // OS_BUILD
+  FW_RESPONSE_CACHE_LOCK();
+  CopyMem_S(pStats, sizeof(*pStats), &gFwResponseCacheStats, sizeof(gFwResponseCacheStats));
+  FW_RESPONSE_CACHE_UNLOCK();
+}
+
+/**
+  Fetch the DIMM's Command Effect Log the first time a state changing command
+  is sent while a cache scope is open. Must be called without the DIMM's
+  passthru lock held, the CEL is read with regular FW commands.
 
-@retval EFI_SUCCESS Success
+  @param[in] pDimm DIMM the command is sent to
+  @param[in] pCmd FW command about to be sent
 **/
-EFI_STATUS ClearPcdCacheOnDimmList(VOID)
+STATIC
+VOID
+LoadCommandEffectLogForCache(
+  IN     DIMM *pDimm,
+  IN     NVM_FW_CMD *pCmd
+  )
 {
-#ifdef PCD_CACHE_ENABLED
-  DIMM *pDimm = NULL;
-  LIST_ENTRY *pDimmNode = NULL;
+  COMMAND_EFFECT_LOG_ENTRY *pLogEntry = NULL;
+  UINT32 EntryCount = 0;
+  BOOLEAN Needed = FALSE;
 
-  if (NULL != gNvmDimmData) {
-    LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
-      if (pDimmNode == NULL) {
-        // Not supposed to get a NULL pDimmNode, but just in case
-        // exit out so we can't dereference it
-        break;
-      }
-      pDimm = DIMM_FROM_NODE(pDimmNode);
-      if (NULL != pDimm) {
-        // Free memory and set to NULL so won't be used by Get PCD calls
-        FREE_POOL_SAFE(pDimm->pPcdOem);
-      }
-    }
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
   }
-#endif // PCD_CACHE_ENABLED
-  return EFI_SUCCESS;
+#endif // OS_BUILD
+  if (IsFwCmdReadOnly(pCmd)) {
+    return;
+  }
+
+  FW_RESPONSE_CACHE_LOCK();
+  Needed = gFwResponseCacheDepth > 0 && !pDimm->CommandEffectLogLoaded;
+  FW_RESPONSE_CACHE_UNLOCK();
+  if (!Needed) {
+    return;
+  }
+
+  if (EFI_ERROR(FwCmdGetCommandEffectLog(pDimm, &pLogEntry, &EntryCount))) {
+    NVDIMM_DBG("Unable to read the Command Effect Log of DCPMM 0x%x, state changing commands flush its cached responses",
+      pDimm->DeviceHandle.AsUint32);
+    FREE_POOL_SAFE(pLogEntry);
+    EntryCount = 0;
+  }
+
+  FW_RESPONSE_CACHE_LOCK();
+  if (!pDimm->CommandEffectLogLoaded) {
+    pDimm->pCommandEffectLog = pLogEntry;
+    pDimm->CommandEffectLogCount = EntryCount;
+    pDimm->CommandEffectLogLoaded = TRUE;
+    pLogEntry = NULL;
+  }
+  FW_RESPONSE_CACHE_UNLOCK();
+  FREE_POOL_SAFE(pLogEntry);
 }
 
 /**
-  Return what passthru method will be used to send the command.
+  Answer a FW command from the cache, or drop stale responses if the command
+  may change DIMM state. Nothing is done unless a cache scope is open.
 
-  @param[in] pDimm The DCPMM to transact with
-  @param[in] Opcode of the FW command. Used to determine if command
-             is dependent on DDRT/SMBUS interface status.
-  @param[in] SubOpcode of the FW command. Used to determine if command
-             is dependent on DDRT/SMBUS interface status.
-  @param[in] IsLargePayloadCommand Need to know if large payload interface is
-                                   even desired. If not, then it makes no sense
-                                   to write to the large payload mailbox unless
-                                   the user specifies it.
-  @param[out] Method Pointer to passthru method variable to modify
-  @retval EFI_SUCCESS Success
-  @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
+  @param[in] pDimm DIMM the command is sent to
+  @param[in,out] pCmd FW command; on a hit the output payload and status are filled in
+  @param[out] pGeneration Cache generation to hand to FwResponseCacheStore
+
+  @retval TRUE The command was answered from the cache
+  @retval FALSE The command must be sent to the DIMM
 **/
-EFI_STATUS
-DeterminePassThruMethod(
+STATIC
+BOOLEAN
+FwResponseCacheLookup(
   IN     DIMM *pDimm,
-  IN     UINT8 Opcode,
-  IN     UINT8 SubOpcode,
-  IN     BOOLEAN IsLargePayloadCommand,
-     OUT DIMM_PASSTHRU_METHOD *pMethod
+  IN OUT NVM_FW_CMD *pCmd,
+     OUT UINT64 *pGeneration
   )
 {
-  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
-  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS Attribs;
+  FW_RESPONSE_CACHE_ENTRY *pEntry = NULL;
+  UINT32 DimmHandle = pDimm->DeviceHandle.AsUint32;
+  UINT32 Hash = 0;
+  UINT32 Index = 0;
+  UINT64 Now = 0;
+  UINT64 TtlMs = 0;
+  BOOLEAN Hit = FALSE;
+#ifdef OS_BUILD
+  PbrContext *pPbrContext = PBR_CTX();
 
-  if (pDimm == NULL || pMethod == NULL) {
-    ReturnCode = EFI_INVALID_PARAMETER;
-    goto Finish;
+  // Recordings must capture every command sent
+  if (gFwResponseCacheLock == NULL || PBR_NORMAL_MODE != PBR_GET_MODE(pPbrContext)) {
+    return FALSE;
   }
+#endif // OS_BUILD
 
-  // Initialize incoming variable to a good default, just in case
-  *pMethod = DimmPassthruSmbusSmallPayload;
-
-  CHECK_RESULT(OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL), Finish);
-
-  CHECK_RESULT(pNvmDimmConfigProtocol->GetFisTransportAttributes(pNvmDimmConfigProtocol, &Attribs), Finish);
-
-  // Check if the user manually specified a certain interface. If specified,
-  // go to passthru directly and don't do any auto-detection.
-  // Ignore "default" settings here, they'll be used later
-  if ((Attribs.Protocol != FisTransportAuto || Attribs.PayloadSize != FisTransportSizeAuto) &&
-      // Skip this flow if only large payload was disabled (the default setting in OS)
-      !(FisTransportAuto == Attribs.Protocol && FisTransportSizeSmallMb == Attribs.PayloadSize)) {
-    // User only specified "-ddrt"
-    if (IS_DDRT_FLAG_ENABLED(Attribs) && Attribs.PayloadSize == FisTransportSizeAuto) {
-      if (IsLargePayloadCommand) {
-        *pMethod = DimmPassthruDdrtLargePayload;
-      } else {
-        *pMethod = DimmPassthruDdrtSmallPayload;
-      }
-    } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_LARGE_PAYLOAD_FLAG_ENABLED(Attribs)) {
-      *pMethod = DimmPassthruDdrtLargePayload;
-    } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_SMALL_PAYLOAD_FLAG_ENABLED(Attribs)) {
-      *pMethod = DimmPassthruDdrtSmallPayload;
-    } else if (IS_SMBUS_FLAG_ENABLED(Attribs)) {
-      *pMethod = DimmPassthruSmbusSmallPayload;
-    } else {
-      NVDIMM_ERR("Invalid Attribs state of %d, %d detected. Exiting", Attribs.Protocol, Attribs.PayloadSize);
-      ReturnCode = EFI_INVALID_PARAMETER;
-      goto Finish;
-    }
+  FW_RESPONSE_CACHE_LOCK();
+  *pGeneration = gFwResponseCacheGeneration;
+  if (gFwResponseCacheDepth == 0) {
     goto Finish;
   }
 
-  // Check if one of DDRT or SMBUS interfaces is ready
-  if (DIMM_DDRT_AND_SMBUS_INTERFACES_DOWN(pDimm->BootStatusBitmask) &&
-    !FW_CMD_INTERFACE_INDEPENDENT(Opcode, SubOpcode)) {
-    ReturnCode = EFI_DEVICE_ERROR;
-    NVDIMM_ERR("PMem module ddrt and smbus interfaces not available. Cancelling PassThru()");
+  if (!IsFwCmdReadOnly(pCmd)) {
+    InvalidateFwResponseCacheForCmd(pDimm, pCmd);
+    goto Finish;
+  }
+  if (!IsFwResponseCacheable(pCmd)) {
     goto Finish;
   }
 
-  // If caller wants to send a large payload command
-  if (TRUE == IsLargePayloadCommand &&
-      // and if no problems found with sending large payload
-      !(FisTransportSizeSmallMb == Attribs.PayloadSize ||
-      (DIMM_MEDIA_NOT_ACCESSIBLE(pDimm->BootStatusBitmask)) ||
-      (pDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY))) {
-
-    // Then allow them to do so
-    *pMethod = DimmPassthruDdrtLargePayload;
+  Hash = HashFwCmdInput(pCmd);
+  Now = FwResponseCacheNow();
+  TtlMs = gFwResponseCacheTtlMs;
+  if (IsFwResponseVolatile(pCmd) && (TtlMs == 0 || TtlMs > FW_RESPONSE_CACHE_VOLATILE_TTL_MS)) {
+    TtlMs = FW_RESPONSE_CACHE_VOLATILE_TTL_MS;
+  }
+  for (Index = 0; Index < FW_RESPONSE_CACHE_ENTRIES; Index++) {
+    pEntry = &gFwResponseCache[Index];
+    if (!pEntry->Valid || pEntry->DimmHandle != DimmHandle || pEntry->InputHash != Hash ||
+        pEntry->Opcode != pCmd->Opcode || pEntry->SubOpcode != pCmd->SubOpcode ||
+        pEntry->InputPayloadSize != pCmd->InputPayloadSize ||
+        pEntry->OutputPayloadSize != pCmd->OutputPayloadSize ||
+        CompareMem(pEntry->InputPayload, pCmd->InputPayload, pCmd->InputPayloadSize) != 0) {
+      continue;
+    }
+    if (TtlMs != 0 && Now - pEntry->TimestampMs > TtlMs) {
+      pEntry->Valid = FALSE;
+      break;
+    }
+    CopyMem_S(pCmd->OutPayload, sizeof(pCmd->OutPayload), pEntry->OutPayload, pEntry->OutputPayloadSize);
+    pCmd->Status = pEntry->Status;
+#ifdef OS_BUILD
+    pCmd->DsmStatus = 0;
+#endif // OS_BUILD
+    Hit = TRUE;
+    break;
+  }
 
-  // Otherwise prefer small payload DDRT
-  } else if (!(pDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY)) {
-    *pMethod = DimmPassthruDdrtSmallPayload;
+  if (Hit) {
+    gFwResponseCacheStats.Hits++;
   } else {
-    // Otherwise last resort is small payload smbus
-    *pMethod = DimmPassthruSmbusSmallPayload;
+    gFwResponseCacheStats.Misses++;
   }
 
 Finish:
-  return ReturnCode;
+  FW_RESPONSE_CACHE_UNLOCK();
+  return Hit;
 }
 
 /**
-  Check if sending a large payload command over the DDRT large payload
-  mailbox is possible. Used by callers often to determine chunking behavior.
-
-  @param[in] pDimm The DCPMM to transact with
-  @param[out] pAvailable Whether large payload is available. Pointer to boolean variable
+  Keep the response to a successfully completed read-only FW command, unless
+  the cache was invalidated while it was in flight
 
-  @retval EFI_SUCCESS Success
-  @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
+  @param[in] pDimm DIMM the command was sent to
+  @param[in] pCmd Completed FW command
+  @param[in] Generation Cache generation returned by FwResponseCacheLookup
 **/
-EFI_STATUS
-IsLargePayloadAvailable(
+STATIC
+VOID
+FwResponseCacheStore(
   IN     DIMM *pDimm,
-     OUT BOOLEAN *pAvailable
+  IN     NVM_FW_CMD *pCmd,
+  IN     UINT64 Generation
   )
 {
-  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  DIMM_PASSTHRU_METHOD Method = DimmPassthruDdrtLargePayload;
+  FW_RESPONSE_CACHE_ENTRY *pEntry = NULL;
 
-  if (pDimm == NULL || pAvailable == NULL) {
-    ReturnCode = EFI_INVALID_PARAMETER;
-    goto Finish;
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
+  }
+#endif // OS_BUILD
+  if (pCmd->Status != FW_SUCCESS || !IsFwResponseCacheable(pCmd)) {
+    return;
   }
 
-  // TRUE -> We are attempting to send a large payload command
-  // Only return true if DDRT large payload is allowed
-  CHECK_RESULT(DeterminePassThruMethod(pDimm, 0, 0, TRUE, &Method), Finish);
-  *pAvailable = DimmPassthruDdrtLargePayload == Method;
+  FW_RESPONSE_CACHE_LOCK();
+  if (gFwResponseCacheDepth > 0 && gFwResponseCacheGeneration == Generation) {
+    // Round robin replacement, the table only lives as long as the scope
+    pEntry = &gFwResponseCache[gFwResponseCacheNext];
+    gFwResponseCacheNext = (gFwResponseCacheNext + 1) % FW_RESPONSE_CACHE_ENTRIES;
 
-Finish:
-  return ReturnCode;
+    pEntry->Valid = TRUE;
+    pEntry->DimmHandle = pDimm->DeviceHandle.AsUint32;
+    pEntry->Opcode = pCmd->Opcode;
+    pEntry->SubOpcode = pCmd->SubOpcode;
+    pEntry->InputHash = HashFwCmdInput(pCmd);
+    pEntry->InputPayloadSize = pCmd->InputPayloadSize;
+    CopyMem_S(pEntry->InputPayload, sizeof(pEntry->InputPayload), pCmd->InputPayload, pCmd->InputPayloadSize);
+    pEntry->OutputPayloadSize = pCmd->OutputPayloadSize;
+    CopyMem_S(pEntry->OutPayload, sizeof(pEntry->OutPayload), pCmd->OutPayload, pCmd->OutputPayloadSize);
+    pEntry->Status = pCmd->Status;
+    pEntry->TimestampMs = FwResponseCacheNow();
+  }
+  FW_RESPONSE_CACHE_UNLOCK();
+}
+
+/**
+  Drop the cached responses a state changing FW command made stale once it
+  completed, read-only commands sent while it was in flight may have stored
+  responses from before it took effect
+
+  @param[in] pDimm DIMM the command was sent to
+  @param[in] pCmd Completed FW command
+**/
+STATIC
+VOID
+FwResponseCacheInvalidateAfter(
+  IN     DIMM *pDimm,
+  IN     NVM_FW_CMD *pCmd
+  )
+{
+#ifdef OS_BUILD
+  if (gFwResponseCacheLock == NULL) {
+    return;
+  }
+#endif // OS_BUILD
+  if (IsFwCmdReadOnly(pCmd)) {
+    return;
+  }
+
+  FW_RESPONSE_CACHE_LOCK();
+  if (gFwResponseCacheDepth > 0) {
+    InvalidateFwResponseCacheForCmd(pDimm, pCmd);
+  }
+  FW_RESPONSE_CACHE_UNLOCK();
 }
 
 EFI_STATUS
@@ -7540,8 +9324,10 @@ PassThru(
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
   DIMM_PASSTHRU_METHOD Method = DimmPassthruDdrtLargePayload;
   BOOLEAN IsLargePayloadCommand = FALSE;
+  UINT64 CacheGeneration = 0;
 
 #ifdef OS_BUILD
+  BOOLEAN Locked = FALSE;
   UINT8 InputPayloadTemp[IN_PAYLOAD_SIZE];
   NVM_INPUT_PAYLOAD_SMBUS_OS_PASSTHRU *pInputPayloadSOP = NULL;
 #endif
@@ -7551,6 +9337,19 @@ PassThru(
     goto Finish;
   }
 
+  LoadCommandEffectLogForCache(pDimm, pCmd);
+
+#ifdef OS_BUILD
+  // Commands to different DIMMs may run in parallel, one at a time per DIMM
+  Locked = (os_mutex_lock(pDimm->pPassThruLock) != 0);
+#endif
+
+  if (FwResponseCacheLookup(pDimm, pCmd, &CacheGeneration)) {
+    NVDIMM_DBG("Answered 0x%x:0x%x for DCPMM 0x%x from the FW response cache", pCmd->Opcode, pCmd->SubOpcode, pDimm->DeviceHandle.AsUint32);
+    ReturnCode = EFI_SUCCESS;
+    goto Finish;
+  }
+
   IsLargePayloadCommand = pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0;
   CHECK_RESULT(DeterminePassThruMethod(pDimm, pCmd->Opcode, pCmd->SubOpcode, IsLargePayloadCommand, &Method), Finish);
 
@@ -7616,7 +9415,166 @@ PassThru(
   }
 #endif // OS_BUILD
 
+  FwResponseCacheStore(pDimm, pCmd, CacheGeneration);
+
+Finish:
+  if (pDimm != NULL && pCmd != NULL) {
+    FwResponseCacheInvalidateAfter(pDimm, pCmd);
+  }
+#ifdef OS_BUILD
+  if (Locked) {
+    os_mutex_unlock(pDimm->pPassThruLock);
+  }
+#endif
+  return ReturnCode;
+}
+
+#ifdef OS_BUILD
+/**
+  Shared state of one DispatchPerDimm call
+**/
+typedef struct _DIMM_DISPATCH {
+  DIMM **ppDimms;
+  UINT32 DimmCount;
+  DIMM_WORK_FN pWorkFn;
+  VOID *pContext;
+  EFI_STATUS *pReturnCodes;
+  UINT32 NextIndex;
+  OS_MUTEX *pLock;
+} DIMM_DISPATCH;
+
+/**
+  Worker loop: claim the next undispatched DIMM until the list is exhausted
+
+  @param[in] pArg Pointer to the DIMM_DISPATCH state
+**/
+STATIC
+VOID *
+DispatchPerDimmWorker(
+  IN     VOID *pArg
+  )
+{
+  DIMM_DISPATCH *pDispatch = (DIMM_DISPATCH *)pArg;
+  UINT32 Index = 0;
+
+  for (;;) {
+    os_mutex_lock(pDispatch->pLock);
+    Index = pDispatch->NextIndex++;
+    os_mutex_unlock(pDispatch->pLock);
+
+    if (Index >= pDispatch->DimmCount) {
+      break;
+    }
+    pDispatch->pReturnCodes[Index] = pDispatch->pWorkFn(pDispatch->ppDimms[Index], Index, pDispatch->pContext);
+  }
+  return NULL;
+}
+#endif // OS_BUILD
+
+/**
+  Run a work item for every DIMM in a list. In the OS build, different DIMMs
+  are worked on in parallel by a bounded set of workers, and PassThru keeps
+  commands to the same DIMM serialized. Items run one after another in UEFI,
+  in PBR record/playback mode, or when worker threads can't be started.
+
+  The work item must only touch state owned by its DIMM or its own slot of
+  the caller's output.
+
+  @param[in] ppDimms List of DIMMs to work on
+  @param[in] DimmCount Number of DIMMs in ppDimms
+  @param[in] pWorkFn Work item to run for every DIMM
+  @param[in] pContext Caller context passed to every work item
+  @param[out] pReturnCodes Optional array of DimmCount per-DIMM statuses
+
+  @retval EFI_SUCCESS Every work item succeeded
+  @retval EFI_INVALID_PARAMETER ppDimms or pWorkFn is NULL
+  @retval Other The first failing status in list order
+**/
+EFI_STATUS
+DispatchPerDimm(
+  IN     DIMM **ppDimms,
+  IN     UINT32 DimmCount,
+  IN     DIMM_WORK_FN pWorkFn,
+  IN     VOID *pContext,
+     OUT EFI_STATUS *pReturnCodes OPTIONAL
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  EFI_STATUS *pCodes = pReturnCodes;
+  UINT32 Index = 0;
+#ifdef OS_BUILD
+  DIMM_DISPATCH Dispatch;
+  OS_THREAD *pWorkers[FW_DISPATCH_MAX_WORKERS];
+  UINT32 WorkerCount = 0;
+  UINT32 MaxWorkers = ConfigDispatchMaxWorkers();
+  PbrContext *pPbrContext = PBR_CTX();
+#endif
+
+  NVDIMM_ENTRY();
+
+  if (ppDimms == NULL || pWorkFn == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (DimmCount == 0) {
+    goto Finish;
+  }
+
+  if (pCodes == NULL) {
+    CHECK_RESULT_MALLOC(pCodes, AllocateZeroPool(sizeof(*pCodes) * DimmCount), Finish);
+  }
+
+  // The first DIMM always runs on the calling thread, on its own. Anything
+  // along the command path that is set up lazily on first use (SMBIOS table,
+  // logger configuration, ...) is then in place before workers start.
+  pCodes[0] = pWorkFn(ppDimms[0], 0, pContext);
+  Index = 1;
+
+#ifdef OS_BUILD
+  // PBR records and plays back commands in order, keep it sequential
+  if (DimmCount > 1 && MaxWorkers > 1 && PBR_NORMAL_MODE == PBR_GET_MODE(pPbrContext) &&
+      (Dispatch.pLock = os_mutex_init(NULL)) != NULL) {
+    Dispatch.ppDimms = ppDimms;
+    Dispatch.DimmCount = DimmCount;
+    Dispatch.pWorkFn = pWorkFn;
+    Dispatch.pContext = pContext;
+    Dispatch.pReturnCodes = pCodes;
+    Dispatch.NextIndex = 1;
+
+    // The calling thread is one of the workers
+    while (WorkerCount < MIN(DimmCount - 1, MaxWorkers) - 1) {
+      pWorkers[WorkerCount] = os_thread_create(DispatchPerDimmWorker, &Dispatch);
+      if (pWorkers[WorkerCount] == NULL) {
+        break;
+      }
+      WorkerCount++;
+    }
+    DispatchPerDimmWorker(&Dispatch);
+    for (Index = 0; Index < WorkerCount; Index++) {
+      os_thread_join(pWorkers[Index]);
+    }
+    os_mutex_delete(Dispatch.pLock, NULL);
+    Index = DimmCount;
+  }
+#endif // OS_BUILD
+
+  for (; Index < DimmCount; Index++) {
+    pCodes[Index] = pWorkFn(ppDimms[Index], Index, pContext);
+  }
+
+  for (Index = 0; Index < DimmCount; Index++) {
+    if (EFI_ERROR(pCodes[Index])) {
+      ReturnCode = pCodes[Index];
+      break;
+    }
+  }
+
 Finish:
+  if (pCodes != pReturnCodes) {
+    FREE_POOL_SAFE(pCodes);
+  }
+  NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
 
@@ -7647,7 +9605,7 @@ FwCmdGetBsr(
     goto Finish;
   }
 
-  CHECK_RESULT_MALLOC(pFwCmd, AllocateZeroPool(sizeof(*pFwCmd)), Finish);
+  CHECK_RESULT_MALLOC(pFwCmd, AllocateFwCmd(), Finish);
 
   pFwCmd->DimmID = pDimm->DimmID;
   pFwCmd->Opcode = PtEmulatedBiosCommands;
@@ -7669,7 +9627,7 @@ FwCmdGetBsr(
   }
 
 Finish:
-  FREE_POOL_SAFE(pFwCmd);
+  FREE_FW_CMD_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -7802,6 +9760,9 @@ BlockMixedSku(
     goto Finish;
   }
 
+  // The consistency is only known once every DIMM reported its SKU
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   if (gNvmDimmData->PMEMDev.DimmSkuConsistency == FALSE) {
     ReturnCode = EFI_UNSUPPORTED;
     ResetCmdStatus(pCommandStatus, NVM_ERR_OPERATION_NOT_SUPPORTED_BY_MIXED_SKU);
@@ -176,6 +176,24 @@ typedef struct _BLOCK_WINDOW {
   UINT32 NumSegmentsOfApt;     //!< Number of segments of the interleaved aperture
 } BLOCK_WINDOW;
 
+// All possible combinations of transport and mailbox size
+typedef enum _DIMM_PASSTHRU_METHOD {
+  DimmPassthruDdrtLargePayload = 0,
+  DimmPassthruDdrtSmallPayload = 1,
+  DimmPassthruSmbusSmallPayload = 2
+} DIMM_PASSTHRU_METHOD;
+
+/**
+  Passthru method resolved by DeterminePassThruMethod for one payload class.
+  Only valid while the transport attributes generation and the boot status
+  bitmask it was derived from are unchanged.
+**/
+typedef struct _PASSTHRU_METHOD_CACHE {
+  UINT32 Generation;                       //!< Transport attributes generation, 0 if never resolved
+  UINT16 BootStatusBitmask;                //!< Boot status bitmask the method was derived from
+  DIMM_PASSTHRU_METHOD Method;
+} PASSTHRU_METHOD_CACHE;
+
 typedef struct _DIMM {
   LIST_ENTRY DimmNode;
   UINT64 Signature;
@@ -292,6 +310,10 @@ typedef struct _DIMM {
 
   DIMM_BSR Bsr;
   UINT16 BootStatusBitmask;
+  PASSTHRU_METHOD_CACHE PassThruMethodCache[2]; //!< Indexed by IsLargePayloadCommand
+  COMMAND_EFFECT_LOG_ENTRY *pCommandEffectLog; //!< CEL used to decide which cached FW responses a command invalidates
+  UINT32 CommandEffectLogCount;
+  BOOLEAN CommandEffectLogLoaded;               //!< The CEL was requested, pCommandEffectLog may still be NULL on failure
 
   /*
   A pointer to a cached copy of the LABEL_STORAGE_AREA for this DIMM. This
@@ -307,6 +329,17 @@ typedef struct _DIMM {
     have been initialized using PCD in OS.
   **/
   BOOLEAN PcdMappedMemInfoRead;
+
+  VOID *pPassThruLock;                          //!< Serializes FW commands sent to this DIMM
+  VOID *pApiLock;                               //!< Serializes the NVM API calls on this DIMM, taken before pPassThruLock
+
+  /**
+    Flag to indicate that the FW-derived fields (boot status, identify,
+    partition info, PCD sizes, security state) have been initialized.
+    In OS the inventory only holds NFIT stubs until a DIMM is first used,
+    see HydrateDimm.
+  **/
+  BOOLEAN Hydrated;
 #endif
   UINT8 FwActiveApiVersionMajor;               //!< Specifies the FW Active Api major version
   UINT8 FwActiveApiVersionMinor;               //!< Specifies the FW Active Api minor version
@@ -317,6 +350,24 @@ typedef struct _DIMM {
 #define DIMM_SIGNATURE     SIGNATURE_64('\0', '\0', '\0', '\0', 'D', 'I', 'M', 'M')
 #define DIMM_FROM_NODE(a)  CR(a, DIMM, DimmNode, DIMM_SIGNATURE)
 
+#define DIMM_REGISTRY_BUCKET_BITS  8
+#define DIMM_REGISTRY_BUCKETS      (1 << DIMM_REGISTRY_BUCKET_BITS)   //!< Keeps the tables at most half full
+
+/**
+  Hash indexes over the DIMM list of the PMEM_DEV, rebuilt when DIMMs are
+  added or removed. Open addressing with linear probing, DIMMs sharing a
+  key are found in list order.
+**/
+typedef struct _DIMM_REGISTRY {
+  BOOLEAN Valid;                                //!< The indexes match the DIMM list
+  UINT32 DimmCount;
+  DIMM *pByIndex[MAX_DIMMS];                    //!< List order
+  DIMM *pByPid[DIMM_REGISTRY_BUCKETS];
+  DIMM *pByHandle[DIMM_REGISTRY_BUCKETS];
+  DIMM *pBySerial[DIMM_REGISTRY_BUCKETS];
+  DIMM *pByUid[DIMM_REGISTRY_BUCKETS];          //!< Keyed by the NVDIMM UID, see GetDimmUid
+} DIMM_REGISTRY;
+
 #define MEMMAP_RANGE_UNDEFINED               1
 #define MEMMAP_RANGE_RESERVED                2
 #define MEMMAP_RANGE_VOLATILE                3
@@ -349,13 +400,6 @@ typedef struct _MEMMAP_RANGE {
 #define MAX_FW_UPDATE_RETRY_ON_DEV_BUSY   10 // Account for ARS potentially getting restarted a few times in the background
 #define DSM_RETRY_SUGGESTED               0x5
 
-// All possible combinations of transport and mailbox size
-typedef enum _DIMM_PASSTHRU_METHOD {
-  DimmPassthruDdrtLargePayload = 0,
-  DimmPassthruDdrtSmallPayload = 1,
-  DimmPassthruSmbusSmallPayload = 2
-} DIMM_PASSTHRU_METHOD;
-
 #ifdef OS_BUILD
 #define INI_PREFERENCES_LARGE_PAYLOAD_DISABLED L"LARGE_PAYLOAD_DISABLED"
 /*
@@ -372,6 +416,22 @@ BOOLEAN ConfigIsLargePayloadDisabled();
 * It returns TRUE in case of DDRT protocol access is disabled and FALSE otherwise
 */
 BOOLEAN ConfigIsDdrtProtocolDisabled();
+
+#define INI_PREFERENCES_DIMM_DISPATCH_WORKERS L"DIMM_DISPATCH_WORKERS"
+
+/*
+* Function get the number of DIMMs DispatchPerDimm may work on at the same time
+*
+* It returns FW_DISPATCH_MAX_WORKERS unless the ini configuration sets a lower, non-zero value
+*/
+UINT32 ConfigDispatchMaxWorkers();
+
+/*
+* Function overrides the ini configuration of ConfigDispatchMaxWorkers for the rest of the process
+*
+* Workers is capped to FW_DISPATCH_MAX_WORKERS, 0 goes back to the ini configuration
+*/
+VOID SetDispatchMaxWorkersOverride(UINT32 Workers);
 #endif // OS_BUILD
 
 EFI_STATUS
@@ -394,6 +454,42 @@ RemoveDimmInventory(
   IN OUT struct _PMEM_DEV *pDev
   );
 
+/**
+  Find the next DIMM having the same NVDIMM UID as a given DIMM
+  Two DIMMs without a valid UID are considered to have the same one, like
+  the empty strings GetDimmUid returns for them.
+
+  @param[in] pDimm The DIMM to find a duplicate of
+  @param[in] pPrevious The duplicate found by the previous call, NULL to start
+
+  @retval DIMM struct pointer of the next duplicate
+  @retval NULL pointer if there are no more
+**/
+DIMM *
+GetNextDimmWithSameUid(
+  IN     DIMM *pDimm,
+  IN     DIMM *pPrevious OPTIONAL
+  );
+
+/**
+  Find the next DIMM having a given NVDIMM UID string, without formatting
+  the UID of every DIMM. The empty string finds the DIMMs without a valid UID,
+  like GetDimmUid returns for them.
+
+  @param[in] pDimms The head of the dimm list
+  @param[in] pDimmUid The UID, as GetDimmUid formats it
+  @param[in] pPrevious The DIMM found by the previous call, NULL to start
+
+  @retval DIMM struct pointer of the next DIMM having the UID
+  @retval NULL pointer if there are no more
+**/
+DIMM *
+GetNextDimmByUid(
+  IN     LIST_ENTRY *pDimms,
+  IN     CONST CHAR16 *pDimmUid,
+  IN     DIMM *pPrevious OPTIONAL
+  );
+
 /**
   Get dimm by Dimm ID
   Scan the dimm list for a dimm identified by Dimm ID
@@ -614,6 +710,57 @@ InitializeDimm (
   IN     ParsedPmttHeader *pPmttHead,
   IN     UINT16 Pid
   );
+
+/**
+  Initialize the FW-derived fields of a DIMM created from NFIT only
+
+  In OS the DIMM inventory is built from the ACPI tables and each DIMM is
+  initialized from FW on first use, so commands targeting a few DIMMs
+  don't pay for the whole population. Does nothing if the DIMM has
+  already been initialized, or outside of OS. A DIMM failing to
+  initialize is marked non-functional.
+
+  @param[in] pDimm The DIMM to initialize
+
+  @retval EFI_SUCCESS The DIMM is initialized, functional or not
+  @retval EFI_INVALID_PARAMETER pDimm is NULL
+**/
+EFI_STATUS
+HydrateDimm(
+  IN     DIMM *pDimm
+  );
+
+/**
+  Initialize the FW-derived fields of every DIMM in the list not
+  initialized yet, see HydrateDimm. Must be called before the list is
+  walked for state only FW provides, like NonFunctional.
+
+  @param[in] pDimms The head of the dimm list
+
+  @retval EFI_SUCCESS The DIMMs are initialized, functional or not
+  @retval EFI_INVALID_PARAMETER pDimms is NULL
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+HydrateDimms(
+  IN     LIST_ENTRY *pDimms
+  );
+
+/**
+  Get dimm by Dimm ID with its FW-derived fields initialized
+  Same as GetDimmByPid followed by HydrateDimm on the match
+
+  @param[in] DimmID: The SMBIOS Type 17 handle of the dimm
+  @param[in] pDimms: The head of the dimm list
+
+  @retval DIMM struct pointer if matching dimm has been found
+  @retval NULL pointer if not found
+**/
+DIMM *
+GetHydratedDimmByPid(
+  IN     UINT32 DimmID,
+  IN     LIST_ENTRY *pDimms
+  );
 /**
   Check if the DIMM containing the specified DIMM ID is
   manageable by the driver
@@ -1637,6 +1784,18 @@ IsDimmSkuModeMismatch(
   IN     DIMM *pDimm2
   );
 
+/**
+  Compare the SKU of every DIMM with the first one and record the result
+  in DimmSkuConsistency and the MixedSKUOffender field of each DIMM.
+  DIMMs not initialized from FW yet have no SKU and are not offenders.
+
+  @param[in,out] pDev The pmem super structure
+**/
+VOID
+CheckDimmSkuConsistency(
+  IN OUT struct _PMEM_DEV *pDev
+  );
+
 /**
   Calculate a size of capacity considered Reserved. It is the aligned PM
   capacity less the mapped AD capacity
@@ -2051,6 +2210,14 @@ DeterminePassThruMethod(
      OUT DIMM_PASSTHRU_METHOD *pMethod
 );
 
+/**
+  Drop every memoized passthru method. Called when the FIS transport
+  attributes change.
+**/
+VOID
+InvalidatePassThruMethodCache(
+  );
+
 /**
   Set Obj Status when DIMM is not found using Id expected by end user
 
@@ -2113,6 +2280,145 @@ IsLargePayloadAvailable(
      OUT BOOLEAN *pAvailable
   );
 
+/**
+  FW command pool statistics
+**/
+typedef struct _FW_CMD_POOL_STATS {
+  UINT64 Requests;         //!< Number of FW commands handed out by AllocateFwCmd
+  UINT64 Reused;           //!< Number of requests served from the pool
+  UINT64 BytesAllocated;   //!< Bytes obtained from the heap for FW commands
+  UINT64 BytesCleared;     //!< Bytes zeroed when returning FW commands to the pool
+} FW_CMD_POOL_STATS;
+
+#define FW_CMD_POOL_DEPTH   4   //!< Number of idle FW commands kept for reuse
+
+#define FREE_FW_CMD_SAFE(pFwCmd) { \
+  if (pFwCmd != NULL) { \
+    FreeFwCmd(pFwCmd); \
+    pFwCmd = NULL; \
+  } \
+}
+
+/**
+  Set up the FW command pool
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the pool lock
+**/
+EFI_STATUS
+InitializeFwCmdPool(
+  );
+
+/**
+  Release every FW command kept in the pool
+**/
+VOID
+UninitializeFwCmdPool(
+  );
+
+/**
+  Get a zeroed FW command, reusing one from the pool when possible
+
+  @retval Pointer to the FW command, NULL on allocation failure
+**/
+NVM_FW_CMD *
+AllocateFwCmd(
+  );
+
+/**
+  Return a FW command obtained from AllocateFwCmd. Only the header and the
+  large payload bytes described by the command sizes are cleared before the
+  command is kept for reuse.
+
+  @param[in] pFwCmd FW command to release
+**/
+VOID
+FreeFwCmd(
+  IN     NVM_FW_CMD *pFwCmd
+  );
+
+/**
+  Get the FW command pool statistics
+
+  @param[out] pStats Pointer to the statistics structure to fill
+**/
+VOID
+GetFwCmdPoolStats(
+     OUT FW_CMD_POOL_STATS *pStats
+  );
+
+/**
+  FW response cache statistics
+**/
+typedef struct _FW_RESPONSE_CACHE_STATS {
+  UINT64 Hits;             //!< Commands answered from the cache
+  UINT64 Misses;           //!< Cacheable commands that had to be sent to the DIMM
+  UINT64 Invalidations;    //!< Entries dropped because a state changing command was sent
+} FW_RESPONSE_CACHE_STATS;
+
+#define FW_RESPONSE_CACHE_ENTRIES   64  //!< Number of read-only FW responses kept per cache scope
+#define FW_RESPONSE_CACHE_VOLATILE_TTL_MS 1000  //!< Maximum age of a replayed sensor, health or log response
+
+/**
+  Set up the FW response cache. The cache starts disabled.
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the cache lock
+**/
+EFI_STATUS
+InitializeFwResponseCache(
+  );
+
+/**
+  Drop every cached FW response and release the cache lock
+**/
+VOID
+UninitializeFwResponseCache(
+  );
+
+/**
+  Open a FW response cache scope. While at least one scope is open, successful
+  small payload responses to read-only commands (identify, get security info and
+  most get features/admin features/log pages) are kept and replayed to later
+  identical requests. Scopes nest; the cache is flushed when the last one closes.
+  Sensor, health, memory info and error log responses are never replayed once
+  older than FW_RESPONSE_CACHE_VOLATILE_TTL_MS.
+
+  @param[in] TtlMs Maximum age of a replayed response in milliseconds,
+    0 to keep responses for the lifetime of the scope. Ignored in UEFI.
+**/
+VOID
+FwResponseCacheBegin(
+  IN     UINT64 TtlMs
+  );
+
+/**
+  Close a FW response cache scope opened with FwResponseCacheBegin
+**/
+VOID
+FwResponseCacheEnd(
+  );
+
+/**
+  Drop cached FW responses
+
+  @param[in] pDimm DIMM whose responses are dropped, NULL to drop all
+**/
+VOID
+InvalidateFwResponseCache(
+  IN     DIMM *pDimm OPTIONAL
+  );
+
+/**
+  Get the FW response cache statistics
+
+  @param[out] pStats Pointer to the statistics structure to fill
+**/
+VOID
+GetFwResponseCacheStats(
+     OUT FW_RESPONSE_CACHE_STATS *pStats
+  );
+
 EFI_STATUS
 PassThru(
   IN     struct _DIMM *pDimm,
@@ -2120,6 +2426,53 @@ PassThru(
   IN     UINT64 Timeout
 );
 
+/**
+  Work item run by DispatchPerDimm for a single DIMM
+
+  @param[in] pDimm The DIMM to work on
+  @param[in] Index Position of pDimm in the dispatched list
+  @param[in] pContext Caller context passed to DispatchPerDimm
+
+  @retval Status of the work item, stored in pReturnCodes[Index]
+**/
+typedef
+EFI_STATUS
+(*DIMM_WORK_FN)(
+  IN     DIMM *pDimm,
+  IN     UINT32 Index,
+  IN     VOID *pContext
+  );
+
+#define FW_DISPATCH_MAX_WORKERS   16  //!< Upper bound on DIMMs worked on at the same time
+
+/**
+  Run a work item for every DIMM in a list. In the OS build, different DIMMs
+  are worked on in parallel by a bounded set of workers, and PassThru keeps
+  commands to the same DIMM serialized. Items run one after another in UEFI,
+  in PBR record/playback mode, or when worker threads can't be started.
+
+  The work item must only touch state owned by its DIMM or its own slot of
+  the caller's output.
+
+  @param[in] ppDimms List of DIMMs to work on
+  @param[in] DimmCount Number of DIMMs in ppDimms
+  @param[in] pWorkFn Work item to run for every DIMM
+  @param[in] pContext Caller context passed to every work item
+  @param[out] pReturnCodes Optional array of DimmCount per-DIMM statuses
+
+  @retval EFI_SUCCESS Every work item succeeded
+  @retval EFI_INVALID_PARAMETER ppDimms or pWorkFn is NULL
+  @retval Other The first failing status in list order
+**/
+EFI_STATUS
+DispatchPerDimm(
+  IN     DIMM **ppDimms,
+  IN     UINT32 DimmCount,
+  IN     DIMM_WORK_FN pWorkFn,
+  IN     VOID *pContext,
+     OUT EFI_STATUS *pReturnCodes OPTIONAL
+  );
+
 /**
   Makes Bios emulated pass through call and acquires the DCPMM Boot
   Status Register
@@ -9,6 +9,8 @@
 #include "Namespace.h"
 #ifndef OS_BUILD
 #include <Dcpmm.h>
+#else
+#include <os_efi_startup_profile.h>
 #endif
 #include <AcpiParsing.h>
 #include "Region.h"
@@ -2411,6 +2413,11 @@ InitializeNamespaces(
   LABEL_STORAGE_AREA *pLsa = NULL;
 
   NVDIMM_ENTRY();
+#ifdef OS_BUILD
+  startup_profile_begin(StartupPhaseNamespaces);
+#endif
+
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
 
   LIST_FOR_EACH(pNode, &gNvmDimmData->PMEMDev.Dimms) {
     pDimm = DIMM_FROM_NODE(pNode);
@@ -2484,6 +2491,9 @@ Finish:
     }
   }
 
+#ifdef OS_BUILD
+  startup_profile_end(StartupPhaseNamespaces);
+#endif
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
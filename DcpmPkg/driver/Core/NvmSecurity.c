@@ -44,7 +44,7 @@ GetDimmSecurityState(
     goto Finish;
   }
 
-  pPassThruCommand = AllocateZeroPool(sizeof(*pPassThruCommand));
+  pPassThruCommand = AllocateFwCmd();
   if (pPassThruCommand == NULL) {
     NVDIMM_ERR("Out of memory.");
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -71,7 +71,7 @@ GetDimmSecurityState(
   ReturnCode = EFI_SUCCESS;
 
 FinishFreeMem:
-  FREE_POOL_SAFE(pPassThruCommand);
+  FREE_FW_CMD_SAFE(pPassThruCommand);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -118,7 +118,7 @@ SetDimmSecurityState(
     goto Finish;
   }
 
-  pPassThruCommand = AllocateZeroPool(sizeof(*pPassThruCommand));
+  pPassThruCommand = AllocateFwCmd();
   if (pPassThruCommand == NULL) {
     NVDIMM_ERR("Out of memory.");
     ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -146,7 +146,7 @@ SetDimmSecurityState(
   ReturnCode = EFI_SUCCESS;
 
 FinishFreeMem:
-  FREE_POOL_SAFE(pPassThruCommand);
+  FREE_FW_CMD_SAFE(pPassThruCommand);
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -12,9 +12,48 @@
 #include <NvmWorkarounds.h>
 #include <NvmSecurity.h>
 #include <Convert.h>
+#ifdef OS_BUILD
+#include <os.h>
+#include <os_efi_startup_profile.h>
+#endif
 
 extern NVMDIMMDRIVER_DATA *gNvmDimmData;
 
+/**
+  Serializes the lazy build of the region lists, readers holding the shared
+  API lock may reach GetRegionList concurrently
+**/
+#ifdef OS_BUILD
+STATIC OS_MUTEX *gRegionListLock = NULL;
+#define REGION_LIST_LOCK()    os_mutex_lock(gRegionListLock)
+#define REGION_LIST_UNLOCK()  os_mutex_unlock(gRegionListLock)
+#else
+#define REGION_LIST_LOCK()
+#define REGION_LIST_UNLOCK()
+#endif // OS_BUILD
+
+/**
+  Set up the lock guarding the lazy build of the region lists
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the lock
+**/
+EFI_STATUS
+InitializeRegionListLock(
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+#ifdef OS_BUILD
+  if (gRegionListLock == NULL) {
+    gRegionListLock = os_mutex_init(NULL);
+    if (gRegionListLock == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+    }
+  }
+#endif // OS_BUILD
+  return ReturnCode;
+}
+
 STATIC
 INT32
 CompareRegionOffsetInDimmRegion(
@@ -190,6 +229,8 @@ InitializeISs(
     goto Finish;
   }
 
+  HydrateDimms(pDimmList);
+
   if (!UseNfit) {
     ReturnCode = RetrieveISsFromPlatformConfigData(pFitHead, pDimmList, pISList);
     if (EFI_ERROR(ReturnCode)) {
@@ -225,10 +266,17 @@ InitializeInterleaveSets(
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
+  REGION_LIST_LOCK();
   if (UseNfit ? !gNvmDimmData->PMEMDev.RegionsNfitInitialized :
     !gNvmDimmData->PMEMDev.RegionsAndNsInitialized) {
+#ifdef OS_BUILD
+    startup_profile_begin(StartupPhaseInterleaveSets);
+#endif
     ReturnCode = InitializeISs(gNvmDimmData->PMEMDev.pFitHead, &gNvmDimmData->PMEMDev.Dimms,
       UseNfit, (UseNfit ? &gNvmDimmData->PMEMDev.ISsNfit : &gNvmDimmData->PMEMDev.ISs));
+#ifdef OS_BUILD
+    startup_profile_end(StartupPhaseInterleaveSets);
+#endif
     if (EFI_ERROR(ReturnCode)) {
       NVDIMM_WARN("Failed to retrieve the REGION list, error = " FORMAT_EFI_STATUS ".", ReturnCode);
     }
@@ -241,6 +289,7 @@ InitializeInterleaveSets(
       }
     }
   }
+  REGION_LIST_UNLOCK();
 
   return ReturnCode;
 }
@@ -296,6 +345,7 @@ GetRegionList(
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
+  REGION_LIST_LOCK();
   if (UseNfit ? !gNvmDimmData->PMEMDev.RegionsNfitInitialized :
     !gNvmDimmData->PMEMDev.RegionsAndNsInitialized) {
     ReturnCode = InitializeISs(gNvmDimmData->PMEMDev.pFitHead, &gNvmDimmData->PMEMDev.Dimms,
@@ -312,6 +362,7 @@ GetRegionList(
       }
     }
   }
+  REGION_LIST_UNLOCK();
 
   if (NULL != ppRegionList) {
     if (!UseNfit) {
@@ -1965,6 +2016,8 @@ RetrieveGoalConfigsFromPlatformConfigData(
     goto Finish;
   }
 
+  HydrateDimms(pDimmList);
+
   ReturnCode = ClearInternalGoalConfigsInfo(pDimmList);
   if (EFI_ERROR(ReturnCode)) {
     goto FinishError;
@@ -5227,6 +5280,8 @@ CheckIfAllDimmsConfigured(
     goto Finish;
   }
 
+  HydrateDimms(pDimmList);
+
   LIST_FOR_EACH(pDimmNode, pDimmList) {
     pDimm = DIMM_FROM_NODE(pDimmNode);
 
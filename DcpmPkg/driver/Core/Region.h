@@ -160,6 +160,16 @@ InitializeISs(
      OUT LIST_ENTRY *pISList
   );
 
+/**
+  Set up the lock guarding the lazy build of the region lists
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the lock
+**/
+EFI_STATUS
+InitializeRegionListLock(
+  );
+
 /**
   Initialize interleave sets
   It initializes the interleave sets using NFIT or PCD
@@ -23,6 +23,8 @@
 #include <PbrDcpmm.h>
 #ifndef OS_BUILD
 #include <Smbus.h>
+#else
+#include <os_efi_startup_profile.h>
 #endif
 
 #if _BullseyeCoverage
@@ -322,6 +324,15 @@ NvmDimmDriverUnload(
   /** Uninitialize data associated with Playback and Record**/
   PbrUninit();
 
+  /** Release FW commands kept for reuse **/
+  UninitializeFwCmdPool();
+
+  /** Drop cached FW responses **/
+  UninitializeFwResponseCache();
+
+  /** Release the SMBIOS memory device index **/
+  UninitializeSmbiosMemoryDeviceIndex();
+
 #ifndef OS_BUILD
   EFI_STATUS TempReturnCode = EFI_SUCCESS;
   EFI_HANDLE *pHandleBuffer = NULL;
@@ -760,6 +771,35 @@ NvmDimmDriverDriverEntryPoint(
     NVDIMM_ERR("Failed to initialize PBR module, error = " FORMAT_EFI_STATUS ".\n", ReturnCode);
     goto Finish;
   }
+  /**
+    Set up the FW command pool shared by all passthru helpers
+  **/
+  ReturnCode = InitializeFwCmdPool();
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to initialize FW command pool, error = " FORMAT_EFI_STATUS ".\n", ReturnCode);
+    goto Finish;
+  }
+  /**
+    Set up the FW response cache used by read-mostly callers
+  **/
+  ReturnCode = InitializeFwResponseCache();
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to initialize FW response cache, error = " FORMAT_EFI_STATUS ".\n", ReturnCode);
+    goto Finish;
+  }
+  /**
+    Set up the locks guarding the region lists and SMBIOS index built on first use
+  **/
+  ReturnCode = InitializeRegionListLock();
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to initialize region list lock, error = " FORMAT_EFI_STATUS ".\n", ReturnCode);
+    goto Finish;
+  }
+  ReturnCode = InitializeSmbiosMemoryDeviceIndex();
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to initialize SMBIOS memory device index, error = " FORMAT_EFI_STATUS ".\n", ReturnCode);
+    goto Finish;
+  }
   /**
     This is the sample usage of the OutputCheckpoint function.
     The minor and major codes are custom. The BIOS scratchpad must be set to this value before the code gets there.
@@ -1109,9 +1149,6 @@ InitializeDimms()
    DIMM *pDimm = NULL;
    DIMM *pDimm2 = NULL;
    LIST_ENTRY *pDimmNode = NULL;
-   LIST_ENTRY *pDimmNode2 = NULL;
-   CHAR16 Dimm1Uid[MAX_DIMM_UID_LENGTH];
-   CHAR16 Dimm2Uid[MAX_DIMM_UID_LENGTH];
 
    NVDIMM_ENTRY();
 
@@ -1144,27 +1181,20 @@ InitializeDimms()
       continue;
     }
 
-    LIST_FOR_EACH(pDimmNode2, &gNvmDimmData->PMEMDev.Dimms) {
-      pDimm2 = DIMM_FROM_NODE(pDimmNode2);
+    for (pDimm2 = GetNextDimmWithSameUid(pDimm, NULL); pDimm2 != NULL; pDimm2 = GetNextDimmWithSameUid(pDimm, pDimm2)) {
       if (IsDimmManageable(pDimm2)) {
-        ZeroMem(Dimm1Uid, sizeof(Dimm1Uid));
-        ZeroMem(Dimm2Uid, sizeof(Dimm2Uid));
-        GetDimmUid(pDimm, Dimm1Uid, MAX_DIMM_UID_LENGTH);
-        GetDimmUid(pDimm2, Dimm2Uid, MAX_DIMM_UID_LENGTH);
-        if (pDimm != pDimm2 && (StrICmp(Dimm1Uid,Dimm2Uid) == 0)) {
-          NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
+        NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
 
 #if defined(DYNAMIC_WA_ENABLE)
-          if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
-            NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
-          } else {
+        if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
+          NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
+        } else {
 #endif
-            ReturnCode = EFI_DEVICE_ERROR;
-            goto Finish;
+          ReturnCode = EFI_DEVICE_ERROR;
+          goto Finish;
 #if defined(DYNAMIC_WA_ENABLE)
-          }
-#endif
         }
+#endif
       }
     }
    }
@@ -1352,9 +1382,6 @@ NvmDimmDriverDriverBindingStart(
    DIMM *pDimm = NULL;
    DIMM *pDimm2 = NULL;
    LIST_ENTRY *pDimmNode = NULL;
-   LIST_ENTRY *pDimmNode2 = NULL;
-   CHAR16 Dimm1Uid[MAX_DIMM_UID_LENGTH];
-   CHAR16 Dimm2Uid[MAX_DIMM_UID_LENGTH];
 
 
    NVDIMM_ENTRY();
@@ -1368,7 +1395,9 @@ NvmDimmDriverDriverBindingStart(
    /**
    load the ACPI Tables (NFIT, PCAT, PMTT)
    **/
+   startup_profile_begin(StartupPhaseAcpiTables);
    ReturnCode = initAcpiTables();
+   startup_profile_end(StartupPhaseAcpiTables);
    if (EFI_ERROR(ReturnCode)) {
       NVDIMM_WARN("Failed to initialize the ACPI tables, error = " FORMAT_EFI_STATUS ".", ReturnCode);
       goto Finish;
@@ -1386,7 +1415,9 @@ NvmDimmDriverDriverBindingStart(
    /**
    enumerate DCPMMs
    **/
+   startup_profile_begin(StartupPhaseDimmInventory);
    ReturnCode = FillDimmList();
+   startup_profile_end(StartupPhaseDimmInventory);
    if (EFI_ERROR(ReturnCode)) {
       NVDIMM_WARN("Failed to initialize Dimms, error = " FORMAT_EFI_STATUS ".", ReturnCode);
    }
@@ -1394,34 +1425,28 @@ NvmDimmDriverDriverBindingStart(
    /**
    Verify that all manageable NVM-DIMMs have unique identifier. Otherwise, print a critical error and
    break further initialization.
+   The UID comes from NFIT, the DIMMs are only initialized from FW to tell
+   if they are manageable when their UIDs collide.
    **/
    LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
       pDimm = DIMM_FROM_NODE(pDimmNode);
-      if (!IsDimmManageable(pDimm)) {
-         continue;
-      }
 
-      LIST_FOR_EACH(pDimmNode2, &gNvmDimmData->PMEMDev.Dimms) {
-         pDimm2 = DIMM_FROM_NODE(pDimmNode2);
-         if (IsDimmManageable(pDimm2)) {
-            ZeroMem(Dimm1Uid, sizeof(Dimm1Uid));
-            ZeroMem(Dimm2Uid, sizeof(Dimm2Uid));
-            GetDimmUid(pDimm, Dimm1Uid, MAX_DIMM_UID_LENGTH);
-            GetDimmUid(pDimm2, Dimm2Uid, MAX_DIMM_UID_LENGTH);
-            if (pDimm != pDimm2 && (StrICmp(Dimm1Uid, Dimm2Uid) == 0)) {
-               NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
+      for (pDimm2 = GetNextDimmWithSameUid(pDimm, NULL); pDimm2 != NULL; pDimm2 = GetNextDimmWithSameUid(pDimm, pDimm2)) {
+         HydrateDimm(pDimm);
+         HydrateDimm(pDimm2);
+         if (IsDimmManageable(pDimm) && IsDimmManageable(pDimm2)) {
+            NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
 
 #if defined(DYNAMIC_WA_ENABLE)
-               if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
-                  NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
-               } else {
+            if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
+               NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
+            } else {
 #endif
-                  ReturnCode = EFI_DEVICE_ERROR;
-                  goto Finish;
+               ReturnCode = EFI_DEVICE_ERROR;
+               goto Finish;
 #if defined(DYNAMIC_WA_ENABLE)
-               }
-#endif
             }
+#endif
          }
       }
    }
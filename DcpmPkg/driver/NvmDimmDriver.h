@@ -100,6 +100,7 @@ extern EFI_DCPMM_PBR_PROTOCOL gNvmDimmDriverNvmDimmPbr;
 
 typedef struct _PMEM_DEV {
   LIST_ENTRY Dimms;
+  DIMM_REGISTRY DimmRegistry;
   LIST_ENTRY ISs;
   LIST_ENTRY ISsNfit;
   LIST_ENTRY Namespaces;
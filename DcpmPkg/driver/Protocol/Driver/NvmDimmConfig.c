@@ -111,6 +111,7 @@ EFI_DCPMM_CONFIG2_PROTOCOL gNvmDimmDriverNvmDimmConfig =
 #ifdef OS_BUILD
   GetPMONRegisters,
   SetPMONRegisters,
+  GetDimmPid,
 #endif
   GetUninitializedDimmCount,
   GetUninitializedDimms,
@@ -360,6 +361,9 @@ GetDimmCount(
     goto Finish;
   }
 
+  // Whether a DCPMM is functional is only known once initialized from FW
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   *pDimmCount = 0;
   LIST_FOR_EACH(pCurrentDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
     pCurrentDimm = DIMM_FROM_NODE(pCurrentDimmNode);
@@ -402,6 +406,9 @@ GetUninitializedDimmCount(
     goto Finish;
   }
 
+  // Whether a DCPMM is functional is only known once initialized from FW
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   *pDimmCount = 0;
   LIST_FOR_EACH(pCurrentDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
     pCurrentDimm = DIMM_FROM_NODE(pCurrentDimmNode);
@@ -1493,9 +1500,15 @@ VerifyTargetDimms (
   // Process through all dimm and socket ids to give maximal feedback, then
   // go to Finish
 
+  // Only the targeted DCPMMs need to be initialized from FW, unless there
+  // are none or they are picked by socket
+  if (DimmIdsCount == 0 || SocketIdsCount > 0) {
+    HydrateDimms(pDimmList);
+  }
+
   // Verify provided dimms ids
   for (Index = 0; Index < DimmIdsCount; Index++) {
-    pCurrentDimm = GetDimmByPid(DimmIds[Index], &gNvmDimmData->PMEMDev.Dimms);
+    pCurrentDimm = GetHydratedDimmByPid(DimmIds[Index], &gNvmDimmData->PMEMDev.Dimms);
     if (pCurrentDimm == NULL) {
       SetObjStatusForDimm(pCommandStatus, pCurrentDimm, NVM_ERR_DIMM_NOT_FOUND);
       ReturnCode = EFI_INVALID_PARAMETER;
@@ -1540,11 +1553,6 @@ VerifyTargetDimms (
   // Main loop, go through each DCPMM in platform
   LIST_FOR_EACH(pCurrentDimmNode, pDimmList) {
     pCurrentDimm = DIMM_FROM_NODE(pCurrentDimmNode);
-    // If it is not an allowed DCPMM, skip it
-    // Error was already thrown if it is a specified DCPMM
-    if (!IsDimmAllowed(pCurrentDimm, RequireDcpmmsBitfield)) {
-      continue;
-    }
 
     FoundMatchDimmId = FALSE;
     FoundMatchSocketId = FALSE;
@@ -1553,6 +1561,18 @@ VerifyTargetDimms (
         FoundMatchDimmId = TRUE;
       }
     }
+    // With DCPMMs specified by id only, the others can't be selected
+    // and may not even be initialized
+    if (DimmIdsCount > 0 && SocketIdsCount == 0 && !FoundMatchDimmId) {
+      continue;
+    }
+
+    // If it is not an allowed DCPMM, skip it
+    // Error was already thrown if it is a specified DCPMM
+    if (!IsDimmAllowed(pCurrentDimm, RequireDcpmmsBitfield)) {
+      continue;
+    }
+
     for (Index = 0; Index < SocketIdsCount; Index++) {
       if (pCurrentDimm->SocketId == SocketIds[Index]) {
         FoundMatchSocketId = TRUE;
@@ -1646,7 +1666,7 @@ VerifyNonfunctionalTargetDimms(
   if (DimmIdsCount > 0) {
     // check if specified DIMMs exist in desired state
     for (Index = 0; Index < DimmIdsCount; Index++) {
-      pCurrentDimm = GetDimmByPid(DimmIds[Index], pDimmList);
+      pCurrentDimm = GetHydratedDimmByPid(DimmIds[Index], pDimmList);
       if (pCurrentDimm == NULL) {
         NVDIMM_DBG("Failed on GetDimmByPid. Does DIMM 0x%04x exist?", DimmIds[Index]);
         AllRequestedDimmsVerified = FALSE;
@@ -1681,6 +1701,7 @@ VerifyNonfunctionalTargetDimms(
     }
   }
   else {
+    HydrateDimms(pDimmList);
     // get all dimms in system in desired state
     LIST_FOR_EACH(pCurrentDimmNode, pDimmList) {
       pCurrentDimm = DIMM_FROM_NODE(pCurrentDimmNode);
@@ -1825,6 +1846,37 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Context of the GetDimms work items
+**/
+typedef struct _GET_DIMMS_CONTEXT {
+  DIMM_INFO_CATEGORIES Categories;
+  DIMM_INFO *pDimmInfo;
+} GET_DIMMS_CONTEXT;
+
+/**
+  Fill in the DIMM_INFO of a single DIMM. DispatchPerDimm work item.
+
+  @param[in] pDimm The DIMM to read
+  @param[in] Index Slot of pDimm in the DIMM_INFO array
+  @param[in] pContext Pointer to GET_DIMMS_CONTEXT
+
+  @retval EFI_SUCCESS Always, errors are reported in the DIMM_INFO error mask
+**/
+STATIC
+EFI_STATUS
+GetDimmInfoWorker(
+  IN     DIMM *pDimm,
+  IN     UINT32 Index,
+  IN     VOID *pContext
+  )
+{
+  GET_DIMMS_CONTEXT *pGetDimmsContext = (GET_DIMMS_CONTEXT *)pContext;
+
+  GetDimmInfo(pDimm, pGetDimmsContext->Categories, &pGetDimmsContext->pDimmInfo[Index]);
+  return EFI_SUCCESS;
+}
+
 /**
   Retrieve the list of functional DCPMMs found in NFIT
 
@@ -1852,6 +1904,8 @@ GetDimms(
   UINT32 Index = 0;
   LIST_ENTRY *pNode = NULL;
   DIMM *pCurDimm = NULL;
+  DIMM *pDimmList[MAX_DIMMS];
+  GET_DIMMS_CONTEXT Context;
 
   NVDIMM_ENTRY();
 
@@ -1862,6 +1916,8 @@ GetDimms(
     goto Finish;
   }
 
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   LIST_COUNT(pNode, &gNvmDimmData->PMEMDev.Dimms, Index);
 
   if (DimmCount > Index)
@@ -1880,14 +1936,132 @@ GetDimms(
       continue;
     }
 
-    if (DimmCount <= Index) {
+    if (DimmCount <= Index || MAX_DIMMS <= Index) {
       NVDIMM_DBG("Array is too small to hold entire DIMM list");
       ReturnCode = EFI_INVALID_PARAMETER;
       goto Finish;
     }
 
-    GetDimmInfo(pCurDimm, dimmInfoCategories, &pDimms[Index]);
+    pDimmList[Index] = pCurDimm;
+    Index++;
+  }
+
+  // Each DIMM fills in its own DIMM_INFO, so the FW calls for
+  // different modules can go out in parallel
+  Context.Categories = dimmInfoCategories;
+  Context.pDimmInfo = pDimms;
+  DispatchPerDimm(pDimmList, Index, GetDimmInfoWorker, &Context, NULL);
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+
+/**
+  Retrieve the list of PMem modules from the ACPI and SMBIOS tables only.
+
+  Unlike GetDimms no FW command is sent, and in OS the DIMMs are not
+  initialized from FW. Only the fields the tables provide are filled: ids,
+  topology, vendor, device and subsystem ids, manufacturing info, serial
+  number and UID from NFIT, and memory type, part number, capacity and
+  locators from SMBIOS Type 17. The manufacturer is the NFIT vendor id.
+  A DIMM is listed unless it is already known to be non-functional, so the
+  list may be longer than the one from GetDimms.
+
+  @param[in] DimmCount The size of pDimms
+  @param[out] pDimms The PMem module list, OPTIONAL to only count the modules
+  @param[out] pDimmsNum The number of PMem modules
+
+  @retval EFI_SUCCESS The module list was returned properly
+  @retval EFI_INVALID_PARAMETER pDimmsNum is NULL
+  @retval EFI_BUFFER_TOO_SMALL pDimms can't hold every module, pDimmsNum is set
+**/
+EFI_STATUS
+GetDimmsFromTables(
+  IN     UINT32 DimmCount,
+     OUT DIMM_INFO *pDimms OPTIONAL,
+     OUT UINT32 *pDimmsNum
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  LIST_ENTRY *pNode = NULL;
+  DIMM *pCurDimm = NULL;
+  DIMM_INFO *pDimmInfo = NULL;
+  SMBIOS_STRUCTURE_POINTER DmiPhysicalDev;
+  SMBIOS_STRUCTURE_POINTER DmiDeviceMappedAddr;
+  SMBIOS_VERSION SmbiosVersion;
+  UINT32 Index = 0;
+  UINT32 Index2 = 0;
+
+  NVDIMM_ENTRY();
+
+  if (pDimmsNum == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (pDimms != NULL) {
+    SetMem(pDimms, sizeof(*pDimms) * DimmCount, 0);
+  }
+
+  LIST_FOR_EACH(pNode, &gNvmDimmData->PMEMDev.Dimms) {
+    pCurDimm = DIMM_FROM_NODE(pNode);
+    if (pCurDimm->NonFunctional == TRUE) {
+      continue;
+    }
+    if (pDimms == NULL || DimmCount <= Index) {
+      Index++;
+      continue;
+    }
+
+    pDimmInfo = &pDimms[Index];
     Index++;
+
+    pDimmInfo->DimmID = pCurDimm->DimmID;
+    pDimmInfo->DimmHandle = pCurDimm->DeviceHandle.AsUint32;
+    pDimmInfo->SocketId = pCurDimm->SocketId;
+    pDimmInfo->ImcId = pCurDimm->ImcId;
+    pDimmInfo->NodeControllerID = pCurDimm->NodeControllerID;
+    pDimmInfo->ChannelId = pCurDimm->ChannelId;
+    pDimmInfo->ChannelPos = pCurDimm->ChannelPos;
+    for (Index2 = 0; Index2 < pCurDimm->FmtInterfaceCodeNum; Index2++) {
+      pDimmInfo->InterfaceFormatCode[Index2] = pCurDimm->FmtInterfaceCode[Index2];
+    }
+    pDimmInfo->InterfaceFormatCodeNum = pCurDimm->FmtInterfaceCodeNum;
+
+    pDimmInfo->VendorId = pCurDimm->VendorId;
+    pDimmInfo->DeviceId = pCurDimm->DeviceId;
+    pDimmInfo->Rid = pCurDimm->Rid;
+    pDimmInfo->SubsystemVendorId = pCurDimm->SubsystemVendorId;
+    pDimmInfo->SubsystemDeviceId = pCurDimm->SubsystemDeviceId;
+    pDimmInfo->SubsystemRid = pCurDimm->SubsystemRid;
+    pDimmInfo->ManufacturingInfoValid = pCurDimm->ManufacturingInfoValid;
+    pDimmInfo->ManufacturingLocation = pCurDimm->ManufacturingLocation;
+    pDimmInfo->ManufacturingDate = pCurDimm->ManufacturingDate;
+    pDimmInfo->ManufacturerId = pCurDimm->VendorId;
+    pDimmInfo->SerialNumber = pCurDimm->SerialNumber;
+
+    if (EFI_ERROR(GetDimmUid(pCurDimm, pDimmInfo->DimmUid, MAX_DIMM_UID_LENGTH)) ||
+        StrLen(pDimmInfo->DimmUid) == 0) {
+      pDimmInfo->ErrorMask |= DIMM_INFO_ERROR_UID;
+    }
+
+    FillSmbiosInfo(pDimmInfo);
+    pDimmInfo->Capacity = pDimmInfo->CapacityFromSmbios;
+
+    // The part number is otherwise read from the FW identify data
+    if (!EFI_ERROR(GetDmiMemdevInfo(pCurDimm->DimmID, &DmiPhysicalDev, &DmiDeviceMappedAddr, &SmbiosVersion)) &&
+        DmiPhysicalDev.Type17 != NULL) {
+      GetSmbiosString(&DmiPhysicalDev, DmiPhysicalDev.Type17->PartNumber,
+        pDimmInfo->PartNumber, PART_NUMBER_STR_LEN);
+    }
+  }
+
+  *pDimmsNum = Index;
+  if (pDimms != NULL && DimmCount < Index) {
+    NVDIMM_DBG("Array is too small to hold entire DIMM list");
+    ReturnCode = EFI_BUFFER_TOO_SMALL;
   }
 
 Finish:
@@ -1937,6 +2111,8 @@ GetUninitializedDimms(
     goto Finish;
   }
 
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   SetMem(pDimms, sizeof(*pDimms) * DimmCount, 0); // this clears error mask as well
 
   Index = 0;
@@ -2001,7 +2177,7 @@ GetDimm(
   }
 
   SetMem(pDimmInfo, sizeof(*pDimmInfo), 0); // this clears error mask as well
-  pDimm = GetDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     NVDIMM_DBG("Failed to retrieve the DCPMM pid %x", Pid);
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -2055,7 +2231,7 @@ GetPMONRegisters(
   }
 
   SetMem(pPayloadPMONRegisters, sizeof(*pPayloadPMONRegisters), 0); // this clears error mask as well
-  pDimm = GetDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     NVDIMM_DBG("Failed to retrieve the DCPMM pid %x", Pid);
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -2104,7 +2280,7 @@ SetPMONRegisters(
     goto Finish;
   }
 
-  pDimm = GetDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(Pid, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     NVDIMM_DBG("Failed to retrieve the DCPMM pid %x", Pid);
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -2117,6 +2293,75 @@ SetPMONRegisters(
     goto Finish;
   }
 
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Resolve a dimm target to its Pid, initializing only that dimm from FW
+
+  The UID and handle are known from NFIT, so a CLI targeting a few dimms
+  doesn't need the whole list from GetDimms. Like GetDimms, only functional
+  dimms are found; UIDs shared by several dimms resolve to the first
+  functional one.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] pDimmUid The UID of the dimm, NULL to look it up by handle
+  @param[in] DimmHandle The device handle of the dimm, used if pDimmUid is NULL
+  @param[out] pPid A pointer to the Pid of the dimm
+
+  @retval EFI_SUCCESS  The Pid of a functional dimm was returned
+  @retval EFI_INVALID_PARAMETER pThis or pPid is NULL
+  @retval EFI_NOT_FOUND No functional dimm matches the target
+**/
+EFI_STATUS
+EFIAPI
+GetDimmPid(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     CONST CHAR16 *pDimmUid OPTIONAL,
+  IN     UINT32 DimmHandle,
+     OUT UINT16 *pPid
+  )
+{
+  EFI_STATUS ReturnCode = EFI_NOT_FOUND;
+  DIMM *pDimm = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pThis == NULL || pPid == NULL) {
+    NVDIMM_DBG("One or more parameters are NULL");
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (pDimmUid == NULL) {
+    pDimm = GetDimmByHandle(DimmHandle, &gNvmDimmData->PMEMDev.Dimms);
+    if (pDimm != NULL) {
+      HydrateDimm(pDimm);
+      if (pDimm->NonFunctional) {
+        pDimm = NULL;
+      }
+    }
+  } else {
+    for (pDimm = GetNextDimmByUid(&gNvmDimmData->PMEMDev.Dimms, pDimmUid, NULL);
+        pDimm != NULL;
+        pDimm = GetNextDimmByUid(&gNvmDimmData->PMEMDev.Dimms, pDimmUid, pDimm)) {
+      HydrateDimm(pDimm);
+      if (!pDimm->NonFunctional) {
+        break;
+      }
+    }
+  }
+
+  if (pDimm == NULL) {
+    NVDIMM_DBG("No functional DCPMM matches the target");
+    goto Finish;
+  }
+
+  *pPid = pDimm->DimmID;
+  ReturnCode = EFI_SUCCESS;
+
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -2588,7 +2833,7 @@ GetAlarmThresholds (
     goto Finish;
   }
 
-  pDimm = GetDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     SetObjStatus(pCommandStatus, DimmPid, NULL, 0, NVM_ERR_DIMM_NOT_FOUND, ObjectTypeDimm);
     goto Finish;
@@ -2841,7 +3086,7 @@ GetSmartAndHealth (
 
   NVDIMM_ENTRY();
 
-  pDimm = GetDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL || pHealthInfo == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
     goto Finish;
@@ -4362,6 +4607,67 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Read the performance data of a single DIMM. DispatchPerDimm work item.
+
+  @param[in] pDimm The DIMM to read
+  @param[in] Index Slot of pDimm in the output table
+  @param[in] pContext The DIMM_PERFORMANCE_DATA output table
+
+  @retval EFI_SUCCESS Success, or the DIMM is not manageable and was skipped
+  @retval EFI_DEVICE_ERROR failure of FW commands
+**/
+STATIC
+EFI_STATUS
+GetDimmPerformanceDataWorker(
+  IN     DIMM *pDimm,
+  IN     UINT32 Index,
+  IN     VOID *pContext
+)
+{
+    EFI_STATUS ReturnCode = EFI_SUCCESS;
+    DIMM_PERFORMANCE_DATA *pPerformanceData = &((DIMM_PERFORMANCE_DATA *)pContext)[Index];
+    PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0 *pPayloadMemInfoPage0 = NULL;
+    PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *pPayloadMemInfoPage1 = NULL;
+
+    if (!IsDimmManageable(pDimm)) {
+        NVDIMM_WARN("Dimm 0x%x is not manageable", pDimm->DeviceHandle.AsUint32);
+        goto Finish;
+    }
+    pPerformanceData->DimmId = pDimm->DimmID;
+
+    // Get Dimm Performance data
+    ReturnCode = FwCmdGetMemoryInfoPage(pDimm, MEMORY_INFO_PAGE_0,
+        sizeof(PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0), (VOID **)&pPayloadMemInfoPage0);
+    if (EFI_ERROR(ReturnCode)) {
+        NVDIMM_ERR("Could not read the memory info page 0; Return code 0x%08x", ReturnCode);
+        ReturnCode = EFI_DEVICE_ERROR;
+        goto Finish;
+    }
+    ReturnCode = FwCmdGetMemoryInfoPage(pDimm, MEMORY_INFO_PAGE_1,
+        sizeof(PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1), (VOID **)&pPayloadMemInfoPage1);
+    if (EFI_ERROR(ReturnCode)) {
+        NVDIMM_ERR("Could not read the memory info page 1; Return code 0x%08x", ReturnCode);
+        ReturnCode = EFI_DEVICE_ERROR;
+        goto Finish;
+    }
+
+    // Copy the data
+    pPerformanceData->MediaReads = pPayloadMemInfoPage0->MediaReads;
+    pPerformanceData->MediaWrites = pPayloadMemInfoPage0->MediaWrites;
+    pPerformanceData->ReadRequests = pPayloadMemInfoPage0->ReadRequests;
+    pPerformanceData->WriteRequests = pPayloadMemInfoPage0->WriteRequests;
+    pPerformanceData->TotalMediaReads = pPayloadMemInfoPage1->TotalMediaReads;
+    pPerformanceData->TotalMediaWrites = pPayloadMemInfoPage1->TotalMediaWrites;
+    pPerformanceData->TotalReadRequests = pPayloadMemInfoPage1->TotalReadRequests;
+    pPerformanceData->TotalWriteRequests = pPayloadMemInfoPage1->TotalWriteRequests;
+
+Finish:
+    FREE_POOL_SAFE(pPayloadMemInfoPage0);
+    FREE_POOL_SAFE(pPayloadMemInfoPage1);
+    return ReturnCode;
+}
+
 /**
 Gather info about performance on all dimms
 
@@ -4383,11 +4689,9 @@ GetDimmsPerformanceData(
 )
 {
     EFI_STATUS ReturnCode = EFI_SUCCESS;
-    DIMM *pDimm = NULL;
+    DIMM *pDimms[MAX_DIMMS];
     LIST_ENTRY *pDimmNode = NULL;
     UINT32 Index = 0;
-    PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0 *pPayloadMemInfoPage0 = NULL;
-    PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *pPayloadMemInfoPage1 = NULL;
 
     NVDIMM_ENTRY();
 
@@ -4396,6 +4700,8 @@ GetDimmsPerformanceData(
         goto Finish;
     }
 
+    HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
     // Get total DIMM count and allocate memory for the table
     ReturnCode = GetListSize(&gNvmDimmData->PMEMDev.Dimms, pDimmCount);
     if (EFI_ERROR(ReturnCode)) {
@@ -4410,50 +4716,18 @@ GetDimmsPerformanceData(
         goto Finish;
     }
 
-    LIST_FOR_UNTIL_INDEX(pDimmNode, &gNvmDimmData->PMEMDev.Dimms, *pDimmCount, Index) {
-        pDimm = DIMM_FROM_NODE(pDimmNode);
-
-        if (!IsDimmManageable(pDimm)) {
-            NVDIMM_WARN("Dimm 0x%x is not manageable", pDimm->DeviceHandle.AsUint32);
-            continue;
-        }
-        (*pDimmsPerformanceData)[Index].DimmId = pDimm->DimmID;
-
-        // Get Dimm Performance data
-        ReturnCode = FwCmdGetMemoryInfoPage(pDimm, MEMORY_INFO_PAGE_0,
-            sizeof(PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0), (VOID **)&pPayloadMemInfoPage0);
-        if (EFI_ERROR(ReturnCode)) {
-            NVDIMM_ERR("Could not read the memory info page 0; Return code 0x%08x", ReturnCode);
-            ReturnCode = EFI_DEVICE_ERROR;
-            FREE_POOL_SAFE(*pDimmsPerformanceData);
-            goto Finish;
-        }
-        ReturnCode = FwCmdGetMemoryInfoPage(pDimm, MEMORY_INFO_PAGE_1,
-            sizeof(PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1), (VOID **)&pPayloadMemInfoPage1);
-        if (EFI_ERROR(ReturnCode)) {
-            NVDIMM_ERR("Could not read the memory info page 1; Return code 0x%08x", ReturnCode);
-            ReturnCode = EFI_DEVICE_ERROR;
-            FREE_POOL_SAFE(*pDimmsPerformanceData);
-            goto Finish;
-        }
-
-        // Copy the data
-        (*pDimmsPerformanceData)[Index].MediaReads = pPayloadMemInfoPage0->MediaReads;
-        (*pDimmsPerformanceData)[Index].MediaWrites = pPayloadMemInfoPage0->MediaWrites;
-        (*pDimmsPerformanceData)[Index].ReadRequests = pPayloadMemInfoPage0->ReadRequests;
-        (*pDimmsPerformanceData)[Index].WriteRequests = pPayloadMemInfoPage0->WriteRequests;
-        (*pDimmsPerformanceData)[Index].TotalMediaReads = pPayloadMemInfoPage1->TotalMediaReads;
-        (*pDimmsPerformanceData)[Index].TotalMediaWrites = pPayloadMemInfoPage1->TotalMediaWrites;
-        (*pDimmsPerformanceData)[Index].TotalReadRequests = pPayloadMemInfoPage1->TotalReadRequests;
-        (*pDimmsPerformanceData)[Index].TotalWriteRequests = pPayloadMemInfoPage1->TotalWriteRequests;
+    LIST_FOR_UNTIL_INDEX(pDimmNode, &gNvmDimmData->PMEMDev.Dimms, MIN(*pDimmCount, MAX_DIMMS), Index) {
+        pDimms[Index] = DIMM_FROM_NODE(pDimmNode);
+    }
 
-        FREE_POOL_SAFE(pPayloadMemInfoPage0);
-        FREE_POOL_SAFE(pPayloadMemInfoPage1);
+    // Modules have independent mailboxes, read them all at once
+    ReturnCode = DispatchPerDimm(pDimms, Index, GetDimmPerformanceDataWorker, *pDimmsPerformanceData, NULL);
+    if (EFI_ERROR(ReturnCode)) {
+        FREE_POOL_SAFE(*pDimmsPerformanceData);
+        goto Finish;
     }
 
 Finish:
-    FREE_POOL_SAFE(pPayloadMemInfoPage0);
-    FREE_POOL_SAFE(pPayloadMemInfoPage1);
     NVDIMM_EXIT_I64(ReturnCode);
     return ReturnCode;
 }
@@ -7121,6 +7395,7 @@ StartDiagnostic(
 
   //Validating user-passed Dimm IDs, include all dimms if no IDs are passed
   pDimmList = &gNvmDimmData->PMEMDev.Dimms;
+  HydrateDimms(pDimmList);
   ReturnCode = GetListSize(pDimmList, &PlatformDimmsCount);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_DBG("Failed on DimmListSize");
@@ -7985,7 +8260,7 @@ GetFwDebugLog(
     goto Finish;
   }
 
-  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
 
   // If we still can't find the dimm, fail out
   if (pDimm == NULL) {
@@ -8203,7 +8478,7 @@ PassThruCommand(
     goto Finish;
   }
 
-  pDimm = GetDimmByPid(pCmd->DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(pCmd->DimmID, &gNvmDimmData->PMEMDev.Dimms);
 
   if (pDimm == NULL || !IsDimmManageable(pDimm)) {
     NVDIMM_DBG("Could not find the specified DIMM or it is unmanageable.");
@@ -8316,10 +8591,6 @@ FillDimmList(
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
   EFI_STATUS TmpReturnCode = EFI_SUCCESS;
-  NvmStatusCode StatusCode = NVM_SUCCESS;
-  LIST_ENTRY *pNode = NULL;
-  DIMM *pCurDimm = NULL;
-  DIMM *pFirstDimm = NULL;
   UINT32 ListSize = 0;
   NVDIMM_ENTRY();
 
@@ -8343,18 +8614,8 @@ FillDimmList(
     goto Finish;
   }
 
-  gNvmDimmData->PMEMDev.DimmSkuConsistency = TRUE;
-  pFirstDimm = DIMM_FROM_NODE(GetFirstNode(&gNvmDimmData->PMEMDev.Dimms));
-
-  LIST_FOR_EACH(pNode, &gNvmDimmData->PMEMDev.Dimms) {
-    pCurDimm = DIMM_FROM_NODE(pNode);
-
-    StatusCode = IsDimmSkuModeMismatch(pFirstDimm, pCurDimm);
-    if (StatusCode != NVM_SUCCESS) {
-      gNvmDimmData->PMEMDev.DimmSkuConsistency = FALSE;
-      pCurDimm->MixedSKUOffender = TRUE;
-    }
-  }
+  // In OS it is evaluated again once the DIMMs are initialized from FW
+  CheckDimmSkuConsistency(&gNvmDimmData->PMEMDev);
 
   NVDIMM_DBG("Found %d DCPMMs", ListSize);
 
@@ -8439,6 +8700,8 @@ GetTotalDcpmmCapacities(
   }
   ArgumentsNotNull = TRUE;
 
+  HydrateDimms(pDimms);
+
   // All shall be zero to start
   *pRawCapacity = *pUnconfiguredCapacity = *pAppDirectCapacity = *pReservedCapacity = *pInaccessibleCapacity = *pVolatileCapacity = 0;
 
@@ -8502,7 +8765,7 @@ GetDcpmmCapacities(
 
   NVDIMM_ENTRY();
 
-  pDimm = GetDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmPid, &gNvmDimmData->PMEMDev.Dimms);
 
   if (pDimm == NULL || pRawCapacity == NULL || pVolatileCapacity == NULL || pUnconfiguredCapacity == NULL ||
       pReservedCapacity == NULL || pAppDirectCapacity == NULL || pInaccessibleCapacity == NULL) {
@@ -9128,11 +9391,13 @@ Finish:
 
 /**
   Retrieve Smbios tables dynamically, and populate Smbios table structures
-  of type 17/20 for the specified Dimm Pid
+  of type 17/20 for the specified Dimm Pid. Structures that do not exist
+  for the DIMM have their Raw pointer set to NULL.
 
   @param[in]  DimmPid The ID of the DIMM
   @param[out] pDmiPhysicalDev Pointer to smbios table structure of type 17
   @param[out] pDmiDeviceMappedAddr Pointer to smbios table structure of type 20
+  @param[out] pSmbiosVersion Pointer to the SMBIOS version
 
   @retval EFI_INVALID_PARAMETER passed NULL argument
   @retval EFI_DEVICE_ERROR Failure to retrieve SMBIOS tables from gST
@@ -9148,42 +9413,14 @@ GetDmiMemdevInfo(
 {
   EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
 
-  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
-  SMBIOS_STRUCTURE_POINTER BoundSmBiosStruct;
-
   NVDIMM_ENTRY();
 
-  ZeroMem(&SmBiosStruct, sizeof(SmBiosStruct));
-  ZeroMem(&BoundSmBiosStruct, sizeof(BoundSmBiosStruct));
-
   if (pDmiPhysicalDev == NULL || pDmiDeviceMappedAddr == NULL || pSmbiosVersion == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
     goto Finish;
   }
 
-  GetFirstAndBoundSmBiosStructPointer(&SmBiosStruct, &BoundSmBiosStruct, pSmbiosVersion);
-  if (SmBiosStruct.Raw == NULL || BoundSmBiosStruct.Raw == NULL) {
-    goto Finish;
-  }
-  while (SmBiosStruct.Raw < BoundSmBiosStruct.Raw) {
-    if (SmBiosStruct.Hdr != NULL) {
-      if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV && SmBiosStruct.Hdr->Handle == DimmPid) {
-        pDmiPhysicalDev->Raw = SmBiosStruct.Raw;
-      } else if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV_MAPPED_ADDR &&
-                 SmBiosStruct.Type20->MemoryDeviceHandle == DimmPid) {
-        pDmiDeviceMappedAddr->Raw = SmBiosStruct.Raw;
-      }
-    } else {
-      NVDIMM_ERR("SmBios entry has invalid pointers set");
-    }
-
-    ReturnCode = GetNextSmbiosStruct(&SmBiosStruct);
-    if (EFI_ERROR(ReturnCode)) {
-      goto Finish;
-    }
-  }
-
-  ReturnCode = EFI_SUCCESS;
+  ReturnCode = GetSmbiosMemoryDevice(DimmPid, pDmiPhysicalDev, pDmiDeviceMappedAddr, pSmbiosVersion);
 
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
@@ -9679,6 +9916,8 @@ GetARSStatus(
 
   *pARSStatus = LONG_OP_STATUS_NOT_STARTED;
 
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
     pDimm = DIMM_FROM_NODE(pDimmNode);
 
@@ -9871,7 +10110,7 @@ GetDdrtIoInitInfo(
 
   ZeroMem(&DdrtIoInitInfo, sizeof(DdrtIoInitInfo));
 
-  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     goto Finish;
   }
@@ -9927,7 +10166,7 @@ GetLongOpStatus(
 
   ZeroMem(&LongOpStatus, sizeof(LongOpStatus));
 
-  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL) {
     goto Finish;
   }
@@ -10543,6 +10782,7 @@ CheckTopologyChange(
   // Check if any DIMMs are non-functional
   // Can't check topology if a DIMM is non-functional
   pDimmList = &gNvmDimmData->PMEMDev.Dimms;
+  HydrateDimms(pDimmList);
 
   LIST_FOR_EACH(pCurrentDimmNode, pDimmList) {
     pCurrentDimm = DIMM_FROM_NODE(pCurrentDimmNode);
@@ -11087,7 +11327,7 @@ GetCommandAccessPolicy(
     goto Finish;
   }
 
-  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  pDimm = GetHydratedDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
   if (pDimm == NULL || !IsDimmManageable(pDimm)) {
     ReturnCode = EFI_INVALID_PARAMETER;
     goto Finish;
@@ -11365,6 +11605,7 @@ SetFisTransportAttributes(
 
   gTransportAttribs.Protocol = Attribs.Protocol;
   gTransportAttribs.PayloadSize = Attribs.PayloadSize;
+  InvalidatePassThruMethodCache();
 
   ReturnCode = EFI_SUCCESS;
 
@@ -296,6 +296,28 @@ SetPMONRegisters(
   IN     UINT16 Pid,
   IN     UINT8 PMONGroupEnable
   );
+
+/**
+  Resolve a PMem module target to its Pid, initializing only that PMem module
+  from FW
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] pDimmUid The UID of the PMem module, NULL to look it up by handle
+  @param[in] DimmHandle The device handle of the PMem module, used if pDimmUid is NULL
+  @param[out] pPid A pointer to the Pid of the PMem module
+
+  @retval EFI_SUCCESS  The Pid of a functional PMem module was returned
+  @retval EFI_INVALID_PARAMETER pThis or pPid is NULL
+  @retval EFI_NOT_FOUND No functional PMem module matches the target
+**/
+EFI_STATUS
+EFIAPI
+GetDimmPid(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     CONST CHAR16 *pDimmUid OPTIONAL,
+  IN     UINT32 DimmHandle,
+     OUT UINT16 *pPid
+  );
 #endif
 
 /**
@@ -1731,6 +1753,25 @@ GetMinFWImageMaxSize(
   IN   UINT32 DimmsNum
 );
 
+/**
+  Retrieve the list of PMem modules from the ACPI and SMBIOS tables only,
+  without sending any FW command. See GetDimms for the complete list.
+
+  @param[in] DimmCount The size of pDimms
+  @param[out] pDimms The PMem module list, OPTIONAL to only count the modules
+  @param[out] pDimmsNum The number of PMem modules
+
+  @retval EFI_SUCCESS The module list was returned properly
+  @retval EFI_INVALID_PARAMETER pDimmsNum is NULL
+  @retval EFI_BUFFER_TOO_SMALL pDimms can't hold every module, pDimmsNum is set
+**/
+EFI_STATUS
+GetDimmsFromTables(
+  IN     UINT32 DimmCount,
+     OUT DIMM_INFO *pDimms OPTIONAL,
+     OUT UINT32 *pDimmsNum
+  );
+
 /*
  * Helper function for initializing information from the System Management BIOS (SMBIOS).
  */
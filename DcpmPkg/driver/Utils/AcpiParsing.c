@@ -66,6 +66,250 @@ CopyMemoryAndAddPointerToArray(
   IN     UINT32 *pNewPointerIndex
   );
 
+#define NFIT_INDEX_MIN_SLOT_BITS        4
+#define NFIT_INDEX_SLOT_COUNT(Bits)     (1U << (Bits))
+#define NFIT_INDEX_NEXT(Slot, Bits)     (((Slot) + 1) & (NFIT_INDEX_SLOT_COUNT(Bits) - 1))
+
+STATIC BOOLEAN gNfitIndexEnabled = TRUE;
+
+/** Returns the index field of an NFIT subtable **/
+typedef UINT16 (*NFIT_INDEX_KEY)(VOID *pTable);
+
+STATIC
+UINT16
+RegionMappingPidKey(
+  IN     VOID *pTable
+  )
+{
+  return ((NvDimmRegionMappingStructure *)pTable)->NvDimmPhysicalId;
+}
+
+STATIC
+UINT16
+SpaRangeIndexKey(
+  IN     VOID *pTable
+  )
+{
+  return ((SpaRangeTbl *)pTable)->SpaRangeDescriptionTableIndex;
+}
+
+STATIC
+UINT16
+InterleaveIndexKey(
+  IN     VOID *pTable
+  )
+{
+  return ((InterleaveStruct *)pTable)->InterleaveStructureIndex;
+}
+
+STATIC
+UINT16
+ControlRegionIndexKey(
+  IN     VOID *pTable
+  )
+{
+  return ((ControlRegionTbl *)pTable)->ControlRegionDescriptorTableIndex;
+}
+
+/**
+  Find the slot of a key, or the free slot it would be inserted in.
+  The index has at least twice as many slots as subtables so it is never full.
+**/
+STATIC
+NfitIndexSlot *
+FindNfitIndexSlot(
+  IN     NfitIndex *pIndex,
+  IN     UINT16 Key
+  )
+{
+  // Fibonacci hashing, the top bits of the product are well mixed
+  UINT32 Slot = (UINT32)(Key * 2654435761U) >> (32 - pIndex->SlotBits);
+
+  while (pIndex->pSlots[Slot].Position != 0 && pIndex->pSlots[Slot].Key != Key) {
+    Slot = NFIT_INDEX_NEXT(Slot, pIndex->SlotBits);
+  }
+  return &pIndex->pSlots[Slot];
+}
+
+/**
+  Returns the position plus one of the first subtable with the given key,
+  or 0 if there is none. Use NextInNfitIndex to get the following ones.
+  Without an index, see SetNfitIndexEnabled, the subtables are scanned.
+
+  @param[in] pIndex pointer to the index.
+  @param[in] ppTables array of subtables the index was built from.
+  @param[in] TablesNum count of subtables.
+  @param[in] GetKey returns the index field of a subtable.
+  @param[in] Key index field value to look for.
+**/
+STATIC
+UINT32
+FindInNfitIndex(
+  IN     NfitIndex *pIndex,
+  IN     VOID **ppTables,
+  IN     UINT32 TablesNum,
+  IN     NFIT_INDEX_KEY GetKey,
+  IN     UINT16 Key
+  )
+{
+  UINT32 Index = 0;
+
+  if (pIndex->pSlots != NULL) {
+    return FindNfitIndexSlot(pIndex, Key)->Position;
+  }
+  for (Index = 0; Index < TablesNum; Index++) {
+    if (GetKey(ppTables[Index]) == Key) {
+      return Index + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  Returns the position plus one of the next subtable with the same key as
+  the one at Position, or 0 if there is none. The index must chain
+  duplicates, see BuildNfitIndex.
+
+  @param[in] pIndex pointer to the index.
+  @param[in] ppTables array of subtables the index was built from.
+  @param[in] TablesNum count of subtables.
+  @param[in] GetKey returns the index field of a subtable.
+  @param[in] Position position plus one of the current subtable.
+**/
+STATIC
+UINT32
+NextInNfitIndex(
+  IN     NfitIndex *pIndex,
+  IN     VOID **ppTables,
+  IN     UINT32 TablesNum,
+  IN     NFIT_INDEX_KEY GetKey,
+  IN     UINT32 Position
+  )
+{
+  UINT32 Index = 0;
+  UINT16 Key = 0;
+
+  if (pIndex->pNext != NULL) {
+    return pIndex->pNext[Position - 1];
+  }
+  Key = GetKey(ppTables[Position - 1]);
+  for (Index = Position; Index < TablesNum; Index++) {
+    if (GetKey(ppTables[Index]) == Key) {
+      return Index + 1;
+    }
+  }
+  return 0;
+}
+
+#ifdef OS_BUILD
+/**
+  Set whether ParseNfitTable builds the lookup indices, see ParsedFitHeader
+**/
+VOID
+SetNfitIndexEnabled(
+  IN     BOOLEAN Enabled
+  )
+{
+  gNfitIndexEnabled = Enabled;
+}
+#endif
+
+/**
+  Builds an index of an array of NFIT subtables.
+
+  @param[in] ppTables array of subtables.
+  @param[in] TablesNum count of subtables.
+  @param[in] GetKey returns the index field of a subtable.
+  @param[in] ChainDuplicates when TRUE, all subtables with the same key are chained in
+    pIndex->pNext in table order, otherwise only the first one is indexed.
+  @param[out] pIndex pointer to the index.
+
+  @retval EFI_SUCCESS if the index was built.
+  @retval EFI_OUT_OF_RESOURCES if a memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+BuildNfitIndex(
+  IN     VOID **ppTables,
+  IN     UINT32 TablesNum,
+  IN     NFIT_INDEX_KEY GetKey,
+  IN     BOOLEAN ChainDuplicates,
+     OUT NfitIndex *pIndex
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  NfitIndexSlot *pSlot = NULL;
+  UINT32 *pLast = NULL;
+  UINT32 SlotBits = NFIT_INDEX_MIN_SLOT_BITS;
+  UINT32 Index = 0;
+
+  if (TablesNum == 0) {
+    goto Finish;
+  }
+
+  while (NFIT_INDEX_SLOT_COUNT(SlotBits) < 2 * TablesNum) {
+    SlotBits++;
+  }
+
+  CHECK_RESULT_MALLOC(pIndex->pSlots, (NfitIndexSlot *)AllocateZeroPool(NFIT_INDEX_SLOT_COUNT(SlotBits) * sizeof(NfitIndexSlot)), Finish);
+  pIndex->SlotBits = SlotBits;
+  if (ChainDuplicates) {
+    CHECK_RESULT_MALLOC(pIndex->pNext, (UINT32 *)AllocateZeroPool(TablesNum * sizeof(UINT32)), Finish);
+    // Last position of each key so far, to append to its chain
+    CHECK_RESULT_MALLOC(pLast, (UINT32 *)AllocateZeroPool(NFIT_INDEX_SLOT_COUNT(SlotBits) * sizeof(UINT32)), Finish);
+  }
+
+  for (Index = 0; Index < TablesNum; Index++) {
+    pSlot = FindNfitIndexSlot(pIndex, GetKey(ppTables[Index]));
+    if (pSlot->Position == 0) {
+      pSlot->Key = GetKey(ppTables[Index]);
+      pSlot->Position = Index + 1;
+    } else if (ChainDuplicates) {
+      pIndex->pNext[pLast[pSlot - pIndex->pSlots] - 1] = Index + 1;
+    }
+    if (ChainDuplicates) {
+      pLast[pSlot - pIndex->pSlots] = Index + 1;
+    }
+  }
+
+Finish:
+  FREE_POOL_SAFE(pLast);
+  return ReturnCode;
+}
+
+/**
+  Builds the lookup indices of a parsed NFIT, see ParsedFitHeader.
+
+  @param[in, out] pParsedNfit pointer to the parsed NFIT.
+
+  @retval EFI_SUCCESS if the indices were built.
+  @retval EFI_OUT_OF_RESOURCES if a memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+BuildNfitIndices(
+  IN OUT ParsedFitHeader *pParsedNfit
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+  if (!gNfitIndexEnabled) {
+    goto Finish;
+  }
+
+  CHECK_RESULT(BuildNfitIndex((VOID **)pParsedNfit->ppNvDimmRegionMappingStructures, pParsedNfit->NvDimmRegionMappingStructuresNum,
+      RegionMappingPidKey, TRUE, &pParsedNfit->RegionMappingsByPid), Finish);
+  CHECK_RESULT(BuildNfitIndex((VOID **)pParsedNfit->ppSpaRangeTbles, pParsedNfit->SpaRangeTblesNum,
+      SpaRangeIndexKey, FALSE, &pParsedNfit->SpaRangeTblesByIndex), Finish);
+  CHECK_RESULT(BuildNfitIndex((VOID **)pParsedNfit->ppInterleaveTbles, pParsedNfit->InterleaveTblesNum,
+      InterleaveIndexKey, FALSE, &pParsedNfit->InterleaveTblesByIndex), Finish);
+  CHECK_RESULT(BuildNfitIndex((VOID **)pParsedNfit->ppControlRegionTbles, pParsedNfit->ControlRegionTblesNum,
+      ControlRegionIndexKey, FALSE, &pParsedNfit->ControlRegionTblesByIndex), Finish);
+
+Finish:
+  return ReturnCode;
+}
+
 /**
   ParseNfitTable - Performs deserialization from binary memory block into parsed structure of pointers.
 
@@ -175,6 +419,8 @@ ParseNfitTable(
     pTableHeader = (SubTableHeader *)pTabPointer;
   }
 
+  CHECK_RESULT(BuildNfitIndices(pParsedNfit), Finish);
+
   ReturnCode = EFI_SUCCESS;
 
 Finish:
@@ -1044,8 +1290,7 @@ GetControlRegionTableForNvDimmRegionTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
-  UINT16 ControlTableIndex = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || pNvDimmRegionMappingStructure == NULL || ppControlRegionTable == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -1053,14 +1298,13 @@ GetControlRegionTableForNvDimmRegionTable(
   }
 
   *ppControlRegionTable = NULL;
-  ControlTableIndex = pNvDimmRegionMappingStructure->NvdimmControlRegionDescriptorTableIndex;
 
-  for (Index = 0; Index < pFitHead->ControlRegionTblesNum; Index++) {
-    if (pFitHead->ppControlRegionTbles[Index]->ControlRegionDescriptorTableIndex == ControlTableIndex) {
-      *ppControlRegionTable = pFitHead->ppControlRegionTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = FindInNfitIndex(&pFitHead->ControlRegionTblesByIndex,
+      (VOID **)pFitHead->ppControlRegionTbles, pFitHead->ControlRegionTblesNum, ControlRegionIndexKey,
+      pNvDimmRegionMappingStructure->NvdimmControlRegionDescriptorTableIndex);
+  if (Position != 0) {
+    *ppControlRegionTable = pFitHead->ppControlRegionTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -1088,7 +1332,7 @@ GetControlRegionTablesForPID(
   )
 {
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  UINT32 Index = 0;
+  UINT32 Position = 0;
   UINT32 Index2 = 0;
   UINT32 CurrentArrayNum = 0;
   ControlRegionTbl *pCtrlTable = NULL;
@@ -1100,28 +1344,30 @@ GetControlRegionTablesForPID(
     goto Finish;
   }
 
-  for (Index = 0; Index < pFitHead->NvDimmRegionMappingStructuresNum; Index++) {
-    if (Pid == pFitHead->ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId) {
-      ReturnCode = GetControlRegionTableForNvDimmRegionTable(
-          pFitHead, pFitHead->ppNvDimmRegionMappingStructures[Index], &pCtrlTable);
+  for (Position = FindInNfitIndex(&pFitHead->RegionMappingsByPid, (VOID **)pFitHead->ppNvDimmRegionMappingStructures,
+           pFitHead->NvDimmRegionMappingStructuresNum, RegionMappingPidKey, Pid);
+       Position != 0;
+       Position = NextInNfitIndex(&pFitHead->RegionMappingsByPid, (VOID **)pFitHead->ppNvDimmRegionMappingStructures,
+           pFitHead->NvDimmRegionMappingStructuresNum, RegionMappingPidKey, Position)) {
+    ReturnCode = GetControlRegionTableForNvDimmRegionTable(
+        pFitHead, pFitHead->ppNvDimmRegionMappingStructures[Position - 1], &pCtrlTable);
 
-      /** Make sure the found Control Region table is not in the array already. **/
-      ContainedAlready = FALSE;
-      for (Index2 = 0; Index2 < CurrentArrayNum; Index2++) {
-        if (pCtrlTable == pControlRegionTables[Index2]) {
-          ContainedAlready = TRUE;
-        }
+    /** Make sure the found Control Region table is not in the array already. **/
+    ContainedAlready = FALSE;
+    for (Index2 = 0; Index2 < CurrentArrayNum; Index2++) {
+      if (pCtrlTable == pControlRegionTables[Index2]) {
+        ContainedAlready = TRUE;
       }
+    }
 
-      if (!ContainedAlready) {
-        if (CurrentArrayNum >= *pControlRegionTablesNum) {
-          NVDIMM_ERR("There are more Control Region tables than length of the input array.");
-          ReturnCode = EFI_BUFFER_TOO_SMALL;
-          goto Finish;
-        }
-        pControlRegionTables[CurrentArrayNum] = pCtrlTable;
-        CurrentArrayNum++;
+    if (!ContainedAlready) {
+      if (CurrentArrayNum >= *pControlRegionTablesNum) {
+        NVDIMM_ERR("There are more Control Region tables than length of the input array.");
+        ReturnCode = EFI_BUFFER_TOO_SMALL;
+        goto Finish;
       }
+      pControlRegionTables[CurrentArrayNum] = pCtrlTable;
+      CurrentArrayNum++;
     }
   }
 
@@ -1152,7 +1398,7 @@ GetSpaRangeTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || ppSpaRangeTbl == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -1161,12 +1407,11 @@ GetSpaRangeTable(
 
   *ppSpaRangeTbl = NULL;
 
-  for (Index = 0; Index < pFitHead->SpaRangeTblesNum; Index++) {
-    if (pFitHead->ppSpaRangeTbles[Index]->SpaRangeDescriptionTableIndex == SpaRangeTblIndex) {
-      *ppSpaRangeTbl = pFitHead->ppSpaRangeTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = FindInNfitIndex(&pFitHead->SpaRangeTblesByIndex, (VOID **)pFitHead->ppSpaRangeTbles,
+      pFitHead->SpaRangeTblesNum, SpaRangeIndexKey, SpaRangeTblIndex);
+  if (Position != 0) {
+    *ppSpaRangeTbl = pFitHead->ppSpaRangeTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -1192,7 +1437,7 @@ GetInterleaveTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || ppInterleaveTbl == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -1201,12 +1446,11 @@ GetInterleaveTable(
 
   *ppInterleaveTbl = NULL;
 
-  for (Index = 0; Index < pFitHead->InterleaveTblesNum; Index++) {
-    if (pFitHead->ppInterleaveTbles[Index]->InterleaveStructureIndex == InterleaveTblIndex) {
-      *ppInterleaveTbl = pFitHead->ppInterleaveTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = FindInNfitIndex(&pFitHead->InterleaveTblesByIndex, (VOID **)pFitHead->ppInterleaveTbles,
+      pFitHead->InterleaveTblesNum, InterleaveIndexKey, InterleaveTblIndex);
+  if (Position != 0) {
+    *ppInterleaveTbl = pFitHead->ppInterleaveTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -1240,7 +1484,8 @@ GetNvDimmRegionMappingStructureForPid(
   )
 {
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
+  NvDimmRegionMappingStructure *pRegionMapping = NULL;
   SpaRangeTbl *pSpaRangeTbl = NULL;
   UINT16 SpaIndexInNvDimmRegion = 0;
   BOOLEAN Found = FALSE;
@@ -1251,12 +1496,13 @@ GetNvDimmRegionMappingStructureForPid(
 
   *ppNvDimmRegionMappingStructure = NULL;
 
-  for (Index = 0; Index < pFitHead->NvDimmRegionMappingStructuresNum; Index++) {
-    if (pFitHead->ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId != Pid) {
-      continue;
-    }
-
-    SpaIndexInNvDimmRegion = pFitHead->ppNvDimmRegionMappingStructures[Index]->SpaRangeDescriptionTableIndex;
+  for (Position = FindInNfitIndex(&pFitHead->RegionMappingsByPid, (VOID **)pFitHead->ppNvDimmRegionMappingStructures,
+           pFitHead->NvDimmRegionMappingStructuresNum, RegionMappingPidKey, Pid);
+       Position != 0;
+       Position = NextInNfitIndex(&pFitHead->RegionMappingsByPid, (VOID **)pFitHead->ppNvDimmRegionMappingStructures,
+           pFitHead->NvDimmRegionMappingStructuresNum, RegionMappingPidKey, Position)) {
+    pRegionMapping = pFitHead->ppNvDimmRegionMappingStructures[Position - 1];
+    SpaIndexInNvDimmRegion = pRegionMapping->SpaRangeDescriptionTableIndex;
     Found = TRUE;
 
     if (SpaRangeIndexProvided && SpaIndexInNvDimmRegion != SpaRangeIndex) {
@@ -1275,7 +1521,7 @@ GetNvDimmRegionMappingStructureForPid(
     }
 
     if (Found) {
-      *ppNvDimmRegionMappingStructure = pFitHead->ppNvDimmRegionMappingStructures[Index];
+      *ppNvDimmRegionMappingStructure = pRegionMapping;
       ReturnCode = EFI_SUCCESS;
       break;
     } else {
@@ -98,6 +98,20 @@ ParseNfitTable(
      OUT ParsedFitHeader **ppParsedNfit
   );
 
+#ifdef OS_BUILD
+/**
+  Set whether ParseNfitTable builds the lookup indices of the parsed NFIT.
+  Without them the lookups scan the subtables, which tests compare the
+  indexed lookups against. Applies to the NFIT parsed next.
+
+  @param[in] Enabled FALSE to scan the subtables, TRUE by default
+**/
+VOID
+SetNfitIndexEnabled(
+  IN     BOOLEAN Enabled
+  );
+#endif
+
 /**
   Performs deserialization from binary memory block, containing PCAT tables, into parsed structure of pointers.
 
@@ -418,6 +418,8 @@ GetDimmsCurrentConfig(
     goto FinishError;
   }
 
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
   /** Count a number of configured dimms **/
   DimmConfigsNum = 0;
   LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
@@ -9,6 +9,9 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Debug.h>
 #include <PbrDcpmm.h>
+#ifdef OS_BUILD
+#include <os.h>
+#endif
 
 /**
   Retrieve Capacity for the given SMBIOS version.
@@ -272,3 +275,268 @@ GetNextSmbiosStruct(
 Finish:
   return ReturnCode;
 }
+
+/** No record of that type for the handle **/
+#define SMBIOS_INDEX_NO_RECORD            MAX_UINT32
+#define SMBIOS_INDEX_MIN_SLOT_BITS        4
+#define SMBIOS_INDEX_SLOT_COUNT(Bits)     (1U << (Bits))
+#define SMBIOS_INDEX_NEXT(Slot, Bits)     (((Slot) + 1) & (SMBIOS_INDEX_SLOT_COUNT(Bits) - 1))
+
+/**
+  Type 17 and Type 20 records of one memory device, as offsets from the
+  start of the SMBIOS table so the index survives the table being copied
+**/
+typedef struct {
+  UINT16 Handle;
+  UINT32 Type17Offset;
+  UINT32 Type20Offset;
+} SMBIOS_MEMORY_DEVICE_SLOT;
+
+/**
+  Open addressing hash table of the memory device records keyed by the
+  Type 17 handle, Type 20 records are filed under their MemoryDeviceHandle
+**/
+typedef struct {
+  UINT32 TableSize;
+  SMBIOS_VERSION Version;
+  UINT32 SlotBits;                       //!< Log2 of the slot count, at least twice the indexed handles
+  SMBIOS_MEMORY_DEVICE_SLOT *pSlots;
+} SMBIOS_MEMORY_DEVICE_INDEX;
+
+STATIC SMBIOS_MEMORY_DEVICE_INDEX gSmbiosMemoryDeviceIndex;
+#ifdef OS_BUILD
+STATIC OS_MUTEX *gSmbiosMemoryDeviceIndexLock = NULL;
+#define SMBIOS_INDEX_LOCK()    os_mutex_lock(gSmbiosMemoryDeviceIndexLock)
+#define SMBIOS_INDEX_UNLOCK()  os_mutex_unlock(gSmbiosMemoryDeviceIndexLock)
+#else
+#define SMBIOS_INDEX_LOCK()
+#define SMBIOS_INDEX_UNLOCK()
+#endif // OS_BUILD
+
+/**
+  First slot probed for a handle
+**/
+STATIC
+UINT32
+SmbiosIndexHash(
+  IN     UINT16 Handle,
+  IN     UINT32 SlotBits
+  )
+{
+  // Fibonacci hashing, the top bits of the product are well mixed
+  return (UINT32)(Handle * 2654435761U) >> (32 - SlotBits);
+}
+
+/**
+  Find the slot of a handle, or the free slot it would be inserted in
+
+  @param[in] pIndex The memory device index
+  @param[in] Handle Type 17 handle
+**/
+STATIC
+SMBIOS_MEMORY_DEVICE_SLOT *
+FindSmbiosIndexSlot(
+  IN     SMBIOS_MEMORY_DEVICE_INDEX *pIndex,
+  IN     UINT16 Handle
+  )
+{
+  UINT32 Slot = SmbiosIndexHash(Handle, pIndex->SlotBits);
+
+  // Never full, the index has at least twice as many slots as handles
+  while (pIndex->pSlots[Slot].Type17Offset != SMBIOS_INDEX_NO_RECORD ||
+         pIndex->pSlots[Slot].Type20Offset != SMBIOS_INDEX_NO_RECORD) {
+    if (pIndex->pSlots[Slot].Handle == Handle) {
+      break;
+    }
+    Slot = SMBIOS_INDEX_NEXT(Slot, pIndex->SlotBits);
+  }
+  return &pIndex->pSlots[Slot];
+}
+
+/**
+  Set up the lock serializing the rebuilds and lookups of the SMBIOS memory
+  device index
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the lock
+**/
+EFI_STATUS
+InitializeSmbiosMemoryDeviceIndex(
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+#ifdef OS_BUILD
+  if (gSmbiosMemoryDeviceIndexLock == NULL) {
+    gSmbiosMemoryDeviceIndexLock = os_mutex_init(NULL);
+    if (gSmbiosMemoryDeviceIndexLock == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+    }
+  }
+#endif // OS_BUILD
+  return ReturnCode;
+}
+
+/**
+  Release the SMBIOS memory device index, it is rebuilt on the next lookup
+**/
+VOID
+UninitializeSmbiosMemoryDeviceIndex(
+  )
+{
+  SMBIOS_INDEX_LOCK();
+  FREE_POOL_SAFE(gSmbiosMemoryDeviceIndex.pSlots);
+  ZeroMem(&gSmbiosMemoryDeviceIndex, sizeof(gSmbiosMemoryDeviceIndex));
+  SMBIOS_INDEX_UNLOCK();
+}
+
+/**
+  Build the memory device index of an SMBIOS table in two walks, one to size
+  the hash table and one to fill it
+
+  @param[in] pFirst First SMBIOS structure of the table
+  @param[in] pBound One after the last SMBIOS structure of the table
+  @param[in] Version SMBIOS version of the table
+
+  @retval EFI_SUCCESS The index was built
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval Other errors malformed table
+**/
+STATIC
+EFI_STATUS
+BuildSmbiosMemoryDeviceIndex(
+  IN     SMBIOS_STRUCTURE_POINTER *pFirst,
+  IN     SMBIOS_STRUCTURE_POINTER *pBound,
+  IN     SMBIOS_VERSION Version
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
+  SMBIOS_MEMORY_DEVICE_SLOT *pSlot = NULL;
+  UINT32 RecordCount = 0;
+  UINT32 SlotBits = SMBIOS_INDEX_MIN_SLOT_BITS;
+  UINT32 Index = 0;
+
+  NVDIMM_ENTRY();
+
+  UninitializeSmbiosMemoryDeviceIndex();
+
+  for (SmBiosStruct = *pFirst; SmBiosStruct.Raw < pBound->Raw; ) {
+    if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV ||
+        SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV_MAPPED_ADDR) {
+      RecordCount++;
+    }
+    CHECK_RESULT(GetNextSmbiosStruct(&SmBiosStruct), Finish);
+  }
+
+  while (SMBIOS_INDEX_SLOT_COUNT(SlotBits) < 2 * RecordCount) {
+    SlotBits++;
+  }
+
+  CHECK_RESULT_MALLOC(gSmbiosMemoryDeviceIndex.pSlots, (SMBIOS_MEMORY_DEVICE_SLOT *)
+    AllocateZeroPool(SMBIOS_INDEX_SLOT_COUNT(SlotBits) * sizeof(SMBIOS_MEMORY_DEVICE_SLOT)), Finish);
+  gSmbiosMemoryDeviceIndex.SlotBits = SlotBits;
+  for (Index = 0; Index < SMBIOS_INDEX_SLOT_COUNT(SlotBits); Index++) {
+    gSmbiosMemoryDeviceIndex.pSlots[Index].Type17Offset = SMBIOS_INDEX_NO_RECORD;
+    gSmbiosMemoryDeviceIndex.pSlots[Index].Type20Offset = SMBIOS_INDEX_NO_RECORD;
+  }
+
+  // A later record of a handle replaces an earlier one, as the table walk did
+  for (SmBiosStruct = *pFirst; SmBiosStruct.Raw < pBound->Raw; ) {
+    if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV) {
+      pSlot = FindSmbiosIndexSlot(&gSmbiosMemoryDeviceIndex, SmBiosStruct.Hdr->Handle);
+      pSlot->Handle = SmBiosStruct.Hdr->Handle;
+      pSlot->Type17Offset = (UINT32)(SmBiosStruct.Raw - pFirst->Raw);
+    } else if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV_MAPPED_ADDR) {
+      pSlot = FindSmbiosIndexSlot(&gSmbiosMemoryDeviceIndex, SmBiosStruct.Type20->MemoryDeviceHandle);
+      pSlot->Handle = SmBiosStruct.Type20->MemoryDeviceHandle;
+      pSlot->Type20Offset = (UINT32)(SmBiosStruct.Raw - pFirst->Raw);
+    }
+    CHECK_RESULT(GetNextSmbiosStruct(&SmBiosStruct), Finish);
+  }
+
+  gSmbiosMemoryDeviceIndex.TableSize = (UINT32)(pBound->Raw - pFirst->Raw);
+  gSmbiosMemoryDeviceIndex.Version = Version;
+
+Finish:
+  if (EFI_ERROR(ReturnCode)) {
+    UninitializeSmbiosMemoryDeviceIndex();
+  }
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Retrieve the Type 17 and Type 20 SMBIOS records of a memory device.
+
+  The records are looked up in an index of the table built on the first call,
+  and rebuilt when the table size or version changes, so each call costs a
+  hash lookup instead of a walk of the table. Not thread safe.
+
+  @param[in]  Handle          Type 17 handle of the memory device
+  @param[out] pType17         Type 17 record, Raw set to NULL if not found
+  @param[out] pType20         Type 20 record, Raw set to NULL if not found
+  @param[out] pSmbiosVersion  SMBIOS version of the table
+
+  @retval EFI_SUCCESS The table was searched, records may still be missing
+  @retval EFI_INVALID_PARAMETER Null parameter passed
+  @retval EFI_DEVICE_ERROR The SMBIOS table could not be retrieved
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+EFI_STATUS
+GetSmbiosMemoryDevice(
+  IN     UINT16 Handle,
+     OUT SMBIOS_STRUCTURE_POINTER *pType17,
+     OUT SMBIOS_STRUCTURE_POINTER *pType20,
+     OUT SMBIOS_VERSION *pSmbiosVersion
+  )
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
+  SMBIOS_STRUCTURE_POINTER BoundSmBiosStruct;
+  SMBIOS_MEMORY_DEVICE_SLOT *pSlot = NULL;
+
+  NVDIMM_ENTRY();
+
+  ZeroMem(&SmBiosStruct, sizeof(SmBiosStruct));
+  ZeroMem(&BoundSmBiosStruct, sizeof(BoundSmBiosStruct));
+
+  CHECK_NULL_ARG(pType17, Finish);
+  CHECK_NULL_ARG(pType20, Finish);
+  CHECK_NULL_ARG(pSmbiosVersion, Finish);
+
+  pType17->Raw = NULL;
+  pType20->Raw = NULL;
+
+  GetFirstAndBoundSmBiosStructPointer(&SmBiosStruct, &BoundSmBiosStruct, pSmbiosVersion);
+  if (SmBiosStruct.Raw == NULL || BoundSmBiosStruct.Raw == NULL) {
+    ReturnCode = EFI_DEVICE_ERROR;
+    goto Finish;
+  }
+
+  SMBIOS_INDEX_LOCK();
+  if (gSmbiosMemoryDeviceIndex.pSlots == NULL ||
+      gSmbiosMemoryDeviceIndex.TableSize != (UINT32)(BoundSmBiosStruct.Raw - SmBiosStruct.Raw) ||
+      gSmbiosMemoryDeviceIndex.Version.Major != pSmbiosVersion->Major ||
+      gSmbiosMemoryDeviceIndex.Version.Minor != pSmbiosVersion->Minor) {
+    ReturnCode = BuildSmbiosMemoryDeviceIndex(&SmBiosStruct, &BoundSmBiosStruct, *pSmbiosVersion);
+    if (EFI_ERROR(ReturnCode)) {
+      SMBIOS_INDEX_UNLOCK();
+      goto Finish;
+    }
+  }
+
+  pSlot = FindSmbiosIndexSlot(&gSmbiosMemoryDeviceIndex, Handle);
+  if (pSlot->Type17Offset != SMBIOS_INDEX_NO_RECORD) {
+    pType17->Raw = SmBiosStruct.Raw + pSlot->Type17Offset;
+  }
+  if (pSlot->Type20Offset != SMBIOS_INDEX_NO_RECORD) {
+    pType20->Raw = SmBiosStruct.Raw + pSlot->Type20Offset;
+  }
+  SMBIOS_INDEX_UNLOCK();
+
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
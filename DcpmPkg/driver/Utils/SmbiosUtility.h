@@ -98,5 +98,45 @@ GetFirstAndBoundSmBiosStructPointer(
   OUT SMBIOS_VERSION *pSmbiosVersion
 );
 
+/**
+  Retrieve the Type 17 and Type 20 SMBIOS records of a memory device from an
+  index of the table built on first use. Not thread safe.
+
+  @param[in]  Handle          Type 17 handle of the memory device
+  @param[out] pType17         Type 17 record, Raw set to NULL if not found
+  @param[out] pType20         Type 20 record, Raw set to NULL if not found
+  @param[out] pSmbiosVersion  SMBIOS version of the table
+
+  @retval EFI_SUCCESS The table was searched, records may still be missing
+  @retval EFI_INVALID_PARAMETER Null parameter passed
+  @retval EFI_DEVICE_ERROR The SMBIOS table could not be retrieved
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+EFI_STATUS
+GetSmbiosMemoryDevice(
+  IN     UINT16 Handle,
+     OUT SMBIOS_STRUCTURE_POINTER *pType17,
+     OUT SMBIOS_STRUCTURE_POINTER *pType20,
+     OUT SMBIOS_VERSION *pSmbiosVersion
+  );
+
+/**
+  Set up the lock serializing the rebuilds and lookups of the SMBIOS memory
+  device index
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_OUT_OF_RESOURCES Unable to create the lock
+**/
+EFI_STATUS
+InitializeSmbiosMemoryDeviceIndex(
+  );
+
+/**
+  Release the SMBIOS memory device index, it is rebuilt on the next lookup
+**/
+VOID
+UninitializeSmbiosMemoryDeviceIndex(
+  );
+
 
 #endif /* _SMBIOS_UTILITY_H_ */
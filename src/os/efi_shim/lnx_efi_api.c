@@ -6,6 +6,8 @@
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <string.h>
+#include <pthread.h>
 #include <Uefi.h>
 #include <Dimm.h>
 #include <NvmDimmDriver.h>
@@ -13,10 +15,17 @@
 #include <lnx_acpi.h>
 #include <lnx_smbios_types.h>
 #include <lnx_adapter_passthrough.h>
+#include <os_efi_preferences.h>
+#include <os_efi_api.h>
 
 #define SMBIOS_ENTRY_POINT_FILE "/sys/firmware/dmi/tables/smbios_entry_point"
 #define SMBIOS_DMI_FILE "/sys/firmware/dmi/tables/DMI"
 
+#define INI_PREFERENCES_DSM_RETRY_MAX           L"DSM_RETRY_MAX"
+#define INI_PREFERENCES_DSM_RETRY_BASE_DELAY_US L"DSM_RETRY_BASE_DELAY_US"
+#define INI_PREFERENCES_DSM_RETRY_MAX_DELAY_US  L"DSM_RETRY_MAX_DELAY_US"
+#define INI_PREFERENCES_DSM_RETRY_DEADLINE_MS   L"DSM_RETRY_DEADLINE_MS"
+
 unsigned char SMBIOS_ANCHOR_STR[] = { 0x5f, 0x53, 0x4d, 0x5f };
 unsigned char SMBIOS_3_ANCHOR_STR[] = { 0x5f, 0x53, 0x4d, 0x33, 0x5f };
 
@@ -27,7 +36,29 @@ extern UINT8 gSmbiosMinorVersion;
 extern UINT8 gSmbiosMajorVersion;
 
 
-extern int get_acpi_table(const char *signature, struct acpi_table *p_table, const unsigned int size);
+#define ACPI_TABLE_CACHE_SIZE 3   //!< NFIT, PCAT, PMTT
+
+/**
+  Tables read from sysfs, once per process. They don't change until reboot,
+  so later init/uninit cycles reuse them, a missing table is cached too.
+**/
+typedef struct {
+  CHAR8 Signature[ACPI_SIGNATURE_LEN + 1];
+  BOOLEAN Loaded;
+  int Rc;                                   //!< Size of the table or acpi_error
+  struct acpi_table *pTable;
+} ACPI_TABLE_CACHE_ENTRY;
+
+STATIC ACPI_TABLE_CACHE_ENTRY gAcpiTableCache[ACPI_TABLE_CACHE_SIZE] = {
+  { "NFIT" }, { "PCAT" }, { "PMTT" }
+};
+STATIC BOOLEAN gSmbiosTableLoaded = FALSE;
+STATIC int gSmbiosTableRc = 0;
+STATIC UINT8 *gSmbiosTableCache = NULL;
+STATIC size_t gSmbiosTableCacheSize = 0;
+STATIC UINT8 gSmbiosCacheMajorVersion = 0;
+STATIC UINT8 gSmbiosCacheMinorVersion = 0;
+STATIC pthread_mutex_t gOsTableCacheLock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
 Gets the current timestamp in terms of milliseconds
@@ -53,6 +84,17 @@ UINT64 GetCurrentMilliseconds()
   return retval;
 }
 
+/**
+Gets a monotonic timestamp in terms of microseconds, for measuring durations
+**/
+UINT64 GetCurrentMicroseconds()
+{
+  struct timespec spec;
+
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return ((UINT64)spec.tv_sec * 1000000) + ((UINT64)spec.tv_nsec / 1000);
+}
+
 /**
 Loads a table as specified in the args
 
@@ -73,13 +115,14 @@ EFI_STATUS
 passthru_os(
   IN     struct _DIMM *pDimm,
   IN OUT NVM_FW_CMD *pCmd,
-  IN     long Timeout
+  IN     long Timeout,
+     OUT UINT32 *pRetries OPTIONAL
 )
 {
   EFI_STATUS Rc = EFI_SUCCESS;
   UINT32 ReturnCode;
 
-  ReturnCode = ioctl_passthrough_fw_cmd((struct fw_cmd *)pCmd);
+  ReturnCode = ioctl_passthrough_fw_cmd((struct fw_cmd *)pCmd, (unsigned int *)pRetries);
   if (0 == ReturnCode)
   {
     Rc = EFI_SUCCESS;
@@ -92,6 +135,71 @@ passthru_os(
   return Rc;
 }
 
+EFI_STATUS
+passthru_os_init(
+)
+{
+  EFI_GUID Guid = { 0 };
+  UINTN Size = sizeof(UINT32);
+  UINT32 Value = 0;
+  struct dsm_retry_policy Policy = {
+    DSM_MAX_RETRIES, DSM_RETRY_BASE_DELAY_US, DSM_RETRY_MAX_DELAY_US, DSM_RETRY_DEADLINE_MS
+  };
+
+  // Settings missing from the preferences keep their defaults
+  if (!EFI_ERROR(GET_VARIABLE(INI_PREFERENCES_DSM_RETRY_MAX, Guid, &Size, &Value)) && Value > 0) {
+    Policy.max_retries = Value;
+  }
+  if (!EFI_ERROR(GET_VARIABLE(INI_PREFERENCES_DSM_RETRY_BASE_DELAY_US, Guid, &Size, &Value))) {
+    Policy.base_delay_us = Value;
+  }
+  if (!EFI_ERROR(GET_VARIABLE(INI_PREFERENCES_DSM_RETRY_MAX_DELAY_US, Guid, &Size, &Value))) {
+    Policy.max_delay_us = Value;
+  }
+  if (!EFI_ERROR(GET_VARIABLE(INI_PREFERENCES_DSM_RETRY_DEADLINE_MS, Guid, &Size, &Value))) {
+    Policy.deadline_ms = Value;
+  }
+  ioctl_passthrough_set_retry_policy(&Policy);
+  // Processes stalled on the same DIMM must not back off in lockstep
+  ioctl_passthrough_seed_retry_jitter((unsigned int)getpid() ^ (unsigned int)GetCurrentMicroseconds());
+
+  if (0 != ndctl_ctx_cache_init())
+  {
+    return EFI_DEVICE_ERROR;
+  }
+  return EFI_SUCCESS;
+}
+
+VOID
+passthru_os_uninit(
+)
+{
+  ndctl_ctx_cache_uninit();
+}
+
+EFI_STATUS
+passthru_os_get_retry_stats(
+  IN     UINT32 DimmHandle,
+     OUT TRANSPORT_RETRY_STATS *pStats
+)
+{
+  struct dsm_retry_stats Stats;
+
+  if (NULL == pStats) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (NVM_SUCCESS != ioctl_passthrough_get_retry_stats(DimmHandle, &Stats)) {
+    return EFI_NOT_FOUND;
+  }
+  pStats->CommandsRetried = Stats.commands_retried;
+  pStats->Retries = Stats.retries;
+  pStats->BackoffUs = Stats.backoff_us;
+  pStats->Exhausted = Stats.exhausted;
+  pStats->DeadlineExpired = Stats.deadline_expired;
+  pStats->Level = Stats.level;
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 get_nfit_table(
   OUT EFI_ACPI_DESCRIPTION_HEADER ** table,
@@ -126,6 +234,10 @@ get_table(
   OUT UINT32 *tablesize
 )
 {
+  EFI_STATUS ReturnCode = EFI_END_OF_FILE;
+  ACPI_TABLE_CACHE_ENTRY *pEntry = NULL;
+  UINT32 Index = 0;
+
   if (NULL == currentTableName || NULL == tablesize || NULL == table)
   {
     return EFI_INVALID_PARAMETER;
@@ -133,56 +245,75 @@ get_table(
 
   *table = NULL;
 
-  int buf_size = get_acpi_table(currentTableName, NULL, 0);
-  if (buf_size <= 0)
+  for (Index = 0; Index < ACPI_TABLE_CACHE_SIZE; Index++) {
+    if (strncmp(gAcpiTableCache[Index].Signature, currentTableName, ACPI_SIGNATURE_LEN) == 0) {
+      pEntry = &gAcpiTableCache[Index];
+      break;
+    }
+  }
+  if (NULL == pEntry)
   {
-    return EFI_END_OF_FILE;
+    return EFI_INVALID_PARAMETER;
   }
 
-  *table = AllocatePool(buf_size);
-  if (NULL == *table)
+  pthread_mutex_lock(&gOsTableCacheLock);
+  if (!pEntry->Loaded)
   {
-    return EFI_END_OF_FILE;
+    pEntry->Rc = read_acpi_table(pEntry->Signature, &pEntry->pTable);
+    pEntry->Loaded = TRUE;
+    if (pEntry->Rc <= 0)
+    {
+      NVDIMM_DBG("Failed to read ACPI table %s, error %d", pEntry->Signature, pEntry->Rc);
+    }
   }
-  *tablesize = (UINT32)buf_size;
-  get_acpi_table(currentTableName, (struct acpi_table*)*table, buf_size);
-  return EFI_SUCCESS;
+
+  // Callers own and free the table they get
+  if (pEntry->Rc > 0)
+  {
+    *table = AllocatePool(pEntry->Rc);
+    if (NULL != *table)
+    {
+      CopyMem(*table, pEntry->pTable, pEntry->Rc);
+      *tablesize = (UINT32)pEntry->Rc;
+      ReturnCode = EFI_SUCCESS;
+    }
+  }
+  pthread_mutex_unlock(&gOsTableCacheLock);
+
+  return ReturnCode;
 }
 
 /*
-* Harvest the raw SMBIOS table data from memory and allocate a copy
-* to parse.
+* Harvest the raw SMBIOS table data from sysfs and allocate a copy
+* to parse. Each sysfs file is opened and read once.
 */
 int get_smbios_table_alloc(UINT8 **pp_smbios_table, size_t *p_allocated_size, UINT8 *major_version, UINT8 *minor_version)
 {
   int rc = 0;
-  size_t entry_size;
-  size_t table_length;
-
-  // set buffer to larger of the possible structs
-  char entry_point_buffer[sizeof(struct smbios_entry_point)];
-  memset(entry_point_buffer, 0, sizeof(struct smbios_entry_point));
-
-  FILE *entry_file = fopen(SMBIOS_ENTRY_POINT_FILE, "r");
-  if (entry_file == NULL)
+  unsigned char *p_entry_point = NULL;
+  size_t entry_size = 0;
+  size_t table_length = 0;
+  unsigned char *p_dmi = NULL;
+  size_t dmi_size = 0;
+
+  rc = read_sysfs_file(SMBIOS_ENTRY_POINT_FILE, &p_entry_point, &entry_size, SIZE_4KB);
+  if (rc != 0)
   {
-    NVDIMM_ERR("Couldn't open SMBIOS entry point file");
+    NVDIMM_ERR("Couldn't read SMBIOS entry point file, error %d", rc);
     return -EIO;
   }
 
-  entry_size = fread(entry_point_buffer, 1, sizeof(struct smbios_entry_point), entry_file);
-
-  struct smbios_entry_point *smbios = ((struct smbios_entry_point *) entry_point_buffer);
-  struct smbios_3_entry_point *smbios_3 = ((struct smbios_3_entry_point *) entry_point_buffer);
-  if ((memcmp(smbios->anchor_str, SMBIOS_ANCHOR_STR, sizeof(SMBIOS_ANCHOR_STR)) == 0) &&
-    (entry_size == sizeof(struct smbios_entry_point)))
+  struct smbios_entry_point *smbios = ((struct smbios_entry_point *) p_entry_point);
+  struct smbios_3_entry_point *smbios_3 = ((struct smbios_3_entry_point *) p_entry_point);
+  if ((entry_size >= sizeof(struct smbios_entry_point)) &&
+    (memcmp(smbios->anchor_str, SMBIOS_ANCHOR_STR, sizeof(SMBIOS_ANCHOR_STR)) == 0))
   {
     table_length = smbios->structure_table_length;
     *major_version = smbios->smbios_major_version;
     *minor_version = smbios->smbios_minor_version;
   }
-  else if ((memcmp(smbios_3->anchor_str, SMBIOS_3_ANCHOR_STR, sizeof(SMBIOS_3_ANCHOR_STR)) == 0) &&
-    (entry_size == sizeof(struct smbios_3_entry_point)))
+  else if ((entry_size >= sizeof(struct smbios_3_entry_point)) &&
+    (memcmp(smbios_3->anchor_str, SMBIOS_3_ANCHOR_STR, sizeof(SMBIOS_3_ANCHOR_STR)) == 0))
   {
     table_length = smbios_3->structure_table_max_length;
     *major_version = smbios_3->smbios_major_version;
@@ -191,44 +322,69 @@ int get_smbios_table_alloc(UINT8 **pp_smbios_table, size_t *p_allocated_size, UI
   else
   {
     NVDIMM_DBG("Couldn't find SMBIOS entry point from sysfs");
-    fclose(entry_file);
+    free(p_entry_point);
     return -ENXIO;
   }
+  free(p_entry_point);
 
-  fclose(entry_file);
-
-  FILE *dmi_file = fopen(SMBIOS_DMI_FILE, "r");
-  if (dmi_file == NULL)
+  rc = read_sysfs_file(SMBIOS_DMI_FILE, &p_dmi, &dmi_size, SIZE_16MB);
+  if (rc != 0)
   {
-    NVDIMM_ERR("Couldn't open SMBIOS DMI file");
+    NVDIMM_ERR("Couldn't read SMBIOS DMI file, error %d", rc);
     return -EIO;
   }
 
-  UINT8 *p_smbios_table = calloc(1, table_length);
-  if (NULL != p_smbios_table) {
-    if (fread(p_smbios_table, 1, table_length, dmi_file) == table_length)
-    {
-      *pp_smbios_table = p_smbios_table;
-      *p_allocated_size = table_length;
-    }
-    else
+  // SMBIOS 3 only gives the maximum length, the DMI file holds the actual table
+  if (dmi_size < table_length)
+  {
+    if (*major_version < 3)
     {
       NVDIMM_ERR("Could not read SMBIOS DMI from sysfs");
-      free(p_smbios_table);
-      fclose(dmi_file);
+      free(p_dmi);
       return -ENXIO;
     }
+    table_length = dmi_size;
   }
-  fclose(dmi_file);
 
-  return rc;
+  *pp_smbios_table = p_dmi;
+  *p_allocated_size = table_length;
+
+  return 0;
 }
 
 UINT32
 get_smbios_table(
 )
 {
-  return get_smbios_table_alloc(&gSmbiosTable, &gSmbiosTableSize, &gSmbiosMajorVersion, &gSmbiosMinorVersion);
+  int rc = 0;
+
+  pthread_mutex_lock(&gOsTableCacheLock);
+  if (!gSmbiosTableLoaded)
+  {
+    gSmbiosTableRc = get_smbios_table_alloc(&gSmbiosTableCache, &gSmbiosTableCacheSize,
+      &gSmbiosCacheMajorVersion, &gSmbiosCacheMinorVersion);
+    gSmbiosTableLoaded = TRUE;
+  }
+  rc = gSmbiosTableRc;
+
+  // The driver frees its table when it stops, give every driver start a copy
+  if (0 == rc && NULL == gSmbiosTable)
+  {
+    gSmbiosTable = AllocatePool(gSmbiosTableCacheSize);
+    if (NULL == gSmbiosTable)
+    {
+      rc = -ENOMEM;
+    }
+    else
+    {
+      CopyMem(gSmbiosTable, gSmbiosTableCache, gSmbiosTableCacheSize);
+      gSmbiosTableSize = gSmbiosTableCacheSize;
+      gSmbiosMajorVersion = gSmbiosCacheMajorVersion;
+      gSmbiosMinorVersion = gSmbiosCacheMinorVersion;
+    }
+  }
+  pthread_mutex_unlock(&gOsTableCacheLock);
+  return rc;
 }
 
 UINT32
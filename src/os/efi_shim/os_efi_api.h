@@ -52,6 +52,11 @@ Gets the current timestamp in terms of milliseconds
 **/
 UINT64 GetCurrentMilliseconds();
 
+/**
+Gets a timestamp in terms of microseconds, for measuring durations
+**/
+UINT64 GetCurrentMicroseconds();
+
 VOID
 EFIAPI
 GetVendorDriverVersion(CHAR16 * pVersion, UINTN VersionStrSize);
@@ -151,12 +156,126 @@ recording/playback as specified
 @param[in]  pDimm    pointer to current Dimm
 @param[in, out]  pCmd    pointer to command data
 @param[in]  Timeout    the command timeout
+@param[out] pRetries   optional, number of times the driver asked for
+                       the command to be retried
 **/
 EFI_STATUS
 passthru_os(
   IN     struct _DIMM *pDimm,
   IN OUT NVM_FW_CMD *pCmd,
-  IN     long Timeout
+  IN     long Timeout,
+     OUT UINT32 *pRetries OPTIONAL
+);
+
+#define TRANSPORT_STATS_BUCKETS       16    ///< Latency histogram buckets per entry
+#define TRANSPORT_STATS_MAX_ENTRIES   512   ///< DIMM/opcode/transport combinations tracked
+/** Upper latency bound of a histogram bucket in microseconds, the last bucket has none **/
+#define TRANSPORT_STATS_BUCKET_LIMIT_US(Bucket)   (32ULL << (Bucket))
+
+/**
+Latency and outcome of the FW commands sent to one DIMM with one
+opcode/subopcode over one transport
+**/
+typedef struct _TRANSPORT_STATS_ENTRY {
+  UINT32 DimmHandle;
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  DIMM_PASSTHRU_METHOD Method;
+  UINT64 Count;                                 ///< Commands sent
+  UINT64 Errors;                                ///< Commands that failed in the OS or driver
+  UINT64 Retries;                               ///< Retries suggested by the driver
+  UINT64 TotalUs;                               ///< Sum of the command latencies
+  UINT64 MaxUs;                                 ///< Slowest command
+  UINT64 Buckets[TRANSPORT_STATS_BUCKETS];      ///< Bucket i counts latencies below TRANSPORT_STATS_BUCKET_LIMIT_US(i)
+} TRANSPORT_STATS_ENTRY;
+
+/**
+Sets up the transport statistics collected by DefaultPassThru
+
+@retval EFI_SUCCESS on success
+@retval EFI_OUT_OF_RESOURCES if the statistics lock could not be created
+**/
+EFI_STATUS
+InitializeTransportStats(
+);
+
+/**
+Releases the transport statistics
+**/
+VOID
+UninitializeTransportStats(
+);
+
+/**
+Clears the collected transport statistics
+**/
+VOID
+ResetTransportStats(
+);
+
+/**
+Copies the collected transport statistics
+
+@param[out] pEntries    array to fill, NULL to only get the number of entries
+@param[in, out] pCount  in: capacity of pEntries, out: number of entries
+                        copied, or available when pEntries is NULL
+
+@retval EFI_SUCCESS on success
+@retval EFI_INVALID_PARAMETER if pCount is NULL
+@retval EFI_BUFFER_TOO_SMALL if pEntries can't hold every entry, the first
+                        *pCount entries are still copied
+**/
+EFI_STATUS
+GetTransportStats(
+  OUT    TRANSPORT_STATS_ENTRY *pEntries OPTIONAL,
+  IN OUT UINT32 *pCount
+);
+
+/**
+Prepares os-specific passthru state that lives for the library lifetime
+(e.g. the driver context and DIMM handle lookup). Rebuilds it if already set up.
+
+@retval EFI_SUCCESS on success
+@retval EFI_DEVICE_ERROR if the driver context could not be created
+**/
+EFI_STATUS
+passthru_os_init(
+);
+
+/**
+Releases the os-specific passthru state set up by passthru_os_init
+**/
+VOID
+passthru_os_uninit(
+);
+
+/**
+Backoff outcome of the FW commands the OS driver suggested to retry on one DIMM
+**/
+typedef struct _TRANSPORT_RETRY_STATS {
+  UINT64 CommandsRetried;                       ///< Commands that got at least one retry suggested
+  UINT64 Retries;                               ///< Retries issued
+  UINT64 BackoffUs;                             ///< Time spent waiting between retries
+  UINT64 Exhausted;                             ///< Commands that ran out of retries
+  UINT64 DeadlineExpired;                       ///< Commands given up on the retry deadline
+  UINT32 Level;                                 ///< Current backoff level of the DIMM
+} TRANSPORT_RETRY_STATS;
+
+/**
+Gets the retry backoff counters of a DIMM, kept since passthru_os_init
+
+@param[in] DimmHandle   handle of the DIMM
+@param[out] pStats      receives the counters
+
+@retval EFI_SUCCESS on success
+@retval EFI_INVALID_PARAMETER if pStats is NULL
+@retval EFI_NOT_FOUND if the OS driver does not know the DIMM
+@retval EFI_UNSUPPORTED if the OS driver does not retry through this layer
+**/
+EFI_STATUS
+passthru_os_get_retry_stats(
+  IN     UINT32 DimmHandle,
+     OUT TRANSPORT_RETRY_STATS *pStats
 );
 
 /**
@@ -12,6 +12,9 @@
 #include <ShellParameters.h>
 #include <NvmDimmDriver.h>
 #include <ProcessorBind.h>
+#include <os.h>
+#include <os_efi_emulator.h>
+#include <os_efi_inventory_cache.h>
 #ifdef _MSC_VER
 #include <io.h>
 #include <conio.h>
@@ -438,6 +441,209 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Transport statistics: an open addressed table keyed by DIMM handle,
+  opcode/subopcode and transport, updated after every FW command
+**/
+STATIC TRANSPORT_STATS_ENTRY gTransportStats[TRANSPORT_STATS_MAX_ENTRIES];
+STATIC BOOLEAN gTransportStatsUsed[TRANSPORT_STATS_MAX_ENTRIES];
+STATIC UINT32 gTransportStatsCount = 0;
+STATIC UINT64 gTransportStatsDropped = 0;
+STATIC OS_MUTEX *gTransportStatsLock = NULL;
+
+EFI_STATUS
+InitializeTransportStats(
+)
+{
+  if (gTransportStatsLock == NULL) {
+    gTransportStatsLock = os_mutex_init(NULL);
+    if (gTransportStatsLock == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  ResetTransportStats();
+  return EFI_SUCCESS;
+}
+
+VOID
+UninitializeTransportStats(
+)
+{
+  if (gTransportStatsLock == NULL) {
+    return;
+  }
+  if (gTransportStatsDropped > 0) {
+    NVDIMM_DBG("Transport statistics table full, %lld commands not counted", gTransportStatsDropped);
+  }
+  os_mutex_delete(gTransportStatsLock, NULL);
+  gTransportStatsLock = NULL;
+}
+
+VOID
+ResetTransportStats(
+)
+{
+  if (gTransportStatsLock == NULL) {
+    return;
+  }
+  os_mutex_lock(gTransportStatsLock);
+  ZeroMem(gTransportStats, sizeof(gTransportStats));
+  ZeroMem(gTransportStatsUsed, sizeof(gTransportStatsUsed));
+  gTransportStatsCount = 0;
+  gTransportStatsDropped = 0;
+  os_mutex_unlock(gTransportStatsLock);
+}
+
+EFI_STATUS
+GetTransportStats(
+  OUT    TRANSPORT_STATS_ENTRY *pEntries OPTIONAL,
+  IN OUT UINT32 *pCount
+)
+{
+  EFI_STATUS Rc = EFI_SUCCESS;
+  UINT32 Index = 0;
+  UINT32 Copied = 0;
+
+  if (pCount == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (gTransportStatsLock == NULL) {
+    *pCount = 0;
+    return EFI_SUCCESS;
+  }
+
+  os_mutex_lock(gTransportStatsLock);
+  if (pEntries == NULL) {
+    *pCount = gTransportStatsCount;
+  } else {
+    for (Index = 0; Index < TRANSPORT_STATS_MAX_ENTRIES; Index++) {
+      if (!gTransportStatsUsed[Index]) {
+        continue;
+      }
+      if (Copied == *pCount) {
+        Rc = EFI_BUFFER_TOO_SMALL;
+        break;
+      }
+      pEntries[Copied++] = gTransportStats[Index];
+    }
+    *pCount = Copied;
+  }
+  os_mutex_unlock(gTransportStatsLock);
+
+  return Rc;
+}
+
+/**
+  Gets the opcode and subopcode of the FW command itself. PassThru wraps
+  the SMBUS commands in a BIOS emulated command before they get here.
+
+  @param[in] pCmd          the command
+  @param[out] pOpcode      receives the opcode
+  @param[out] pSubOpcode   receives the subopcode
+
+  @retval TRUE if the command is sent over SMBUS
+**/
+STATIC
+BOOLEAN
+GetUnwrappedOpcode(
+  IN     NVM_FW_CMD *pCmd,
+     OUT UINT8 *pOpcode,
+     OUT UINT8 *pSubOpcode
+)
+{
+  NVM_INPUT_PAYLOAD_SMBUS_OS_PASSTHRU *pSmbusPayload = NULL;
+
+  *pOpcode = pCmd->Opcode;
+  *pSubOpcode = pCmd->SubOpcode;
+  if (PtEmulatedBiosCommands == pCmd->Opcode && SubopExtVendorSpecific == pCmd->SubOpcode) {
+    pSmbusPayload = (NVM_INPUT_PAYLOAD_SMBUS_OS_PASSTHRU *)pCmd->InputPayload;
+    if (SmbusTransportInterface == pSmbusPayload->TransportInterface) {
+      *pOpcode = pSmbusPayload->Opcode;
+      *pSubOpcode = pSmbusPayload->SubOpcode;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Account one FW command in the transport statistics
+
+  @param[in] DimmHandle    handle of the DIMM the command was sent to
+  @param[in] pCmd          the command, after it completed
+  @param[in] Rc            result of the command
+  @param[in] Retries       retries suggested by the driver
+  @param[in] LatencyUs     time spent in the OS passthru
+**/
+STATIC
+VOID
+RecordTransportStats(
+  IN     UINT32 DimmHandle,
+  IN     NVM_FW_CMD *pCmd,
+  IN     EFI_STATUS Rc,
+  IN     UINT32 Retries,
+  IN     UINT64 LatencyUs
+)
+{
+  TRANSPORT_STATS_ENTRY *pEntry = NULL;
+  DIMM_PASSTHRU_METHOD Method = DimmPassthruDdrtSmallPayload;
+  UINT8 Opcode = 0;
+  UINT8 SubOpcode = 0;
+  UINT32 Slot = 0;
+  UINT32 Probe = 0;
+  UINT32 Bucket = 0;
+
+  if (gTransportStatsLock == NULL) {
+    return;
+  }
+
+  // Count SMBUS commands as the wrapped one
+  if (GetUnwrappedOpcode(pCmd, &Opcode, &SubOpcode)) {
+    Method = DimmPassthruSmbusSmallPayload;
+  } else if (pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0) {
+    Method = DimmPassthruDdrtLargePayload;
+  }
+
+  while (Bucket < TRANSPORT_STATS_BUCKETS - 1 && LatencyUs >= TRANSPORT_STATS_BUCKET_LIMIT_US(Bucket)) {
+    Bucket++;
+  }
+
+  Slot = (DimmHandle * 31 + ((UINT32)Opcode << 8 | SubOpcode) * 7 + Method) % TRANSPORT_STATS_MAX_ENTRIES;
+
+  os_mutex_lock(gTransportStatsLock);
+  for (Probe = 0; Probe < TRANSPORT_STATS_MAX_ENTRIES; Probe++) {
+    pEntry = &gTransportStats[Slot];
+    if (!gTransportStatsUsed[Slot]) {
+      gTransportStatsUsed[Slot] = TRUE;
+      gTransportStatsCount++;
+      pEntry->DimmHandle = DimmHandle;
+      pEntry->Opcode = Opcode;
+      pEntry->SubOpcode = SubOpcode;
+      pEntry->Method = Method;
+      break;
+    }
+    if (pEntry->DimmHandle == DimmHandle && pEntry->Opcode == Opcode &&
+        pEntry->SubOpcode == SubOpcode && pEntry->Method == Method) {
+      break;
+    }
+    Slot = (Slot + 1) % TRANSPORT_STATS_MAX_ENTRIES;
+  }
+
+  if (Probe == TRANSPORT_STATS_MAX_ENTRIES) {
+    gTransportStatsDropped++;
+  } else {
+    pEntry->Count++;
+    pEntry->Retries += Retries;
+    pEntry->TotalUs += LatencyUs;
+    pEntry->MaxUs = MAX(pEntry->MaxUs, LatencyUs);
+    pEntry->Buckets[Bucket]++;
+    if (EFI_ERROR(Rc)) {
+      pEntry->Errors++;
+    }
+  }
+  os_mutex_unlock(gTransportStatsLock);
+}
+
 EFI_STATUS
 EFIAPI
 DefaultPassThru(
@@ -449,6 +655,10 @@ DefaultPassThru(
   EFI_STATUS Rc = EFI_SUCCESS;
   EFI_STATUS PbrRc = EFI_SUCCESS;
   UINT32 DimmID;
+  UINT32 Retries = 0;
+  UINT64 StartUs = 0;
+  UINT8 Opcode = 0;
+  UINT8 SubOpcode = 0;
   PbrContext *pContext = PBR_CTX();
 
   if (!pDimm || !pCmd)
@@ -465,7 +675,19 @@ DefaultPassThru(
 
   DimmID = pCmd->DimmID;
   pCmd->DimmID = pDimm->DeviceHandle.AsUint32;
-  Rc = passthru_os(pDimm, pCmd, (long)Timeout);
+  StartUs = GetCurrentMicroseconds();
+  if (emulated_dimms_enabled()) {
+    Rc = emulated_passthru(pDimm, pCmd, (long)Timeout, &Retries);
+  } else {
+    Rc = passthru_os(pDimm, pCmd, (long)Timeout, &Retries);
+  }
+  RecordTransportStats(pCmd->DimmID, pCmd, Rc, Retries, GetCurrentMicroseconds() - StartUs);
+  GetUnwrappedOpcode(pCmd, &Opcode, &SubOpcode);
+  if (Opcode == PtUpdateFw && !EFI_ERROR(Rc)) {
+    // A new or activated FW image may change what the inventory cache holds,
+    // whether it went over DDRT or SMBUS
+    inventory_cache_invalidate();
+  }
 
   if (PBR_RECORD_MODE == PBR_GET_MODE(pContext))
   {
@@ -515,7 +737,8 @@ initAcpiTables()
   }
   else
   {
-    if (EFI_ERROR(get_nfit_table(&PtrNfitTable, &Size)))
+    if (EFI_ERROR(emulated_dimms_enabled() ? emulated_get_nfit_table(&PtrNfitTable, &Size) :
+      get_nfit_table(&PtrNfitTable, &Size)))
     {
       NVDIMM_WARN("Failed to get the NFIT table.\n");
       failures++;
@@ -530,7 +753,8 @@ initAcpiTables()
       }
     }
 
-    if (EFI_ERROR(get_pcat_table(&PtrPcatTable, &Size)))
+    if (EFI_ERROR(emulated_dimms_enabled() ? emulated_get_pcat_table(&PtrPcatTable, &Size) :
+      get_pcat_table(&PtrPcatTable, &Size)))
     {
       NVDIMM_WARN("Failed to get the PCAT table.\n");
       failures++;
@@ -545,7 +769,8 @@ initAcpiTables()
       }
     }
 
-    if (EFI_ERROR(get_pmtt_table(&PtrPMTTTable, &Size)))
+    if (EFI_ERROR(emulated_dimms_enabled() ? emulated_get_pmtt_table(&PtrPMTTTable, &Size) :
+      get_pmtt_table(&PtrPMTTTable, &Size)))
     {
       NVDIMM_WARN("Failed to get the PMTT table.\n");
       //failures++; //table allowed to be empty here. Will do more checks in ParseAcpiTables
@@ -584,6 +809,11 @@ initAcpiTables()
     goto Finish;
   }
 
+  if (EFI_ERROR(inventory_cache_load(PtrNfitTable, PtrPcatTable, PtrPMTTTable)))
+  {
+    NVDIMM_WARN("Failed to load the inventory cache.");
+  }
+
 Finish:
   if (PBR_PLAYBACK_MODE != PBR_GET_MODE(pContext)) {
     FREE_POOL_SAFE(PtrNfitTable);
@@ -612,7 +842,11 @@ GetFirstAndBoundSmBiosStructPointer(
   // One time initialization
   if (NULL == gSmbiosTable && PBR_PLAYBACK_MODE != PBR_GET_MODE(pContext))
   {
-    get_smbios_table();
+    if (emulated_dimms_enabled()) {
+      emulated_get_smbios_table(&gSmbiosTable, &gSmbiosTableSize, &gSmbiosMajorVersion, &gSmbiosMinorVersion);
+    } else {
+      get_smbios_table();
+    }
   }
 
   if (PBR_RECORD_MODE == PBR_GET_MODE(pContext))
@@ -0,0 +1,943 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+  Software model of a platform populated with PMem modules. When enabled
+  through EMULATED_DIMM_COUNT the OS layer takes the NFIT, PCAT and SMBIOS
+  tables from here and DefaultPassThru sends FW commands here instead of to
+  the OS driver, so the whole stack can be exercised and benchmarked without
+  hardware.
+**/
+
+#include <stdlib.h>
+#include <errno.h>
+#include <Base.h>
+#include <Uefi.h>
+#include <Debug.h>
+#include <Utility.h>
+#include <NvmTables.h>
+#include <NvmStatus.h>
+#include <NvmTypes.h>
+#include <PcdCommon.h>
+#include <NvmDimmPassThru.h>
+#include <NvmDimmConfigInt.h>
+#include <NvmDimmDriver.h>
+#include <AcpiParsing.h>
+#include <PlatformConfigData.h>
+#include <SmbiosUtility.h>
+#include <os.h>
+#include <os_efi_preferences.h>
+#include <os_efi_emulator.h>
+
+#define EMULATED_DIMM_RAW_CAPACITY      (128ULL << 30)
+#define EMULATED_SMBIOS_HANDLE_BASE     0x1000
+#define EMULATED_SERIAL_NUMBER_BASE     0xE5000000
+#define EMULATED_MANUFACTURING_LOCATION 0x42
+#define EMULATED_MANUFACTURING_DATE     0x1820
+#define EMULATED_CONTROLLER_RID         0x0020
+#define EMULATED_FIS_VERSION            0x0115          // BCD 1.15
+#define EMULATED_PART_NUMBER            "NMA1XXD128GPS"
+#define EMULATED_PCD_PARTITIONS         (PCD_LSA_PARTITION_ID + 1)
+#define EMULATED_ERROR_LOG_MAX_ENTRIES  256
+#define EMULATED_SMBIOS_MAJOR_VERSION   3
+#define EMULATED_SMBIOS_MINOR_VERSION   2
+#define EMULATED_SMBIOS_STRING_LENGTH   32
+#define EMULATED_SMBIOS_STRING_COUNT    5
+
+// Command effect bits as laid out in COMMAND_EFFECT_LOG_ENTRY
+#define CEL_NO_EFFECTS                  BIT0
+#define CEL_CONFIG_CHANGE_AFTER_REBOOT  BIT2
+#define CEL_IMMEDIATE_CONFIG_CHANGE     BIT3
+#define CEL_IMMEDIATE_POLICY_CHANGE     BIT8
+
+typedef struct {
+  UINT32 DeviceHandle;
+  UINT16 PhysicalId;
+  UINT32 SerialNumber;
+  UINT8 Fwr[FW_BCD_VERSION_LEN];
+  UINT8 StagedFwr[FW_BCD_VERSION_LEN];
+  BOOLEAN FwStaged;
+  UINT8 LastFwUpdateStatus;
+  UINT32 FwUpdateBytes;
+  PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS LongOp;
+  BOOLEAN LongOpValid;
+  UINT64 ReadRequests;
+  UINT64 WriteRequests;
+  UINT64 TotalReadRequests;
+  UINT64 TotalWriteRequests;
+  UINT8 *pPcd[EMULATED_PCD_PARTITIONS];   //!< allocated on first write, reads as zeros before
+} EMULATED_DIMM;
+
+typedef struct {
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  UINT32 Effects;
+} EMULATED_CEL_ENTRY;
+
+/**
+  Commands implemented by the model and what they do to module state
+**/
+STATIC CONST EMULATED_CEL_ENTRY gEmulatedCel[] = {
+  { PtIdentifyDimm,         SubopIdentify,              CEL_NO_EFFECTS },
+  { PtIdentifyDimm,         SubopDeviceCharacteristics, CEL_NO_EFFECTS },
+  { PtGetSecInfo,           SubopGetSecState,           CEL_NO_EFFECTS },
+  { PtGetFeatures,          SubopAlarmThresholds,       CEL_NO_EFFECTS },
+  { PtGetFeatures,          SubopPolicyPowMgmt,         CEL_NO_EFFECTS },
+  { PtGetFeatures,          SubopAddressRangeScrub,     CEL_NO_EFFECTS },
+  { PtGetFeatures,          SubopConfigDataPolicy,      CEL_NO_EFFECTS },
+  { PtSetFeatures,          SubopAlarmThresholds,       CEL_IMMEDIATE_POLICY_CHANGE },
+  { PtSetFeatures,          SubopPolicyPowMgmt,         CEL_IMMEDIATE_POLICY_CHANGE },
+  { PtSetFeatures,          SubopConfigDataPolicy,      CEL_IMMEDIATE_POLICY_CHANGE },
+  { PtGetAdminFeatures,     SubopSystemTime,            CEL_NO_EFFECTS },
+  { PtGetAdminFeatures,     SubopPlatformDataInfo,      CEL_NO_EFFECTS },
+  { PtGetAdminFeatures,     SubopDimmPartitionInfo,     CEL_NO_EFFECTS },
+  { PtGetAdminFeatures,     SubopViralPolicy,           CEL_NO_EFFECTS },
+  { PtSetAdminFeatures,     SubopSystemTime,            CEL_IMMEDIATE_POLICY_CHANGE },
+  { PtSetAdminFeatures,     SubopPlatformDataInfo,      CEL_CONFIG_CHANGE_AFTER_REBOOT },
+  { PtGetLog,               SubopSmartHealth,           CEL_NO_EFFECTS },
+  { PtGetLog,               SubopFwImageInfo,           CEL_NO_EFFECTS },
+  { PtGetLog,               SubopMemInfo,               CEL_NO_EFFECTS },
+  { PtGetLog,               SubopLongOperationStat,     CEL_NO_EFFECTS },
+  { PtGetLog,               SubopErrorLog,              CEL_NO_EFFECTS },
+  { PtGetLog,               SubopCommandEffectLog,      CEL_NO_EFFECTS },
+  { PtUpdateFw,             SubopUpdateFw,              CEL_CONFIG_CHANGE_AFTER_REBOOT },
+  { PtUpdateFw,             SubopFwActivate,            CEL_IMMEDIATE_CONFIG_CHANGE },
+  { PtEmulatedBiosCommands, SubopGetBSR,                CEL_NO_EFFECTS },
+};
+
+STATIC EMULATED_DIMM *gEmulatedDimms = NULL;
+STATIC UINT32 gEmulatedDimmCount = 0;
+STATIC UINT32 gEmulatedLatencyUs = 0;
+STATIC UINT32 gEmulatedFailureRate = 0;
+STATIC UINT32 gEmulatedSeed = 0;
+STATIC OS_MUTEX *gEmulatedLock = NULL;
+
+/**
+  Reads one numeric emulator setting, missing settings read as 0
+**/
+STATIC
+UINT32
+GetEmulatorPreference(
+  IN     CHAR16 *pName
+)
+{
+  EFI_GUID Guid = { 0 };
+  UINT32 Value = 0;
+  UINTN Size = sizeof(Value);
+
+  if (EFI_ERROR(GET_VARIABLE(pName, Guid, &Size, &Value))) {
+    return 0;
+  }
+  return Value;
+}
+
+/**
+  Topology of the emulated platform: 12 modules per socket,
+  2 iMCs per socket, 3 channels per iMC and 2 slots per channel
+**/
+STATIC
+UINT32
+EmulatedDeviceHandle(
+  IN     UINT32 Index
+)
+{
+  NfitDeviceHandle Handle;
+  UINT32 InSocket = Index % EMULATED_DIMMS_PER_SOCKET;
+
+  Handle.AsUint32 = 0;
+  Handle.NfitDeviceHandle.SocketId = Index / EMULATED_DIMMS_PER_SOCKET;
+  Handle.NfitDeviceHandle.MemControllerId = InSocket / 6;
+  Handle.NfitDeviceHandle.MemChannel = (InSocket % 6) / 2;
+  Handle.NfitDeviceHandle.DimmNumber = InSocket % 2;
+  return Handle.AsUint32;
+}
+
+STATIC
+UINT32
+EmulatedSocketCount(
+)
+{
+  return (gEmulatedDimmCount + EMULATED_DIMMS_PER_SOCKET - 1) / EMULATED_DIMMS_PER_SOCKET;
+}
+
+EFI_STATUS
+emulated_dimms_init(
+)
+{
+  UINT32 Count = 0;
+  UINT32 Index = 0;
+
+  if (gEmulatedDimms != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Count = GetEmulatorPreference(INI_PREFERENCES_EMULATED_DIMM_COUNT);
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+  if (Count > EMULATED_DIMM_MAX_COUNT) {
+    NVDIMM_WARN("Limiting emulated PMem modules to %d", EMULATED_DIMM_MAX_COUNT);
+    Count = EMULATED_DIMM_MAX_COUNT;
+  }
+
+  gEmulatedLock = os_mutex_init(NULL);
+  if (gEmulatedLock == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  gEmulatedDimms = AllocateZeroPool(Count * sizeof(*gEmulatedDimms));
+  if (gEmulatedDimms == NULL) {
+    os_mutex_delete(gEmulatedLock, NULL);
+    gEmulatedLock = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    gEmulatedDimms[Index].DeviceHandle = EmulatedDeviceHandle(Index);
+    gEmulatedDimms[Index].PhysicalId = (UINT16)(EMULATED_SMBIOS_HANDLE_BASE + Index);
+    gEmulatedDimms[Index].SerialNumber = EMULATED_SERIAL_NUMBER_BASE + Index;
+    // BCD 01.02.00.5375
+    gEmulatedDimms[Index].Fwr[FWR_PRODUCT_VERSION_OFFSET] = 0x01;
+    gEmulatedDimms[Index].Fwr[FWR_REVISION_VERSION_OFFSET] = 0x02;
+    gEmulatedDimms[Index].Fwr[FWR_SECURITY_VERSION_OFFSET] = 0x00;
+    gEmulatedDimms[Index].Fwr[FWR_BUILD_VERSION_HI_OFFSET] = 0x53;
+    gEmulatedDimms[Index].Fwr[FWR_BUILD_VERSION_LOW_OFFSET] = 0x75;
+  }
+
+  gEmulatedLatencyUs = GetEmulatorPreference(INI_PREFERENCES_EMULATED_CMD_LATENCY_US);
+  gEmulatedFailureRate = GetEmulatorPreference(INI_PREFERENCES_EMULATED_CMD_FAILURE_RATE);
+  gEmulatedSeed = Count;
+  gEmulatedDimmCount = Count;
+
+  NVDIMM_DBG("Emulating %d PMem modules, %dus per command, %d/1000 failures",
+    gEmulatedDimmCount, gEmulatedLatencyUs, gEmulatedFailureRate);
+  return EFI_SUCCESS;
+}
+
+VOID
+emulated_dimms_uninit(
+)
+{
+  UINT32 Index = 0;
+  UINT32 Partition = 0;
+
+  if (gEmulatedDimms == NULL) {
+    return;
+  }
+  for (Index = 0; Index < gEmulatedDimmCount; Index++) {
+    for (Partition = 0; Partition < EMULATED_PCD_PARTITIONS; Partition++) {
+      FREE_POOL_SAFE(gEmulatedDimms[Index].pPcd[Partition]);
+    }
+  }
+  FREE_POOL_SAFE(gEmulatedDimms);
+  gEmulatedDimmCount = 0;
+  os_mutex_delete(gEmulatedLock, NULL);
+  gEmulatedLock = NULL;
+}
+
+BOOLEAN
+emulated_dimms_enabled(
+)
+{
+  return gEmulatedDimmCount > 0;
+}
+
+/**
+  Platform Config Data get/set, every partition is PCD_PARTITION_SIZE bytes
+**/
+STATIC
+UINT8
+EmulatedGetPcd(
+  IN     EMULATED_DIMM *pEmuDimm,
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  PT_INPUT_PAYLOAD_GET_PLATFORM_CONFIG_DATA *pIn = (PT_INPUT_PAYLOAD_GET_PLATFORM_CONFIG_DATA *)pInput;
+  PT_OUTPUT_PAYLOAD_GET_PLATFORM_CONFIG_DATA_SIZE *pSize = (PT_OUTPUT_PAYLOAD_GET_PLATFORM_CONFIG_DATA_SIZE *)pCmd->OutPayload;
+  UINT8 *pPartition = NULL;
+  UINT32 Length = 0;
+
+  if (pIn->PartitionId >= EMULATED_PCD_PARTITIONS) {
+    return FW_INVALID_COMMAND_PARAMETER;
+  }
+  if (pIn->CmdOptions.RetrieveOption == PCD_CMD_OPT_PARTITION_SIZE) {
+    pSize->Size = PCD_PARTITION_SIZE;
+    return FW_SUCCESS;
+  }
+
+  pPartition = pEmuDimm->pPcd[pIn->PartitionId];
+  if (pIn->CmdOptions.PayloadType == PCD_CMD_OPT_SMALL_PAYLOAD) {
+    if (pIn->Offset > PCD_PARTITION_SIZE - PCD_GET_SMALL_PAYLOAD_DATA_SIZE) {
+      return FW_INVALID_COMMAND_PARAMETER;
+    }
+    if (pPartition != NULL) {
+      CopyMem_S(pCmd->OutPayload, sizeof(pCmd->OutPayload), pPartition + pIn->Offset, PCD_GET_SMALL_PAYLOAD_DATA_SIZE);
+    }
+  } else {
+    Length = MIN(pCmd->LargeOutputPayloadSize, PCD_PARTITION_SIZE);
+    if (pPartition != NULL) {
+      CopyMem_S(pCmd->LargeOutputPayload, sizeof(pCmd->LargeOutputPayload), pPartition, Length);
+    } else {
+      ZeroMem(pCmd->LargeOutputPayload, Length);
+    }
+  }
+  return FW_SUCCESS;
+}
+
+STATIC
+UINT8
+EmulatedSetPcd(
+  IN     EMULATED_DIMM *pEmuDimm,
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  PT_INPUT_PAYLOAD_SET_DATA_PLATFORM_CONFIG_DATA *pIn = (PT_INPUT_PAYLOAD_SET_DATA_PLATFORM_CONFIG_DATA *)pInput;
+  UINT8 **ppPartition = NULL;
+  UINT32 Length = 0;
+
+  if (pIn->PartitionId >= EMULATED_PCD_PARTITIONS) {
+    return FW_INVALID_COMMAND_PARAMETER;
+  }
+
+  if (pIn->PayloadType == PCD_CMD_OPT_SMALL_PAYLOAD) {
+    Length = PCD_SET_SMALL_PAYLOAD_DATA_SIZE;
+  } else {
+    Length = pCmd->LargeInputPayloadSize;
+  }
+  if (pIn->Offset > PCD_PARTITION_SIZE || Length > PCD_PARTITION_SIZE - pIn->Offset) {
+    return FW_INVALID_COMMAND_PARAMETER;
+  }
+
+  ppPartition = &pEmuDimm->pPcd[pIn->PartitionId];
+  if (*ppPartition == NULL) {
+    *ppPartition = AllocateZeroPool(PCD_PARTITION_SIZE);
+    if (*ppPartition == NULL) {
+      return FW_NO_RESOURCES;
+    }
+  }
+
+  if (pIn->PayloadType == PCD_CMD_OPT_SMALL_PAYLOAD) {
+    CopyMem_S(*ppPartition + pIn->Offset, PCD_PARTITION_SIZE - pIn->Offset, pIn->Data, Length);
+  } else {
+    CopyMem_S(*ppPartition + pIn->Offset, PCD_PARTITION_SIZE - pIn->Offset, pCmd->LargeInputPayload, Length);
+  }
+  return FW_SUCCESS;
+}
+
+/**
+  Image transfer completes right away, the image is staged and activated
+  by FW activate or on the next emulator start
+**/
+STATIC
+UINT8
+EmulatedUpdateFw(
+  IN     EMULATED_DIMM *pEmuDimm,
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  FW_SMALL_PAYLOAD_UPDATE_PACKET *pPacket = (FW_SMALL_PAYLOAD_UPDATE_PACKET *)pInput;
+  BOOLEAN Complete = FALSE;
+
+  if (pPacket->PayloadTypeSelector == FW_UPDATE_LARGE_PAYLOAD_SELECTOR) {
+    pEmuDimm->FwUpdateBytes = pCmd->LargeInputPayloadSize;
+    Complete = TRUE;
+  } else {
+    if (pPacket->TransactionType == FW_UPDATE_INIT_TRANSFER) {
+      pEmuDimm->FwUpdateBytes = 0;
+    }
+    pEmuDimm->FwUpdateBytes += UPDATE_FIRMWARE_SMALL_PAYLOAD_DATA_PACKET_SIZE;
+    Complete = pPacket->TransactionType == FW_UPDATE_END_TRANSFER;
+  }
+
+  if (Complete) {
+    CopyMem_S(pEmuDimm->StagedFwr, sizeof(pEmuDimm->StagedFwr), pEmuDimm->Fwr, sizeof(pEmuDimm->Fwr));
+    pEmuDimm->StagedFwr[FWR_BUILD_VERSION_LOW_OFFSET]++;
+    pEmuDimm->FwStaged = TRUE;
+    pEmuDimm->LastFwUpdateStatus = FW_UPDATE_STATUS_STAGED_SUCCESS;
+
+    ZeroMem(&pEmuDimm->LongOp, sizeof(pEmuDimm->LongOp));
+    pEmuDimm->LongOp.CmdOpcode = PtUpdateFw;
+    pEmuDimm->LongOp.CmdSubOpcode = SubopUpdateFw;
+    pEmuDimm->LongOp.Percent = 100;
+    pEmuDimm->LongOp.Status = FW_SUCCESS;
+    pEmuDimm->LongOpValid = TRUE;
+  }
+  return FW_SUCCESS;
+}
+
+STATIC
+UINT8
+EmulatedGetCel(
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  PT_INPUT_PAYLOAD_GET_COMMAND_EFFECT_LOG *pIn = (PT_INPUT_PAYLOAD_GET_COMMAND_EFFECT_LOG *)pInput;
+  PT_OUTPUT_PAYLOAD_GET_COMMAND_EFFECT_LOG *pOut = (PT_OUTPUT_PAYLOAD_GET_COMMAND_EFFECT_LOG *)pCmd->OutPayload;
+  COMMAND_EFFECT_LOG_ENTRY *pEntries = NULL;
+  UINT32 MaxEntries = 0;
+  UINT32 Index = 0;
+
+  if (pIn->LogAction == EntriesCount) {
+    pOut->LogTypeData.CelCount.LogEntryCount = ARRAY_SIZE(gEmulatedCel);
+    return FW_SUCCESS;
+  }
+
+  if (pIn->PayloadType == LargePayload) {
+    pEntries = (COMMAND_EFFECT_LOG_ENTRY *)pCmd->LargeOutputPayload;
+    MaxEntries = pCmd->LargeOutputPayloadSize / sizeof(*pEntries);
+  } else {
+    pEntries = pOut->LogTypeData.CelEntries.CelEntry;
+    MaxEntries = ARRAY_SIZE(pOut->LogTypeData.CelEntries.CelEntry);
+  }
+
+  for (Index = 0; Index < MaxEntries && pIn->EntryOffset + Index < ARRAY_SIZE(gEmulatedCel); Index++) {
+    pEntries[Index].Opcode.AsUint32 = 0;
+    pEntries[Index].Opcode.Separated.Opcode = gEmulatedCel[pIn->EntryOffset + Index].Opcode;
+    pEntries[Index].Opcode.Separated.SubOpcode = gEmulatedCel[pIn->EntryOffset + Index].SubOpcode;
+    pEntries[Index].EffectName.AsUint32 = gEmulatedCel[pIn->EntryOffset + Index].Effects;
+  }
+  return FW_SUCCESS;
+}
+
+STATIC
+UINT8
+EmulatedGetLog(
+  IN     EMULATED_DIMM *pEmuDimm,
+  IN     UINT8 SubOpcode,
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  PT_PAYLOAD_SMART_AND_HEALTH *pSmart = NULL;
+  PT_PAYLOAD_FW_IMAGE_INFO *pFwImageInfo = NULL;
+  PT_INPUT_PAYLOAD_GET_ERROR_LOG *pErrorLogIn = NULL;
+  LOG_INFO_DATA_RETURN *pLogInfo = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0 *pPage0 = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *pPage1 = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE4 *pPage4 = NULL;
+
+  switch (SubOpcode) {
+  case SubopSmartHealth:
+    pSmart = (PT_PAYLOAD_SMART_AND_HEALTH *)pCmd->OutPayload;
+    pSmart->ValidationFlags.Separated.HealthStatus = 1;
+    pSmart->ValidationFlags.Separated.PercentageRemaining = 1;
+    pSmart->ValidationFlags.Separated.MediaTemperature = 1;
+    pSmart->ValidationFlags.Separated.ControllerTemperature = 1;
+    pSmart->ValidationFlags.Separated.AITDRAMStatus = 1;
+    pSmart->ValidationFlags.Separated.AlarmTrips = 1;
+    pSmart->ValidationFlags.Separated.LatchedLastShutdownStatus = 1;
+    pSmart->ValidationFlags.Separated.SizeOfVendorSpecificDataValid = 1;
+    pSmart->PercentageRemaining = 100;
+    pSmart->MediaTemperature.Separated.TemperatureValue = 30;
+    pSmart->ControllerTemperature.Separated.TemperatureValue = 35;
+    pSmart->AITDRAMStatus = 1;
+    pSmart->VendorSpecificDataSize = sizeof(pSmart->VendorSpecificData);
+    pSmart->VendorSpecificData.MaxMediaTemperature.Separated.TemperatureValue = 42;
+    pSmart->VendorSpecificData.MaxControllerTemperature.Separated.TemperatureValue = 47;
+    return FW_SUCCESS;
+
+  case SubopFwImageInfo:
+    pFwImageInfo = (PT_PAYLOAD_FW_IMAGE_INFO *)pCmd->OutPayload;
+    CopyMem_S(pFwImageInfo->FwRevision, sizeof(pFwImageInfo->FwRevision), pEmuDimm->Fwr, sizeof(pEmuDimm->Fwr));
+    if (pEmuDimm->FwStaged) {
+      CopyMem_S(pFwImageInfo->StagedFwRevision, sizeof(pFwImageInfo->StagedFwRevision),
+        pEmuDimm->StagedFwr, sizeof(pEmuDimm->StagedFwr));
+      pFwImageInfo->StagedFwActivatable = 1;
+    }
+    pFwImageInfo->LastFwUpdateStatus = pEmuDimm->LastFwUpdateStatus;
+    return FW_SUCCESS;
+
+  case SubopMemInfo:
+    switch (((PT_INPUT_PAYLOAD_MEMORY_INFO *)pInput)->MemoryPage) {
+    case MEMORY_INFO_PAGE_0:
+      pPage0 = (PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE0 *)pCmd->OutPayload;
+      pPage0->ReadRequests.Uint64 = pEmuDimm->ReadRequests;
+      pPage0->WriteRequests.Uint64 = pEmuDimm->WriteRequests;
+      pPage0->MediaReads.Uint64 = pEmuDimm->ReadRequests;
+      pPage0->MediaWrites.Uint64 = pEmuDimm->WriteRequests;
+      return FW_SUCCESS;
+    case MEMORY_INFO_PAGE_1:
+      pPage1 = (PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *)pCmd->OutPayload;
+      pPage1->TotalReadRequests.Uint64 = pEmuDimm->TotalReadRequests;
+      pPage1->TotalWriteRequests.Uint64 = pEmuDimm->TotalWriteRequests;
+      pPage1->TotalMediaReads.Uint64 = pEmuDimm->TotalReadRequests;
+      pPage1->TotalMediaWrites.Uint64 = pEmuDimm->TotalWriteRequests;
+      return FW_SUCCESS;
+    case MEMORY_INFO_PAGE_3:
+      // No error injection ever enabled
+      return FW_SUCCESS;
+    case MEMORY_INFO_PAGE_4:
+      pPage4 = (PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE4 *)pCmd->OutPayload;
+      pPage4->DcpmmAveragePower = 12000;
+      pPage4->AveragePower12V = 9000;
+      pPage4->AveragePower1_2V = 3000;
+      return FW_SUCCESS;
+    default:
+      return FW_INVALID_COMMAND_PARAMETER;
+    }
+
+  case SubopLongOperationStat:
+    if (!pEmuDimm->LongOpValid) {
+      return FW_DATA_NOT_SET;
+    }
+    CopyMem_S(pCmd->OutPayload, sizeof(pCmd->OutPayload), &pEmuDimm->LongOp, sizeof(pEmuDimm->LongOp));
+    return FW_SUCCESS;
+
+  case SubopErrorLog:
+    // The logs are always empty
+    pErrorLogIn = (PT_INPUT_PAYLOAD_GET_ERROR_LOG *)pInput;
+    if (pErrorLogIn->LogParameters.Separated.LogInfo) {
+      pLogInfo = (LOG_INFO_DATA_RETURN *)pCmd->OutPayload;
+      pLogInfo->MaxLogEntries = EMULATED_ERROR_LOG_MAX_ENTRIES;
+    }
+    return FW_SUCCESS;
+
+  case SubopCommandEffectLog:
+    return EmulatedGetCel(pInput, pCmd);
+
+  default:
+    return FW_UNSUPPORTED_COMMAND;
+  }
+}
+
+/**
+  Executes one FW command against the model
+
+  @param[in] pEmuDimm module addressed by the command
+  @param[in] Opcode, SubOpcode the command, after unwrapping an SMBUS request
+  @param[in] pInput the small input payload
+  @param[in,out] pCmd large payloads and output payload
+
+  @retval FW status of the command
+**/
+STATIC
+UINT8
+EmulatedFwCmd(
+  IN     EMULATED_DIMM *pEmuDimm,
+  IN     UINT8 Opcode,
+  IN     UINT8 SubOpcode,
+  IN     UINT8 *pInput,
+  IN OUT NVM_FW_CMD *pCmd
+)
+{
+  PT_ID_DIMM_PAYLOAD *pIdentify = NULL;
+  PT_DEVICE_CHARACTERISTICS_PAYLOAD *pCharacteristics = NULL;
+  PT_DIMM_PARTITION_INFO_PAYLOAD *pPartitionInfo = NULL;
+  DIMM_BSR Bsr;
+
+  switch (Opcode) {
+  case PtIdentifyDimm:
+    if (SubOpcode == SubopIdentify) {
+      pIdentify = (PT_ID_DIMM_PAYLOAD *)pCmd->OutPayload;
+      pIdentify->Vid = SPD_INTEL_VENDOR_ID;
+      pIdentify->Did = SPD_DEVICE_ID_10;
+      pIdentify->Rid = EMULATED_CONTROLLER_RID;
+      pIdentify->Ifc = DCPMM_FMT_CODE_APP_DIRECT;
+      CopyMem_S(pIdentify->Fwr, sizeof(pIdentify->Fwr), pEmuDimm->Fwr, sizeof(pEmuDimm->Fwr));
+      pIdentify->Rc = (UINT32)(EMULATED_DIMM_RAW_CAPACITY / BLOCKSIZE_4K);
+      pIdentify->Mf = SPD_INTEL_VENDOR_ID;
+      pIdentify->Sn = pEmuDimm->SerialNumber;
+      AsciiStrCpyS(pIdentify->Pn, sizeof(pIdentify->Pn), EMULATED_PART_NUMBER);
+      pIdentify->DimmSku = BIT0 | BIT2;   // memory mode and app direct
+      pIdentify->ApiVer = EMULATED_FIS_VERSION;
+      pIdentify->ActiveApiVer = EMULATED_FIS_VERSION;
+      return FW_SUCCESS;
+    }
+    if (SubOpcode == SubopDeviceCharacteristics) {
+      pCharacteristics = (PT_DEVICE_CHARACTERISTICS_PAYLOAD *)pCmd->OutPayload;
+      pCharacteristics->ControllerShutdownThreshold.Separated.TemperatureValue = 102;
+      pCharacteristics->MediaShutdownThreshold.Separated.TemperatureValue = 87;
+      pCharacteristics->MediaThrottlingStartThreshold.Separated.TemperatureValue = 85;
+      pCharacteristics->MediaThrottlingStopThreshold.Separated.TemperatureValue = 84;
+      pCharacteristics->ControllerThrottlingStartThreshold.Separated.TemperatureValue = 100;
+      pCharacteristics->ControllerThrottlingStopThreshold.Separated.TemperatureValue = 99;
+      pCharacteristics->MaxAveragePowerLimit = 18000;
+      return FW_SUCCESS;
+    }
+    return FW_UNSUPPORTED_COMMAND;
+
+  case PtGetSecInfo:
+    // Security disabled, zeroed payload
+    return SubOpcode == SubopGetSecState ? FW_SUCCESS : FW_UNSUPPORTED_COMMAND;
+
+  case PtGetFeatures:
+    // Default policies, zeroed payloads
+    pEmuDimm->ReadRequests++;
+    return FW_SUCCESS;
+
+  case PtSetFeatures:
+    pEmuDimm->WriteRequests++;
+    return FW_SUCCESS;
+
+  case PtGetAdminFeatures:
+    pEmuDimm->ReadRequests++;
+    if (SubOpcode == SubopPlatformDataInfo) {
+      return EmulatedGetPcd(pEmuDimm, pInput, pCmd);
+    }
+    if (SubOpcode == SubopDimmPartitionInfo) {
+      pPartitionInfo = (PT_DIMM_PARTITION_INFO_PAYLOAD *)pCmd->OutPayload;
+      pPartitionInfo->PersistentCapacity = (UINT32)(EMULATED_DIMM_RAW_CAPACITY / BLOCKSIZE_4K);
+      pPartitionInfo->RawCapacity = (UINT32)(EMULATED_DIMM_RAW_CAPACITY / BLOCKSIZE_4K);
+      return FW_SUCCESS;
+    }
+    return FW_SUCCESS;
+
+  case PtSetAdminFeatures:
+    pEmuDimm->WriteRequests++;
+    if (SubOpcode == SubopPlatformDataInfo) {
+      return EmulatedSetPcd(pEmuDimm, pInput, pCmd);
+    }
+    return FW_SUCCESS;
+
+  case PtGetLog:
+    pEmuDimm->ReadRequests++;
+    return EmulatedGetLog(pEmuDimm, SubOpcode, pInput, pCmd);
+
+  case PtUpdateFw:
+    if (SubOpcode == SubopUpdateFw) {
+      return EmulatedUpdateFw(pEmuDimm, pInput, pCmd);
+    }
+    if (SubOpcode == SubopFwActivate) {
+      if (!pEmuDimm->FwStaged) {
+        return FW_DATA_NOT_SET;
+      }
+      CopyMem_S(pEmuDimm->Fwr, sizeof(pEmuDimm->Fwr), pEmuDimm->StagedFwr, sizeof(pEmuDimm->StagedFwr));
+      pEmuDimm->FwStaged = FALSE;
+      pEmuDimm->LastFwUpdateStatus = FW_UPDATE_STATUS_LOAD_SUCCESS;
+      return FW_SUCCESS;
+    }
+    return FW_UNSUPPORTED_COMMAND;
+
+  case PtEmulatedBiosCommands:
+    if (SubOpcode == SubopGetBSR) {
+      Bsr.AsUint64 = 0;
+      Bsr.Separated_Current_FIS.Major = DIMM_BSR_MAJOR_CHECKPOINT_INIT_COMPLETE;
+      Bsr.Separated_Current_FIS.MR = DIMM_BSR_MEDIA_TRAINED;
+      Bsr.Separated_Current_FIS.MBR = DIMM_BSR_MAILBOX_READY;
+      Bsr.Separated_Current_FIS.DR = DDRT_TRAINING_COMPLETE;
+      CopyMem_S(pCmd->OutPayload, sizeof(pCmd->OutPayload), &Bsr.AsUint64, sizeof(Bsr.AsUint64));
+      return FW_SUCCESS;
+    }
+    return FW_UNSUPPORTED_COMMAND;
+
+  default:
+    return FW_UNSUPPORTED_COMMAND;
+  }
+}
+
+EFI_STATUS
+emulated_passthru(
+  IN     struct _DIMM *pDimm,
+  IN OUT NVM_FW_CMD *pCmd,
+  IN     long Timeout,
+     OUT UINT32 *pRetries OPTIONAL
+)
+{
+  NVM_INPUT_PAYLOAD_SMBUS_OS_PASSTHRU *pSmbusPayload = NULL;
+  EMULATED_DIMM *pEmuDimm = NULL;
+  UINT8 *pInput = NULL;
+  UINT8 Opcode = 0;
+  UINT8 SubOpcode = 0;
+  UINT32 Index = 0;
+  BOOLEAN Fail = FALSE;
+
+  if (pCmd == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (pRetries != NULL) {
+    *pRetries = 0;
+  }
+  if (gEmulatedDimms == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  if (gEmulatedLatencyUs > 0) {
+    gBS->Stall(gEmulatedLatencyUs);
+  }
+
+  os_mutex_lock(gEmulatedLock);
+  for (Index = 0; Index < gEmulatedDimmCount; Index++) {
+    if (gEmulatedDimms[Index].DeviceHandle == pCmd->DimmID) {
+      pEmuDimm = &gEmulatedDimms[Index];
+      break;
+    }
+  }
+  if (gEmulatedFailureRate > 0) {
+    gEmulatedSeed = gEmulatedSeed * 1103515245 + 12345;
+    Fail = ((gEmulatedSeed >> 16) % 1000) < gEmulatedFailureRate;
+  }
+
+  if (pEmuDimm == NULL) {
+    os_mutex_unlock(gEmulatedLock);
+    return EFI_NOT_FOUND;
+  }
+
+  ZeroMem(pCmd->OutPayload, sizeof(pCmd->OutPayload));
+  pCmd->DsmStatus = 0;
+  if (Fail) {
+    pCmd->Status = FW_INTERNAL_DEVICE_ERROR;
+    os_mutex_unlock(gEmulatedLock);
+    return EFI_SUCCESS;
+  }
+
+  Opcode = pCmd->Opcode;
+  SubOpcode = pCmd->SubOpcode;
+  pInput = pCmd->InputPayload;
+  // SMBUS requests arrive wrapped in the OS vendor specific command
+  if (Opcode == PtEmulatedBiosCommands && SubOpcode == SubopExtVendorSpecific) {
+    pSmbusPayload = (NVM_INPUT_PAYLOAD_SMBUS_OS_PASSTHRU *)pCmd->InputPayload;
+    Opcode = pSmbusPayload->Opcode;
+    SubOpcode = pSmbusPayload->SubOpcode;
+    pInput = pSmbusPayload->Data;
+  }
+
+  pEmuDimm->TotalReadRequests -= pEmuDimm->ReadRequests;
+  pEmuDimm->TotalWriteRequests -= pEmuDimm->WriteRequests;
+  pCmd->Status = EmulatedFwCmd(pEmuDimm, Opcode, SubOpcode, pInput, pCmd);
+  pEmuDimm->TotalReadRequests += pEmuDimm->ReadRequests;
+  pEmuDimm->TotalWriteRequests += pEmuDimm->WriteRequests;
+  os_mutex_unlock(gEmulatedLock);
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+emulated_get_nfit_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+)
+{
+  NFitHeader *pNfit = NULL;
+  NvDimmRegionMappingStructure *pRegion = NULL;
+  ControlRegionTbl *pControlRegion = NULL;
+  UINT8 *pCursor = NULL;
+  UINT32 Length = 0;
+  UINT32 Index = 0;
+
+  if (pTable == NULL || tablesize == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Length = sizeof(*pNfit) + gEmulatedDimmCount * (sizeof(*pRegion) + sizeof(*pControlRegion));
+  pNfit = AllocateZeroPool(Length);
+  if (pNfit == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  pNfit->Header.Signature = NFIT_TABLE_SIG;
+  pNfit->Header.Length = Length;
+  pNfit->Header.Revision.AsUint8 = ACPI_REVISION_1;
+  CopyMem_S(pNfit->Header.OemId, sizeof(pNfit->Header.OemId), "EMUPMM", sizeof(pNfit->Header.OemId));
+
+  pCursor = (UINT8 *)(pNfit + 1);
+  for (Index = 0; Index < gEmulatedDimmCount; Index++) {
+    pRegion = (NvDimmRegionMappingStructure *)pCursor;
+    pRegion->Header.Type = NVDIMM_NVDIMM_REGION_TYPE;
+    pRegion->Header.Length = sizeof(*pRegion);
+    pRegion->DeviceHandle.AsUint32 = gEmulatedDimms[Index].DeviceHandle;
+    pRegion->NvDimmPhysicalId = gEmulatedDimms[Index].PhysicalId;
+    pRegion->NvdimmControlRegionDescriptorTableIndex = (UINT16)(Index + 1);
+    pCursor += sizeof(*pRegion);
+
+    pControlRegion = (ControlRegionTbl *)pCursor;
+    pControlRegion->Header.Type = NVDIMM_CONTROL_REGION_TYPE;
+    pControlRegion->Header.Length = sizeof(*pControlRegion);
+    pControlRegion->ControlRegionDescriptorTableIndex = (UINT16)(Index + 1);
+    pControlRegion->VendorId = SPD_INTEL_VENDOR_ID;
+    pControlRegion->DeviceId = SPD_DEVICE_ID_10;
+    pControlRegion->Rid = EMULATED_CONTROLLER_RID;
+    pControlRegion->SubsystemVendorId = SPD_INTEL_VENDOR_ID;
+    pControlRegion->SubsystemDeviceId = SPD_DEVICE_ID_10;
+    pControlRegion->SubsystemRid = EMULATED_CONTROLLER_RID;
+    pControlRegion->ValidFields = 1;
+    pControlRegion->ManufacturingLocation = EMULATED_MANUFACTURING_LOCATION;
+    pControlRegion->ManufacturingDate = EMULATED_MANUFACTURING_DATE;
+    pControlRegion->SerialNumber = gEmulatedDimms[Index].SerialNumber;
+    pControlRegion->RegionFormatInterfaceCode = DCPMM_FMT_CODE_APP_DIRECT;
+    pCursor += sizeof(*pControlRegion);
+  }
+
+  GenerateChecksum(pNfit, Length, PCAT_TABLE_HEADER_CHECKSUM_OFFSET);
+  *pTable = (EFI_ACPI_DESCRIPTION_HEADER *)pNfit;
+  *tablesize = Length;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+emulated_get_pcat_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+)
+{
+  PLATFORM_CONFIG_ATTRIBUTES_TABLE *pPcat = NULL;
+  PLATFORM_CAPABILITY_INFO *pCapability = NULL;
+  MEMORY_INTERLEAVE_CAPABILITY_INFO *pInterleave = NULL;
+  SOCKET_SKU_INFO_TABLE *pSocketSku = NULL;
+  UINT8 *pCursor = NULL;
+  UINT32 InterleaveLength = sizeof(*pInterleave) + sizeof(pInterleave->InterleaveFormatList[0]);
+  UINT32 Length = 0;
+  UINT32 Socket = 0;
+
+  if (pTable == NULL || tablesize == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Length = sizeof(*pPcat) + sizeof(*pCapability) + InterleaveLength + EmulatedSocketCount() * sizeof(*pSocketSku);
+  pPcat = AllocateZeroPool(Length);
+  if (pPcat == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  pPcat->Header.Signature = PCAT_TABLE_SIG;
+  pPcat->Header.Length = Length;
+  pPcat->Header.Revision.AsUint8 = PCAT_HEADER_REVISION_1;
+  CopyMem_S(pPcat->Header.OemId, sizeof(pPcat->Header.OemId), "EMUPMM", sizeof(pPcat->Header.OemId));
+
+  pCursor = (UINT8 *)pPcat->pPcatTables;
+  pCapability = (PLATFORM_CAPABILITY_INFO *)pCursor;
+  pCapability->Header.Type = PCAT_TYPE_PLATFORM_CAPABILITY_INFO_TABLE;
+  pCapability->Header.Length = sizeof(*pCapability);
+  pCapability->MgmtSwConfigInputSupport = BIT0;
+  pCapability->MemoryModeCapabilities.MemoryModesFlags.OneLm = 1;
+  pCapability->MemoryModeCapabilities.MemoryModesFlags.Memory = 1;
+  pCapability->MemoryModeCapabilities.MemoryModesFlags.AppDirect = 1;
+  pCursor += sizeof(*pCapability);
+
+  pInterleave = (MEMORY_INTERLEAVE_CAPABILITY_INFO *)pCursor;
+  pInterleave->Header.Type = PCAT_TYPE_INTERLEAVE_CAPABILITY_INFO_TABLE;
+  pInterleave->Header.Length = (UINT16)InterleaveLength;
+  pInterleave->MemoryMode = 3;                  // App Direct
+  pInterleave->InterleaveAlignmentSize = 26;    // 64MiB
+  pInterleave->NumOfFormatsSupported = 1;
+  pInterleave->InterleaveFormatList[0].InterleaveFormatSplit.ChannelInterleaveSize = CHANNEL_INTERLEAVE_SIZE_4KB;
+  pInterleave->InterleaveFormatList[0].InterleaveFormatSplit.iMCInterleaveSize = IMC_INTERLEAVE_SIZE_4KB;
+  pInterleave->InterleaveFormatList[0].InterleaveFormatSplit.NumberOfChannelWays = INTERLEAVE_SET_1_WAY | INTERLEAVE_SET_2_WAY |
+    INTERLEAVE_SET_3_WAY | INTERLEAVE_SET_6_WAY;
+  pInterleave->InterleaveFormatList[0].InterleaveFormatSplit.Recommended = 1;
+  pCursor += InterleaveLength;
+
+  for (Socket = 0; Socket < EmulatedSocketCount(); Socket++) {
+    pSocketSku = (SOCKET_SKU_INFO_TABLE *)pCursor;
+    pSocketSku->Header.Type = PCAT_TYPE_SOCKET_SKU_INFO_TABLE;
+    pSocketSku->Header.Length = sizeof(*pSocketSku);
+    pSocketSku->SocketId = (UINT16)Socket;
+    pSocketSku->MappedMemorySizeLimit = EMULATED_DIMMS_PER_SOCKET * EMULATED_DIMM_RAW_CAPACITY * 2;
+    pCursor += sizeof(*pSocketSku);
+  }
+
+  GenerateChecksum(pPcat, Length, PCAT_TABLE_HEADER_CHECKSUM_OFFSET);
+  *pTable = (EFI_ACPI_DESCRIPTION_HEADER *)pPcat;
+  *tablesize = Length;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+emulated_get_pmtt_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+)
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Appends an SMBIOS string to the string set at pStrings
+
+  @retval number of bytes used, including the terminator
+**/
+STATIC
+UINT32
+AppendSmbiosString(
+  IN     CHAR8 *pStrings,
+  IN     UINT32 Size,
+  IN     CONST CHAR8 *pString
+)
+{
+  AsciiStrCpyS(pStrings, Size, pString);
+  return (UINT32)AsciiStrLen(pString) + 1;
+}
+
+int
+emulated_get_smbios_table(
+  OUT UINT8 **ppTable,
+  OUT size_t *pTableSize,
+  OUT UINT8 *pMajorVersion,
+  OUT UINT8 *pMinorVersion
+)
+{
+  SMBIOS_TABLE_TYPE17 *pType17 = NULL;
+  SMBIOS_STRUCTURE *pEnd = NULL;
+  CHAR8 String[EMULATED_SMBIOS_STRING_LENGTH];
+  CHAR8 *pStrings = NULL;
+  UINT8 *pTable = NULL;
+  UINT8 *pCursor = NULL;
+  NfitDeviceHandle Handle;
+  UINT32 StringsSize = 0;
+  UINT32 Size = 0;
+  UINT32 Index = 0;
+
+  if (ppTable == NULL || pTableSize == NULL || pMajorVersion == NULL || pMinorVersion == NULL) {
+    return -EINVAL;
+  }
+
+  // Each Type 17 string set plus its terminator
+  StringsSize = EMULATED_SMBIOS_STRING_COUNT * EMULATED_SMBIOS_STRING_LENGTH + 1;
+  Size = gEmulatedDimmCount * (sizeof(*pType17) + StringsSize) + sizeof(*pEnd) + 2;
+  pTable = calloc(1, Size);
+  if (pTable == NULL) {
+    return -ENOMEM;
+  }
+
+  pCursor = pTable;
+  for (Index = 0; Index < gEmulatedDimmCount; Index++) {
+    Handle.AsUint32 = gEmulatedDimms[Index].DeviceHandle;
+    pType17 = (SMBIOS_TABLE_TYPE17 *)pCursor;
+    pType17->Hdr.Type = EFI_SMBIOS_TYPE_MEMORY_DEVICE;
+    pType17->Hdr.Length = sizeof(*pType17);
+    pType17->Hdr.Handle = gEmulatedDimms[Index].PhysicalId;
+    pType17->TotalWidth = 72;
+    pType17->DataWidth = 64;
+    pType17->Size = 0x7FFF;   // see ExtendedSize
+    pType17->ExtendedSize = (UINT32)(EMULATED_DIMM_RAW_CAPACITY >> 20);
+    pType17->FormFactor = MemoryFormFactorDimm;
+    pType17->MemoryType = MemoryTypeDdr4;
+    pType17->TypeDetail.Nonvolatile = 1;
+    pType17->Speed = 2666;
+    pType17->DeviceLocator = 1;
+    pType17->BankLocator = 2;
+    pType17->Manufacturer = 3;
+    pType17->SerialNumber = 4;
+    pType17->PartNumber = 5;
+    pCursor += sizeof(*pType17);
+
+    pStrings = (CHAR8 *)pCursor;
+    AsciiSPrint(String, sizeof(String), "CPU%d_DIMM_%c%d", Handle.NfitDeviceHandle.SocketId + 1,
+      'A' + Handle.NfitDeviceHandle.MemControllerId * 3 + Handle.NfitDeviceHandle.MemChannel,
+      Handle.NfitDeviceHandle.DimmNumber + 1);
+    pCursor += AppendSmbiosString((CHAR8 *)pCursor, StringsSize, String);
+    AsciiSPrint(String, sizeof(String), "NODE %d", Handle.NfitDeviceHandle.SocketId);
+    pCursor += AppendSmbiosString((CHAR8 *)pCursor, StringsSize - (UINT32)((CHAR8 *)pCursor - pStrings), String);
+    pCursor += AppendSmbiosString((CHAR8 *)pCursor, StringsSize - (UINT32)((CHAR8 *)pCursor - pStrings), "Intel");
+    AsciiSPrint(String, sizeof(String), "%08X", gEmulatedDimms[Index].SerialNumber);
+    pCursor += AppendSmbiosString((CHAR8 *)pCursor, StringsSize - (UINT32)((CHAR8 *)pCursor - pStrings), String);
+    pCursor += AppendSmbiosString((CHAR8 *)pCursor, StringsSize - (UINT32)((CHAR8 *)pCursor - pStrings), EMULATED_PART_NUMBER);
+    pCursor++;   // string set terminator
+  }
+
+  pEnd = (SMBIOS_STRUCTURE *)pCursor;
+  pEnd->Type = EFI_SMBIOS_TYPE_END_OF_TABLE;
+  pEnd->Length = sizeof(*pEnd);
+  pEnd->Handle = 0xFFFF;
+  pCursor += sizeof(*pEnd) + 2;
+
+  *ppTable = pTable;
+  *pTableSize = pCursor - pTable;
+  *pMajorVersion = EMULATED_SMBIOS_MAJOR_VERSION;
+  *pMinorVersion = EMULATED_SMBIOS_MINOR_VERSION;
+  return 0;
+}
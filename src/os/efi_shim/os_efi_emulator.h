@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef OS_EFI_EMULATOR_H_
+#define OS_EFI_EMULATOR_H_
+
+#include <Uefi.h>
+#include <Dimm.h>
+#include <FwUtility.h>
+
+#define INI_PREFERENCES_EMULATED_DIMM_COUNT         L"EMULATED_DIMM_COUNT"
+#define INI_PREFERENCES_EMULATED_CMD_LATENCY_US     L"EMULATED_CMD_LATENCY_US"
+#define INI_PREFERENCES_EMULATED_CMD_FAILURE_RATE   L"EMULATED_CMD_FAILURE_RATE"
+
+#define EMULATED_DIMMS_PER_SOCKET   12
+#define EMULATED_DIMM_MAX_COUNT     (8 * EMULATED_DIMMS_PER_SOCKET)
+
+/**
+Reads the emulator configuration from the preferences and, when emulated
+modules are requested, sets up their state. Must be called after the
+preferences are initialized.
+
+@retval EFI_SUCCESS  The emulator is ready, or disabled by configuration
+@retval EFI_OUT_OF_RESOURCES  Memory allocation failure
+**/
+EFI_STATUS
+emulated_dimms_init(
+);
+
+/**
+Releases the emulated module state set up by emulated_dimms_init
+**/
+VOID
+emulated_dimms_uninit(
+);
+
+/**
+Tells whether the platform tables and FW commands are served by the emulator
+
+@retval TRUE if emulated modules are configured
+**/
+BOOLEAN
+emulated_dimms_enabled(
+);
+
+/**
+Emulated counterpart of passthru_os. Executes the FW command against the
+software model of the module addressed by pCmd->DimmID (the NFIT device
+handle) after the configured latency. Injected failures are reported as
+FW_INTERNAL_DEVICE_ERROR in pCmd->Status.
+
+@param[in]  pDimm    pointer to current Dimm
+@param[in, out]  pCmd    pointer to command data
+@param[in]  Timeout    the command timeout
+@param[out] pRetries   optional, always 0 for the emulator
+
+@retval EFI_SUCCESS  The command was executed, pCmd->Status holds the FW status
+@retval EFI_NOT_FOUND  No emulated module has the given handle
+@retval EFI_NOT_READY  The emulator is not enabled
+**/
+EFI_STATUS
+emulated_passthru(
+  IN     struct _DIMM *pDimm,
+  IN OUT NVM_FW_CMD *pCmd,
+  IN     long Timeout,
+     OUT UINT32 *pRetries OPTIONAL
+);
+
+/**
+Builds an NFIT describing the emulated modules
+
+@param[out] pTable - newly allocated table, freed by the caller
+@param[out] tablesize the size of the returned table
+
+@retval EFI_SUCCESS  The table was built
+@retval Other errors failure of allocation
+**/
+EFI_STATUS
+emulated_get_nfit_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+);
+
+/**
+Builds a PCAT for the emulated platform
+
+@param[out] pTable - newly allocated table, freed by the caller
+@param[out] tablesize the size of the returned table
+
+@retval EFI_SUCCESS  The table was built
+@retval Other errors failure of allocation
+**/
+EFI_STATUS
+emulated_get_pcat_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+);
+
+/**
+The emulated platform publishes a revision 1 PCAT, for which the PMTT is
+optional, so no PMTT is built
+
+@retval EFI_NOT_FOUND  always
+**/
+EFI_STATUS
+emulated_get_pmtt_table(
+  OUT EFI_ACPI_DESCRIPTION_HEADER ** pTable,
+  OUT UINT32 *tablesize
+);
+
+/**
+Builds an SMBIOS table with a Type 17 memory device per emulated module
+
+@param[out] ppTable newly allocated table
+@param[out] pTableSize size of the table
+@param[out] pMajorVersion SMBIOS major version
+@param[out] pMinorVersion SMBIOS minor version
+
+@retval 0 on success, negative errno otherwise
+**/
+int
+emulated_get_smbios_table(
+  OUT UINT8 **ppTable,
+  OUT size_t *pTableSize,
+  OUT UINT8 *pMajorVersion,
+  OUT UINT8 *pMinorVersion
+);
+
+#endif //OS_EFI_EMULATOR_H_
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+  Inventory cache. When enabled through INVENTORY_CACHE_ENABLED the static
+  FW-derived fields of the DIMMs are kept in a file between runs, so a DIMM
+  found in it is initialized without sending it the partition info and PCD
+  size commands. The file is only used during the boot that wrote it and
+  for the same NFIT, PCAT and PMTT, and an entry only for the FW version
+  identify DIMM reports, anything else is a full initialization. Identify
+  data and status (boot status, security state) are never cached.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Base.h>
+#include <Uefi.h>
+#include <Debug.h>
+#include <Utility.h>
+#include <NvmTypes.h>
+#include <NvmDimmPassThru.h>
+#include <PbrTypes.h>
+#include <PbrDcpmm.h>
+#include <os.h>
+#include <os_str.h>
+#include <os_efi_preferences.h>
+#include <os_efi_inventory_cache.h>
+
+#define INVENTORY_CACHE_SIGNATURE   "IPMCTLIC"
+#define INVENTORY_CACHE_VERSION     2
+#define INVENTORY_CACHE_BOOT_ID_LEN 64
+#define INVENTORY_CACHE_TABLES      3     //!< NFIT, PCAT, PMTT
+#define INVENTORY_CACHE_PATH_LEN    256
+
+typedef struct {
+  UINT32 Length;
+  UINT32 Checksum;
+  UINT32 Hash;                              //!< FNV-1a of the whole table, the checksum alone is a byte
+} INVENTORY_CACHE_TABLE_KEY;
+
+typedef struct {
+  INVENTORY_CACHE_TABLE_KEY Tables[INVENTORY_CACHE_TABLES];
+  CHAR8 BootId[INVENTORY_CACHE_BOOT_ID_LEN];
+} INVENTORY_CACHE_KEY;
+
+typedef struct {
+  CHAR8 Signature[8];
+  UINT32 Version;
+  UINT32 EntrySize;                         //!< Catches a layout change of a field type
+  INVENTORY_CACHE_KEY Key;
+  UINT32 EntryCount;
+  UINT32 Reserved;
+} INVENTORY_CACHE_HEADER;
+
+typedef struct {
+  /** Match the DIMM the entry describes, see IsCacheEntryOfDimm **/
+  UINT32 DeviceHandle;
+  UINT32 SerialNumber;
+  UINT16 VendorId;
+  UINT16 ManufacturingDate;
+  UINT8 ManufacturingLocation;
+  FIRMWARE_VERSION FwVer;                   //!< Running FW the entry was read from
+  /** Partition info and PCD partition sizes **/
+  UINT64 VolatileStart;
+  UINT64 VolatileCapacity;
+  UINT64 PmStart;
+  UINT64 PmCapacity;
+  UINT32 PcdOemPartitionSize;
+  UINT32 PcdLsaPartitionSize;
+} INVENTORY_CACHE_ENTRY;
+
+STATIC BOOLEAN gInventoryCacheEnabled = FALSE;
+STATIC BOOLEAN gInventoryCacheDirty = FALSE;
+STATIC BOOLEAN gInventoryCacheFromFile = FALSE;   //!< Entries were read from the file
+STATIC INVENTORY_CACHE_KEY gInventoryCacheKey;
+STATIC INVENTORY_CACHE_ENTRY *gInventoryCacheEntries = NULL;
+STATIC UINT32 gInventoryCacheEntryCount = 0;
+STATIC OS_MUTEX *gInventoryCacheLock = NULL;
+
+/**
+  Reads the preference enabling the cache, a missing setting disables it
+**/
+STATIC
+BOOLEAN
+IsInventoryCacheEnabledByPreference(
+)
+{
+  EFI_GUID Guid = { 0 };
+  UINT32 Value = 0;
+  UINTN Size = sizeof(Value);
+
+  if (EFI_ERROR(GET_VARIABLE(INI_PREFERENCES_INVENTORY_CACHE_ENABLED, Guid, &Size, &Value))) {
+    return FALSE;
+  }
+  return Value == 1;
+}
+
+/**
+  Builds the path of the cache file, creating its directory
+**/
+STATIC
+EFI_STATUS
+GetInventoryCachePath(
+     OUT char *pPath,
+  IN     size_t PathLen
+)
+{
+#if defined(__LINUX__) || defined(__ESX__)
+  snprintf(pPath, PathLen, "%s", INVENTORY_CACHE_DIR);
+#else
+  char *pAppData = getenv("APPDATA");
+
+  if (pAppData == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  snprintf(pPath, PathLen, "%s%s", pAppData, INVENTORY_CACHE_DIR);
+#endif
+  os_mkdir(pPath);
+  if (strlen(pPath) + sizeof(INVENTORY_CACHE_FILE_NAME) > PathLen) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  strncat(pPath, INVENTORY_CACHE_FILE_NAME, PathLen - strlen(pPath) - 1);
+  return EFI_SUCCESS;
+}
+
+/**
+  Computes the part of the key describing one ACPI table
+**/
+STATIC
+VOID
+GetInventoryCacheTableKey(
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pTable OPTIONAL,
+     OUT INVENTORY_CACHE_TABLE_KEY *pKey
+)
+{
+  UINT8 *pBytes = (UINT8 *)pTable;
+  UINT32 Hash = 2166136261U;
+  UINT32 Index = 0;
+
+  ZeroMem(pKey, sizeof(*pKey));
+  if (pTable == NULL) {
+    return;
+  }
+  for (Index = 0; Index < pTable->Length; Index++) {
+    Hash = (Hash ^ pBytes[Index]) * 16777619U;
+  }
+  pKey->Length = pTable->Length;
+  pKey->Checksum = pTable->Checksum;
+  pKey->Hash = Hash;
+}
+
+/**
+  Tells whether an entry describes a DIMM as it runs now, the NFIT fields
+  and the FW version of the DIMM must be initialized
+**/
+STATIC
+BOOLEAN
+IsCacheEntryOfDimm(
+  IN     INVENTORY_CACHE_ENTRY *pEntry,
+  IN     DIMM *pDimm
+)
+{
+  return pEntry->DeviceHandle == pDimm->DeviceHandle.AsUint32 &&
+      pEntry->SerialNumber == pDimm->SerialNumber &&
+      pEntry->VendorId == pDimm->VendorId &&
+      pEntry->ManufacturingDate == pDimm->ManufacturingDate &&
+      pEntry->ManufacturingLocation == pDimm->ManufacturingLocation &&
+      pEntry->FwVer.FwProduct == pDimm->FwVer.FwProduct &&
+      pEntry->FwVer.FwRevision == pDimm->FwVer.FwRevision &&
+      pEntry->FwVer.FwSecurityVersion == pDimm->FwVer.FwSecurityVersion &&
+      pEntry->FwVer.FwBuild == pDimm->FwVer.FwBuild &&
+      pEntry->FwVer.FwApiMajor == pDimm->FwVer.FwApiMajor &&
+      pEntry->FwVer.FwApiMinor == pDimm->FwVer.FwApiMinor;
+}
+
+/**
+  Opens the cache file and reads its header, NULL if there is no valid file
+**/
+STATIC
+FILE *
+OpenInventoryCacheFile(
+  IN     char *pPath,
+     OUT INVENTORY_CACHE_HEADER *pHeader
+)
+{
+  FILE *pFile = NULL;
+
+  if (0 != os_fopen(&pFile, pPath, "rb") || pFile == NULL) {
+    return NULL;
+  }
+  if (fread(pHeader, sizeof(*pHeader), 1, pFile) != 1 ||
+      CompareMem(pHeader->Signature, INVENTORY_CACHE_SIGNATURE, sizeof(pHeader->Signature)) != 0 ||
+      pHeader->Version != INVENTORY_CACHE_VERSION ||
+      pHeader->EntrySize != sizeof(INVENTORY_CACHE_ENTRY) ||
+      pHeader->EntryCount > MAX_DIMMS) {
+    NVDIMM_WARN("Ignoring invalid inventory cache file");
+    fclose(pFile);
+    return NULL;
+  }
+  return pFile;
+}
+
+/**
+  Reads the entries of the cache file if its key is the current one
+**/
+STATIC
+VOID
+ReadInventoryCacheFile(
+)
+{
+  char Path[INVENTORY_CACHE_PATH_LEN];
+  FILE *pFile = NULL;
+  INVENTORY_CACHE_HEADER Header;
+
+  if (EFI_ERROR(GetInventoryCachePath(Path, sizeof(Path)))) {
+    return;
+  }
+  pFile = OpenInventoryCacheFile(Path, &Header);
+  if (pFile == NULL) {
+    NVDIMM_DBG("No inventory cache file");
+    return;
+  }
+
+  if (CompareMem(&Header.Key, &gInventoryCacheKey, sizeof(gInventoryCacheKey)) != 0) {
+    NVDIMM_DBG("Inventory cache is from another boot or for other ACPI tables");
+    // Rewritten for the current key with what gets initialized in this run
+    gInventoryCacheDirty = TRUE;
+    goto Finish;
+  }
+  if (fread(gInventoryCacheEntries, sizeof(INVENTORY_CACHE_ENTRY), Header.EntryCount, pFile) != Header.EntryCount) {
+    NVDIMM_WARN("Truncated inventory cache file");
+    goto Finish;
+  }
+  gInventoryCacheEntryCount = Header.EntryCount;
+  gInventoryCacheFromFile = TRUE;
+
+Finish:
+  fclose(pFile);
+}
+
+/**
+  Tells whether the cache file still holds what this run read from it.
+  Another run invalidating the cache, after a FW update, deletes the file,
+  and the entries read before that must not be written back.
+**/
+STATIC
+BOOLEAN
+IsInventoryCacheFileUnchanged(
+  IN     char *pPath
+)
+{
+  FILE *pFile = NULL;
+  INVENTORY_CACHE_HEADER Header;
+  BOOLEAN Unchanged = FALSE;
+
+  if (!gInventoryCacheFromFile) {
+    return TRUE;
+  }
+  pFile = OpenInventoryCacheFile(pPath, &Header);
+  if (pFile != NULL) {
+    Unchanged = CompareMem(&Header.Key, &gInventoryCacheKey, sizeof(gInventoryCacheKey)) == 0;
+    fclose(pFile);
+  }
+  return Unchanged;
+}
+
+/**
+  Writes the entries to the cache file, through a temporary file of its
+  own so other processes never read a partial one
+**/
+STATIC
+VOID
+WriteInventoryCacheFile(
+)
+{
+  char Path[INVENTORY_CACHE_PATH_LEN];
+  char TempPath[INVENTORY_CACHE_PATH_LEN + sizeof(".XXXXXX")];
+  FILE *pFile = NULL;
+  INVENTORY_CACHE_HEADER Header;
+  BOOLEAN Written = FALSE;
+
+  if (EFI_ERROR(GetInventoryCachePath(Path, sizeof(Path)))) {
+    return;
+  }
+  if (!IsInventoryCacheFileUnchanged(Path)) {
+    NVDIMM_DBG("Inventory cache file was invalidated or replaced, not writing it");
+    return;
+  }
+  snprintf(TempPath, sizeof(TempPath), "%s.XXXXXX", Path);
+  pFile = os_fopen_unique(TempPath);
+  if (pFile == NULL) {
+    NVDIMM_WARN("Failed to write the inventory cache file %s", TempPath);
+    return;
+  }
+
+  ZeroMem(&Header, sizeof(Header));
+  CopyMem_S(Header.Signature, sizeof(Header.Signature), INVENTORY_CACHE_SIGNATURE, sizeof(Header.Signature));
+  Header.Version = INVENTORY_CACHE_VERSION;
+  Header.EntrySize = sizeof(INVENTORY_CACHE_ENTRY);
+  Header.Key = gInventoryCacheKey;
+  Header.EntryCount = gInventoryCacheEntryCount;
+
+  Written = fwrite(&Header, sizeof(Header), 1, pFile) == 1 &&
+      fwrite(gInventoryCacheEntries, sizeof(INVENTORY_CACHE_ENTRY), gInventoryCacheEntryCount, pFile) == gInventoryCacheEntryCount;
+  if (fclose(pFile) != 0) {
+    Written = FALSE;
+  }
+  if (!Written) {
+    NVDIMM_WARN("Failed to write the inventory cache file %s", TempPath);
+    remove(TempPath);
+    return;
+  }
+#ifdef _MSC_VER
+  // rename doesn't replace an existing file on Windows
+  remove(Path);
+#endif
+  if (rename(TempPath, Path) != 0) {
+    NVDIMM_WARN("Failed to replace the inventory cache file %s", Path);
+    remove(TempPath);
+  }
+}
+
+EFI_STATUS
+inventory_cache_load(
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pNfit,
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pPcat,
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pPmtt OPTIONAL
+)
+{
+  inventory_cache_uninit();
+
+  // Recording and playing back sessions must see every FW command
+  if (!IsInventoryCacheEnabledByPreference() || PBR_NORMAL_MODE != PBR_GET_MODE(PBR_CTX())) {
+    return EFI_SUCCESS;
+  }
+
+  ZeroMem(&gInventoryCacheKey, sizeof(gInventoryCacheKey));
+  if (0 != os_get_boot_id(gInventoryCacheKey.BootId, sizeof(gInventoryCacheKey.BootId))) {
+    NVDIMM_WARN("No boot identifier, not using the inventory cache");
+    return EFI_SUCCESS;
+  }
+  GetInventoryCacheTableKey(pNfit, &gInventoryCacheKey.Tables[0]);
+  GetInventoryCacheTableKey(pPcat, &gInventoryCacheKey.Tables[1]);
+  GetInventoryCacheTableKey(pPmtt, &gInventoryCacheKey.Tables[2]);
+
+  gInventoryCacheLock = os_mutex_init(NULL);
+  if (gInventoryCacheLock == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  gInventoryCacheEntries = AllocateZeroPool(MAX_DIMMS * sizeof(*gInventoryCacheEntries));
+  if (gInventoryCacheEntries == NULL) {
+    os_mutex_delete(gInventoryCacheLock, NULL);
+    gInventoryCacheLock = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ReadInventoryCacheFile();
+  gInventoryCacheEnabled = TRUE;
+  return EFI_SUCCESS;
+}
+
+VOID
+inventory_cache_uninit(
+)
+{
+  if (gInventoryCacheEnabled && gInventoryCacheDirty) {
+    WriteInventoryCacheFile();
+  }
+  gInventoryCacheEnabled = FALSE;
+  gInventoryCacheDirty = FALSE;
+  gInventoryCacheFromFile = FALSE;
+  gInventoryCacheEntryCount = 0;
+  FREE_POOL_SAFE(gInventoryCacheEntries);
+  if (gInventoryCacheLock != NULL) {
+    os_mutex_delete(gInventoryCacheLock, NULL);
+    gInventoryCacheLock = NULL;
+  }
+}
+
+BOOLEAN
+inventory_cache_restore(
+  IN OUT DIMM *pDimm
+)
+{
+  INVENTORY_CACHE_ENTRY *pEntry = NULL;
+  BOOLEAN Restored = FALSE;
+  UINT32 Index = 0;
+
+  if (!gInventoryCacheEnabled || pDimm == NULL) {
+    return FALSE;
+  }
+
+  os_mutex_lock(gInventoryCacheLock);
+  for (Index = 0; Index < gInventoryCacheEntryCount; Index++) {
+    pEntry = &gInventoryCacheEntries[Index];
+    if (!IsCacheEntryOfDimm(pEntry, pDimm)) {
+      continue;
+    }
+    pDimm->VolatileStart = pEntry->VolatileStart;
+    pDimm->VolatileCapacity = pEntry->VolatileCapacity;
+    pDimm->PmStart = pEntry->PmStart;
+    pDimm->PmCapacity = pEntry->PmCapacity;
+    pDimm->PcdOemPartitionSize = pEntry->PcdOemPartitionSize;
+    pDimm->PcdLsaPartitionSize = pEntry->PcdLsaPartitionSize;
+    Restored = TRUE;
+    break;
+  }
+  os_mutex_unlock(gInventoryCacheLock);
+
+  return Restored;
+}
+
+VOID
+inventory_cache_store(
+  IN     DIMM *pDimm
+)
+{
+  INVENTORY_CACHE_ENTRY *pEntry = NULL;
+  UINT32 Index = 0;
+
+  if (!gInventoryCacheEnabled || pDimm == NULL) {
+    return;
+  }
+
+  os_mutex_lock(gInventoryCacheLock);
+  for (Index = 0; Index < gInventoryCacheEntryCount; Index++) {
+    if (gInventoryCacheEntries[Index].DeviceHandle == pDimm->DeviceHandle.AsUint32) {
+      break;
+    }
+  }
+  if (Index == MAX_DIMMS) {
+    goto Finish;
+  }
+  if (Index == gInventoryCacheEntryCount) {
+    gInventoryCacheEntryCount++;
+  }
+
+  pEntry = &gInventoryCacheEntries[Index];
+  ZeroMem(pEntry, sizeof(*pEntry));
+  pEntry->DeviceHandle = pDimm->DeviceHandle.AsUint32;
+  pEntry->SerialNumber = pDimm->SerialNumber;
+  pEntry->VendorId = pDimm->VendorId;
+  pEntry->ManufacturingDate = pDimm->ManufacturingDate;
+  pEntry->ManufacturingLocation = pDimm->ManufacturingLocation;
+  pEntry->FwVer = pDimm->FwVer;
+  pEntry->VolatileStart = pDimm->VolatileStart;
+  pEntry->VolatileCapacity = pDimm->VolatileCapacity;
+  pEntry->PmStart = pDimm->PmStart;
+  pEntry->PmCapacity = pDimm->PmCapacity;
+  pEntry->PcdOemPartitionSize = pDimm->PcdOemPartitionSize;
+  pEntry->PcdLsaPartitionSize = pDimm->PcdLsaPartitionSize;
+  gInventoryCacheDirty = TRUE;
+
+Finish:
+  os_mutex_unlock(gInventoryCacheLock);
+}
+
+VOID
+inventory_cache_invalidate(
+)
+{
+  char Path[INVENTORY_CACHE_PATH_LEN];
+
+  if (!gInventoryCacheEnabled) {
+    return;
+  }
+
+  os_mutex_lock(gInventoryCacheLock);
+  gInventoryCacheEntryCount = 0;
+  gInventoryCacheDirty = FALSE;
+  gInventoryCacheFromFile = FALSE;
+  if (!EFI_ERROR(GetInventoryCachePath(Path, sizeof(Path)))) {
+    remove(Path);
+  }
+  os_mutex_unlock(gInventoryCacheLock);
+}
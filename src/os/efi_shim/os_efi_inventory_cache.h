@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef OS_EFI_INVENTORY_CACHE_H_
+#define OS_EFI_INVENTORY_CACHE_H_
+
+#include <Uefi.h>
+#include <Dimm.h>
+
+#define INI_PREFERENCES_INVENTORY_CACHE_ENABLED     L"INVENTORY_CACHE_ENABLED"
+
+#if defined(__LINUX__) || defined(__ESX__)
+#define INVENTORY_CACHE_DIR         "/var/cache/ipmctl/"
+#else
+#define INVENTORY_CACHE_DIR         "\\Intel\\ipmctl\\"    //!< Under %APPDATA%
+#endif
+#define INVENTORY_CACHE_FILE_NAME   "inventory.cache"
+
+/**
+Reads the preference enabling the cache and, when enabled, loads the cache
+file if it was written during this boot for the same ACPI tables. Must be
+called once the tables are parsed, entries from a file with a different key
+are dropped and the file is rewritten on inventory_cache_uninit.
+
+@param[in]  pNfit  NFIT the inventory is built from
+@param[in]  pPcat  PCAT the inventory is built from
+@param[in]  pPmtt  PMTT the inventory is built from, optional
+
+@retval EFI_SUCCESS  The cache is ready, disabled or empty
+@retval EFI_OUT_OF_RESOURCES  Memory allocation failure
+**/
+EFI_STATUS
+inventory_cache_load(
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pNfit,
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pPcat,
+  IN     EFI_ACPI_DESCRIPTION_HEADER *pPmtt OPTIONAL
+);
+
+/**
+Writes the cache file if new entries were stored and releases the cache.
+The file is not written if another process invalidated it since it was
+loaded.
+**/
+VOID
+inventory_cache_uninit(
+);
+
+/**
+Fills the static FW-derived fields of a DIMM (partition info and PCD
+partition sizes) from its cache entry. The NFIT fields and the identify
+data must already be initialized, the entry is matched by device handle,
+UID fields and running FW version.
+
+@param[in, out]  pDimm  The DIMM to fill
+
+@retval TRUE if the DIMM was found in the cache and filled
+**/
+BOOLEAN
+inventory_cache_restore(
+  IN OUT DIMM *pDimm
+);
+
+/**
+Records the static FW-derived fields of a fully initialized DIMM
+
+@param[in]  pDimm  The DIMM to record
+**/
+VOID
+inventory_cache_store(
+  IN     DIMM *pDimm
+);
+
+/**
+Drops every entry and deletes the cache file. Called when a FW image is
+sent or activated, as what the new FW reports may no longer match the
+entries.
+**/
+VOID
+inventory_cache_invalidate(
+);
+
+#endif //OS_EFI_INVENTORY_CACHE_H_
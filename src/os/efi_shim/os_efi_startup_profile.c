@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+  Startup profile. The phases of the library and CLI startup are timed with
+  the monotonic clock on every run, which costs a few timestamps. When the
+  STARTUP_PROFILE preference is set the breakdown is emitted as JSON on
+  uninit, together with the FW commands sent per opcode taken from the
+  transport statistics, so hosts where the startup regresses can be found.
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <Base.h>
+#include <Uefi.h>
+#include <Debug.h>
+#include <Utility.h>
+#include <NvmTypes.h>
+#include <os_efi_api.h>
+#include <os_efi_preferences.h>
+#include <os_efi_startup_profile.h>
+
+#define STARTUP_PROFILE_COMMAND_LEN   256
+#define STARTUP_PROFILE_OUTPUT_LEN    256
+
+typedef struct {
+  UINT32 Depth;                 ///< Nesting of begin calls, only the outermost is timed
+  UINT64 StartedUs;
+  UINT64 FirstStartUs;          ///< Relative to the profile start
+  UINT64 Count;
+  UINT64 TotalUs;
+  UINT64 MaxUs;
+} STARTUP_PHASE_TIMING;
+
+/** FW commands of one opcode/subopcode, over every DIMM and transport **/
+typedef struct {
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  UINT64 Count;
+  UINT64 Errors;
+  UINT64 Retries;
+  UINT64 TotalUs;
+  UINT64 MaxUs;
+} STARTUP_FW_COMMAND_CLASS;
+
+STATIC CONST CHAR8 *gStartupPhaseNames[StartupPhaseMax] = {
+  "driver_entry",
+  "acpi_tables",
+  "dimm_inventory",
+  "dimm_hydration",
+  "interleave_sets",
+  "namespaces",
+  "command"
+};
+
+STATIC UINT64 gStartupProfileStartUs = 0;
+STATIC STARTUP_PHASE_TIMING gStartupPhases[StartupPhaseMax];
+STATIC CHAR8 gStartupProfileCommand[STARTUP_PROFILE_COMMAND_LEN];
+
+VOID
+startup_profile_init(
+  IN     int argc,
+  IN     char *argv[]
+)
+{
+  size_t Length = 0;
+  int Index = 0;
+
+  if (gStartupProfileStartUs != 0) {
+    return;
+  }
+  gStartupProfileStartUs = GetCurrentMicroseconds();
+  ZeroMem(gStartupPhases, sizeof(gStartupPhases));
+  gStartupProfileCommand[0] = '\0';
+
+  for (Index = 0; argv != NULL && Index < argc && argv[Index] != NULL; Index++) {
+    Length = strlen(gStartupProfileCommand);
+    snprintf(gStartupProfileCommand + Length, sizeof(gStartupProfileCommand) - Length,
+      "%s%s", (Index == 0) ? "" : " ", argv[Index]);
+  }
+}
+
+VOID
+startup_profile_begin(
+  IN     STARTUP_PHASE Phase
+)
+{
+  if (gStartupProfileStartUs == 0 || Phase >= StartupPhaseMax) {
+    return;
+  }
+  if (gStartupPhases[Phase].Depth++ == 0) {
+    gStartupPhases[Phase].StartedUs = GetCurrentMicroseconds();
+  }
+}
+
+VOID
+startup_profile_end(
+  IN     STARTUP_PHASE Phase
+)
+{
+  STARTUP_PHASE_TIMING *pTiming = NULL;
+  UINT64 ElapsedUs = 0;
+
+  if (gStartupProfileStartUs == 0 || Phase >= StartupPhaseMax) {
+    return;
+  }
+  pTiming = &gStartupPhases[Phase];
+  if (pTiming->Depth == 0 || --pTiming->Depth != 0) {
+    return;
+  }
+
+  ElapsedUs = GetCurrentMicroseconds() - pTiming->StartedUs;
+  if (pTiming->Count == 0) {
+    pTiming->FirstStartUs = pTiming->StartedUs - gStartupProfileStartUs;
+  }
+  pTiming->Count++;
+  pTiming->TotalUs += ElapsedUs;
+  if (ElapsedUs > pTiming->MaxUs) {
+    pTiming->MaxUs = ElapsedUs;
+  }
+}
+
+/**
+  Writes a string as a JSON string literal
+**/
+STATIC
+VOID
+WriteJsonString(
+  IN     FILE *pFile,
+  IN     CONST CHAR8 *pString
+)
+{
+  fputc('"', pFile);
+  for (; *pString != '\0'; pString++) {
+    if (*pString == '"' || *pString == '\\') {
+      fprintf(pFile, "\\%c", *pString);
+    } else if ((UINT8)*pString < 0x20) {
+      fprintf(pFile, "\\u%04x", (UINT8)*pString);
+    } else {
+      fputc(*pString, pFile);
+    }
+  }
+  fputc('"', pFile);
+}
+
+/**
+  Sums the transport statistics per opcode/subopcode
+
+  @param[out] pClasses  array of TRANSPORT_STATS_MAX_ENTRIES classes
+  @param[out] pCount    number of classes filled
+**/
+STATIC
+VOID
+GetFwCommandClasses(
+     OUT STARTUP_FW_COMMAND_CLASS *pClasses,
+     OUT UINT32 *pCount
+)
+{
+  TRANSPORT_STATS_ENTRY *pEntries = NULL;
+  UINT32 EntryCount = TRANSPORT_STATS_MAX_ENTRIES;
+  UINT32 EntryIndex = 0;
+  UINT32 ClassIndex = 0;
+
+  *pCount = 0;
+  pEntries = AllocateZeroPool(sizeof(*pEntries) * TRANSPORT_STATS_MAX_ENTRIES);
+  if (pEntries == NULL) {
+    return;
+  }
+  if (EFI_ERROR(GetTransportStats(pEntries, &EntryCount))) {
+    goto Finish;
+  }
+
+  for (EntryIndex = 0; EntryIndex < EntryCount; EntryIndex++) {
+    for (ClassIndex = 0; ClassIndex < *pCount; ClassIndex++) {
+      if (pClasses[ClassIndex].Opcode == pEntries[EntryIndex].Opcode &&
+          pClasses[ClassIndex].SubOpcode == pEntries[EntryIndex].SubOpcode) {
+        break;
+      }
+    }
+    if (ClassIndex == *pCount) {
+      ZeroMem(&pClasses[ClassIndex], sizeof(pClasses[ClassIndex]));
+      pClasses[ClassIndex].Opcode = pEntries[EntryIndex].Opcode;
+      pClasses[ClassIndex].SubOpcode = pEntries[EntryIndex].SubOpcode;
+      (*pCount)++;
+    }
+    pClasses[ClassIndex].Count += pEntries[EntryIndex].Count;
+    pClasses[ClassIndex].Errors += pEntries[EntryIndex].Errors;
+    pClasses[ClassIndex].Retries += pEntries[EntryIndex].Retries;
+    pClasses[ClassIndex].TotalUs += pEntries[EntryIndex].TotalUs;
+    if (pEntries[EntryIndex].MaxUs > pClasses[ClassIndex].MaxUs) {
+      pClasses[ClassIndex].MaxUs = pEntries[EntryIndex].MaxUs;
+    }
+  }
+
+Finish:
+  FREE_POOL_SAFE(pEntries);
+}
+
+/**
+  Writes the profile as a single line JSON object
+**/
+STATIC
+VOID
+WriteStartupProfile(
+  IN     FILE *pFile,
+  IN     UINT64 TotalUs
+)
+{
+  STARTUP_FW_COMMAND_CLASS *pClasses = NULL;
+  UINT32 ClassCount = 0;
+  UINT32 Index = 0;
+
+  fprintf(pFile, "{\"version\":%d,\"command\":", STARTUP_PROFILE_VERSION);
+  WriteJsonString(pFile, gStartupProfileCommand);
+  fprintf(pFile, ",\"total_us\":%llu,\"phases\":{", TotalUs);
+  for (Index = 0; Index < StartupPhaseMax; Index++) {
+    fprintf(pFile, "%s\"%s\":{\"count\":%llu,\"start_us\":%llu,\"total_us\":%llu,\"max_us\":%llu}",
+      (Index == 0) ? "" : ",", gStartupPhaseNames[Index],
+      gStartupPhases[Index].Count, gStartupPhases[Index].FirstStartUs,
+      gStartupPhases[Index].TotalUs, gStartupPhases[Index].MaxUs);
+  }
+  fprintf(pFile, "},\"fw_commands\":[");
+
+  pClasses = AllocateZeroPool(sizeof(*pClasses) * TRANSPORT_STATS_MAX_ENTRIES);
+  if (pClasses != NULL) {
+    GetFwCommandClasses(pClasses, &ClassCount);
+  }
+  for (Index = 0; Index < ClassCount; Index++) {
+    fprintf(pFile, "%s{\"opcode\":%d,\"sub_opcode\":%d,\"count\":%llu,\"errors\":%llu,"
+      "\"retries\":%llu,\"total_us\":%llu,\"max_us\":%llu}",
+      (Index == 0) ? "" : ",", pClasses[Index].Opcode, pClasses[Index].SubOpcode,
+      pClasses[Index].Count, pClasses[Index].Errors, pClasses[Index].Retries,
+      pClasses[Index].TotalUs, pClasses[Index].MaxUs);
+  }
+  fprintf(pFile, "]}\n");
+
+  FREE_POOL_SAFE(pClasses);
+}
+
+VOID
+startup_profile_uninit(
+)
+{
+  EFI_GUID Guid = { 0 };
+  CHAR8 Output[STARTUP_PROFILE_OUTPUT_LEN];
+  FILE *pFile = NULL;
+  UINT64 TotalUs = 0;
+
+  if (gStartupProfileStartUs == 0) {
+    return;
+  }
+  TotalUs = GetCurrentMicroseconds() - gStartupProfileStartUs;
+  gStartupProfileStartUs = 0;
+
+  if (EFI_ERROR(preferences_get_string_ascii(INI_PREFERENCES_STARTUP_PROFILE, Guid, sizeof(Output), Output)) ||
+      AsciiStrLen(Output) == 0 || AsciiStriCmp(Output, STARTUP_PROFILE_OFF) == 0) {
+    return;
+  }
+
+  if (AsciiStriCmp(Output, STARTUP_PROFILE_STDERR) == 0) {
+    WriteStartupProfile(stderr, TotalUs);
+    return;
+  }
+
+  pFile = fopen(Output, "a");
+  if (pFile == NULL) {
+    NVDIMM_WARN("Failed to open the startup profile file %s", Output);
+    return;
+  }
+  WriteStartupProfile(pFile, TotalUs);
+  fclose(pFile);
+}
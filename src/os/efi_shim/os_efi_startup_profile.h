@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef OS_EFI_STARTUP_PROFILE_H_
+#define OS_EFI_STARTUP_PROFILE_H_
+
+#include <Uefi.h>
+
+#define INI_PREFERENCES_STARTUP_PROFILE     "STARTUP_PROFILE"
+#define STARTUP_PROFILE_OFF                 "OFF"
+#define STARTUP_PROFILE_STDERR              "STDERR"
+#define STARTUP_PROFILE_VERSION             1
+
+/**
+Phases of the library and CLI startup that are timed. A phase run by
+another one (e.g. the DIMM hydration started by the namespace
+initialization) is also accounted to the outer phase.
+**/
+typedef enum _STARTUP_PHASE {
+  StartupPhaseDriverEntry = 0,    ///< NvmDimmDriverDriverEntryPoint
+  StartupPhaseAcpiTables,         ///< initAcpiTables
+  StartupPhaseDimmInventory,      ///< InitializeDimmInventory, DIMM list from NFIT
+  StartupPhaseDimmHydration,      ///< HydrateDimms, DIMM initialization from FW
+  StartupPhaseInterleaveSets,     ///< InitializeInterleaveSets
+  StartupPhaseNamespaces,         ///< InitializeNamespaces
+  StartupPhaseCommand,            ///< The CLI command, including the driver start it triggers
+  StartupPhaseMax
+} STARTUP_PHASE;
+
+/**
+Starts the profile clock. Only the first call after startup_profile_uninit
+has an effect, so the CLI can start it before the library init does.
+
+@param[in]  argc  Number of CLI arguments, 0 for library users
+@param[in]  argv  CLI arguments, recorded in the report
+**/
+VOID
+startup_profile_init(
+  IN     int argc,
+  IN     char *argv[]
+);
+
+/**
+Marks the start of a phase. Phases are expected to be run by the thread
+that initializes the library, a phase already running is not restarted.
+
+@param[in]  Phase  The phase started
+**/
+VOID
+startup_profile_begin(
+  IN     STARTUP_PHASE Phase
+);
+
+/**
+Marks the end of a phase started by startup_profile_begin
+
+@param[in]  Phase  The phase ended
+**/
+VOID
+startup_profile_end(
+  IN     STARTUP_PHASE Phase
+);
+
+/**
+Emits the per-phase timing breakdown, along with the FW commands sent per
+opcode, when STARTUP_PROFILE is set, then resets the profile. STDERR writes
+it to stderr, any other value but OFF is a file the report is appended to,
+one JSON object per line. Must be called before the preferences and the
+transport statistics are released.
+**/
+VOID
+startup_profile_uninit(
+);
+
+#endif //OS_EFI_STARTUP_PROFILE_H_
@@ -6,10 +6,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys\timeb.h> 
+#include <time.h>
 #include <Uefi.h>
 #include <Dimm.h>
 #include <win_scm2_passthrough.h>
 #include <NvmDimmDriver.h>
+#include <os_efi_api.h>
 
 #define SIZE_16MB   0x01000000
 #define MAX_FILE_SIZE_WINDOWS SIZE_16MB
@@ -60,6 +62,17 @@ UINT64 GetCurrentMilliseconds()
   return retval;
 }
 
+/**
+Gets a timestamp in terms of microseconds, for measuring durations
+**/
+UINT64 GetCurrentMicroseconds()
+{
+  struct timespec spec;
+
+  timespec_get(&spec, TIME_UTC);
+  return ((UINT64)spec.tv_sec * 1000000) + ((UINT64)spec.tv_nsec / 1000);
+}
+
 /**
 Loads a table as specified in the args
 
@@ -83,13 +96,19 @@ EFIAPI
 passthru_os(
   IN     struct _DIMM *pDimm,
   IN OUT NVM_FW_CMD *pCmd,
-  IN     UINT64 Timeout
+  IN     UINT64 Timeout,
+     OUT UINT32 *pRetries OPTIONAL
 )
 {
   EFI_STATUS Rc = EFI_SUCCESS;
   UINT32 ReturnCode;
   unsigned int dsm_status;
 
+  // The SCM2 driver does not retry on our behalf
+  if (pRetries != NULL) {
+    *pRetries = 0;
+  }
+
   ReturnCode = win_scm2_passthrough((struct fw_cmd *)pCmd, &dsm_status);
   if (0 == ReturnCode && 0 == dsm_status)
   {
@@ -105,6 +124,29 @@ passthru_os(
   return Rc;
 }
 
+EFI_STATUS
+passthru_os_init(
+)
+{
+  return EFI_SUCCESS;
+}
+
+VOID
+passthru_os_uninit(
+)
+{
+}
+
+EFI_STATUS
+passthru_os_get_retry_stats(
+  IN     UINT32 DimmHandle,
+     OUT TRANSPORT_RETRY_STATS *pStats
+)
+{
+  // The SCM2 driver does not retry on our behalf, there is no backoff
+  return EFI_UNSUPPORTED;
+}
+
 EFI_STATUS
 get_nfit_table(
   OUT EFI_ACPI_DESCRIPTION_HEADER ** table,
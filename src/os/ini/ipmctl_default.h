@@ -56,3 +56,36 @@
 "# 3 - Log INFOs and above\n"
 "# 4 - Verbose mode On\n"
 "DBG_LOG_LEVEL = 0\n"
+"\n"
+"# Software emulated PMem modules, used instead of the platform when not 0\n"
+"# Modules are placed 12 per socket, up to 96\n"
+"EMULATED_DIMM_COUNT = 0\n"
+"# Latency in microseconds added to each emulated FW command\n"
+"EMULATED_CMD_LATENCY_US = 0\n"
+"# Emulated FW commands failing with an internal device error, per 1000\n"
+"EMULATED_CMD_FAILURE_RATE = 0\n"
+"\n"
+"# Handling of FW commands the driver asks to retry\n"
+"# Attempts per command, waits double from the base delay up to the\n"
+"# max delay and a command is given up once the deadline is reached\n"
+"DSM_RETRY_MAX = 5\n"
+"DSM_RETRY_BASE_DELAY_US = 100\n"
+"DSM_RETRY_MAX_DELAY_US = 100000\n"
+"DSM_RETRY_DEADLINE_MS = 5000\n"
+"\n"
+"# Number of PMem modules worked on at the same time\n"
+"# 0 - As many as supported (16)\n"
+"# 1 - One at a time\n"
+"DIMM_DISPATCH_WORKERS = 0\n"
+"\n"
+"# Keep the static PMem module inventory in a file between runs\n"
+"# It is used until the next reboot, or FW update through this tool\n"
+"# 0 - Disabled\n"
+"# 1 - Enabled\n"
+"INVENTORY_CACHE_ENABLED = 0\n"
+"\n"
+"# Timing of the startup phases and FW commands, as one line of JSON\n"
+"# OFF - Disabled\n"
+"# STDERR - Written to stderr\n"
+"# Any other value is a file the line is appended to\n"
+"STARTUP_PROFILE = OFF\n"
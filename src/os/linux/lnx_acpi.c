@@ -14,12 +14,16 @@
 #include <unistd.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include <os_str.h>
 
 #define	SYSFS_ACPI_PATH	"/sys/firmware/acpi/tables/"
 int g_count = 0;
 
 #define MAX_FILE_SIZE_LINUX SIZE_16MB
+#define SYSFS_READ_CHUNK 4096
 
 /*!
 * 8 bit unsigned integer as a boolean
@@ -86,81 +90,181 @@ int check_acpi_table(const char *signature,
 }
 
 
+/*
+ * Read a whole sysfs file with a single open, retrying interrupted and
+ * short reads. The file size is only a hint, sysfs may report 0.
+ * The buffer is allocated here and must be freed by the caller.
+ * Returns 0 on success or a negative errno.
+ */
+int read_sysfs_file(
+		const char *path,
+		unsigned char **pp_buf,
+		size_t *p_size,
+		const size_t max_size)
+{
+	int rc = 0;
+	struct stat st;
+	size_t capacity = SYSFS_READ_CHUNK;
+	size_t total = 0;
+	ssize_t bytes_read = 0;
+	unsigned char *p_buf = NULL;
+	unsigned char *p_new = NULL;
+
+	if (path == NULL || pp_buf == NULL || p_size == NULL)
+	{
+		return -EINVAL;
+	}
+
+	int fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+	{
+		return -errno;
+	}
+
+	// One more byte than the reported size, so EOF is seen without growing
+	if (fstat(fd, &st) == 0 && st.st_size > 0 && (size_t)st.st_size < max_size)
+	{
+		capacity = (size_t)st.st_size + 1;
+	}
+
+	p_buf = malloc(capacity);
+	if (p_buf == NULL)
+	{
+		close(fd);
+		return -ENOMEM;
+	}
+
+	while (1)
+	{
+		if (total == capacity)
+		{
+			if (capacity >= max_size)
+			{
+				rc = -EFBIG;
+				break;
+			}
+			capacity = (capacity * 2 < max_size) ? capacity * 2 : max_size;
+			p_new = realloc(p_buf, capacity);
+			if (p_new == NULL)
+			{
+				rc = -ENOMEM;
+				break;
+			}
+			p_buf = p_new;
+		}
+
+		bytes_read = read(fd, p_buf + total, capacity - total);
+		if (bytes_read < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			rc = -errno;
+			break;
+		}
+		if (bytes_read == 0)
+		{
+			break;
+		}
+		total += (size_t)bytes_read;
+	}
+	close(fd);
+
+	if (rc == 0 && total == 0)
+	{
+		rc = -ENODATA;
+	}
+	if (rc != 0)
+	{
+		free(p_buf);
+		return rc;
+	}
+
+	*pp_buf = p_buf;
+	*p_size = total;
+	return 0;
+}
+
 /*!
- * Return the specified ACPI table or the size
- * required
+ * Read and verify the specified ACPI table with a single read of sysfs.
+ * The table is allocated here and must be freed by the caller.
+ * Returns the size of the table or an acpi_error.
  */
-int get_acpi_table(
+int read_acpi_table(
 		const char *signature,
-		struct acpi_table *p_table,
-		const unsigned int size)
+		struct acpi_table **pp_table)
 {
 	int rc = 0;
-
 	char table_path[PATH_MAX];
+	unsigned char *p_buf = NULL;
+	size_t size = 0;
+	struct acpi_table *p_table = NULL;
+
+	if (signature == NULL || pp_table == NULL)
+	{
+		return ACPI_ERR_BADINPUT;
+	}
+
 	snprintf(table_path, sizeof(table_path), "%s%s", SYSFS_ACPI_PATH, signature);
+	rc = read_sysfs_file(table_path, &p_buf, &size, MAX_FILE_SIZE_LINUX);
+	if (rc == -ENOENT)
+	{
+		return ACPI_ERR_TABLENOTFOUND;
+	}
+	if (rc != 0)
+	{
+		return ACPI_ERR_BADTABLE;
+	}
 
-	int fd = open(table_path, O_RDONLY|O_CLOEXEC);
-	if (fd < 0)
+	p_table = (struct acpi_table *)p_buf;
+	if (size < sizeof(struct acpi_table_header) || p_table->header.length > size)
 	{
-		rc = ACPI_ERR_TABLENOTFOUND;
+		rc = ACPI_ERR_BADTABLE;
 	}
 	else
 	{
-		struct acpi_table_header header;
-		size_t header_size = sizeof (header);
+		rc = check_acpi_table(signature, p_table);
+	}
 
-		ssize_t hdr_bytes_read = read(fd, &header, header_size);
-		// Check total_table_size
-		if (hdr_bytes_read != header_size || header.length > MAX_FILE_SIZE_LINUX)
+	if (rc != ACPI_SUCCESS)
+	{
+		free(p_buf);
+		return rc;
+	}
+
+	*pp_table = p_table;
+	return (int)p_table->header.length;
+}
+
+/*!
+ * Return the specified ACPI table or the size
+ * required
+ */
+int get_acpi_table(
+		const char *signature,
+		struct acpi_table *p_table,
+		const unsigned int size)
+{
+	struct acpi_table *p_read_table = NULL;
+	int rc = read_acpi_table(signature, &p_read_table);
+
+	if (rc > 0 && p_table)
+	{
+		memset(p_table, 0, size);
+		if (size < (unsigned int)rc)
 		{
+			os_memcpy(&(p_table->header), sizeof(struct acpi_table_header),
+					&(p_read_table->header), sizeof(struct acpi_table_header));
 			rc = ACPI_ERR_BADTABLE;
 		}
 		else
 		{
-			size_t total_table_size = header.length;
-			rc = (int)total_table_size;
-			if (p_table)
-			{
-				memset(p_table, 0, size);
-				os_memcpy(&(p_table->header), sizeof(struct acpi_table_header), &header, header_size);
-				if (size < total_table_size)
-				{
-					rc = ACPI_ERR_BADTABLE;
-				}
-				else
-				{
-					size_t requested_bytes = total_table_size - header_size;
-					unsigned char *p_buff = p_table->p_ext_tables;
-					ssize_t total_read = 0;
-
-					while (total_read < requested_bytes)
-					{
-						ssize_t bytes_read = read(fd, p_buff, requested_bytes);
-						p_buff += bytes_read;
-						total_read += bytes_read;
-					}
-
-					if (total_read != requested_bytes)
-					{
-						rc = ACPI_ERR_BADTABLE;
-					}
-					else
-					{
-						if (p_table->header.length > total_table_size)
-						{
-							rc = ACPI_ERR_BADTABLE;
-						}
-						else
-						{
-							rc = check_acpi_table(signature, p_table);
-						}
-					}
-				}
-			}
+			os_memcpy(p_table, size, p_read_table, rc);
+			rc = ACPI_SUCCESS;
 		}
-		close(fd);
 	}
+	free(p_read_table);
 
 	return rc;
 }
@@ -11,6 +11,7 @@
 #define	SRC_COMMON_ACPI_ACPI_H_
 
 #include "lnx_common.h"
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -82,6 +83,24 @@ int get_acpi_table(
 		struct acpi_table *p_table,
 		const unsigned int size);
 
+/*!
+ * Read and verify the specified ACPI table, allocated for the caller.
+ * Returns the size of the table or an acpi_error.
+ */
+int read_acpi_table(
+		const char *signature,
+		struct acpi_table **pp_table);
+
+/*!
+ * Read a whole sysfs file, allocated for the caller.
+ * Returns 0 or a negative errno.
+ */
+int read_sysfs_file(
+		const char *path,
+		unsigned char **pp_buf,
+		size_t *p_size,
+		const size_t max_size);
+
 /*!
  * Verify the ACPI table size, checksum and signature
  */
@@ -16,10 +16,48 @@
 //#include <os/os_adapter.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include <os_types.h>
 #include <NvmSharedDefs.h>
 #define DEV_SMALL_PAYLOAD_SIZE	128 /* 128B - Size for a passthrough command small payload */
 
+/*
+ * Process-lifetime libndctl context and DIMM handle table. Built once when the
+ * library initializes so that a passthrough only costs the ioctl itself.
+ * Readers hold the lock across a command so the ndctl_dimm stays valid,
+ * a rebuild (init or lookup miss after hotplug/rescan) takes it exclusively.
+ */
+struct ndctl_dimm_cache_entry
+{
+	unsigned int handle;
+	struct ndctl_dimm *p_dimm;
+	struct pt_bios_get_size mb_size; /* large mailbox geometry, valid once mb_size_valid is set */
+	int mb_size_valid;
+	struct dsm_retry_stats retry; /* retry backoff state and counters, guarded by g_retry_lock */
+};
+
+static struct ndctl_ctx *g_ndctl_ctx = NULL;
+static struct ndctl_dimm_cache_entry *g_ndctl_dimm_cache = NULL;
+static unsigned int g_ndctl_dimm_cache_cnt = 0;
+static pthread_rwlock_t g_ndctl_ctx_lock = PTHREAD_RWLOCK_INITIALIZER;
+/*
+ * Handles a lookup miss already rebuilt the table for and still did not find.
+ * They fail fast until the next ndctl_ctx_cache_init starts a new generation,
+ * so commands to an absent DIMM do not re-enumerate sysfs every time.
+ */
+#define NDCTL_MISSED_HANDLES_MAX 16
+static unsigned int g_ndctl_missed_handles[NDCTL_MISSED_HANDLES_MAX];
+static unsigned int g_ndctl_missed_handles_cnt = 0;
+static pthread_mutex_t g_ndctl_mb_size_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct dsm_retry_policy g_retry_policy = {
+	DSM_MAX_RETRIES, DSM_RETRY_BASE_DELAY_US, DSM_RETRY_MAX_DELAY_US, DSM_RETRY_DEADLINE_MS
+};
+static unsigned int g_retry_seed = 1;
+static pthread_mutex_t g_retry_lock = PTHREAD_MUTEX_INITIALIZER;
+
 #define DSM_TO_NVM_ERROR(dsm_vendor_error, p_fw_cmd, rc) \
   p_fw_cmd->Status = DSM_EXTENDED_ERROR(dsm_vendor_error); \
   p_fw_cmd->DsmStatus = DSM_VENDOR_ERROR(dsm_vendor_error); \
@@ -158,6 +196,86 @@ int bios_get_payload_size(struct ndctl_dimm *p_dimm, struct pt_bios_get_size *p_
 	return rc;
 }
 
+/*
+ * Get the large mailbox geometry for a DIMM. The sizes are fixed for the life
+ * of the platform, so they are fetched once per DIMM and kept in the handle
+ * table. Caller holds the handle table lock when p_dimm came from it; a DIMM
+ * that isn't in the table is simply queried every time.
+ */
+static int bios_get_cached_payload_size(struct ndctl_dimm *p_dimm,
+		struct pt_bios_get_size *p_bios_mb_size, struct fw_cmd *p_fw_cmd)
+{
+	COMMON_LOG_ENTRY();
+	int rc = NVM_SUCCESS;
+	struct ndctl_dimm_cache_entry *p_entry = NULL;
+	int cached = 0;
+
+	for (unsigned int i = 0; i < g_ndctl_dimm_cache_cnt; i++)
+	{
+		if (g_ndctl_dimm_cache[i].p_dimm == p_dimm)
+		{
+			p_entry = &g_ndctl_dimm_cache[i];
+			break;
+		}
+	}
+
+	pthread_mutex_lock(&g_ndctl_mb_size_lock);
+	if (p_entry && p_entry->mb_size_valid)
+	{
+		*p_bios_mb_size = p_entry->mb_size;
+		cached = 1;
+	}
+	pthread_mutex_unlock(&g_ndctl_mb_size_lock);
+
+	if (!cached)
+	{
+		if ((rc = bios_get_payload_size(p_dimm, p_bios_mb_size, p_fw_cmd)) == NVM_SUCCESS &&
+				p_entry)
+		{
+			pthread_mutex_lock(&g_ndctl_mb_size_lock);
+			p_entry->mb_size = *p_bios_mb_size;
+			p_entry->mb_size_valid = 1;
+			pthread_mutex_unlock(&g_ndctl_mb_size_lock);
+		}
+	}
+
+	COMMON_LOG_EXIT_RETURN_I(rc);
+	return rc;
+}
+
+/*
+ * Get a large payload vendor command sized for in_size/out_size, reusing
+ * *pp_vendor_cmd when it already has that shape. Only the final partial
+ * chunk of a transfer needs a second command.
+ */
+static int bios_get_chunk_cmd(struct ndctl_dimm *p_dimm, unsigned int opcode,
+		size_t in_size, size_t out_size, struct ndctl_cmd **pp_vendor_cmd,
+		size_t *p_cmd_in_size, size_t *p_cmd_out_size)
+{
+	int rc = NVM_SUCCESS;
+
+	if (*pp_vendor_cmd == NULL || *p_cmd_in_size != in_size || *p_cmd_out_size != out_size)
+	{
+		if (*pp_vendor_cmd)
+		{
+			ndctl_cmd_unref(*pp_vendor_cmd);
+		}
+
+		if ((*pp_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(p_dimm, opcode,
+				in_size, out_size)) == NULL)
+		{
+			COMMON_LOG_ERROR("Failed to get vendor command from driver");
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+		}
+		else
+		{
+			*p_cmd_in_size = in_size;
+			*p_cmd_out_size = out_size;
+		}
+	}
+	return rc;
+}
+
 /*
  * Populate the emulated bios large input mailbox
  */
@@ -172,7 +290,7 @@ int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 		COMMON_LOG_ERROR("Invalid parameter, Dimm is null");
 		rc = NVM_ERR_INVALID_PARAMETER;
 	}
-	else if ((rc = bios_get_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
+	else if ((rc = bios_get_cached_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
 	{
 		if (mb_size.large_input_payload_size < p_fw_cmd->LargeInputPayloadSize)
 		{
@@ -182,6 +300,19 @@ int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 		{
 			unsigned int transfer_size = mb_size.rw_size;
 			unsigned int current_offset = 0;
+			struct ndctl_cmd *p_vendor_cmd = NULL;
+			size_t cmd_in_size = 0;
+			size_t cmd_out_size = 0;
+
+			BIOS_INPUT(bios_InputPayload, 0);
+			// one chunk buffer for the whole transfer, sized for a full rw_size chunk
+			struct bios_InputPayload *p_dsm_input = calloc(1,
+				sizeof (struct bios_InputPayload) + mb_size.rw_size);
+			if (!p_dsm_input)
+			{
+				COMMON_LOG_ERROR("Failed to allocate memory for BIOS input payload");
+				rc = NVM_ERR_NO_MEM;
+			}
 
 			while (current_offset < p_fw_cmd->LargeInputPayloadSize &&
 					rc == NVM_SUCCESS)
@@ -191,82 +322,68 @@ int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 					transfer_size = p_fw_cmd->LargeInputPayloadSize - current_offset;
 				}
 
-				BIOS_INPUT(bios_InputPayload, transfer_size);
-				struct bios_InputPayload *p_dsm_input = calloc(1,
-					sizeof (struct bios_InputPayload));
-				if (p_dsm_input)
+				size_t input_size = sizeof (*p_dsm_input) + transfer_size;
+				if ((rc = bios_get_chunk_cmd(p_dimm, BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND,
+						SUBOP_WRITE_LARGE_PAYLOAD_INPUT), input_size, 0,
+						&p_vendor_cmd, &cmd_in_size, &cmd_out_size)) == NVM_SUCCESS)
 				{
-					struct ndctl_cmd *p_vendor_cmd = NULL;
-					if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(
-							p_dimm, BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND,
-							SUBOP_WRITE_LARGE_PAYLOAD_INPUT),
-							sizeof (*p_dsm_input), 0)) == NULL)
+					int lnx_err_status = 0;
+					unsigned int dsm_vendor_err_status = 0;
+
+					p_dsm_input->size = transfer_size;
+					p_dsm_input->offset = current_offset;
+
+					memmove(p_dsm_input->buffer,
+						p_fw_cmd->LargeInputPayload + current_offset,
+						transfer_size);
+
+					size_t bytes_written = ndctl_cmd_vendor_set_input(
+						p_vendor_cmd, p_dsm_input, input_size);
+
+					if (bytes_written != input_size)
 					{
-						COMMON_LOG_ERROR("Failed to get vendor command from driver");
+						COMMON_LOG_ERROR("Failed to write input payload");
 						rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
 					}
 					else
 					{
-						int lnx_err_status = 0;
-						unsigned int dsm_vendor_err_status = 0;
-
-						p_dsm_input->size = transfer_size;
-						p_dsm_input->offset = current_offset;
-
-						memmove(p_dsm_input->buffer,
-							p_fw_cmd->LargeInputPayload + current_offset,
-							sizeof (p_dsm_input->buffer));
-
-						size_t bytes_written = ndctl_cmd_vendor_set_input(
-							p_vendor_cmd, p_dsm_input, sizeof (*p_dsm_input));
-
-						if (bytes_written != sizeof (*p_dsm_input))
-						{
-							COMMON_LOG_ERROR("Failed to write input payload");
-							rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						}
-						else
+						if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
 						{
-							if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
+							if ((dsm_vendor_err_status =
+									ndctl_cmd_get_firmware_status(p_vendor_cmd))
+											!= DSM_VENDOR_SUCCESS)
 							{
-								if ((dsm_vendor_err_status =
-										ndctl_cmd_get_firmware_status(p_vendor_cmd))
-												!= DSM_VENDOR_SUCCESS)
-								{
-                  DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-									COMMON_LOG_ERROR_F("BIOS write failed: "
-											"DSM returned error %d for command with "
-											"Opcode- 0x%x SubOpcode- 0x%x ", dsm_vendor_err_status,
-											p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-								}
-								else
-								{
-										current_offset += transfer_size;
-								}
-
+                DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
+								COMMON_LOG_ERROR_F("BIOS write failed: "
+										"DSM returned error %d for command with "
+										"Opcode- 0x%x SubOpcode- 0x%x ", dsm_vendor_err_status,
+										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 							}
 							else
 							{
-								rc = linux_err_to_nvm_lib_err(lnx_err_status);
-								COMMON_LOG_ERROR_F("BIOS write failed: "
-										"Linux driver returned error %d for command with "
-											"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
-												p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-
+									current_offset += transfer_size;
 							}
+
 						}
+						else
+						{
+							rc = linux_err_to_nvm_lib_err(lnx_err_status);
+							COMMON_LOG_ERROR_F("BIOS write failed: "
+									"Linux driver returned error %d for command with "
+										"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
+											p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 
-						ndctl_cmd_unref(p_vendor_cmd);
+						}
 					}
-					free(p_dsm_input);
-				}
-				else
-				{
-					COMMON_LOG_ERROR("Failed to allocate memory for BIOS input payload");
-					rc = NVM_ERR_NO_MEM;
 				}
 			} // end while
 
+			if (p_vendor_cmd)
+			{
+				ndctl_cmd_unref(p_vendor_cmd);
+			}
+			free(p_dsm_input);
+
 			if (current_offset != p_fw_cmd->LargeInputPayloadSize)
 			{
 				COMMON_LOG_ERROR("Failed to write large payload");
@@ -293,7 +410,7 @@ int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 		COMMON_LOG_ERROR("Invalid parameter, Dimm is null");
 		rc = NVM_ERR_INVALID_PARAMETER;
 	}
-	else if ((rc = bios_get_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
+	else if ((rc = bios_get_cached_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
 	{
 		if (mb_size.large_input_payload_size < p_fw_cmd->LargeOutputPayloadSize)
 		{
@@ -305,6 +422,12 @@ int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 			unsigned int current_offset = 0;
 			int lnx_err_status = 0;
 			unsigned int dsm_vendor_err_status = 0;
+			struct ndctl_cmd *p_vendor_cmd = NULL;
+			size_t cmd_in_size = 0;
+			size_t cmd_out_size = 0;
+
+			BIOS_INPUT(bios_InputPayload, 0);
+			struct bios_InputPayload dsm_input;
 
 			rc = NVM_SUCCESS;
 			while (current_offset < p_fw_cmd->LargeOutputPayloadSize &&
@@ -315,80 +438,68 @@ int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
 					transfer_size = p_fw_cmd->LargeOutputPayloadSize - current_offset;
 				}
 
-				BIOS_INPUT(bios_InputPayload, 0);
-				struct bios_InputPayload *p_dsm_input =
-					calloc(1, sizeof (struct bios_InputPayload));
-				if (p_dsm_input)
+				if ((rc = bios_get_chunk_cmd(p_dimm, BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND,
+						SUBOP_READ_LARGE_PAYLOAD_OUTPUT), sizeof (dsm_input), transfer_size,
+						&p_vendor_cmd, &cmd_in_size, &cmd_out_size)) != NVM_SUCCESS)
 				{
-					struct ndctl_cmd *p_vendor_cmd = NULL;
-					if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(p_dimm,
-						BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND, SUBOP_READ_LARGE_PAYLOAD_OUTPUT),
-						sizeof (*p_dsm_input), transfer_size)) == NULL)
+					break;
+				}
+
+				dsm_input.size = transfer_size;
+				dsm_input.offset = current_offset;
+
+				size_t bytes_written = ndctl_cmd_vendor_set_input(
+					p_vendor_cmd, &dsm_input, sizeof (dsm_input));
+				if (bytes_written != sizeof (dsm_input))
+				{
+					COMMON_LOG_ERROR("Failed to write input payload");
+					rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+				}
+
+				if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
+				{
+					if ((dsm_vendor_err_status =
+							ndctl_cmd_get_firmware_status(p_vendor_cmd)) !=
+									DSM_VENDOR_SUCCESS)
 					{
-						rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						COMMON_LOG_ERROR("Failed to get vendor command from driver");
+            DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
+						COMMON_LOG_ERROR_F("BIOS read failed: "
+								"DSM returned error %d for command with "
+								"Opcode - 0x%x SubOpcode - 0x%x ", dsm_vendor_err_status,
+								p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 					}
 					else
 					{
-						p_dsm_input->size = transfer_size;
-						p_dsm_input->offset = current_offset;
-
-						size_t bytes_written = ndctl_cmd_vendor_set_input(
-							p_vendor_cmd, p_dsm_input, sizeof (*p_dsm_input));
-						if (bytes_written != sizeof (*p_dsm_input))
+						size_t return_size = ndctl_cmd_vendor_get_output(p_vendor_cmd,
+								p_fw_cmd->LargeOutputPayload +
+								current_offset, transfer_size);
+						if (return_size != transfer_size)
 						{
-							COMMON_LOG_ERROR("Failed to write input payload");
 							rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						}
-
-						if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
-						{
-							if ((dsm_vendor_err_status =
-									ndctl_cmd_get_firmware_status(p_vendor_cmd)) !=
-											DSM_VENDOR_SUCCESS)
-							{
-                DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-								COMMON_LOG_ERROR_F("BIOS read failed: "
-										"DSM returned error %d for command with "
-										"Opcode - 0x%x SubOpcode - 0x%x ", dsm_vendor_err_status,
-										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-							}
-							else
-							{
-								size_t return_size = ndctl_cmd_vendor_get_output(p_vendor_cmd,
-										p_fw_cmd->LargeOutputPayload +
-										current_offset, transfer_size);
-								if (return_size != transfer_size)
-								{
-									rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-									COMMON_LOG_ERROR("Large Payload returned "
-											"less data than requested");
-								}
-								else
-								{
-									current_offset += transfer_size;
-								}
-							}
+							COMMON_LOG_ERROR("Large Payload returned "
+									"less data than requested");
 						}
 						else
 						{
-							rc = linux_err_to_nvm_lib_err(lnx_err_status);
-							COMMON_LOG_ERROR_F("BIOS read failed: "
-									"Linux driver returned error %d for command with "
-									"Opcode - 0x%x SubOpcode - 0x%x ", lnx_err_status,
-									p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+							current_offset += transfer_size;
 						}
-						ndctl_cmd_unref(p_vendor_cmd);
 					}
-					free(p_dsm_input);
 				}
 				else
 				{
-					COMMON_LOG_ERROR("Failed to allocate memory for BIOS payload");
-					rc = NVM_ERR_NO_MEM;
+					rc = linux_err_to_nvm_lib_err(lnx_err_status);
+					COMMON_LOG_ERROR_F("BIOS read failed: "
+							"Linux driver returned error %d for command with "
+							"Opcode - 0x%x SubOpcode - 0x%x ", lnx_err_status,
+							p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 				}
 			}  // end while
 
+			if (p_vendor_cmd)
+			{
+				ndctl_cmd_unref(p_vendor_cmd);
+			}
+
 			if (current_offset != p_fw_cmd->LargeOutputPayloadSize)
 			{
 				COMMON_LOG_ERROR("Failed to read large payload");
@@ -430,14 +541,358 @@ int get_dimm_by_handle(struct ndctl_ctx *ctx, unsigned int handle, struct ndctl_
 	return rc;
 }
 
+/*
+ * Release the cached context and handle table. Caller holds the write lock.
+ */
+static void ndctl_ctx_cache_free()
+{
+	free(g_ndctl_dimm_cache);
+	g_ndctl_dimm_cache = NULL;
+	g_ndctl_dimm_cache_cnt = 0;
+
+	if (g_ndctl_ctx)
+	{
+		ndctl_unref(g_ndctl_ctx);
+		g_ndctl_ctx = NULL;
+	}
+}
+
+/*
+ * (Re)create the cached context and handle table. Caller holds the write lock.
+ */
+static int ndctl_ctx_cache_build()
+{
+	COMMON_LOG_ENTRY();
+	int rc = NVM_SUCCESS;
+	unsigned int count = 0;
+	struct ndctl_bus *bus;
+	struct ndctl_dimm *dimm;
+
+	ndctl_ctx_cache_free();
+
+	if ((rc = ndctl_new(&g_ndctl_ctx)) < 0)
+	{
+		COMMON_LOG_ERROR("Failed to retrieve ctx");
+		g_ndctl_ctx = NULL;
+		rc = linux_err_to_nvm_lib_err(rc);
+	}
+	else
+	{
+		rc = NVM_SUCCESS;
+		ndctl_bus_foreach(g_ndctl_ctx, bus)
+		{
+			ndctl_dimm_foreach(bus, dimm)
+			{
+				count++;
+			}
+		}
+
+		if (count > 0)
+		{
+			g_ndctl_dimm_cache = calloc(count, sizeof (*g_ndctl_dimm_cache));
+			if (g_ndctl_dimm_cache == NULL)
+			{
+				COMMON_LOG_ERROR("Failed to allocate memory for DIMM handle table");
+				ndctl_ctx_cache_free();
+				rc = NVM_ERR_NO_MEM;
+			}
+			else
+			{
+				ndctl_bus_foreach(g_ndctl_ctx, bus)
+				{
+					ndctl_dimm_foreach(bus, dimm)
+					{
+						if (g_ndctl_dimm_cache_cnt < count)
+						{
+							g_ndctl_dimm_cache[g_ndctl_dimm_cache_cnt].handle =
+								ndctl_dimm_get_handle(dimm);
+							g_ndctl_dimm_cache[g_ndctl_dimm_cache_cnt].p_dimm = dimm;
+							g_ndctl_dimm_cache_cnt++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	COMMON_LOG_EXIT_RETURN_I(rc);
+	return rc;
+}
+
+/*
+ * Look up a DIMM entry in the handle table. Caller holds the lock.
+ */
+static struct ndctl_dimm_cache_entry *ndctl_ctx_cache_find_entry(unsigned int handle)
+{
+	for (unsigned int i = 0; i < g_ndctl_dimm_cache_cnt; i++)
+	{
+		if (g_ndctl_dimm_cache[i].handle == handle)
+		{
+			return &g_ndctl_dimm_cache[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Look up a DIMM in the handle table. Caller holds the lock.
+ */
+static struct ndctl_dimm *ndctl_ctx_cache_find(unsigned int handle)
+{
+	struct ndctl_dimm_cache_entry *p_entry = ndctl_ctx_cache_find_entry(handle);
+
+	return p_entry ? p_entry->p_dimm : NULL;
+}
+
+/*
+ * Whether a lookup miss already rebuilt the table for a handle. Caller holds
+ * the lock.
+ */
+static int ndctl_ctx_cache_missed(unsigned int handle)
+{
+	unsigned int cnt = g_ndctl_missed_handles_cnt < NDCTL_MISSED_HANDLES_MAX ?
+		g_ndctl_missed_handles_cnt : NDCTL_MISSED_HANDLES_MAX;
+
+	for (unsigned int i = 0; i < cnt; i++)
+	{
+		if (g_ndctl_missed_handles[i] == handle)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Get the cached ndctl_dimm for a handle. On success the read lock is held
+ * and must be dropped with ndctl_ctx_cache_release() once the command is done.
+ * A miss rebuilds the table once per handle and generation, in case the bus
+ * was rescanned or a DIMM was hotplugged since it was built.
+ */
+static int ndctl_ctx_cache_get_dimm(unsigned int handle, struct ndctl_dimm **pp_dimm)
+{
+	COMMON_LOG_ENTRY();
+	int rc = NVM_SUCCESS;
+
+	pthread_rwlock_rdlock(&g_ndctl_ctx_lock);
+	if ((*pp_dimm = ndctl_ctx_cache_find(handle)) == NULL && ndctl_ctx_cache_missed(handle))
+	{
+		pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+		COMMON_LOG_ERROR("Failed to get DIMM from driver");
+		rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+	}
+	else if (*pp_dimm == NULL)
+	{
+		pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+
+		pthread_rwlock_wrlock(&g_ndctl_ctx_lock);
+		if (ndctl_ctx_cache_find(handle) == NULL)
+		{
+			if (ndctl_ctx_cache_missed(handle))
+			{
+				rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+			}
+			else if ((rc = ndctl_ctx_cache_build()) == NVM_SUCCESS &&
+				ndctl_ctx_cache_find(handle) == NULL)
+			{
+				g_ndctl_missed_handles[g_ndctl_missed_handles_cnt++ %
+					NDCTL_MISSED_HANDLES_MAX] = handle;
+			}
+		}
+		pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+
+		if (rc == NVM_SUCCESS)
+		{
+			pthread_rwlock_rdlock(&g_ndctl_ctx_lock);
+			if ((*pp_dimm = ndctl_ctx_cache_find(handle)) == NULL)
+			{
+				pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+				COMMON_LOG_ERROR("Failed to get DIMM from driver");
+				rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+			}
+		}
+	}
+
+	COMMON_LOG_EXIT_RETURN_I(rc);
+	return rc;
+}
+
+static void ndctl_ctx_cache_release()
+{
+	pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+}
+
+/*
+ * Build (or rebuild) the process-lifetime ndctl context and DIMM handle table
+ */
+int ndctl_ctx_cache_init()
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&g_ndctl_ctx_lock);
+	g_ndctl_missed_handles_cnt = 0;
+	rc = ndctl_ctx_cache_build();
+	pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+	return rc;
+}
+
+/*
+ * Release the process-lifetime ndctl context and DIMM handle table
+ */
+void ndctl_ctx_cache_uninit()
+{
+	pthread_rwlock_wrlock(&g_ndctl_ctx_lock);
+	ndctl_ctx_cache_free();
+	pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+}
+
+/*
+ * Microseconds from a monotonic clock
+ */
+static unsigned long long monotonic_us()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+void ioctl_passthrough_set_retry_policy(const struct dsm_retry_policy *p_policy)
+{
+	pthread_mutex_lock(&g_retry_lock);
+	if (p_policy)
+	{
+		g_retry_policy = *p_policy;
+	}
+	else
+	{
+		g_retry_policy.max_retries = DSM_MAX_RETRIES;
+		g_retry_policy.base_delay_us = DSM_RETRY_BASE_DELAY_US;
+		g_retry_policy.max_delay_us = DSM_RETRY_MAX_DELAY_US;
+		g_retry_policy.deadline_ms = DSM_RETRY_DEADLINE_MS;
+	}
+	pthread_mutex_unlock(&g_retry_lock);
+}
+
+void ioctl_passthrough_seed_retry_jitter(unsigned int seed)
+{
+	pthread_mutex_lock(&g_retry_lock);
+	g_retry_seed = seed;
+	pthread_mutex_unlock(&g_retry_lock);
+}
+
+int ioctl_passthrough_get_retry_stats(unsigned int handle, struct dsm_retry_stats *p_stats)
+{
+	int rc = NVM_ERR_INVALID_PARAMETER;
+	struct ndctl_dimm_cache_entry *p_entry = NULL;
+
+	if (p_stats == NULL)
+	{
+		return rc;
+	}
+
+	pthread_rwlock_rdlock(&g_ndctl_ctx_lock);
+	if ((p_entry = ndctl_ctx_cache_find_entry(handle)) != NULL)
+	{
+		pthread_mutex_lock(&g_retry_lock);
+		*p_stats = p_entry->retry;
+		pthread_mutex_unlock(&g_retry_lock);
+		rc = NVM_SUCCESS;
+	}
+	pthread_rwlock_unlock(&g_ndctl_ctx_lock);
+	return rc;
+}
+
+/*
+ * Wait before retry number 'retry' (1 based) of a command to the DIMM.
+ * Returns 0 without waiting if the wait would run past the deadline.
+ */
+static int dsm_retry_backoff(struct ndctl_dimm_cache_entry *p_entry,
+	const struct dsm_retry_policy *p_policy, int retry, unsigned long long start_us)
+{
+	unsigned int shift;
+	unsigned long long delay_us;
+
+	pthread_mutex_lock(&g_retry_lock);
+	shift = p_entry->retry.level + (unsigned int)retry - 1;
+	if (p_policy->base_delay_us == 0)
+	{
+		delay_us = 0;
+	}
+	else if (shift >= 32 ||
+		((unsigned long long)p_policy->base_delay_us << shift) > p_policy->max_delay_us)
+	{
+		delay_us = p_policy->max_delay_us;
+	}
+	else
+	{
+		delay_us = (unsigned long long)p_policy->base_delay_us << shift;
+	}
+	// Full wait up to half of it off, so DIMMs stalled together do not retry in lockstep
+	if (delay_us > 1)
+	{
+		delay_us -= rand_r(&g_retry_seed) % (delay_us / 2 + 1);
+	}
+
+	if (p_policy->deadline_ms &&
+		monotonic_us() + delay_us - start_us > (unsigned long long)p_policy->deadline_ms * 1000)
+	{
+		p_entry->retry.deadline_expired++;
+		pthread_mutex_unlock(&g_retry_lock);
+		return 0;
+	}
+
+	if (retry == 1)
+	{
+		p_entry->retry.commands_retried++;
+	}
+	p_entry->retry.retries++;
+	p_entry->retry.backoff_us += delay_us;
+	pthread_mutex_unlock(&g_retry_lock);
+
+	if (delay_us)
+	{
+		usleep((useconds_t)delay_us);
+	}
+	return 1;
+}
+
+/*
+ * Update the remembered backoff level of the DIMM once a command is done
+ */
+static void dsm_retry_complete(struct ndctl_dimm_cache_entry *p_entry,
+	const struct dsm_retry_policy *p_policy, int retry)
+{
+	pthread_mutex_lock(&g_retry_lock);
+	if (retry > 0)
+	{
+		if (p_entry->retry.level < DSM_RETRY_MAX_LEVEL)
+		{
+			p_entry->retry.level++;
+		}
+		if ((unsigned int)retry >= p_policy->max_retries)
+		{
+			p_entry->retry.exhausted++;
+		}
+	}
+	else if (p_entry->retry.level > 0)
+	{
+		p_entry->retry.level--;
+	}
+	pthread_mutex_unlock(&g_retry_lock);
+}
+
 /*
  * Execute a passthrough IOCTL
  */
-int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
+int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd, unsigned int *p_retries)
 {
 	COMMON_LOG_ENTRY();
 	int rc = NVM_SUCCESS;
-	struct ndctl_ctx *ctx;
+	struct ndctl_dimm *p_dimm = NULL;
+	struct ndctl_dimm_cache_entry *p_entry = NULL;
+	struct dsm_retry_policy policy;
+	unsigned long long start_us = 0;
 	int retry = 0;
 
 	// check input parameters
@@ -456,128 +911,138 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 		rc = NVM_LIB_ERR_NOTSUPPORTED;
 	}
 #endif
-	else if ((rc = ndctl_new(&ctx)) < 0)
-	{
-		COMMON_LOG_ERROR("Failed to retrieve ctx");
-		rc = linux_err_to_nvm_lib_err(rc);
-	}
-	else
+	else if ((rc = ndctl_ctx_cache_get_dimm(p_fw_cmd->DimmID, &p_dimm)) == NVM_SUCCESS)
 	{
-		struct ndctl_dimm *p_dimm = NULL;
-		if ((rc = get_dimm_by_handle(ctx, p_fw_cmd->DimmID, &p_dimm)) == NVM_SUCCESS)
+		unsigned int Opcode = BUILD_DSM_OPCODE(p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+		struct ndctl_cmd *p_vendor_cmd = NULL;
+
+		p_entry = ndctl_ctx_cache_find_entry(p_fw_cmd->DimmID);
+		pthread_mutex_lock(&g_retry_lock);
+		policy = g_retry_policy;
+		pthread_mutex_unlock(&g_retry_lock);
+		start_us = monotonic_us();
+		if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(
+				p_dimm, Opcode, p_fw_cmd->InputPayloadSize,
+				DEV_SMALL_PAYLOAD_SIZE)) == NULL)
 		{
-			unsigned int Opcode = BUILD_DSM_OPCODE(p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-			struct ndctl_cmd *p_vendor_cmd = NULL;
-			if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(
-					p_dimm, Opcode, p_fw_cmd->InputPayloadSize,
-					DEV_SMALL_PAYLOAD_SIZE)) == NULL)
-			{
-				rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-				COMMON_LOG_ERROR("Failed to get vendor command from driver");
-			}
-			else
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+			COMMON_LOG_ERROR("Failed to get vendor command from driver");
+		}
+		else
+		{
+			while ((unsigned int)retry < policy.max_retries)
 			{
-				while (retry < DSM_MAX_RETRIES)
-				{
-					int lnx_err_status = 0;
-					unsigned int dsm_vendor_err_status = 0;
+				int lnx_err_status = 0;
+				unsigned int dsm_vendor_err_status = 0;
           p_fw_cmd->DsmStatus = 0;
           p_fw_cmd->Status = 0;
 
-					if (p_fw_cmd->InputPayloadSize > 0)
-					{
-						size_t bytes_written = ndctl_cmd_vendor_set_input(p_vendor_cmd,
-							p_fw_cmd->InputPayload, p_fw_cmd->InputPayloadSize);
+				if (p_fw_cmd->InputPayloadSize > 0)
+				{
+					size_t bytes_written = ndctl_cmd_vendor_set_input(p_vendor_cmd,
+						p_fw_cmd->InputPayload, p_fw_cmd->InputPayloadSize);
 
-						if (bytes_written != p_fw_cmd->InputPayloadSize)
-						{
-							COMMON_LOG_ERROR("Failed to write input payload");
-							rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-							break;
-						}
+					if (bytes_written != p_fw_cmd->InputPayloadSize)
+					{
+						COMMON_LOG_ERROR("Failed to write input payload");
+						rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+						break;
 					}
+				}
 
-					if (p_fw_cmd->LargeInputPayloadSize > 0)
+				if (p_fw_cmd->LargeInputPayloadSize > 0)
+				{
+					rc = bios_write_large_payload(p_dimm, p_fw_cmd);
+					if (rc != NVM_SUCCESS)
 					{
-						rc = bios_write_large_payload(p_dimm, p_fw_cmd);
-						if (rc != NVM_SUCCESS)
-						{
-							break;
-						}
+						break;
 					}
+				}
 
-					COMMON_LOG_HANDOFF_F("Passthrough IOCTL. Opcode: 0x%x, SubOpcode: 0x%x",
-						p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-					if (p_fw_cmd->InputPayloadSize)
+				COMMON_LOG_HANDOFF_F("Passthrough IOCTL. Opcode: 0x%x, SubOpcode: 0x%x",
+					p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+				if (p_fw_cmd->InputPayloadSize)
+				{
+					// Print one DWORD at a time starting from LSB of InputPayload
+					for (int i = 0; i < p_fw_cmd->InputPayloadSize / sizeof(UINT32); i++)
 					{
-						// Print one DWORD at a time starting from LSB of InputPayload
-						for (int i = 0; i < p_fw_cmd->InputPayloadSize / sizeof(UINT32); i++)
-						{
-							// Make sure entire DWORD gets printed
-							COMMON_LOG_HANDOFF_F("Input[%d]: 0x%.8x",
-								i, ((UINT32 *) (p_fw_cmd->InputPayload))[i]);
-						}
+						// Make sure entire DWORD gets printed
+						COMMON_LOG_HANDOFF_F("Input[%d]: 0x%.8x",
+							i, ((UINT32 *) (p_fw_cmd->InputPayload))[i]);
 					}
+				}
 
-					if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) >= 0)
-					{
-						// BSR returns 0x78, but everything else seems to indicate the
-						// command was a success. Going
-						// to ignore the result for now. If there was a real error,
-						// the fw_status should have it.
-						dsm_vendor_err_status =	ndctl_cmd_get_firmware_status(p_vendor_cmd);
+				if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) >= 0)
+				{
+					// BSR returns 0x78, but everything else seems to indicate the
+					// command was a success. Going
+					// to ignore the result for now. If there was a real error,
+					// the fw_status should have it.
+					dsm_vendor_err_status =	ndctl_cmd_get_firmware_status(p_vendor_cmd);
 
-						if (dsm_vendor_err_status == DSM_VENDOR_RETRY_SUGGESTED)
-						{
+					if (dsm_vendor_err_status == DSM_VENDOR_RETRY_SUGGESTED)
+					{
               DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-							COMMON_LOG_ERROR_F("RETRY %i IOCTL passthrough failed: "
-								"DSM returned error %d for command with "
-										"Opcode - 0x%x SubOpcode - 0x%x \n", retry, dsm_vendor_err_status,
-											p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-							retry++;
-							continue;
-						}
-						else if (dsm_vendor_err_status != DSM_VENDOR_SUCCESS)
+						COMMON_LOG_ERROR_F("RETRY %i IOCTL passthrough failed: "
+							"DSM returned error %d for command with "
+									"Opcode - 0x%x SubOpcode - 0x%x \n", retry, dsm_vendor_err_status,
+										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+						retry++;
+						if ((unsigned int)retry < policy.max_retries &&
+							!dsm_retry_backoff(p_entry, &policy, retry, start_us))
 						{
-              DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-							COMMON_LOG_ERROR_F("IOCTL passthrough failed: "
-								"DSM returned error %d for command with "
-										"Opcode - 0x%x SubOpcode - 0x%x \n", dsm_vendor_err_status,
-											p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+							COMMON_LOG_ERROR_F("Giving up retries after %i attempts, "
+								"deadline of %u ms reached", retry, policy.deadline_ms);
 							break;
 						}
-						else
+						continue;
+					}
+					else if (dsm_vendor_err_status != DSM_VENDOR_SUCCESS)
+					{
+              DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
+						COMMON_LOG_ERROR_F("IOCTL passthrough failed: "
+							"DSM returned error %d for command with "
+									"Opcode - 0x%x SubOpcode - 0x%x \n", dsm_vendor_err_status,
+										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+						break;
+					}
+					else
+					{
+						if (p_fw_cmd->OutputPayloadSize > 0)
 						{
-							if (p_fw_cmd->OutputPayloadSize > 0)
-							{
                 DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-								ndctl_cmd_vendor_get_output(p_vendor_cmd,
-											p_fw_cmd->OutPayload,
-												p_fw_cmd->OutputPayloadSize);
-							}
+							ndctl_cmd_vendor_get_output(p_vendor_cmd,
+										p_fw_cmd->OutPayload,
+											p_fw_cmd->OutputPayloadSize);
+						}
 
-							if (p_fw_cmd->LargeOutputPayloadSize > 0)
-							{
+						if (p_fw_cmd->LargeOutputPayloadSize > 0)
+						{
 
-								rc = bios_read_large_payload(p_dimm, p_fw_cmd);
-							}
-							break;
+							rc = bios_read_large_payload(p_dimm, p_fw_cmd);
 						}
-					}
-					else
-					{
-						rc = linux_err_to_nvm_lib_err(lnx_err_status);
-						COMMON_LOG_ERROR_F("IOCTL passthrough failed "
-								"Linux driver returned error %d for command with "
-								"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
-								p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 						break;
 					}
 				}
-				ndctl_cmd_unref(p_vendor_cmd);
+				else
+				{
+					rc = linux_err_to_nvm_lib_err(lnx_err_status);
+					COMMON_LOG_ERROR_F("IOCTL passthrough failed "
+							"Linux driver returned error %d for command with "
+							"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
+							p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+					break;
+				}
 			}
+			ndctl_cmd_unref(p_vendor_cmd);
+			dsm_retry_complete(p_entry, &policy, retry);
 		}
-		ndctl_unref(ctx);
+		ndctl_ctx_cache_release();
+	}
+
+	if (p_retries != NULL)
+	{
+		*p_retries = (unsigned int)retry;
 	}
 
 	memset(&p_fw_cmd, 0, sizeof(p_fw_cmd));
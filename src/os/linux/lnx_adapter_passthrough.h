@@ -26,9 +26,70 @@ struct pt_bios_get_size {
 };
 #pragma pack(pop)
 
+/*
+ * How DSM_VENDOR_RETRY_SUGGESTED responses are retried. The n-th retry of a
+ * command waits a jittered base_delay_us << (level + n), capped at
+ * max_delay_us, where level is remembered per DIMM: it grows while the DIMM
+ * keeps asking for retries and decays with every command that goes through
+ * without one. A command is given up once max_retries is reached or the
+ * next wait would end past deadline_ms (0 for no deadline).
+ */
+struct dsm_retry_policy {
+	unsigned int max_retries;
+	unsigned int base_delay_us;
+	unsigned int max_delay_us;
+	unsigned int deadline_ms;
+};
+
+#define DSM_RETRY_BASE_DELAY_US		100
+#define DSM_RETRY_MAX_DELAY_US		100000
+#define DSM_RETRY_DEADLINE_MS		5000
+#define DSM_RETRY_MAX_LEVEL		16
+
+/*
+ * Retry outcome counters of one DIMM
+ */
+struct dsm_retry_stats {
+	unsigned long long commands_retried;	/* commands that got at least one retry suggested */
+	unsigned long long retries;		/* retries issued */
+	unsigned long long backoff_us;		/* time spent waiting between retries */
+	unsigned long long exhausted;		/* commands that ran out of retries */
+	unsigned long long deadline_expired;	/* commands given up on the deadline */
+	unsigned int level;			/* current backoff level */
+};
+
+
+
+/*
+ * Execute a passthrough IOCTL. When p_retries is not NULL it receives the
+ * number of DSM_VENDOR_RETRY_SUGGESTED responses seen for the command.
+ */
+int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd, unsigned int *p_retries);
+
+/*
+ * Build (or rebuild) the process-lifetime ndctl context and DIMM handle table
+ */
+int ndctl_ctx_cache_init();
+
+/*
+ * Release the process-lifetime ndctl context and DIMM handle table
+ */
+void ndctl_ctx_cache_uninit();
+
+/*
+ * Replace the retry policy used by ioctl_passthrough_fw_cmd. A NULL policy
+ * restores the defaults.
+ */
+void ioctl_passthrough_set_retry_policy(const struct dsm_retry_policy *p_policy);
 
+/*
+ * Get the retry counters of the DIMM with the given handle, they are kept
+ * with the DIMM handle table and start over when it is rebuilt
+ */
+int ioctl_passthrough_get_retry_stats(unsigned int handle, struct dsm_retry_stats *p_stats);
 
 /*
- * Execute a passthrough IOCTL
+ * Seed the retry jitter, so processes retrying on the same DIMM do not
+ * draw the same delays
  */
-int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd);
+void ioctl_passthrough_seed_retry_jitter(unsigned int seed);
@@ -21,9 +21,9 @@
 #include <stdio.h>
 #include <libgen.h>
 #include <cpuid.h>
-#include <sys/shm.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
+#include <sys/file.h>
+#include <fcntl.h>
 #include <Base.h>
 #include <lnx_adapter.h>
 #include <string.h>
@@ -31,12 +31,15 @@
 #include <nvm_management.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/eventfd.h>
 
 #define	LOCALE_DIR	"/usr/share/locale"
-#define FTOK_PROJ_ID 'R' // Today proj_id is an int, but still only 8 bits are used.
-                        // Typical usage has an ASCII character proj_id,
-                        // that is why the behavior is said to be undefined when proj_id is zero.
-#define SHM_PERM_FLG 0666 // permissions granted to the owner, group, and others.
+#define	LOCK_DIR	"/run/ipmctl"
+#define LOCK_DIR_PERM 0755
+#define LOCK_FILE_PERM 0644
+#define LOCK_RETRY_US 10000
 
 #ifndef ACCESSPERMS
 #define ACCESSPERMS (S_IRWXU|S_IRWXG|S_IRWXO)
@@ -75,6 +78,8 @@ int os_get_filesize(const char *filename, size_t *filesize)
 
 /*
  * Initializes a mutex.
+ * The mutex is local to the process, the name is only used on Windows.
+ * Use os_file_lock_init to serialize with other processes.
  */
 OS_MUTEX * os_mutex_init(const char *name)
 {
@@ -87,23 +92,6 @@ OS_MUTEX * os_mutex_init(const char *name)
 		pthread_mutexattr_init(&attr);
 		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 
-		// if named make it cross-process safe
-		if (name)
-		{
-			pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-			// create a shared memory id
-			int shmid = shmget(ftok(name, FTOK_PROJ_ID), sizeof (pthread_mutex_t), IPC_CREAT | SHM_PERM_FLG);
-			if (shmid != -1)
-			{
-				// attach to the shared memory
-				pthread_mutex_t *p_tmp = (pthread_mutex_t *)shmat(shmid, NULL, 0);
-				if (p_tmp)
-				{
-					memmove(mutex, p_tmp, sizeof (pthread_mutex_t));
-				}
-			}
-		}
-
 		// failure when pthread_mutex_init(..) != 0
 		rc = pthread_mutex_init((pthread_mutex_t *)mutex, &attr);
 		if (rc != 0) {
@@ -154,18 +142,6 @@ int os_mutex_delete(OS_MUTEX *p_mutex, const char *name)
   {
     // failure when pthread_mutex_destroy(..) != 0
     rc = (pthread_mutex_destroy((pthread_mutex_t *)p_mutex) == 0);
-
-    // detach and remove the shared memory
-    if (name)
-    {
-      shmdt(p_mutex);
-      // remove the shared memory
-      int shmid = shmget(ftok(name, FTOK_PROJ_ID), sizeof(pthread_mutex_t), SHM_PERM_FLG);
-      if (shmid != -1)
-      {
-        shmctl(shmid, IPC_RMID, NULL);
-      }
-    }
     free(p_mutex);
   }
   return rc;
@@ -236,6 +212,299 @@ int os_rwlock_delete(OS_RWLOCK *p_rwlock)
 	return (pthread_rwlock_destroy(p_handle) == 0);
 }
 
+/*
+ * Opens the lock file of the given name, created on first use in a
+ * directory only root may write to. The lock is an flock on it, released by
+ * the kernel when the process exits, so a crashed process never leaves it
+ * held. The file is never removed, another process may be waiting on it.
+ */
+OS_FILE_LOCK *os_file_lock_init(const char *name)
+{
+	char path[OS_PATH_LEN];
+	struct stat dir_stat;
+	int *p_fd = NULL;
+	int fd;
+
+	if (!name)
+	{
+		return NULL;
+	}
+	if (mkdir(LOCK_DIR, LOCK_DIR_PERM) != 0 && errno != EEXIST)
+	{
+		return NULL;
+	}
+	// refuse a directory another user could plant the lock file in
+	if (lstat(LOCK_DIR, &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode) ||
+		dir_stat.st_uid != 0 || (dir_stat.st_mode & (S_IWGRP | S_IWOTH)))
+	{
+		return NULL;
+	}
+	snprintf(path, sizeof(path), "%s/%s.lock", LOCK_DIR, name);
+	if ((fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, LOCK_FILE_PERM)) < 0)
+	{
+		return NULL;
+	}
+	if (NULL == (p_fd = (int *)malloc(sizeof(int))))
+	{
+		close(fd);
+		return NULL;
+	}
+	*p_fd = fd;
+	return p_fd;
+}
+
+/*
+ * Polls for the lock until OS_FILE_LOCK_TIMEOUT_MS, a holder that never
+ * lets go must not hang every other process
+ */
+static int file_lock(OS_FILE_LOCK *p_lock, int operation)
+{
+	unsigned long long waited_us = 0;
+	int rc;
+
+	if (!p_lock)
+	{
+		return 0;
+	}
+	if (operation != LOCK_UN)
+	{
+		operation |= LOCK_NB;
+	}
+	while ((rc = flock(*(int *)p_lock, operation)) != 0)
+	{
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EWOULDBLOCK ||
+			waited_us >= (unsigned long long)OS_FILE_LOCK_TIMEOUT_MS * 1000)
+		{
+			break;
+		}
+		usleep(LOCK_RETRY_US);
+		waited_us += LOCK_RETRY_US;
+	}
+	return (rc == 0);
+}
+
+/*
+ * Takes the lock shared with the other readers, waits for a writer
+ * up to OS_FILE_LOCK_TIMEOUT_MS
+ */
+int os_file_lock_shared(OS_FILE_LOCK *p_lock)
+{
+	return file_lock(p_lock, LOCK_SH);
+}
+
+/*
+ * Takes the lock exclusively, waits for all the other holders
+ * up to OS_FILE_LOCK_TIMEOUT_MS
+ */
+int os_file_lock_exclusive(OS_FILE_LOCK *p_lock)
+{
+	return file_lock(p_lock, LOCK_EX);
+}
+
+/*
+ * Releases the lock, shared or exclusive.
+ * The lock belongs to the process, not the thread taking it.
+ */
+int os_file_unlock(OS_FILE_LOCK *p_lock)
+{
+	return file_lock(p_lock, LOCK_UN);
+}
+
+/*
+ * Closes the lock file, releasing the lock if held
+ */
+int os_file_lock_delete(OS_FILE_LOCK *p_lock)
+{
+	int rc = 1;
+	if (p_lock)
+	{
+		rc = (close(*(int *)p_lock) == 0);
+		free(p_lock);
+	}
+	return rc;
+}
+
+/*
+ * Starts a new thread running p_func(p_arg)
+ */
+OS_THREAD *os_thread_create(OS_THREAD_FUNC p_func, void *p_arg)
+{
+	pthread_t *p_thread = (pthread_t *) malloc(sizeof(pthread_t));
+	if (p_thread)
+	{
+		// failure when pthread_create(..) != 0
+		if (pthread_create(p_thread, NULL, p_func, p_arg) != 0)
+		{
+			free(p_thread);
+			p_thread = NULL;
+		}
+	}
+	return p_thread;
+}
+
+/*
+ * Waits for a thread to finish and releases it
+ */
+int os_thread_join(OS_THREAD *p_thread)
+{
+	int rc = 0;
+	if (p_thread)
+	{
+		// failure when pthread_join(..) != 0
+		rc = (pthread_join(*(pthread_t *)p_thread, NULL) == 0);
+		free(p_thread);
+	}
+	return rc;
+}
+
+struct lnx_cond
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+/*
+ * Creates a condition variable together with the lock protecting it
+ */
+OS_COND *os_cond_init()
+{
+	struct lnx_cond *p_cond = (struct lnx_cond *) malloc(sizeof(struct lnx_cond));
+	if (p_cond)
+	{
+		pthread_condattr_t attr;
+		pthread_condattr_init(&attr);
+		// timed waits are measured against the monotonic clock
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		if (pthread_mutex_init(&p_cond->mutex, NULL) != 0)
+		{
+			free(p_cond);
+			p_cond = NULL;
+		}
+		else if (pthread_cond_init(&p_cond->cond, &attr) != 0)
+		{
+			pthread_mutex_destroy(&p_cond->mutex);
+			free(p_cond);
+			p_cond = NULL;
+		}
+		pthread_condattr_destroy(&attr);
+	}
+	return p_cond;
+}
+
+/*
+ * Locks the lock of a condition variable
+ */
+int os_cond_lock(OS_COND *p_cond)
+{
+	// failure when pthread_mutex_lock(..) != 0
+	return p_cond && (pthread_mutex_lock(&((struct lnx_cond *)p_cond)->mutex) == 0);
+}
+
+/*
+ * Unlocks the lock of a condition variable
+ */
+int os_cond_unlock(OS_COND *p_cond)
+{
+	// failure when pthread_mutex_unlock(..) != 0
+	return p_cond && (pthread_mutex_unlock(&((struct lnx_cond *)p_cond)->mutex) == 0);
+}
+
+/*
+ * Waits for the condition to be signaled, the caller holds its lock.
+ * A negative timeout waits forever. Returns 0 on timeout or failure.
+ */
+int os_cond_wait(OS_COND *p_cond, int timeout_ms)
+{
+	int rc = 0;
+	if (p_cond)
+	{
+		struct lnx_cond *p_handle = (struct lnx_cond *)p_cond;
+		if (timeout_ms < 0)
+		{
+			rc = (pthread_cond_wait(&p_handle->cond, &p_handle->mutex) == 0);
+		}
+		else
+		{
+			struct timespec deadline;
+			clock_gettime(CLOCK_MONOTONIC, &deadline);
+			deadline.tv_sec += timeout_ms / 1000;
+			deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+			if (deadline.tv_nsec >= 1000000000)
+			{
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000;
+			}
+			rc = (pthread_cond_timedwait(&p_handle->cond, &p_handle->mutex, &deadline) == 0);
+		}
+	}
+	return rc;
+}
+
+/*
+ * Wakes up every thread waiting on the condition
+ */
+int os_cond_broadcast(OS_COND *p_cond)
+{
+	// failure when pthread_cond_broadcast(..) != 0
+	return p_cond && (pthread_cond_broadcast(&((struct lnx_cond *)p_cond)->cond) == 0);
+}
+
+/*
+ * Deletes the condition variable and its lock
+ */
+int os_cond_delete(OS_COND *p_cond)
+{
+	int rc = 1;
+	if (p_cond)
+	{
+		struct lnx_cond *p_handle = (struct lnx_cond *)p_cond;
+		rc = (pthread_cond_destroy(&p_handle->cond) == 0) &&
+			(pthread_mutex_destroy(&p_handle->mutex) == 0);
+		free(p_handle);
+	}
+	return rc;
+}
+
+/*
+ * Creates a non-blocking eventfd that can be added to a poll/epoll set.
+ * Returns -1 on failure.
+ */
+int os_event_fd_create()
+{
+	return eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+/*
+ * Makes an eventfd readable
+ */
+void os_event_fd_signal(int fd)
+{
+	uint64_t one = 1;
+	if (fd >= 0)
+	{
+		// only fails when the counter would overflow, the fd is readable then anyway
+		if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		{
+			syslog(LOG_DEBUG, "eventfd write failed: %d", errno);
+		}
+	}
+}
+
+/*
+ * Closes an eventfd
+ */
+void os_event_fd_close(int fd)
+{
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+}
+
 /*
  * Retrieve the name of the host server.
  */
@@ -315,6 +584,37 @@ int os_get_os_type()
 	return OS_TYPE_LINUX;
 }
 
+/*
+ * Retrieve an identifier that is unique per boot of the system.
+ */
+int os_get_boot_id(char *boot_id, const unsigned int boot_id_len)
+{
+	int rc = -1;
+	FILE *p_file = NULL;
+	size_t len = 0;
+
+	if (boot_id == NULL || boot_id_len == 0)
+	{
+		return -1;
+	}
+
+	p_file = fopen("/proc/sys/kernel/random/boot_id", "r");
+	if (p_file != NULL)
+	{
+		if (fgets(boot_id, boot_id_len, p_file) != NULL)
+		{
+			len = strlen(boot_id);
+			if (len > 0 && boot_id[len - 1] == '\n')
+			{
+				boot_id[len - 1] = '\0';
+			}
+			rc = 0;
+		}
+		fclose(p_file);
+	}
+	return rc;
+}
+
 int os_get_driver_capabilities(struct nvm_driver_capabilities *p_capabilities)
 {
 	p_capabilities->features.get_platform_capabilities = 1;
@@ -379,6 +679,24 @@ int os_mkdir(char *path)
   return 0;
 }
 
+FILE *os_fopen_unique(char *path_template)
+{
+  FILE *p_file = NULL;
+  int fd = mkstemp(path_template);
+
+  if (fd < 0) {
+    return NULL;
+  }
+  // mkstemp creates the file 0600, keep the mode fopen would have given it
+  fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  p_file = fdopen(fd, "wb");
+  if (p_file == NULL) {
+    close(fd);
+    unlink(path_template);
+  }
+  return p_file;
+}
+
 /*
  Get CPUID info for Linux. Depending on the inputRequestType,
   regs[0...3] will be populated with register values eax....edx
@@ -29,6 +29,9 @@
 #include <os_efi_shell_parameters_protocol.h>
 #include <os_efi_preferences.h>
 #include <os_efi_api.h>
+#include <os_efi_emulator.h>
+#include <os_efi_inventory_cache.h>
+#include <os_efi_startup_profile.h>
 #include <Common.h>
 #include <NvmDimmConfig.h>
 #include <NvmDimmPassThru.h>
@@ -45,19 +48,45 @@
 #define STRINGIZE2(s) #s
 #define STRINGIZE(s) STRINGIZE2(s)
 #define VERSION_STR STRINGIZE(__VERSION_NUMBER__)
-#define NVM_API_MUTEX "nvm_api"
+#define NVM_API_LOCK "ipmctl"
 
 #define INVALID_DIMM_HANDLE     0
+/*
+ * Lock hierarchy of the API calls, always taken in this order:
+ * 1. The inventory lock. The calls reading the inventory or sending commands
+ *    to its DIMMs share it, counted by g_api_readers. The calls changing the
+ *    platform configuration and nvm_sync_lock_api users hold it exclusively
+ *    by owning g_api_mutex once there are no readers. The process holds
+ *    g_api_lock_file the same way while it has readers or a writer, so the
+ *    other processes using the library or the CLI follow the same rules.
+ *    Calls fail with NVM_ERR_BUSY_DEVICE when the lock file is not granted
+ *    within OS_FILE_LOCK_TIMEOUT_MS.
+ * 2. The pApiLock of one DIMM, held by the calls on that DIMM so their FW
+ *    command sequences do not interleave. Calls on other DIMMs run meanwhile.
+ * 3. The pPassThruLock of the DIMM, taken by the driver for each FW command.
+ */
 OS_MUTEX *g_api_mutex;
+OS_COND *g_api_readers_cond;
+OS_FILE_LOCK *g_api_lock_file;
+unsigned int g_api_readers;
+unsigned int g_api_writer_depth;
+// Set while the readers hold g_api_lock_file shared, or a reader is taking it
+BOOLEAN g_api_file_shared;
+BOOLEAN g_api_file_sharing;
 unsigned int g_dimm_cnt;
 int g_basic_commands = 0;
-DIMM_INFO *g_dimms;
 int get_dimm_id(const char *uid, UINT16 *dimm_id, unsigned int *dimm_handle);
 void dimm_info_to_device_discovery(DIMM_INFO *p_dimm, struct device_discovery *p_device);
 int g_nvm_initialized = 0;
+// Open nvm_create_context calls, the cached DIMM state is kept while any is open
+unsigned int g_context_depth = 0;
 int get_fw_err_log_stats(const unsigned int dimm_id, const unsigned char log_level, const unsigned char log_type, LOG_INFO_DATA_RETURN *log_info);
 static int nvm_internal_init(BOOLEAN binding_start);
+static void api_clear_pcd_cache();
+static int api_lock_shared();
+static void api_unlock_shared();
 static void nvm_internal_uninit(BOOLEAN binding_stop);
+static void pt_async_uninit();
 
 extern EFI_SHELL_PARAMETERS_PROTOCOL gOsShellParametersProtocol;
 extern NVMDIMMDRIVER_DATA *gNvmDimmData;
@@ -93,12 +122,17 @@ static int nvm_internal_init(BOOLEAN binding_start)
 
   if (g_nvm_initialized) {
 
-    // Clear PCD cache on any API entry point
-    ClearPcdCacheOnDimmList();
+    // Clear PCD cache on any API entry point outside of a context
+    if (g_context_depth == 0) {
+      api_clear_pcd_cache();
+    }
 
     return rc;
   }
 
+  // The CLI starts the clock earlier, with its command line
+  startup_profile_init(0, NULL);
+
   // Configure gOsShellParametersProtocol
   if (gOsShellParametersProtocol.StdOut == 0) {
     gOsShellParametersProtocol.StdOut = stdout;
@@ -119,11 +153,26 @@ static int nvm_internal_init(BOOLEAN binding_start)
 
   NVDIMM_DBG("Nvm Init");
 
-  if (NULL == (g_api_mutex = os_mutex_init(NVM_API_MUTEX)))
+  if (NULL == (g_api_mutex = os_mutex_init(NULL)))
   {
     NVDIMM_ERR("Failed to intialize NVM API mutex\n");
     return NVM_ERR_UNKNOWN;
   }
+  if (NULL == (g_api_readers_cond = os_cond_init()))
+  {
+    NVDIMM_ERR("Failed to intialize NVM API inventory lock\n");
+    rc = NVM_ERR_UNKNOWN;
+    goto cleanup_mutex;
+  }
+  g_api_readers = 0;
+  g_api_writer_depth = 0;
+  g_api_file_shared = FALSE;
+  g_api_file_sharing = FALSE;
+  // Without it the calls are only serialized within this process
+  if (NULL == (g_api_lock_file = os_file_lock_init(NVM_API_LOCK)))
+  {
+    NVDIMM_WARN("Failed to open the NVM API lock file\n");
+  }
 
   EFI_HANDLE FakeBindHandle = (EFI_HANDLE)0x1;
   init_protocol_bs();
@@ -137,12 +186,34 @@ static int nvm_internal_init(BOOLEAN binding_start)
     goto cleanup_mutex;
   }
 
+  // Emulated modules replace the platform tables and the OS driver when configured
+  if (EFI_SUCCESS != emulated_dimms_init())
+  {
+    NVDIMM_ERR("Failed to initialize emulated PMem modules\n");
+    rc = NVM_ERR_UNKNOWN;
+    goto cleanup_mutex;
+  }
+
+  startup_profile_begin(StartupPhaseDriverEntry);
   if (EFI_SUCCESS != NvmDimmDriverDriverEntryPoint(0, NULL))
   {
+    startup_profile_end(StartupPhaseDriverEntry);
     NVDIMM_ERR("Nvm Dimm driver entry point failed.\n");
     rc = NVM_ERR_UNKNOWN;
     goto cleanup_mutex;
   }
+  startup_profile_end(StartupPhaseDriverEntry);
+
+  // Driver context for passthrough is created once here and reused by every FW command
+  if (EFI_SUCCESS != passthru_os_init())
+  {
+    NVDIMM_WARN("Failed to initialize passthrough driver context\n");
+  }
+
+  if (EFI_SUCCESS != InitializeTransportStats())
+  {
+    NVDIMM_WARN("Failed to initialize passthrough transport statistics\n");
+  }
 
   rc = os_check_admin_permissions();
   if (NVM_SUCCESS != rc) {
@@ -156,19 +227,39 @@ static int nvm_internal_init(BOOLEAN binding_start)
 
   if (binding_start && (!g_fast_path && !g_basic_commands))
   {
+    // Reads every DIMM, other processes may be changing the configuration
+    if (NVM_SUCCESS != (rc = api_lock_shared())) {
+      nvm_internal_uninit(FALSE);
+      return rc;
+    }
     NvmDimmDriverDriverBindingStart(&gNvmDimmDriverDriverBinding, FakeBindHandle, NULL);
+    api_unlock_shared();
   }
 
   g_nvm_initialized = 1;
   return rc;
 cleanup_mutex:
-  os_mutex_delete(g_api_mutex, NVM_API_MUTEX);
+  if (g_api_lock_file) {
+    os_file_lock_delete(g_api_lock_file);
+    g_api_lock_file = NULL;
+  }
+  if (g_api_readers_cond) {
+    os_cond_delete(g_api_readers_cond);
+    g_api_readers_cond = NULL;
+  }
+  os_mutex_delete(g_api_mutex, NULL);
   g_api_mutex = NULL;
   return rc;
 }
 
+static void api_lock_exclusive_local();
+static void api_unlock_exclusive_local();
+
 NVM_API void nvm_uninit()
 {
+  // Let the calls running on other threads complete first
+  api_lock_exclusive_local();
+  api_unlock_exclusive_local();
   nvm_internal_uninit(TRUE);
 }
 
@@ -176,15 +267,33 @@ static void nvm_internal_uninit(BOOLEAN binding_stop)
 {
   EFI_HANDLE FakeBindHandle = (EFI_HANDLE)0x1;
 
+  // async workers issue commands through the driver, stop them before it goes away
+  pt_async_uninit();
+  nvm_free_context(TRUE);
+
   if (binding_stop && (!g_fast_path && !g_basic_commands)) {
     NvmDimmDriverDriverBindingStop(&gNvmDimmDriverDriverBinding, FakeBindHandle, 0, NULL);
   }
   NvmDimmDriverUnload(FakeBindHandle);
+  passthru_os_uninit();
+  // Reports the FW commands too, so it goes before the statistics and preferences
+  startup_profile_uninit();
+  UninitializeTransportStats();
+  inventory_cache_uninit();
+  emulated_dimms_uninit();
   uninit_protocol_shell_parameters_protocol();
   preferences_uninit();
 
+  if (g_api_lock_file) {
+    os_file_lock_delete(g_api_lock_file);
+    g_api_lock_file = NULL;
+  }
+  if (g_api_readers_cond) {
+    os_cond_delete(g_api_readers_cond);
+    g_api_readers_cond = NULL;
+  }
   if (g_api_mutex) {
-    os_mutex_delete(g_api_mutex, NVM_API_MUTEX);
+    os_mutex_delete(g_api_mutex, NULL);
     g_api_mutex = NULL;
   }
   g_nvm_initialized = 0;
@@ -216,24 +325,250 @@ NVM_API void nvm_conf_file_flush()
   preferences_flush_the_file();
 }
 
-NVM_API void nvm_sync_lock_api()
+/*
+ * Shares the inventory with the other readers. Readers only wait for a
+ * thread holding it exclusively, g_api_mutex is recursive so the shared
+ * sections nest in each other and in an exclusive section of the same thread.
+ * The first reader of the process shares the lock file with other processes,
+ * without holding g_api_mutex so the other threads are not stalled meanwhile;
+ * the next readers wait for it. Returns NVM_ERR_BUSY_DEVICE, without the
+ * lock, when the lock file is not granted in time.
+ */
+static int api_lock_shared()
 {
-  if (g_api_mutex)
+  BOOLEAN file_locked;
+
+  if (!g_api_mutex || !g_api_readers_cond)
+    return NVM_SUCCESS;
+  os_mutex_lock(g_api_mutex);
+  os_cond_lock(g_api_readers_cond);
+  g_api_readers++;
+  os_mutex_unlock(g_api_mutex);
+  // Nested in an exclusive section, the process already holds the file
+  if (0 != g_api_writer_depth || !g_api_lock_file) {
+    os_cond_unlock(g_api_readers_cond);
+    return NVM_SUCCESS;
+  }
+  while (g_api_file_sharing)
+    os_cond_wait(g_api_readers_cond, -1);
+  if (!g_api_file_shared) {
+    g_api_file_sharing = TRUE;
+    os_cond_unlock(g_api_readers_cond);
+    file_locked = os_file_lock_shared(g_api_lock_file);
+    os_cond_lock(g_api_readers_cond);
+    g_api_file_sharing = FALSE;
+    g_api_file_shared = file_locked;
+    if (!file_locked) {
+      NVDIMM_ERR("Timed out waiting for the NVM API lock file\n");
+      g_api_readers--;
+    }
+    os_cond_broadcast(g_api_readers_cond);
+    if (!file_locked) {
+      os_cond_unlock(g_api_readers_cond);
+      return NVM_ERR_BUSY_DEVICE;
+    }
+  }
+  os_cond_unlock(g_api_readers_cond);
+  return NVM_SUCCESS;
+}
+
+static void api_unlock_shared()
+{
+  if (!g_api_mutex || !g_api_readers_cond)
+    return;
+  os_cond_lock(g_api_readers_cond);
+  if (0 == --g_api_readers) {
+    if (g_api_file_shared) {
+      os_file_unlock(g_api_lock_file);
+      g_api_file_shared = FALSE;
+    }
+    os_cond_broadcast(g_api_readers_cond);
+  }
+  os_cond_unlock(g_api_readers_cond);
+}
+
+/*
+ * Takes the inventory of this process exclusively once the readers are done.
+ * g_api_mutex is released while waiting, so nested shared sections of the
+ * readers complete. Nests in an exclusive section, must not be taken from a
+ * shared one. Enough for the state private to the process, like contexts.
+ */
+static void api_lock_exclusive_local()
+{
+  if (!g_api_mutex || !g_api_readers_cond)
+    return;
+  for (;;) {
     os_mutex_lock(g_api_mutex);
+    os_cond_lock(g_api_readers_cond);
+    if (0 == g_api_readers) {
+      os_cond_unlock(g_api_readers_cond);
+      return;
+    }
+    os_mutex_unlock(g_api_mutex);
+    os_cond_wait(g_api_readers_cond, -1);
+    os_cond_unlock(g_api_readers_cond);
+  }
 }
 
-NVM_API void nvm_sync_unlock_api()
+static void api_unlock_exclusive_local()
 {
   if (g_api_mutex)
     os_mutex_unlock(g_api_mutex);
 }
 
+/*
+ * Takes the inventory exclusively, the outermost section then also waits
+ * for the readers of the other processes. g_api_writer_depth is only used
+ * by the thread owning g_api_mutex. Returns NVM_ERR_BUSY_DEVICE, without
+ * the lock, when the lock file is not granted in time.
+ */
+static int api_lock_exclusive()
+{
+  if (!g_api_mutex || !g_api_readers_cond)
+    return NVM_SUCCESS;
+  api_lock_exclusive_local();
+  if (0 == g_api_writer_depth &&
+      g_api_lock_file && !os_file_lock_exclusive(g_api_lock_file)) {
+    NVDIMM_ERR("Timed out waiting for the NVM API lock file\n");
+    api_unlock_exclusive_local();
+    return NVM_ERR_BUSY_DEVICE;
+  }
+  g_api_writer_depth++;
+  return NVM_SUCCESS;
+}
+
+static void api_unlock_exclusive()
+{
+  if (!g_api_mutex || !g_api_readers_cond)
+    return;
+  if (0 == --g_api_writer_depth)
+    os_file_unlock(g_api_lock_file);
+  api_unlock_exclusive_local();
+}
+
+/*
+ * Drops the cached PCD of every DIMM, unless calls running on other threads
+ * may be reading it. The first call once they are done refreshes it.
+ */
+static void api_clear_pcd_cache()
+{
+  if (!g_api_mutex || !g_api_readers_cond) {
+    ClearPcdCacheOnDimmList();
+    return;
+  }
+  os_mutex_lock(g_api_mutex);
+  os_cond_lock(g_api_readers_cond);
+  if (0 == g_api_readers)
+    ClearPcdCacheOnDimmList();
+  os_cond_unlock(g_api_readers_cond);
+  os_mutex_unlock(g_api_mutex);
+}
+
+/*
+ * Starts a call reading the inventory, or changing it when exclusive.
+ * api_unlock_inventory is only called when it succeeds.
+ */
+static int api_lock_inventory(BOOLEAN exclusive)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init()))
+    return rc;
+  if (exclusive)
+    return api_lock_exclusive();
+  return api_lock_shared();
+}
+
+static void api_unlock_inventory(BOOLEAN exclusive)
+{
+  if (exclusive)
+    api_unlock_exclusive();
+  else
+    api_unlock_shared();
+}
+
+/*
+ * Starts a call on one device: the shared inventory lock, then the API lock
+ * of the DIMM. Sets the DIMM to pass to api_unlock_device, NULL when the
+ * UID is not found, the call then fails its own lookup. api_unlock_device
+ * is only called when it succeeds.
+ */
+static int api_lock_device(const NVM_UID device_uid, DIMM **pp_dimm)
+{
+  UINT16 dimm_id;
+  int rc;
+
+  *pp_dimm = NULL;
+  if (NVM_SUCCESS != (rc = nvm_init()) || NVM_SUCCESS != (rc = api_lock_shared()))
+    return rc;
+  if (NULL != device_uid && NVM_SUCCESS == get_dimm_id(device_uid, &dimm_id, NULL) &&
+      NULL != (*pp_dimm = GetDimmByPid(dimm_id, &gNvmDimmData->PMEMDev.Dimms)) &&
+      NULL != (*pp_dimm)->pApiLock) {
+    os_mutex_lock((*pp_dimm)->pApiLock);
+  }
+  return NVM_SUCCESS;
+}
+
+/*
+ * Same as api_lock_device for a DIMM already resolved to its ID
+ */
+static int api_lock_device_id(UINT16 dimm_id, DIMM **pp_dimm)
+{
+  int rc;
+
+  *pp_dimm = NULL;
+  if (NVM_SUCCESS != (rc = api_lock_shared()))
+    return rc;
+  if (NULL != (*pp_dimm = GetDimmByPid(dimm_id, &gNvmDimmData->PMEMDev.Dimms)) &&
+      NULL != (*pp_dimm)->pApiLock) {
+    os_mutex_lock((*pp_dimm)->pApiLock);
+  }
+  return NVM_SUCCESS;
+}
+
+static void api_unlock_device(DIMM *p_dimm)
+{
+  if (NULL != p_dimm && NULL != p_dimm->pApiLock)
+    os_mutex_unlock(p_dimm->pApiLock);
+  api_unlock_shared();
+}
+
+NVM_API int nvm_sync_lock_api()
+{
+  return api_lock_exclusive();
+}
+
+NVM_API void nvm_sync_unlock_api()
+{
+  api_unlock_exclusive();
+}
+
 struct Command g_cur_command;
 void nvm_current_cmd(struct Command Command)
 {
   g_cur_command = Command;
 }
 
+/*
+ * Serializes a CLI command with the API users, in this or other processes.
+ * The show commands share the inventory, the others hold it exclusively.
+ * nvm_cli_unlock is only called when it succeeds.
+ */
+int nvm_cli_lock(BOOLEAN exclusive)
+{
+  if (exclusive)
+    return api_lock_exclusive();
+  return api_lock_shared();
+}
+
+void nvm_cli_unlock(BOOLEAN exclusive)
+{
+  if (exclusive)
+    api_unlock_exclusive();
+  else
+    api_unlock_shared();
+}
+
 
 
 NVM_API int nvm_run_cli(int argc, char *argv[])
@@ -241,6 +576,8 @@ NVM_API int nvm_run_cli(int argc, char *argv[])
   EFI_STATUS rc;
   int nvm_status;
 
+  startup_profile_init(argc, argv);
+
   rc = init_protocol_shell_parameters_protocol(argc, argv);
   if (rc == EFI_INVALID_PARAMETER) {
     wprintf(L"Syntax Error: Exceeded input parameters limit.\n");
@@ -260,7 +597,12 @@ NVM_API int nvm_run_cli(int argc, char *argv[])
     FREE_POOL_SAFE(ErrStr);
     return nvm_status;
   }
+  // Repeated read-only FW commands within one CLI command are answered once
+  FwResponseCacheBegin(0);
+  startup_profile_begin(StartupPhaseCommand);
   rc = UefiToOsReturnCode(UefiMain(0, NULL));
+  startup_profile_end(StartupPhaseCommand);
+  FwResponseCacheEnd();
 
   nvm_internal_uninit(FALSE);
   return (int)rc;
@@ -492,7 +834,7 @@ NVM_API int nvm_get_number_of_memory_topology_devices(unsigned int *count)
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_memory_topology(struct memory_topology *  p_devices,
+static int get_memory_topology_locked(struct memory_topology *  p_devices,
             const NVM_UINT8   count)
 {
   EFI_STATUS efi_status = EFI_SUCCESS;
@@ -573,6 +915,18 @@ Finish:
   return nvm_status;
 }
 
+NVM_API int nvm_get_memory_topology(struct memory_topology *  p_devices,
+            const NVM_UINT8   count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_memory_topology_locked(p_devices, count);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
 NVM_API int nvm_get_number_of_devices(unsigned int *count)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -604,7 +958,7 @@ Finish:
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_devices(struct device_discovery *p_devices, const NVM_UINT8 count)
+static int get_devices_locked(struct device_discovery *p_devices, const NVM_UINT8 count)
 {
   int nvm_status;
   unsigned int i;
@@ -650,14 +1004,85 @@ NVM_API int nvm_get_devices(struct device_discovery *p_devices, const NVM_UINT8
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_devices_nfit(struct device_discovery *p_devices, const NVM_UINT8 count)
+NVM_API int nvm_get_devices(struct device_discovery *p_devices, const NVM_UINT8 count)
 {
-  int rc = nvm_get_devices(p_devices, count);
+  int rc;
 
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_devices_locked(p_devices, count);
+  api_unlock_inventory(FALSE);
   return rc;
 }
 
-NVM_API int nvm_get_device_discovery(const NVM_UID    device_uid,
+NVM_API int nvm_get_number_of_devices_nfit(unsigned int *count)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT32 dimm_cnt = 0;
+  int nvm_status;
+
+  if (NVM_SUCCESS != (nvm_status = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", nvm_status);
+    return nvm_status;
+  }
+
+  if (NULL == count) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  ReturnCode = GetDimmsFromTables(0, NULL, &dimm_cnt);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
+    return NVM_ERR_UNKNOWN;
+  }
+
+  *count = dimm_cnt;
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_devices_nfit(struct device_discovery *p_devices, const NVM_UINT8 count)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  DIMM_INFO *pdimms = NULL;
+  UINT32 dimm_cnt = 0;
+  int nvm_status;
+  unsigned int i;
+
+  if (NVM_SUCCESS != (nvm_status = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", nvm_status);
+    return nvm_status;
+  }
+
+  if (NULL == p_devices) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  pdimms = (DIMM_INFO *)AllocatePool(sizeof(DIMM_INFO) * count);
+  if (NULL == pdimms && 0 != count) {
+    NVDIMM_ERR("Failed to allocate memory\n");
+    return NVM_ERR_NOT_ENOUGH_FREE_SPACE;
+  }
+
+  // Answered from NFIT and SMBIOS, the DIMM FW is not woken up. Arrays sized
+  // by nvm_get_number_of_devices miss the modules whose FW does not respond,
+  // they get the first count modules.
+  ReturnCode = GetDimmsFromTables(count, pdimms, &dimm_cnt);
+  if (EFI_ERROR(ReturnCode) && EFI_BUFFER_TOO_SMALL != ReturnCode) {
+    NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
+    FREE_POOL_SAFE(pdimms);
+    return NVM_ERR_OPERATION_FAILED;
+  }
+
+  ZeroMem(p_devices, sizeof(*p_devices) * count);
+  for (i = 0; i < dimm_cnt && i < count; ++i)
+    dimm_info_to_device_discovery(&pdimms[i], &p_devices[i]);
+  FREE_POOL_SAFE(pdimms);
+  return NVM_SUCCESS;
+}
+
+static int get_device_discovery_locked(const NVM_UID    device_uid,
              struct device_discovery *  p_discovery)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -690,6 +1115,19 @@ NVM_API int nvm_get_device_discovery(const NVM_UID    device_uid,
   return NVM_SUCCESS;
 }
 
+NVM_API int nvm_get_device_discovery(const NVM_UID    device_uid,
+             struct device_discovery *  p_discovery)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_discovery_locked(device_uid, p_discovery);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 static void dimm_info_to_device_status(DIMM_INFO *p_dimm, struct device_status *p_status)
 {
    //DIMM_INFO_CATEGORY_PACKAGE_SPARING
@@ -736,7 +1174,7 @@ static void dimm_info_to_device_status(DIMM_INFO *p_dimm, struct device_status *
    p_status->injected_non_media_errors = p_dimm->PoisonErrorInjectionsCounter;     // The number of injected non-media errors on DIMM
 }
 
-NVM_API int nvm_get_device_status(const NVM_UID   device_uid,
+static int get_device_status_locked(const NVM_UID   device_uid,
           struct device_status *p_status)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -772,11 +1210,26 @@ NVM_API int nvm_get_device_status(const NVM_UID   device_uid,
   }
   p_status->boot_status = BootstatusBitmask;
   dimm_info_to_device_status(&dimm_info, p_status);
+  // Platform-wide, every DIMM needs to report its SKU
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
   p_status->mixed_sku = gNvmDimmData->PMEMDev.DimmSkuConsistency;
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_pmon_registers(const NVM_UID   device_uid,
+NVM_API int nvm_get_device_status(const NVM_UID   device_uid,
+          struct device_status *p_status)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_status_locked(device_uid, p_status);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_pmon_registers_locked(const NVM_UID   device_uid,
           const NVM_UINT8 SmartDataMask, PMON_REGISTERS *p_output_payload)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -803,7 +1256,20 @@ NVM_API int nvm_get_pmon_registers(const NVM_UID   device_uid,
   }
   return NVM_SUCCESS;
 }
-NVM_API int nvm_set_pmon_registers(const NVM_UID   device_uid,
+
+NVM_API int nvm_get_pmon_registers(const NVM_UID   device_uid,
+          const NVM_UINT8 SmartDataMask, PMON_REGISTERS *p_output_payload)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_pmon_registers_locked(device_uid, SmartDataMask, p_output_payload);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+static int set_pmon_registers_locked(const NVM_UID   device_uid,
           NVM_UINT8 PMONGroupEnable)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -827,14 +1293,45 @@ NVM_API int nvm_set_pmon_registers(const NVM_UID   device_uid,
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_device_settings(const NVM_UID   device_uid,
-            struct device_settings *  p_settings)
+NVM_API int nvm_set_pmon_registers(const NVM_UID   device_uid,
+          NVM_UINT8 PMONGroupEnable)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = set_pmon_registers_locked(device_uid, PMONGroupEnable);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_device_settings(DIMM *pDimm, struct device_settings *p_settings)
 {
   EFI_STATUS ReturnCode;
+  PT_VIRAL_POLICY_PAYLOAD ViralPolicyPayload;
+
+  ReturnCode = FwCmdGetViralPolicy(pDimm, &ViralPolicyPayload);
+  if (ReturnCode == EFI_UNSUPPORTED) {
+    p_settings->viral_policy = 0;
+    p_settings->viral_status = 0;
+  } else {
+    if (EFI_ERROR(ReturnCode)) {
+      return NVM_ERR_UNKNOWN;
+    }
+    p_settings->viral_policy = ViralPolicyPayload.ViralPolicyEnable;
+    p_settings->viral_status = ViralPolicyPayload.ViralStatus;
+  }
+
+  return NVM_SUCCESS;
+}
+
+static int get_device_settings_locked(const NVM_UID   device_uid,
+            struct device_settings *  p_settings)
+{
   DIMM *pDimm = NULL;
   UINT16 dimm_id;
   int rc;
-  PT_VIRAL_POLICY_PAYLOAD ViralPolicyPayload;
   int nvm_status;
 
   if (NVM_SUCCESS != (nvm_status = nvm_init())) {
@@ -857,22 +1354,39 @@ NVM_API int nvm_get_device_settings(const NVM_UID   device_uid,
     return NVM_ERR_UNKNOWN;
   }
 
-  ReturnCode = FwCmdGetViralPolicy(pDimm, &ViralPolicyPayload);
-  if (ReturnCode == EFI_UNSUPPORTED) {
-    p_settings->viral_policy = 0;
-    p_settings->viral_status = 0;
-  } else {
-    if (EFI_ERROR(ReturnCode)) {
-      return NVM_ERR_UNKNOWN;
-    }
-    p_settings->viral_policy = ViralPolicyPayload.ViralPolicyEnable;
-    p_settings->viral_status = ViralPolicyPayload.ViralStatus;
-  }
+  return get_device_settings(pDimm, p_settings);
+}
 
-  return NVM_SUCCESS;
+NVM_API int nvm_get_device_settings(const NVM_UID   device_uid,
+            struct device_settings *  p_settings)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_settings_locked(device_uid, p_settings);
+  api_unlock_device(p_dimm);
+  return rc;
 }
 
-NVM_API int nvm_get_device_details(const NVM_UID    device_uid,
+/*
+ * Fills the SMBIOS Type 17 fields of the details from a DIMM_INFO_CATEGORY_ALL query
+ */
+static void dimm_info_to_device_details(DIMM_INFO *p_dimm, struct device_details *p_details)
+{
+  p_details->form_factor = p_dimm->FormFactor;                                          // The type of DIMM.
+  p_details->data_width = p_dimm->DataWidth;                                            // The width in bits used to store user data.
+  p_details->total_width = p_dimm->TotalWidth;                                          // The width in bits for data and ECC and/or redundancy.
+  p_details->speed = p_dimm->Speed;                                                     // The speed in nanoseconds.
+  os_memcpy(p_details->device_locator, NVM_DEVICE_LOCATOR_LEN, p_dimm->DeviceLocator, NVM_DEVICE_LOCATOR_LEN);     // The socket or board position label
+  os_memcpy(p_details->bank_label, NVM_BANK_LABEL_LEN, p_dimm->BankLabel, sizeof(p_dimm->BankLabel));                 // The bank label
+  p_details->peak_power_budget = p_dimm->PeakPowerBudget.Data;                               // instantaneous power budget in mW (100-20000 mW).
+  p_details->avg_power_budget = p_dimm->AvgPowerLimit.Data;                                 // average power budget in mW (100-18000 mW).
+  p_details->package_sparing_enabled = p_dimm->PackageSparingEnabled;                   // Enable or disable package sparing.
+}
+
+static int get_device_details(const NVM_UID device_uid,
            struct device_details *  p_details)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -899,18 +1413,13 @@ NVM_API int nvm_get_device_details(const NVM_UID    device_uid,
   }
 
   // from SMBIOS Type 17 Table
-  p_details->form_factor = dimm_info.FormFactor;                                          // The type of DIMM.
-  p_details->data_width = dimm_info.DataWidth;                                            // The width in bits used to store user data.
-  p_details->total_width = dimm_info.TotalWidth;                                          // The width in bits for data and ECC and/or redundancy.
-  p_details->speed = dimm_info.Speed;                                                     // The speed in nanoseconds.
-  os_memcpy(p_details->device_locator, NVM_DEVICE_LOCATOR_LEN, dimm_info.DeviceLocator, NVM_DEVICE_LOCATOR_LEN);     // The socket or board position label
-  os_memcpy(p_details->bank_label, NVM_BANK_LABEL_LEN, dimm_info.BankLabel, sizeof(dimm_info.BankLabel));                 // The bank label
-  p_details->peak_power_budget = dimm_info.PeakPowerBudget.Data;                               // instantaneous power budget in mW (100-20000 mW).
-  p_details->avg_power_budget = dimm_info.AvgPowerLimit.Data;                                 // average power budget in mW (100-18000 mW).
-  p_details->package_sparing_enabled = dimm_info.PackageSparingEnabled;                   // Enable or disable package sparing.
+  dimm_info_to_device_details(&dimm_info, p_details);
 
+  ZeroMem(&SystemCapabilitiesInfo, sizeof(SystemCapabilitiesInfo));
   ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
     &SystemCapabilitiesInfo);
+  FREE_HII_POINTER(SystemCapabilitiesInfo.PtrInterleaveFormatsSupported);
+  FREE_HII_POINTER(SystemCapabilitiesInfo.PtrInterleaveSize);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
     return NVM_ERR_UNKNOWN;
@@ -953,39 +1462,49 @@ NVM_API int nvm_get_device_details(const NVM_UID    device_uid,
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_device_performance(const NVM_UID      device_uid,
-               struct device_performance *  p_performance)
+static int get_device_details_locked(const NVM_UID    device_uid,
+           struct device_details *  p_details)
 {
-  NVM_FW_CMD *cmd = NULL;
-  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *pmem_info_output;
-  PT_INPUT_PAYLOAD_MEMORY_INFO mem_info_input;
-  int rc = NVM_ERR_UNKNOWN;
-
-  if (NULL == p_performance) {
-    NVDIMM_ERR("NULL input parameter\n");
-    return NVM_ERR_INVALID_PARAMETER;
-  }
+  int rc;
 
   if (NVM_SUCCESS != (rc = nvm_init())) {
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  // The details are assembled from several getters that send the same
+  // read-only FW commands (identify, SMART, memory info) more than once
+  FwResponseCacheBegin(0);
+  rc = get_device_details(device_uid, p_details);
+  FwResponseCacheEnd();
+  return rc;
+}
+
+NVM_API int nvm_get_device_details(const NVM_UID    device_uid,
+           struct device_details *  p_details)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_details_locked(device_uid, p_details);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_device_performance(UINT16 dimm_id, struct device_performance *p_performance)
+{
+  NVM_FW_CMD *cmd = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE1 *pmem_info_output;
+  PT_INPUT_PAYLOAD_MEMORY_INFO mem_info_input;
+  int rc = NVM_ERR_UNKNOWN;
 
-  if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
+  if (NULL == (cmd = AllocateFwCmd())) {
     NVDIMM_ERR("Failed to allocate memory\n");
     goto finish;
   }
-
-  ZeroMem(cmd, sizeof(NVM_FW_CMD));
   ZeroMem(&mem_info_input, sizeof(mem_info_input));
   mem_info_input.MemoryPage = 1;
-  UINT16 dimm_id;
-  unsigned int dimm_handle;
-
-  if (NVM_SUCCESS != (rc = get_dimm_id((char *)device_uid, &dimm_id, &dimm_handle))) {
-    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
-    goto finish;
-  }
   cmd->DimmID = dimm_id; //PassThruCommand needs the dimm_id (not handle)
   cmd->Opcode = PtGetLog;
   cmd->SubOpcode = SubopMemInfo;
@@ -1006,7 +1525,44 @@ NVM_API int nvm_get_device_performance(const NVM_UID      device_uid,
   }
 
 finish:
-  FREE_POOL_SAFE(cmd);
+  FREE_FW_CMD_SAFE(cmd);
+  return rc;
+}
+
+static int get_device_performance_locked(const NVM_UID      device_uid,
+               struct device_performance *  p_performance)
+{
+  UINT16 dimm_id;
+  int rc = NVM_ERR_UNKNOWN;
+
+  if (NULL == p_performance) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  if (NVM_SUCCESS != (rc = get_dimm_id((char *)device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    return rc;
+  }
+
+  return get_device_performance(dimm_id, p_performance);
+}
+
+NVM_API int nvm_get_device_performance(const NVM_UID      device_uid,
+               struct device_performance *  p_performance)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_performance_locked(device_uid, p_performance);
+  api_unlock_device(p_dimm);
   return rc;
 }
 
@@ -1126,14 +1682,37 @@ enum fw_update_status firmware_update_status_to_enum(unsigned char last_fw_updat
   return fw_update_status;
 }
 
-NVM_API int nvm_get_device_fw_image_info(const NVM_UID    device_uid,
-           struct device_fw_info *p_fw_info)
+static int get_device_fw_image_info(DIMM *pDimm, struct device_fw_info *p_fw_info)
 {
   EFI_STATUS ReturnCode;
+  PT_PAYLOAD_FW_IMAGE_INFO *fw_image_info = NULL;
+
+  ReturnCode = FwCmdGetFirmwareImageInfo(pDimm, &fw_image_info);
+  if (EFI_ERROR(ReturnCode) || (NULL == fw_image_info)) {
+    NVDIMM_ERR("FwCmdGetFirmwareImageInfo failed (%d)\n", ReturnCode);
+    return NVM_ERR_UNKNOWN;
+  }
+
+  FW_VER_ARR_TO_STR(fw_image_info->FwRevision, p_fw_info->active_fw_revision,
+        NVM_VERSION_LEN);
+
+  FW_VER_ARR_TO_STR(fw_image_info->StagedFwRevision, p_fw_info->staged_fw_revision,
+        NVM_VERSION_LEN);
+
+  p_fw_info->FWImageMaxSize = fw_image_info->FWImageMaxSize * 4096; /* convert to bytes from blocks */
+
+  p_fw_info->fw_update_status =
+    firmware_update_status_to_enum(fw_image_info->LastFwUpdateStatus);
+  free(fw_image_info);
+  return NVM_SUCCESS;
+}
+
+static int get_device_fw_image_info_locked(const NVM_UID    device_uid,
+           struct device_fw_info *p_fw_info)
+{
   DIMM *pDimm = NULL;
   UINT16 dimm_id;
   int rc;
-  PT_PAYLOAD_FW_IMAGE_INFO *fw_image_info = NULL;
   int nvm_status;
 
   if (NULL == p_fw_info) {
@@ -1156,27 +1735,23 @@ NVM_API int nvm_get_device_fw_image_info(const NVM_UID    device_uid,
     return NVM_ERR_UNKNOWN;
   }
 
-  ReturnCode = FwCmdGetFirmwareImageInfo(pDimm, &fw_image_info);
-  if (EFI_ERROR(ReturnCode) || (NULL == fw_image_info)) {
-    NVDIMM_ERR("FwCmdGetFirmwareImageInfo failed (%d)\n", ReturnCode);
-    return NVM_ERR_UNKNOWN;
-  }
-
-  FW_VER_ARR_TO_STR(fw_image_info->FwRevision, p_fw_info->active_fw_revision,
-        NVM_VERSION_LEN);
-
-  FW_VER_ARR_TO_STR(fw_image_info->StagedFwRevision, p_fw_info->staged_fw_revision,
-        NVM_VERSION_LEN);
+  return get_device_fw_image_info(pDimm, p_fw_info);
+}
 
-  p_fw_info->FWImageMaxSize = fw_image_info->FWImageMaxSize * 4096; /* convert to bytes from blocks */
+NVM_API int nvm_get_device_fw_image_info(const NVM_UID    device_uid,
+           struct device_fw_info *p_fw_info)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
 
-  p_fw_info->fw_update_status =
-    firmware_update_status_to_enum(fw_image_info->LastFwUpdateStatus);
-  free(fw_image_info);
-  return NVM_SUCCESS;
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_fw_image_info_locked(device_uid, p_fw_info);
+  api_unlock_device(p_dimm);
+  return rc;
 }
 
-NVM_API int nvm_update_device_fw(const NVM_UID device_uid,
+static int update_device_fw_locked(const NVM_UID device_uid,
          const NVM_PATH path, const NVM_SIZE path_len, const NVM_BOOL force)
 {
   int rc = NVM_SUCCESS;
@@ -1218,7 +1793,20 @@ NVM_API int nvm_update_device_fw(const NVM_UID device_uid,
   return NVM_SUCCESS;
 }
 
-NVM_API int nvm_examine_device_fw(const NVM_UID device_uid,
+NVM_API int nvm_update_device_fw(const NVM_UID device_uid,
+         const NVM_PATH path, const NVM_SIZE path_len, const NVM_BOOL force)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = update_device_fw_locked(device_uid, path, path_len, force);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int examine_device_fw_locked(const NVM_UID device_uid,
           const NVM_PATH path, const NVM_SIZE path_len,
           NVM_VERSION image_version, const NVM_SIZE image_version_len)
 {
@@ -1273,6 +1861,20 @@ NVM_API int nvm_examine_device_fw(const NVM_UID device_uid,
   return rc;
 }
 
+NVM_API int nvm_examine_device_fw(const NVM_UID device_uid,
+          const NVM_PATH path, const NVM_SIZE path_len,
+          NVM_VERSION image_version, const NVM_SIZE image_version_len)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = examine_device_fw_locked(device_uid, path, path_len, image_version, image_version_len);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 int driver_features_to_nvm_features(
   const struct driver_feature_flags * p_driver_features,
   struct nvm_features *     p_nvm_features)
@@ -1393,7 +1995,7 @@ NVM_API int nvm_get_nvm_capabilities(struct nvm_capabilities *p_capabilties)
     return NVM_SUCCESS;
 }
 
-NVM_API int nvm_get_nvm_capacities(struct device_capacities *p_capacities)
+static int get_nvm_capacities_locked(struct device_capacities *p_capacities)
 {
   UINT64 RawCapacity;
   UINT64 VolatileCapacity;
@@ -1452,6 +2054,17 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_get_nvm_capacities(struct device_capacities *p_capacities)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_nvm_capacities_locked(p_capacities);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
 static void get_sensor_units(const enum sensor_type type, struct sensor *psensor)
 {
   switch (type) {
@@ -1511,36 +2124,17 @@ int fill_sensor_info(DIMM_SENSOR    DimmSensorsSet[SENSOR_TYPE_COUNT],
   }
 }
 
-NVM_API int nvm_get_sensors(const NVM_UID device_uid, struct sensor *p_sensors,
-          const NVM_UINT16 count)
+static int get_sensors(UINT16 dimm_id, struct sensor *p_sensors)
 {
   EFI_STATUS ReturnCode;
-  UINT16 dimm_id;
   DIMM_SENSOR DimmSensorsSet[SENSOR_TYPE_COUNT];
   int rc = NVM_SUCCESS;
   int i;
 
-  if (NULL == p_sensors) {
-    NVDIMM_ERR("NULL input parameter\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
-    goto Finish;
-  }
-
-  if (NVM_SUCCESS != (rc = nvm_init())) {
-    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    return rc;
-  }
-
-  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
-    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
-    goto Finish;
-  }
-
   ReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, DimmSensorsSet);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(L"Failed to GetSensorsInfo\n");
-    rc = NVM_ERR_UNKNOWN;
-    goto Finish;
+    return NVM_ERR_UNKNOWN;
   }
 
   for (i = 0; i < SENSOR_TYPE_COUNT; ++i) {
@@ -1549,20 +2143,16 @@ NVM_API int nvm_get_sensors(const NVM_UID device_uid, struct sensor *p_sensors,
       rc = NVM_ERR_OPERATION_FAILED;
     }
   }
-
-Finish:
   return rc;
 }
 
-NVM_API int nvm_get_sensor(const NVM_UID device_uid, const enum sensor_type type,
-         struct sensor *p_sensor)
+static int get_sensors_locked(const NVM_UID device_uid, struct sensor *p_sensors,
+          const NVM_UINT16 count)
 {
-  EFI_STATUS EFIReturnCode = EFI_INVALID_PARAMETER;
   UINT16 dimm_id;
-  DIMM_SENSOR DimmSensorsSet[SENSOR_TYPE_COUNT];
   int rc = NVM_SUCCESS;
 
-  if (NULL == p_sensor) {
+  if (NULL == p_sensors) {
     NVDIMM_ERR("NULL input parameter\n");
     rc = NVM_ERR_INVALID_PARAMETER;
     goto Finish;
@@ -1570,7 +2160,7 @@ NVM_API int nvm_get_sensor(const NVM_UID device_uid, const enum sensor_type type
 
   if (NVM_SUCCESS != (rc = nvm_init())) {
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    goto Finish;
+    return rc;
   }
 
   if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
@@ -1578,47 +2168,419 @@ NVM_API int nvm_get_sensor(const NVM_UID device_uid, const enum sensor_type type
     goto Finish;
   }
 
-  EFIReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, DimmSensorsSet);
-  if (EFI_ERROR(EFIReturnCode)) {
-    NVDIMM_ERR_W(L"Failed to GetSensorsInfo\n");
-    rc = NVM_ERR_OPERATION_FAILED;
-    goto Finish;
-  }
-  EFIReturnCode = fill_sensor_info(DimmSensorsSet, p_sensor, type);
-  if (EFI_ERROR(EFIReturnCode)) {
-    NVDIMM_ERR_W(L"Failed to FillSensorsInfo\n");
-    rc = NVM_ERR_OPERATION_FAILED;
-  }
+  rc = get_sensors(dimm_id, p_sensors);
 
 Finish:
   return rc;
 }
 
-NVM_API int nvm_set_sensor_settings(const NVM_UID device_uid,
-            const enum sensor_type type, const struct sensor_settings *p_settings)
+NVM_API int nvm_get_sensors(const NVM_UID device_uid, struct sensor *p_sensors,
+          const NVM_UINT16 count)
 {
-  EFI_STATUS ReturnCode;
-  COMMAND_STATUS *pCommandStatus = NULL;
-  UINT16 dimm_id;
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_sensors_locked(device_uid, p_sensors, count);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+/*
+ * Fills the details of every DIMM from a single DIMM list query. The system
+ * wide parts (capabilities, capacities, SKU consistency) are read once and
+ * the boot status, FW image info, performance, sensors and settings once per
+ * DIMM, instead of once per getter as a nvm_get_device_details loop does.
+ */
+static int get_devices_details(struct device_details *p_details, const NVM_UINT32 count)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  SYSTEM_CAPABILITIES_INFO SystemCapabilitiesInfo;
+  struct device_capacities capacities;
+  DIMM_INFO *pdimms = NULL;
+  DIMM *pDimm = NULL;
+  UINT16 BootstatusBitmask;
+  unsigned int actual_count = 0;
+  unsigned int i;
   int rc = NVM_SUCCESS;
 
-  if (NULL == p_settings) {
-    NVDIMM_ERR("NULL input parameter\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
-    goto Finish;
+  if (NVM_SUCCESS != (rc = nvm_get_number_of_devices(&actual_count))) {
+    NVDIMM_ERR("Failed to obtain the number of devices (%d)\n", rc);
+    return NVM_ERR_OPERATION_FAILED;
+  }
+  if (count != actual_count) {
+    return NVM_ERR_BAD_SIZE;
   }
 
-  if (NVM_SUCCESS != (rc = nvm_init())) {
-    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    goto Finish;
+  ZeroMem(p_details, sizeof(*p_details) * count);
+
+  ZeroMem(&SystemCapabilitiesInfo, sizeof(SystemCapabilitiesInfo));
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
+    &SystemCapabilitiesInfo);
+  FREE_HII_POINTER(SystemCapabilitiesInfo.PtrInterleaveFormatsSupported);
+  FREE_HII_POINTER(SystemCapabilitiesInfo.PtrInterleaveSize);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
+    return NVM_ERR_UNKNOWN;
   }
 
-  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
-    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
-    goto Finish;
+  // Partition information is platform-wide, the same for every DIMM
+  if (NVM_SUCCESS != (rc = nvm_get_nvm_capacities(&capacities))) {
+    return rc;
   }
 
-  ReturnCode = InitializeCommandStatus(&pCommandStatus);
+  pdimms = (DIMM_INFO *)AllocateZeroPool(sizeof(DIMM_INFO) * actual_count);
+  if (NULL == pdimms) {
+    NVDIMM_ERR("Failed to allocate memory\n");
+    return NVM_ERR_NOT_ENOUGH_FREE_SPACE;
+  }
+
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimms(&gNvmDimmDriverNvmDimmConfig, (UINT32)actual_count, DIMM_INFO_CATEGORY_ALL, pdimms);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
+    rc = NVM_ERR_OPERATION_FAILED;
+    goto Finish;
+  }
+
+  // Platform-wide, every DIMM needs to report its SKU
+  HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+
+  for (i = 0; i < actual_count; ++i) {
+    if (NULL == (pDimm = GetDimmByPid(pdimms[i].DimmID, &gNvmDimmData->PMEMDev.Dimms))) {
+      NVDIMM_ERR("Failed to get dimm by Pid (%d)\n", pdimms[i].DimmID);
+      rc = NVM_ERR_DIMM_NOT_FOUND;
+      goto Finish;
+    }
+
+    // Basic device identifying information and SMBIOS Type 17 Table
+    dimm_info_to_device_discovery(&pdimms[i], &p_details[i].discovery);
+    dimm_info_to_device_details(&pdimms[i], &p_details[i]);
+
+    // Device health and status.
+    ReturnCode = gNvmDimmDriverNvmDimmConfig.GetBSRAndBootStatusBitMask(&gNvmDimmDriverNvmDimmConfig, pdimms[i].DimmID, NULL, &BootstatusBitmask);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_ERR("Failed to get boot status %d\n", ReturnCode);
+      p_details[i].status.is_missing = TRUE;
+      rc = NVM_ERR_DIMM_NOT_FOUND;
+      goto Finish;
+    }
+    p_details[i].status.boot_status = BootstatusBitmask;
+    dimm_info_to_device_status(&pdimms[i], &p_details[i].status);
+    p_details[i].status.mixed_sku = gNvmDimmData->PMEMDev.DimmSkuConsistency;
+
+    if (NVM_SUCCESS != (rc = get_device_fw_image_info(pDimm, &p_details[i].fw_info)))
+      goto Finish;
+    if (NVM_SUCCESS != (rc = get_device_performance(pdimms[i].DimmID, &p_details[i].performance)))
+      goto Finish;
+    if (NVM_SUCCESS != (rc = get_sensors(pdimms[i].DimmID, p_details[i].sensors)))
+      goto Finish;
+    p_details[i].capacities = capacities;
+    if (NVM_SUCCESS != (rc = get_device_settings(pDimm, &p_details[i].settings)))
+      goto Finish;
+  }
+
+Finish:
+  FREE_POOL_SAFE(pdimms);
+  return rc;
+}
+
+static int get_devices_details_locked(struct device_details *p_details, const NVM_UINT32 count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NULL == p_details) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  // The DIMM list query and the per DIMM getters share the identify, SMART
+  // and memory info commands
+  FwResponseCacheBegin(0);
+  rc = get_devices_details(p_details, count);
+  FwResponseCacheEnd();
+  return rc;
+}
+
+NVM_API int nvm_get_devices_details(struct device_details *p_details, const NVM_UINT32 count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_devices_details_locked(p_details, count);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
+/*
+ * The device fields read from a DIMM_INFO query, and the categories each
+ * needs on top of the identify data
+ */
+#define DEVICE_FIELDS_FROM_DIMM_INFO (DEVICE_FIELD_DISCOVERY | DEVICE_FIELD_SMBIOS | \
+  DEVICE_FIELD_CONFIG_STATUS | DEVICE_FIELD_HEALTH | DEVICE_FIELD_PACKAGE_SPARING | \
+  DEVICE_FIELD_ARS_STATUS | DEVICE_FIELD_OVERWRITE_STATUS | DEVICE_FIELD_ERROR_INJECTION | \
+  DEVICE_FIELD_POWER_BUDGET)
+
+static UINT16 device_fields_to_dimm_info_categories(const NVM_DEVICE_FIELD_BITMASK fields)
+{
+  UINT16 categories = DIMM_INFO_CATEGORY_NONE;
+
+  if (fields & DEVICE_FIELD_HEALTH)
+    categories |= DIMM_INFO_CATEGORY_SMART_AND_HEALTH;
+  if (fields & DEVICE_FIELD_PACKAGE_SPARING)
+    categories |= DIMM_INFO_CATEGORY_PACKAGE_SPARING;
+  if (fields & DEVICE_FIELD_ARS_STATUS)
+    categories |= DIMM_INFO_CATEGORY_ARS_STATUS;
+  if (fields & DEVICE_FIELD_OVERWRITE_STATUS)
+    categories |= DIMM_INFO_CATEGORY_OVERWRITE_DIMM_STATUS;
+  if (fields & DEVICE_FIELD_ERROR_INJECTION)
+    categories |= DIMM_INFO_CATEGORY_MEM_INFO_PAGE_3;
+  if (fields & DEVICE_FIELD_POWER_BUDGET)
+    categories |= DIMM_INFO_CATEGORY_POWER_MGMT_POLICY;
+  return categories;
+}
+
+/*
+ * Copies the selected fields of a DIMM_INFO query, see dimm_info_to_device_status
+ * and dimm_info_to_device_details for the whole set
+ */
+static void dimm_info_to_device_fields(DIMM_INFO *p_dimm, const NVM_DEVICE_FIELD_BITMASK fields,
+  struct device_details *p_details)
+{
+  struct device_details all_fields;
+
+  ZeroMem(&all_fields, sizeof(all_fields));
+  dimm_info_to_device_status(p_dimm, &all_fields.status);
+  dimm_info_to_device_details(p_dimm, &all_fields);
+
+  if (fields & DEVICE_FIELD_DISCOVERY) {
+    dimm_info_to_device_discovery(p_dimm, &p_details->discovery);
+  }
+  if (fields & DEVICE_FIELD_SMBIOS) {
+    p_details->form_factor = all_fields.form_factor;
+    p_details->data_width = all_fields.data_width;
+    p_details->total_width = all_fields.total_width;
+    p_details->speed = all_fields.speed;
+    os_memcpy(p_details->device_locator, NVM_DEVICE_LOCATOR_LEN, all_fields.device_locator, NVM_DEVICE_LOCATOR_LEN);
+    os_memcpy(p_details->bank_label, NVM_BANK_LABEL_LEN, all_fields.bank_label, NVM_BANK_LABEL_LEN);
+  }
+  if (fields & DEVICE_FIELD_CONFIG_STATUS) {
+    p_details->status.is_new = all_fields.status.is_new;
+    p_details->status.is_configured = all_fields.status.is_configured;
+    p_details->status.sku_violation = all_fields.status.sku_violation;
+    p_details->status.config_status = all_fields.status.config_status;
+  }
+  if (fields & DEVICE_FIELD_HEALTH) {
+    p_details->status.health = all_fields.status.health;
+    p_details->status.last_shutdown_status_details = all_fields.status.last_shutdown_status_details;
+    p_details->status.unlatched_last_shutdown_status_details = all_fields.status.unlatched_last_shutdown_status_details;
+    p_details->status.thermal_throttle_performance_loss_pcnt = all_fields.status.thermal_throttle_performance_loss_pcnt;
+    p_details->status.last_shutdown_time = all_fields.status.last_shutdown_time;
+    p_details->status.ait_dram_enabled = all_fields.status.ait_dram_enabled;
+  }
+  if (fields & DEVICE_FIELD_PACKAGE_SPARING) {
+    p_details->package_sparing_enabled = all_fields.package_sparing_enabled;
+    p_details->status.package_spares_available = all_fields.status.package_spares_available;
+  }
+  if (fields & DEVICE_FIELD_ARS_STATUS) {
+    p_details->status.ars_status = all_fields.status.ars_status;
+  }
+  if (fields & DEVICE_FIELD_OVERWRITE_STATUS) {
+    p_details->status.overwritedimm_status = all_fields.status.overwritedimm_status;
+  }
+  if (fields & DEVICE_FIELD_ERROR_INJECTION) {
+    p_details->status.injected_media_errors = all_fields.status.injected_media_errors;
+    p_details->status.injected_non_media_errors = all_fields.status.injected_non_media_errors;
+  }
+  if (fields & DEVICE_FIELD_POWER_BUDGET) {
+    p_details->peak_power_budget = all_fields.peak_power_budget;
+    p_details->avg_power_budget = all_fields.avg_power_budget;
+  }
+}
+
+static int get_device_fields(const NVM_UID device_uid, const NVM_DEVICE_FIELD_BITMASK fields,
+  struct device_details *p_details)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  DIMM_INFO dimm_info = { 0 };
+  DIMM *pDimm = NULL;
+  UINT16 dimm_id;
+  UINT16 BootstatusBitmask;
+  int rc;
+
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    return NVM_ERR_DIMM_NOT_FOUND;
+  }
+  if (NULL == (pDimm = GetDimmByPid(dimm_id, &gNvmDimmData->PMEMDev.Dimms))) {
+    NVDIMM_ERR("Failed to get dimm by Pid (%d)\n", dimm_id);
+    return NVM_ERR_DIMM_NOT_FOUND;
+  }
+
+  if (fields & DEVICE_FIELDS_FROM_DIMM_INFO) {
+    ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimm(&gNvmDimmDriverNvmDimmConfig, dimm_id,
+      device_fields_to_dimm_info_categories(fields), &dimm_info);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
+      return NVM_ERR_DIMM_NOT_FOUND;
+    }
+    dimm_info_to_device_fields(&dimm_info, fields, p_details);
+  }
+
+  if (fields & DEVICE_FIELD_SENSORS) {
+    if (NVM_SUCCESS != (rc = get_sensors(dimm_id, p_details->sensors)))
+      return rc;
+  }
+  if (fields & DEVICE_FIELD_BOOT_STATUS) {
+    ReturnCode = gNvmDimmDriverNvmDimmConfig.GetBSRAndBootStatusBitMask(&gNvmDimmDriverNvmDimmConfig, dimm_id, NULL, &BootstatusBitmask);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_ERR("Failed to get boot status %d\n", ReturnCode);
+      return NVM_ERR_DIMM_NOT_FOUND;
+    }
+    p_details->status.boot_status = BootstatusBitmask;
+  }
+  if (fields & DEVICE_FIELD_MIXED_SKU) {
+    // Platform-wide, every DIMM needs to report its SKU
+    HydrateDimms(&gNvmDimmData->PMEMDev.Dimms);
+    p_details->status.mixed_sku = gNvmDimmData->PMEMDev.DimmSkuConsistency;
+  }
+  if (fields & DEVICE_FIELD_FW_INFO) {
+    if (NVM_SUCCESS != (rc = get_device_fw_image_info(pDimm, &p_details->fw_info)))
+      return rc;
+  }
+  if (fields & DEVICE_FIELD_PERFORMANCE) {
+    if (NVM_SUCCESS != (rc = get_device_performance(dimm_id, &p_details->performance)))
+      return rc;
+  }
+  if (fields & DEVICE_FIELD_SETTINGS) {
+    if (NVM_SUCCESS != (rc = get_device_settings(pDimm, &p_details->settings)))
+      return rc;
+    p_details->status.viral_state = p_details->settings.viral_status;
+  }
+  if (fields & DEVICE_FIELD_CAPACITIES) {
+    if (NVM_SUCCESS != (rc = nvm_get_nvm_capacities(&p_details->capacities)))
+      return rc;
+  }
+  return NVM_SUCCESS;
+}
+
+static int get_device_fields_locked(const NVM_UID device_uid, const NVM_DEVICE_FIELD_BITMASK fields,
+  struct device_details *p_details)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NULL == p_details || 0 != (fields & ~(NVM_DEVICE_FIELD_BITMASK)DEVICE_FIELD_ALL)) {
+    NVDIMM_ERR("Invalid input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  ZeroMem(p_details, sizeof(*p_details));
+  // The health and sensor fields share the SMART command
+  FwResponseCacheBegin(0);
+  rc = get_device_fields(device_uid, fields, p_details);
+  FwResponseCacheEnd();
+  return rc;
+}
+
+NVM_API int nvm_get_device_fields(const NVM_UID device_uid, const NVM_DEVICE_FIELD_BITMASK fields,
+  struct device_details *p_details)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_device_fields_locked(device_uid, fields, p_details);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_sensor_locked(const NVM_UID device_uid, const enum sensor_type type,
+         struct sensor *p_sensor)
+{
+  EFI_STATUS EFIReturnCode = EFI_INVALID_PARAMETER;
+  UINT16 dimm_id;
+  DIMM_SENSOR DimmSensorsSet[SENSOR_TYPE_COUNT];
+  int rc = NVM_SUCCESS;
+
+  if (NULL == p_sensor) {
+    NVDIMM_ERR("NULL input parameter\n");
+    rc = NVM_ERR_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    goto Finish;
+  }
+
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    goto Finish;
+  }
+
+  EFIReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, DimmSensorsSet);
+  if (EFI_ERROR(EFIReturnCode)) {
+    NVDIMM_ERR_W(L"Failed to GetSensorsInfo\n");
+    rc = NVM_ERR_OPERATION_FAILED;
+    goto Finish;
+  }
+  EFIReturnCode = fill_sensor_info(DimmSensorsSet, p_sensor, type);
+  if (EFI_ERROR(EFIReturnCode)) {
+    NVDIMM_ERR_W(L"Failed to FillSensorsInfo\n");
+    rc = NVM_ERR_OPERATION_FAILED;
+  }
+
+Finish:
+  return rc;
+}
+
+NVM_API int nvm_get_sensor(const NVM_UID device_uid, const enum sensor_type type,
+         struct sensor *p_sensor)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_sensor_locked(device_uid, type, p_sensor);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int set_sensor_settings_locked(const NVM_UID device_uid,
+            const enum sensor_type type, const struct sensor_settings *p_settings)
+{
+  EFI_STATUS ReturnCode;
+  COMMAND_STATUS *pCommandStatus = NULL;
+  UINT16 dimm_id;
+  int rc = NVM_SUCCESS;
+
+  if (NULL == p_settings) {
+    NVDIMM_ERR("NULL input parameter\n");
+    rc = NVM_ERR_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    goto Finish;
+  }
+
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    goto Finish;
+  }
+
+  ReturnCode = InitializeCommandStatus(&pCommandStatus);
   if (EFI_ERROR(ReturnCode)) {
     rc = NVM_ERR_OPERATION_FAILED;
     goto Finish;
@@ -1641,12 +2603,25 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_set_sensor_settings(const NVM_UID device_uid,
+            const enum sensor_type type, const struct sensor_settings *p_settings)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = set_sensor_settings_locked(device_uid, type, p_settings);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 NVM_API int nvm_get_number_of_regions( NVM_UINT8 *count)
 {
 	return nvm_get_number_of_regions_ex(FALSE, count);
 }
 
-NVM_API int nvm_get_number_of_regions_ex(const NVM_BOOL use_nfit, NVM_UINT8 *count)
+static int get_number_of_regions_ex_locked(const NVM_BOOL use_nfit, NVM_UINT8 *count)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   COMMAND_STATUS *pCommandStatus = NULL;
@@ -1682,11 +2657,22 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_get_number_of_regions_ex(const NVM_BOOL use_nfit, NVM_UINT8 *count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_number_of_regions_ex_locked(use_nfit, count);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
 NVM_API int nvm_get_regions( struct region *p_regions, NVM_UINT8 *count) {
 	return nvm_get_regions_ex(FALSE, p_regions, count);
 }
 
-NVM_API int nvm_get_regions_ex(const NVM_BOOL use_nfit, struct region *p_regions, NVM_UINT8 *count)
+static int get_regions_ex_locked(const NVM_BOOL use_nfit, struct region *p_regions, NVM_UINT8 *count)
 {
   COMMAND_STATUS *pCommandStatus = NULL;
   NVM_UINT8 RegionCount, Index, DimmIndex;
@@ -1707,7 +2693,7 @@ NVM_API int nvm_get_regions_ex(const NVM_BOOL use_nfit, struct region *p_regions
   if (EFI_ERROR(erc))
     return NVM_ERR_UNKNOWN;
 
-  if (NVM_SUCCESS != (rc = nvm_get_number_of_regions_ex(use_nfit, &RegionCount))) {
+  if (NVM_SUCCESS != (rc = get_number_of_regions_ex_locked(use_nfit, &RegionCount))) {
     FreeCommandStatus(&pCommandStatus);
     return rc;
   }
@@ -1749,7 +2735,18 @@ Finish:
   return rc;
 }
 
-NVM_API int nvm_create_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
+NVM_API int nvm_get_regions_ex(const NVM_BOOL use_nfit, struct region *p_regions, NVM_UINT8 *count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_regions_ex_locked(use_nfit, p_regions, count);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
+static int create_config_goal_locked(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
            struct config_goal_input *p_goal_input)
 {
   COMMAND_STATUS *pCommandStatus = NULL;
@@ -1808,7 +2805,19 @@ Finish:
   return rc;
 }
 
-NVM_API int nvm_get_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
+NVM_API int nvm_create_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
+           struct config_goal_input *p_goal_input)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(TRUE)))
+    return rc;
+  rc = create_config_goal_locked(p_device_uids, device_uids_count, p_goal_input);
+  api_unlock_inventory(TRUE);
+  return rc;
+}
+
+static int get_config_goal_locked(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
         struct config_goal *p_goal)
 {
   COMMAND_STATUS *pCommandStatus = NULL;
@@ -1901,7 +2910,19 @@ Finish:
   return rc;
 }
 
-NVM_API int nvm_delete_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count)
+NVM_API int nvm_get_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count,
+        struct config_goal *p_goal)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_config_goal_locked(p_device_uids, device_uids_count, p_goal);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
+static int delete_config_goal_locked(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count)
 {
   COMMAND_STATUS *pCommandStatus = NULL;
   UINT16 *p_dimm_ids = NULL;
@@ -1951,6 +2972,17 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_delete_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uids_count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(TRUE)))
+    return rc;
+  rc = delete_config_goal_locked(p_device_uids, device_uids_count);
+  api_unlock_inventory(TRUE);
+  return rc;
+}
+
 
 
 NVM_API int nvm_dump_goal_config(const NVM_PATH file,
@@ -1986,7 +3018,7 @@ NVM_API int nvm_dump_goal_config(const NVM_PATH file,
 }
 
 
-NVM_API int nvm_load_goal_config(const NVM_PATH file,
+static int load_goal_config_locked(const NVM_PATH file,
          const NVM_SIZE file_len)
 {
   int rc = NVM_SUCCESS;
@@ -2080,6 +3112,18 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_load_goal_config(const NVM_PATH file,
+         const NVM_SIZE file_len)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(TRUE)))
+    return rc;
+  rc = load_goal_config_locked(file, file_len);
+  api_unlock_inventory(TRUE);
+  return rc;
+}
+
 void get_version_numbers(int *major, int *minor, int *hotfix, int *build)
 {
   int first = 0;
@@ -2162,7 +3206,7 @@ EFI_STATUS execute_cli_cmd(wchar_t * CmdLine)
   return ReturnCode;
 }
 
-NVM_API int nvm_gather_support(const NVM_PATH support_file, const NVM_SIZE support_file_len)
+static int gather_support_locked(const NVM_PATH support_file, const NVM_SIZE support_file_len)
 {
   int rc = NVM_SUCCESS;
   unsigned int Index;
@@ -2203,8 +3247,19 @@ NVM_API int nvm_gather_support(const NVM_PATH support_file, const NVM_SIZE suppo
   return NVM_SUCCESS;
 }
 
+NVM_API int nvm_gather_support(const NVM_PATH support_file, const NVM_SIZE support_file_len)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(TRUE)))
+    return rc;
+  rc = gather_support_locked(support_file, support_file_len);
+  api_unlock_inventory(TRUE);
+  return rc;
+}
+
 
-NVM_API int nvm_inject_device_error(const NVM_UID		device_uid,
+static int inject_device_error_locked(const NVM_UID		device_uid,
             const struct device_error * p_error)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -2243,7 +3298,20 @@ Finish:
   return rc;
 }
 
-NVM_API int nvm_clear_injected_device_error(const NVM_UID device_uid,
+NVM_API int nvm_inject_device_error(const NVM_UID		device_uid,
+            const struct device_error * p_error)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = inject_device_error_locked(device_uid, p_error);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int clear_injected_device_error_locked(const NVM_UID device_uid,
               const struct device_error *p_error)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -2282,7 +3350,20 @@ Finish:
   return rc;
 }
 
-NVM_API int nvm_run_diagnostic(const NVM_UID device_uid,
+NVM_API int nvm_clear_injected_device_error(const NVM_UID device_uid,
+              const struct device_error *p_error)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = clear_injected_device_error_locked(device_uid, p_error);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int run_diagnostic_locked(const NVM_UID device_uid,
              const struct diagnostic *p_diagnostic, NVM_UINT32 *p_results)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -2347,6 +3428,19 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_run_diagnostic(const NVM_UID device_uid,
+             const struct diagnostic *p_diagnostic, NVM_UINT32 *p_results)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = run_diagnostic_locked(device_uid, p_diagnostic, p_results);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 NVM_API int nvm_set_user_preference(const NVM_PREFERENCE_KEY  key,
             const NVM_PREFERENCE_VALUE  value)
 {
@@ -2387,6 +3481,18 @@ NVM_API int nvm_set_user_preference(const NVM_PREFERENCE_KEY  key,
   return NVM_SUCCESS;
 }
 
+NVM_API int nvm_set_dispatch_workers(const NVM_UINT32 workers)
+{
+  SetDispatchMaxWorkersOverride(workers);
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_set_nfit_index(const NVM_BOOL enabled)
+{
+  SetNfitIndexEnabled(enabled ? TRUE : FALSE);
+  return NVM_SUCCESS;
+}
+
 /*
  * Function enables disables the debug logger
  */
@@ -2418,7 +3524,7 @@ NVM_API int nvm_toggle_debug_logging(const NVM_BOOL enabled)
   return DebugLoggerEnable(enabled);
 }
 
-NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
+static int get_jobs_locked(struct job *p_jobs, const NVM_UINT32 count)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   int rc = NVM_SUCCESS;
@@ -2451,19 +3557,17 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
     return NVM_ERR_BAD_SIZE;
   }
 
-  if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
+  if (NULL == (cmd = AllocateFwCmd())) {
     NVDIMM_ERR("Failed to allocate memory\n");
     return NVM_ERR_NOT_ENOUGH_FREE_SPACE;
   }
-
-  ZeroMem(cmd, sizeof(NVM_FW_CMD));
   pLongOpStatus = (PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS *)cmd->OutPayload;
   // Populate the list of DIMM_INFO structures with relevant information
   CmdStub.pPrintCtx = NULL;
   ReturnCode = GetDimmList(&gNvmDimmDriverNvmDimmConfig, &CmdStub, DIMM_INFO_CATEGORY_NONE, &pDimms, &DimmCount);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR("Failed to get dimm list %d\n", (int)ReturnCode);
-    FreePool(cmd);
+    FreeFwCmd(cmd);
     return NVM_ERR_OPERATION_FAILED;
   }
 
@@ -2518,21 +3622,79 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
     p_jobs[i].result = NULL;
     job_index++;
   }
-  FreePool(cmd);
+  FreeFwCmd(cmd);
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = api_lock_inventory(FALSE)))
+    return rc;
+  rc = get_jobs_locked(p_jobs, count);
+  api_unlock_inventory(FALSE);
+  return rc;
+}
+
+static int create_context_locked()
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  // The DIMM list, table indices and initialized DIMMs already live as long
+  // as the library, the context also keeps the PCD cache and the read-only
+  // FW responses until it is freed. Sensor and log responses still expire
+  // after FW_RESPONSE_CACHE_VOLATILE_TTL_MS.
+  FwResponseCacheBegin(0);
+  g_context_depth++;
   return NVM_SUCCESS;
 }
 
 NVM_API int nvm_create_context()
 {
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init()))
+    return rc;
+  api_lock_exclusive_local();
+  rc = create_context_locked();
+  api_unlock_exclusive_local();
+  return rc;
+}
+
+static int free_context_locked(const NVM_BOOL force)
+{
+  if (g_context_depth == 0) {
+    return NVM_SUCCESS;
+  }
+
+  do {
+    FwResponseCacheEnd();
+    g_context_depth--;
+  } while (force && g_context_depth > 0);
+
+  if (g_context_depth == 0) {
+    ClearPcdCacheOnDimmList();
+  }
   return NVM_SUCCESS;
 }
 
 NVM_API int nvm_free_context(const NVM_BOOL force)
 {
-  return NVM_SUCCESS;
+  int rc;
+
+  api_lock_exclusive_local();
+  rc = free_context_locked(force);
+  api_unlock_exclusive_local();
+  return rc;
 }
 
-NVM_API int nvm_get_fw_error_log_entry_cmd(
+static int get_fw_error_log_entry_cmd_locked(
   const NVM_UID   device_uid,
   const unsigned short  seq_num,
   const unsigned char log_level,
@@ -2606,6 +3768,23 @@ Finish:
   return rc;
 }
 
+NVM_API int nvm_get_fw_error_log_entry_cmd(
+  const NVM_UID   device_uid,
+  const unsigned short  seq_num,
+  const unsigned char log_level,
+  const unsigned char log_type,
+  ERROR_LOG * error_entry)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_fw_error_log_entry_cmd_locked(device_uid, seq_num, log_level, log_type, error_entry);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 NVM_API int nvm_get_config_int(const char *param_name, int default_val)
 {
   int val = default_val;
@@ -2621,7 +3800,7 @@ NVM_API int nvm_get_config_int(const char *param_name, int default_val)
   return val;
 }
 
-NVM_API int nvm_get_fw_err_log_stats(const NVM_UID      device_uid,
+static int get_fw_err_log_stats_locked(const NVM_UID      device_uid,
              struct device_error_log_status * error_log_stats)
 {
   UINT16 dimm_id;
@@ -2671,6 +3850,19 @@ NVM_API int nvm_get_fw_err_log_stats(const NVM_UID      device_uid,
   return rc;
 }
 
+NVM_API int nvm_get_fw_err_log_stats(const NVM_UID      device_uid,
+             struct device_error_log_status * error_log_stats)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_fw_err_log_stats_locked(device_uid, error_log_stats);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
 NVM_API int nvm_get_dimm_id(const NVM_UID device_uid,
           unsigned int *  dimm_id,
           unsigned int *  dimm_handle)
@@ -2689,42 +3881,28 @@ int get_dimm_id(const char *uid, UINT16 *dimm_id, unsigned int *dimm_handle)
 {
   EFI_STATUS rc;
   CHAR16 uid_wide[MAX_DIMM_UID_LENGTH];
-  unsigned int i;
-
-  if (NULL == g_dimms) {
-    if (NVM_SUCCESS != nvm_get_number_of_devices(&g_dimm_cnt)) {
-      NVDIMM_ERR("Failed to get number of devices\n");
-      return NVM_ERR_UNKNOWN;
-    }
-
-    g_dimms = (DIMM_INFO *)AllocatePool(sizeof(DIMM_INFO) * g_dimm_cnt);
-    if (NULL == g_dimms) {
-      NVDIMM_ERR("Failed to allocate memory\n");
-      return NVM_ERR_UNKNOWN;
-    }
-
-    rc = gNvmDimmDriverNvmDimmConfig.GetDimms(&gNvmDimmDriverNvmDimmConfig, (UINT32)g_dimm_cnt, DIMM_INFO_CATEGORY_NONE, g_dimms);
-    if (EFI_ERROR(rc)) {
-      FreePool(g_dimms);
-      g_dimms = NULL;
-      NVDIMM_ERR("GetDimms failed (%d)\n", rc);
-      return NVM_ERR_UNKNOWN;
-    }
-  }
+  LIST_ENTRY *p_dimms = &gNvmDimmData->PMEMDev.Dimms;
+  DIMM *p_dimm = NULL;
 
   rc = AsciiStrToUnicodeStrS(uid, uid_wide, MAX_DIMM_UID_LENGTH);
   if (EFI_ERROR(rc)) {
     NVDIMM_ERR("Failed while converting uid (%s) to UniCode. (%d)\n", uid, rc);
     return NVM_ERR_UNKNOWN;
   }
-  for (i = 0; i < g_dimm_cnt; ++i) {
-    if (0 == StrCmp(uid_wide, g_dimms[i].DimmUid)) {
-      if (dimm_id)
-        *dimm_id = g_dimms[i].DimmID;
-      if (dimm_handle)
-        *dimm_handle = g_dimms[i].DimmHandle;
-      return NVM_SUCCESS;
+  // The UID comes from NFIT, only the matching DIMM needs to be initialized
+  // from FW to tell if it is functional (GetDimms skips the others). It is
+  // looked up in the DIMM registry rather than formatting every DIMM UID.
+  for (p_dimm = GetNextDimmByUid(p_dimms, uid_wide, NULL); p_dimm != NULL;
+       p_dimm = GetNextDimmByUid(p_dimms, uid_wide, p_dimm)) {
+    HydrateDimm(p_dimm);
+    if (p_dimm->NonFunctional) {
+      continue;
     }
+    if (dimm_id)
+      *dimm_id = p_dimm->DimmID;
+    if (dimm_handle)
+      *dimm_handle = p_dimm->DeviceHandle.AsUint32;
+    return NVM_SUCCESS;
   }
   return NVM_ERR_UNKNOWN;
 }
@@ -2780,11 +3958,10 @@ int get_fw_err_log_stats(
   NVM_FW_CMD *cmd;
   PT_INPUT_PAYLOAD_GET_ERROR_LOG get_error_log_input;
 
-  if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
+  if (NULL == (cmd = AllocateFwCmd())) {
     NVDIMM_ERR("Failed to allocate memory\n");
     goto finish;
   }
-  ZeroMem(cmd, sizeof(NVM_FW_CMD));
   ZeroMem(&get_error_log_input, sizeof(get_error_log_input));
   get_error_log_input.SequenceNumber = 0;
   get_error_log_input.LogParameters.Separated.LogInfo = 1;
@@ -2804,53 +3981,36 @@ int get_fw_err_log_stats(
   }
 finish:
   if (cmd)
-    FreePool(cmd);
+    FreeFwCmd(cmd);
   return rc;
 }
 
-NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
-              struct device_pt_cmd *  p_cmd)
+/*
+ * Check the payload sizes of a pass-through command against the mailbox limits
+ */
+static int pt_cmd_check_sizes(struct device_pt_cmd *p_cmd)
 {
-  NVM_FW_CMD *cmd = NULL;
-  UINT16 dimm_id;
-  unsigned int dimm_handle;
-  int rc = NVM_ERR_UNKNOWN;
-
   if (p_cmd->input_payload_size > MAX_IN_PAYLOAD_SIZE ||
     p_cmd->large_input_payload_size > MAX_IN_MB_SIZE)
   {
     NVDIMM_ERR("Invalid input payload size(s)\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
-    goto finish;
-
+    return NVM_ERR_INVALID_PARAMETER;
   }
 
   if (p_cmd->output_payload_size > MAX_OUT_PAYLOAD_SIZE ||
     p_cmd->large_output_payload_size > MAX_OUT_MB_SIZE)
   {
     NVDIMM_ERR("Invalid output payload size(s)\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
-    goto finish;
-
-  }
-
-  if (NVM_SUCCESS != (rc = nvm_init())) {
-    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    return rc;
-  }
-
-  if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
-    NVDIMM_ERR("Failed to allocate memory\n");
-    goto finish;
-  }
-
-  ZeroMem(cmd, sizeof(NVM_FW_CMD));
-
-  if (NVM_SUCCESS != (rc = get_dimm_id((char *)device_uid, &dimm_id, &dimm_handle))) {
-    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
-    goto finish;
+    return NVM_ERR_INVALID_PARAMETER;
   }
+  return NVM_SUCCESS;
+}
 
+/*
+ * Fill in a FW command from a pass-through command
+ */
+static void pt_cmd_to_fw_cmd(struct device_pt_cmd *p_cmd, UINT16 dimm_id, NVM_FW_CMD *cmd)
+{
   cmd->DimmID = dimm_id; //PassThruCommand needs the dimm_id (not handle)
   cmd->Opcode = p_cmd->opcode;
   cmd->SubOpcode = p_cmd->sub_opcode;
@@ -2860,26 +4020,20 @@ NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
   cmd->LargeInputPayloadSize = p_cmd->large_input_payload_size;
   cmd->LargeOutputPayloadSize = p_cmd->large_output_payload_size;
   CopyMem_S(cmd->LargeInputPayload, sizeof(cmd->LargeInputPayload), p_cmd->large_input_payload, cmd->LargeInputPayloadSize);
+}
 
-  if (EFI_SUCCESS != PassThruCommand(cmd, PT_TIMEOUT_INTERVAL))
-  {
-    NVDIMM_ERR("Passthru command failed\n");
-    goto finish;
-  }
-  else
-  {
-    NVDIMM_DBG("Passthru command executed successfully\n");
-    rc = NVM_SUCCESS;
-  }
-
+/*
+ * Copy the output of a completed FW command back into a pass-through command
+ */
+static int fw_cmd_to_pt_cmd(NVM_FW_CMD *cmd, struct device_pt_cmd *p_cmd)
+{
   if (cmd->LargeOutputPayloadSize)
   {
     if(p_cmd->large_output_payload_size < cmd->LargeOutputPayloadSize)
     {
       p_cmd->large_output_payload_size = 0; //indicate to caller that nothing was copied into their large output payload buffer
       NVDIMM_ERR("Not enough memory to copy the large output payload\n");
-      rc = NVM_ERR_INVALID_PARAMETER;
-      goto finish;
+      return NVM_ERR_INVALID_PARAMETER;
     }
     CopyMem_S(p_cmd->large_output_payload, p_cmd->large_output_payload_size, cmd->LargeOutputPayload, cmd->LargeOutputPayloadSize);
     p_cmd->large_output_payload_size = cmd->LargeOutputPayloadSize;
@@ -2890,125 +4044,792 @@ NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
     {
       p_cmd->output_payload_size = 0; //indicate to caller that nothing was copied into their output payload buffer
       NVDIMM_ERR("Not enough memory to copy the output payload\n");
-      rc = NVM_ERR_INVALID_PARAMETER;
-      goto finish;
+      return NVM_ERR_INVALID_PARAMETER;
     }
     CopyMem_S(p_cmd->output_payload, p_cmd->output_payload_size, cmd->OutPayload, cmd->OutputPayloadSize);
     p_cmd->output_payload_size = cmd->OutputPayloadSize;
   }
-finish:
-  FREE_POOL_SAFE(cmd);
-  return rc;
+  return NVM_SUCCESS;
 }
 
-static int nvm_get_command_effect_log_helper(const NVM_UID device_uid,
-  NVM_UINT32 *p_cel_count,
-  struct command_effect_log **pp_cel)
+static int send_device_passthrough_cmd_locked(const NVM_UID   device_uid,
+              struct device_pt_cmd *  p_cmd)
 {
+  NVM_FW_CMD *cmd = NULL;
   UINT16 dimm_id;
-  int rc = NVM_SUCCESS;
-  EFI_STATUS ReturnCode = EFI_SUCCESS;
-
-
-  if (NULL == pp_cel || NULL == p_cel_count) {
-    NVDIMM_ERR("NULL input parameter\n");
-    return NVM_ERR_INVALID_PARAMETER;
-  }
-
-  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
-    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
-    return NVM_ERR_UNKNOWN;
-  }
-
-  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetCommandEffectLog(&gNvmDimmDriverNvmDimmConfig, dimm_id, (COMMAND_EFFECT_LOG_ENTRY **)pp_cel, p_cel_count);
-  if (EFI_ERROR(ReturnCode)) {
-    return NVM_ERR_OPERATION_FAILED;
-  }
-
-  if (0 == *p_cel_count) {
-    rc = NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY;
-  }
-  return rc;
-}
-
-NVM_API int nvm_get_number_of_command_effect_log_entries(const NVM_UID device_uid,
-  NVM_UINT32 *p_count)
-{
-  int rc = NVM_SUCCESS;
-  struct command_effect_log *p_cel = NULL;
+  unsigned int dimm_handle;
+  int rc = NVM_ERR_UNKNOWN;
 
-  if (p_count == NULL)
+  if (NVM_SUCCESS != (rc = pt_cmd_check_sizes(p_cmd)))
   {
-    NVDIMM_ERR("NULL input parameter\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
     goto finish;
   }
 
   if (NVM_SUCCESS != (rc = nvm_init())) {
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    goto finish;
+    return rc;
   }
 
-  rc = nvm_get_command_effect_log_helper(device_uid, p_count, &p_cel);
-
-  if (NVM_SUCCESS != rc && NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY != rc) {
-    NVDIMM_ERR("Failed to get number of command effect log entries %d\n", rc);
+  if (NULL == (cmd = AllocateFwCmd())) {
+    NVDIMM_ERR("Failed to allocate memory\n");
     goto finish;
   }
 
-finish:
-  FREE_POOL_SAFE(p_cel);
-  return rc;
-}
-
-NVM_API int nvm_get_command_effect_log(const NVM_UID device_uid,
-  struct command_effect_log *p_cel,
-  const NVM_UINT32 count)
-{
-  int rc = NVM_SUCCESS;
-  NVM_UINT32 actual_count = 0;
-  struct command_effect_log *p_cel_local = NULL;
-  NVM_UINT32 cel_size = 0;
-
-  if (NULL == p_cel) {
-    NVDIMM_ERR("NULL input parameter\n");
-    rc = NVM_ERR_INVALID_PARAMETER;
+  if (NVM_SUCCESS != (rc = get_dimm_id((char *)device_uid, &dimm_id, &dimm_handle))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     goto finish;
   }
 
-  if (NVM_SUCCESS != (rc = nvm_init())) {
-    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
-    goto finish;
-  }
+  pt_cmd_to_fw_cmd(p_cmd, dimm_id, cmd);
 
-  rc = nvm_get_command_effect_log_helper(device_uid, &actual_count, &p_cel_local);
-  if (NVM_SUCCESS != rc && NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY != rc) {
-    NVDIMM_ERR("Failed to get number of command effect log entries %d\n", rc);
+  if (EFI_SUCCESS != PassThruCommand(cmd, PT_TIMEOUT_INTERVAL))
+  {
+    NVDIMM_ERR("Passthru command failed\n");
     goto finish;
   }
-
-  if (actual_count != count)
+  else
   {
-    rc = NVM_ERR_BAD_SIZE;
-    goto finish;
+    NVDIMM_DBG("Passthru command executed successfully\n");
+    rc = NVM_SUCCESS;
   }
 
-  cel_size = actual_count * sizeof(struct command_effect_log);
-  CopyMem_S(p_cel, cel_size, p_cel_local, cel_size);
-
+  rc = fw_cmd_to_pt_cmd(cmd, p_cmd);
 finish:
-  FREE_POOL_SAFE(p_cel_local);
+  FREE_FW_CMD_SAFE(cmd);
   return rc;
 }
 
-NVM_API int nvm_get_command_access_policy(const NVM_UID device_uid,
-          NVM_UINT32 *p_cap_count,
-          struct command_access_policy *p_cap)
+NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
+              struct device_pt_cmd *  p_cmd)
 {
-  UINT16 dimm_id;
-  int rc = NVM_SUCCESS;
-  EFI_STATUS ReturnCode = EFI_SUCCESS;
-  UINT32 cap_count, index;
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = send_device_passthrough_cmd_locked(device_uid, p_cmd);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+/*
+ * Asynchronous pass-through commands. Submitted commands wait in a fixed
+ * table of slots and are run through the regular PassThruCommand path by a
+ * small set of worker threads. A worker only takes a command whose DIMM has
+ * nothing else running, so each DIMM sees its commands in submission order
+ * and no worker sits blocked behind another worker's DIMM.
+ */
+#define PT_ASYNC_MAX_OUTSTANDING  256
+#define PT_ASYNC_MAX_WORKERS      MAX_DIMMS
+
+enum pt_async_state
+{
+  PT_ASYNC_FREE = 0,
+  PT_ASYNC_QUEUED,
+  PT_ASYNC_RUNNING,
+  PT_ASYNC_DONE
+};
+
+struct pt_async_slot
+{
+  NVM_PT_TICKET ticket;
+  enum pt_async_state state;
+  UINT16 dimm_id;
+  struct device_pt_cmd *p_cmd;
+  NVM_FW_CMD *p_fw_cmd;
+  int rc;
+};
+
+static struct pt_async_slot g_pt_async_slots[PT_ASYNC_MAX_OUTSTANDING];
+static OS_THREAD *g_pt_async_workers[PT_ASYNC_MAX_WORKERS];
+static unsigned int g_pt_async_worker_cnt = 0;
+static unsigned int g_pt_async_idle_cnt = 0;
+static NVM_PT_TICKET g_pt_async_next_ticket = 1;
+static int g_pt_async_shutdown = 0;
+static int g_pt_async_event_fd = -1;
+static OS_COND *g_pt_async_cond = NULL;
+
+/*
+ * Find the oldest queued command whose DIMM is idle. Caller holds the lock.
+ */
+static struct pt_async_slot *pt_async_next_runnable()
+{
+  struct pt_async_slot *p_next = NULL;
+  unsigned int i, j;
+
+  for (i = 0; i < PT_ASYNC_MAX_OUTSTANDING; i++)
+  {
+    struct pt_async_slot *p_slot = &g_pt_async_slots[i];
+    if (p_slot->state != PT_ASYNC_QUEUED ||
+      (p_next && p_next->ticket < p_slot->ticket))
+    {
+      continue;
+    }
+
+    for (j = 0; j < PT_ASYNC_MAX_OUTSTANDING; j++)
+    {
+      struct pt_async_slot *p_other = &g_pt_async_slots[j];
+      if (p_other->dimm_id == p_slot->dimm_id &&
+        ((p_other->state == PT_ASYNC_RUNNING) ||
+         (p_other->state == PT_ASYNC_QUEUED && p_other->ticket < p_slot->ticket)))
+      {
+        break;
+      }
+    }
+    if (j == PT_ASYNC_MAX_OUTSTANDING)
+    {
+      p_next = p_slot;
+    }
+  }
+  return p_next;
+}
+
+static void *pt_async_worker(void *p_arg)
+{
+  struct pt_async_slot *p_slot;
+  DIMM *p_dimm;
+  int rc;
+
+  os_cond_lock(g_pt_async_cond);
+  while (!g_pt_async_shutdown)
+  {
+    if (NULL == (p_slot = pt_async_next_runnable()))
+    {
+      g_pt_async_idle_cnt++;
+      os_cond_wait(g_pt_async_cond, -1);
+      g_pt_async_idle_cnt--;
+      continue;
+    }
+
+    p_slot->state = PT_ASYNC_RUNNING;
+    os_cond_unlock(g_pt_async_cond);
+
+    // Same locks as nvm_send_device_passthrough_cmd, so the command does not
+    // overlap an exclusive call or another call on the DIMM
+    if (NVM_SUCCESS != (rc = api_lock_device_id(p_slot->dimm_id, &p_dimm)))
+    {
+      NVDIMM_ERR("Failed to lock dimm %d\n", p_slot->dimm_id);
+    }
+    else
+    {
+      if (NULL == p_dimm)
+      {
+        NVDIMM_ERR("Failed to find dimm %d\n", p_slot->dimm_id);
+        rc = NVM_ERR_BAD_DEVICE;
+      }
+      else if (EFI_SUCCESS != PassThruCommand(p_slot->p_fw_cmd, PT_TIMEOUT_INTERVAL))
+      {
+        NVDIMM_ERR("Passthru command failed\n");
+        rc = NVM_ERR_UNKNOWN;
+      }
+      else
+      {
+        rc = fw_cmd_to_pt_cmd(p_slot->p_fw_cmd, p_slot->p_cmd);
+      }
+      api_unlock_device(p_dimm);
+    }
+    p_slot->p_cmd->result = rc;
+
+    os_cond_lock(g_pt_async_cond);
+    p_slot->rc = rc;
+    p_slot->state = PT_ASYNC_DONE;
+    FREE_FW_CMD_SAFE(p_slot->p_fw_cmd);
+    // wakes waiters, and idle workers that may now run the DIMM's next command
+    os_cond_broadcast(g_pt_async_cond);
+    os_event_fd_signal(g_pt_async_event_fd);
+  }
+  os_cond_unlock(g_pt_async_cond);
+  return NULL;
+}
+
+/*
+ * Create the async state on first use
+ */
+static int pt_async_init()
+{
+  int rc = NVM_SUCCESS;
+
+  if (g_pt_async_cond)
+  {
+    return NVM_SUCCESS;
+  }
+
+  // Only guards the creation, the slots are guarded by g_pt_async_cond
+  os_mutex_lock(g_api_mutex);
+  if (!g_pt_async_cond)
+  {
+    g_pt_async_shutdown = 0;
+    g_pt_async_event_fd = os_event_fd_create();
+    if (NULL == (g_pt_async_cond = os_cond_init()))
+    {
+      NVDIMM_ERR("Failed to initialize async passthrough state\n");
+      os_event_fd_close(g_pt_async_event_fd);
+      g_pt_async_event_fd = -1;
+      rc = NVM_ERR_NO_MEM;
+    }
+  }
+  os_mutex_unlock(g_api_mutex);
+  return rc;
+}
+
+/*
+ * Stop the async workers and drop every outstanding command
+ */
+static void pt_async_uninit()
+{
+  unsigned int i;
+
+  if (!g_pt_async_cond)
+  {
+    return;
+  }
+
+  os_cond_lock(g_pt_async_cond);
+  g_pt_async_shutdown = 1;
+  os_cond_broadcast(g_pt_async_cond);
+  os_cond_unlock(g_pt_async_cond);
+
+  for (i = 0; i < g_pt_async_worker_cnt; i++)
+  {
+    os_thread_join(g_pt_async_workers[i]);
+    g_pt_async_workers[i] = NULL;
+  }
+  g_pt_async_worker_cnt = 0;
+  g_pt_async_idle_cnt = 0;
+
+  for (i = 0; i < PT_ASYNC_MAX_OUTSTANDING; i++)
+  {
+    FREE_FW_CMD_SAFE(g_pt_async_slots[i].p_fw_cmd);
+  }
+  ZeroMem(g_pt_async_slots, sizeof(g_pt_async_slots));
+
+  os_event_fd_close(g_pt_async_event_fd);
+  g_pt_async_event_fd = -1;
+  os_cond_delete(g_pt_async_cond);
+  g_pt_async_cond = NULL;
+}
+
+/*
+ * Find the slot holding a ticket. Caller holds the lock.
+ */
+static struct pt_async_slot *pt_async_find(NVM_PT_TICKET ticket)
+{
+  unsigned int i;
+
+  if (ticket != 0)
+  {
+    for (i = 0; i < PT_ASYNC_MAX_OUTSTANDING; i++)
+    {
+      if (g_pt_async_slots[i].state != PT_ASYNC_FREE && g_pt_async_slots[i].ticket == ticket)
+      {
+        return &g_pt_async_slots[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+NVM_API int nvm_submit_device_passthrough_cmd(const NVM_UID device_uid, struct device_pt_cmd *p_cmd,
+  NVM_PT_TICKET *p_ticket)
+{
+  NVM_FW_CMD *cmd = NULL;
+  struct pt_async_slot *p_slot = NULL;
+  UINT16 dimm_id;
+  unsigned int dimm_handle;
+  unsigned int i;
+  int rc = NVM_ERR_UNKNOWN;
+
+  if (NULL == p_cmd || NULL == p_ticket)
+  {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = pt_cmd_check_sizes(p_cmd)))
+  {
+    goto finish;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  if (NVM_SUCCESS != (rc = pt_async_init()))
+  {
+    goto finish;
+  }
+
+  // The DIMM list may be rebuilt by an exclusive call, resolve the UID under the shared lock
+  if (NVM_SUCCESS != (rc = api_lock_shared()))
+  {
+    goto finish;
+  }
+  rc = get_dimm_id((char *)device_uid, &dimm_id, &dimm_handle);
+  api_unlock_shared();
+  if (NVM_SUCCESS != rc) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    goto finish;
+  }
+
+  if (NULL == (cmd = AllocateFwCmd())) {
+    NVDIMM_ERR("Failed to allocate memory\n");
+    rc = NVM_ERR_NO_MEM;
+    goto finish;
+  }
+  pt_cmd_to_fw_cmd(p_cmd, dimm_id, cmd);
+
+  os_cond_lock(g_pt_async_cond);
+  for (i = 0; i < PT_ASYNC_MAX_OUTSTANDING; i++)
+  {
+    if (g_pt_async_slots[i].state == PT_ASYNC_FREE)
+    {
+      p_slot = &g_pt_async_slots[i];
+      break;
+    }
+  }
+
+  if (NULL == p_slot)
+  {
+    NVDIMM_ERR("Too many outstanding passthrough commands\n");
+    rc = NVM_ERR_NO_MEM;
+  }
+  else
+  {
+    p_slot->ticket = g_pt_async_next_ticket++;
+    p_slot->dimm_id = dimm_id;
+    p_slot->p_cmd = p_cmd;
+    p_slot->p_fw_cmd = cmd;
+    p_slot->rc = NVM_ERR_UNKNOWN;
+    p_slot->state = PT_ASYNC_QUEUED;
+    *p_ticket = p_slot->ticket;
+    cmd = NULL;
+
+    // grow the worker set until every DIMM with queued work can be served
+    if (g_pt_async_idle_cnt == 0 && g_pt_async_worker_cnt < PT_ASYNC_MAX_WORKERS)
+    {
+      if (NULL != (g_pt_async_workers[g_pt_async_worker_cnt] = os_thread_create(pt_async_worker, NULL)))
+      {
+        g_pt_async_worker_cnt++;
+      }
+      else if (g_pt_async_worker_cnt == 0)
+      {
+        NVDIMM_ERR("Failed to start async passthrough worker\n");
+        FREE_FW_CMD_SAFE(p_slot->p_fw_cmd);
+        ZeroMem(p_slot, sizeof(*p_slot));
+        rc = NVM_ERR_UNKNOWN;
+      }
+    }
+    os_cond_broadcast(g_pt_async_cond);
+  }
+  os_cond_unlock(g_pt_async_cond);
+
+finish:
+  FREE_FW_CMD_SAFE(cmd);
+  return rc;
+}
+
+NVM_API int nvm_wait_device_passthrough_cmds(const NVM_PT_TICKET *p_tickets, const NVM_UINT32 count,
+  const NVM_BOOL wait_all, const int timeout_ms, NVM_UINT32 *p_completed_count)
+{
+  struct pt_async_slot *p_slot = NULL;
+  NVM_UINT32 completed = 0;
+  NVM_UINT32 i;
+  int rc = NVM_SUCCESS;
+  UINT64 deadline_us = 0;
+  UINT64 now_us;
+  int remaining_ms = timeout_ms;
+
+  if (NULL == p_tickets || 0 == count || NULL == g_pt_async_cond)
+  {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (timeout_ms > 0)
+  {
+    deadline_us = GetCurrentMicroseconds() + (UINT64)timeout_ms * 1000;
+  }
+
+  os_cond_lock(g_pt_async_cond);
+  for (;;)
+  {
+    completed = 0;
+    for (i = 0; i < count; i++)
+    {
+      if (NULL == (p_slot = pt_async_find(p_tickets[i])))
+      {
+        rc = NVM_ERR_INVALID_PARAMETER;
+        break;
+      }
+      if (p_slot->state == PT_ASYNC_DONE)
+      {
+        completed++;
+      }
+    }
+
+    if (rc != NVM_SUCCESS ||
+      (wait_all && completed == count) || (!wait_all && completed > 0))
+    {
+      break;
+    }
+
+    // every submit and completion wakes us up, only wait for what is left
+    if (timeout_ms > 0)
+    {
+      now_us = GetCurrentMicroseconds();
+      remaining_ms = (now_us >= deadline_us) ? 0 :
+        (int)((deadline_us - now_us + 999) / 1000);
+    }
+    if (0 == remaining_ms || !os_cond_wait(g_pt_async_cond, remaining_ms))
+    {
+      rc = NVM_ERR_TIMEOUT;
+      break;
+    }
+  }
+  os_cond_unlock(g_pt_async_cond);
+
+  if (p_completed_count)
+  {
+    *p_completed_count = completed;
+  }
+  return rc;
+}
+
+NVM_API int nvm_complete_device_passthrough_cmd(const NVM_PT_TICKET ticket)
+{
+  struct pt_async_slot *p_slot = NULL;
+  int rc = NVM_ERR_INVALID_PARAMETER;
+
+  if (NULL == g_pt_async_cond)
+  {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  os_cond_lock(g_pt_async_cond);
+  if (NULL != (p_slot = pt_async_find(ticket)))
+  {
+    if (p_slot->state != PT_ASYNC_DONE)
+    {
+      rc = NVM_ERR_BUSY_DEVICE;
+    }
+    else
+    {
+      rc = p_slot->rc;
+      ZeroMem(p_slot, sizeof(*p_slot));
+    }
+  }
+  os_cond_unlock(g_pt_async_cond);
+  return rc;
+}
+
+NVM_API int nvm_get_device_passthrough_event_fd(int *p_fd)
+{
+  int rc;
+
+  if (NULL == p_fd)
+  {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  if (NVM_SUCCESS != (rc = pt_async_init()))
+  {
+    return rc;
+  }
+
+  if (g_pt_async_event_fd < 0)
+  {
+    return NVM_ERR_API_NOT_SUPPORTED;
+  }
+  *p_fd = g_pt_async_event_fd;
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_transport_stats_count(NVM_UINT32 *p_count)
+{
+  int rc;
+
+  if (NULL == p_count)
+  {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  GetTransportStats(NULL, p_count);
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_transport_stats(struct transport_stats *p_stats, const NVM_UINT32 count,
+  NVM_UINT32 *p_returned)
+{
+  TRANSPORT_STATS_ENTRY *p_entries = NULL;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  NVM_UINT32 entry_count = count;
+  NVM_UINT32 i;
+  int rc;
+
+  if (NULL == p_stats || NULL == p_returned || 0 == count)
+  {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  if (NULL == (p_entries = AllocateZeroPool(sizeof(*p_entries) * count)))
+  {
+    NVDIMM_ERR("Failed to allocate memory\n");
+    return NVM_ERR_NO_MEM;
+  }
+
+  ReturnCode = GetTransportStats(p_entries, &entry_count);
+  for (i = 0; i < entry_count; i++)
+  {
+    p_stats[i].device_handle = p_entries[i].DimmHandle;
+    p_stats[i].opcode = p_entries[i].Opcode;
+    p_stats[i].subopcode = p_entries[i].SubOpcode;
+    switch (p_entries[i].Method)
+    {
+    case DimmPassthruSmbusSmallPayload:
+      p_stats[i].method = TRANSPORT_METHOD_SMBUS;
+      break;
+    case DimmPassthruDdrtSmallPayload:
+      p_stats[i].method = TRANSPORT_METHOD_DDRT_SMALL_PAYLOAD;
+      break;
+    default:
+      p_stats[i].method = TRANSPORT_METHOD_DDRT_LARGE_PAYLOAD;
+      break;
+    }
+    p_stats[i].count = p_entries[i].Count;
+    p_stats[i].errors = p_entries[i].Errors;
+    p_stats[i].retries = p_entries[i].Retries;
+    p_stats[i].total_latency_us = p_entries[i].TotalUs;
+    p_stats[i].max_latency_us = p_entries[i].MaxUs;
+    os_memcpy(p_stats[i].latency_histogram, sizeof(p_stats[i].latency_histogram),
+      p_entries[i].Buckets, sizeof(p_entries[i].Buckets));
+  }
+  *p_returned = entry_count;
+  FreePool(p_entries);
+
+  return (EFI_BUFFER_TOO_SMALL == ReturnCode) ? NVM_ERR_BAD_SIZE : NVM_SUCCESS;
+}
+
+NVM_API int nvm_reset_transport_stats()
+{
+  int rc;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  ResetTransportStats();
+  return NVM_SUCCESS;
+}
+
+static int get_transport_retry_stats_locked(const NVM_UID device_uid,
+  struct transport_retry_stats *p_stats)
+{
+  TRANSPORT_RETRY_STATS stats;
+  UINT16 dimm_id;
+  unsigned int dimm_handle;
+  EFI_STATUS ReturnCode;
+  int rc;
+
+  if (NULL == p_stats)
+  {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  if (NVM_SUCCESS != (rc = get_dimm_id((char *)device_uid, &dimm_id, &dimm_handle))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    return rc;
+  }
+
+  ReturnCode = passthru_os_get_retry_stats(dimm_handle, &stats);
+  if (EFI_UNSUPPORTED == ReturnCode)
+  {
+    return NVM_ERR_OPERATION_NOT_SUPPORTED;
+  }
+  if (EFI_ERROR(ReturnCode))
+  {
+    NVDIMM_ERR("Failed to get the retry statistics of dimm 0x%x\n", dimm_handle);
+    return NVM_ERR_UNKNOWN;
+  }
+
+  p_stats->commands_retried = stats.CommandsRetried;
+  p_stats->retries = stats.Retries;
+  p_stats->backoff_us = stats.BackoffUs;
+  p_stats->exhausted = stats.Exhausted;
+  p_stats->deadline_expired = stats.DeadlineExpired;
+  p_stats->backoff_level = stats.Level;
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_transport_retry_stats(const NVM_UID device_uid,
+  struct transport_retry_stats *p_stats)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_transport_retry_stats_locked(device_uid, p_stats);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int nvm_get_command_effect_log_helper(const NVM_UID device_uid,
+  NVM_UINT32 *p_cel_count,
+  struct command_effect_log **pp_cel)
+{
+  UINT16 dimm_id;
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+
+  if (NULL == pp_cel || NULL == p_cel_count) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    return NVM_ERR_UNKNOWN;
+  }
+
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetCommandEffectLog(&gNvmDimmDriverNvmDimmConfig, dimm_id, (COMMAND_EFFECT_LOG_ENTRY **)pp_cel, p_cel_count);
+  if (EFI_ERROR(ReturnCode)) {
+    return NVM_ERR_OPERATION_FAILED;
+  }
+
+  if (0 == *p_cel_count) {
+    rc = NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY;
+  }
+  return rc;
+}
+
+static int get_number_of_command_effect_log_entries_locked(const NVM_UID device_uid,
+  NVM_UINT32 *p_count)
+{
+  int rc = NVM_SUCCESS;
+  struct command_effect_log *p_cel = NULL;
+
+  if (p_count == NULL)
+  {
+    NVDIMM_ERR("NULL input parameter\n");
+    rc = NVM_ERR_INVALID_PARAMETER;
+    goto finish;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    goto finish;
+  }
+
+  rc = nvm_get_command_effect_log_helper(device_uid, p_count, &p_cel);
+
+  if (NVM_SUCCESS != rc && NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY != rc) {
+    NVDIMM_ERR("Failed to get number of command effect log entries %d\n", rc);
+    goto finish;
+  }
+
+finish:
+  FREE_POOL_SAFE(p_cel);
+  return rc;
+}
+
+NVM_API int nvm_get_number_of_command_effect_log_entries(const NVM_UID device_uid,
+  NVM_UINT32 *p_count)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_number_of_command_effect_log_entries_locked(device_uid, p_count);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_command_effect_log_locked(const NVM_UID device_uid,
+  struct command_effect_log *p_cel,
+  const NVM_UINT32 count)
+{
+  int rc = NVM_SUCCESS;
+  NVM_UINT32 actual_count = 0;
+  struct command_effect_log *p_cel_local = NULL;
+  NVM_UINT32 cel_size = 0;
+
+  if (NULL == p_cel) {
+    NVDIMM_ERR("NULL input parameter\n");
+    rc = NVM_ERR_INVALID_PARAMETER;
+    goto finish;
+  }
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    goto finish;
+  }
+
+  rc = nvm_get_command_effect_log_helper(device_uid, &actual_count, &p_cel_local);
+  if (NVM_SUCCESS != rc && NVM_SUCCESS_NO_COMMAND_EFFECT_LOG_ENTRY != rc) {
+    NVDIMM_ERR("Failed to get number of command effect log entries %d\n", rc);
+    goto finish;
+  }
+
+  if (actual_count != count)
+  {
+    rc = NVM_ERR_BAD_SIZE;
+    goto finish;
+  }
+
+  cel_size = actual_count * sizeof(struct command_effect_log);
+  CopyMem_S(p_cel, cel_size, p_cel_local, cel_size);
+
+finish:
+  FREE_POOL_SAFE(p_cel_local);
+  return rc;
+}
+
+NVM_API int nvm_get_command_effect_log(const NVM_UID device_uid,
+  struct command_effect_log *p_cel,
+  const NVM_UINT32 count)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_command_effect_log_locked(device_uid, p_cel, count);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_command_access_policy_locked(const NVM_UID device_uid,
+          NVM_UINT32 *p_cap_count,
+          struct command_access_policy *p_cap)
+{
+  UINT16 dimm_id;
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT32 cap_count, index;
   COMMAND_ACCESS_POLICY_ENTRY *p_cap_info = NULL;
 
   if (NULL == p_cap || NULL == p_cap_count) {
@@ -3071,7 +4892,21 @@ finish:
   return rc;
 }
 
-NVM_API int nvm_get_number_of_cap_entries(const NVM_UID device_uid,
+NVM_API int nvm_get_command_access_policy(const NVM_UID device_uid,
+          NVM_UINT32 *p_cap_count,
+          struct command_access_policy *p_cap)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_command_access_policy_locked(device_uid, p_cap_count, p_cap);
+  api_unlock_device(p_dimm);
+  return rc;
+}
+
+static int get_number_of_cap_entries_locked(const NVM_UID device_uid,
   NVM_UINT32 *p_count)
 {
   UINT16 dimm_id;
@@ -3104,3 +4939,16 @@ NVM_API int nvm_get_number_of_cap_entries(const NVM_UID device_uid,
 
   return rc;
 }
+
+NVM_API int nvm_get_number_of_cap_entries(const NVM_UID device_uid,
+  NVM_UINT32 *p_count)
+{
+  DIMM *p_dimm = NULL;
+  int rc = api_lock_device(device_uid, &p_dimm);
+
+  if (NVM_SUCCESS != rc)
+    return rc;
+  rc = get_number_of_cap_entries_locked(device_uid, p_count);
+  api_unlock_device(p_dimm);
+  return rc;
+}
@@ -855,6 +855,32 @@ struct device_details {
   NVM_UINT8			reserved[8];				///< reserved
 };
 
+typedef NVM_UINT64 NVM_DEVICE_FIELD_BITMASK;
+
+/**
+ * The bitmask of #device_details fields retrieved by #nvm_get_device_fields.
+ * Each field costs only the FW commands needed to read it.
+ */
+enum device_field {
+  DEVICE_FIELD_DISCOVERY = 0x1,             ///< discovery, from the platform tables and the identify data
+  DEVICE_FIELD_SMBIOS = 0x2,                ///< form_factor, data_width, total_width, speed, device_locator and bank_label
+  DEVICE_FIELD_CONFIG_STATUS = 0x4,         ///< status is_new, is_configured, sku_violation and config_status
+  DEVICE_FIELD_HEALTH = 0x8,                ///< status health, last shutdown status and time, thermal throttle loss and ait_dram_enabled
+  DEVICE_FIELD_SENSORS = 0x10,              ///< sensors: health, temperatures, media and thermal error count, power on time...
+  DEVICE_FIELD_BOOT_STATUS = 0x20,          ///< status boot_status
+  DEVICE_FIELD_MIXED_SKU = 0x40,            ///< status mixed_sku, every device is initialized to compare SKUs
+  DEVICE_FIELD_PACKAGE_SPARING = 0x80,      ///< package_sparing_enabled and status package_spares_available
+  DEVICE_FIELD_ARS_STATUS = 0x100,          ///< status ars_status
+  DEVICE_FIELD_OVERWRITE_STATUS = 0x200,    ///< status overwritedimm_status
+  DEVICE_FIELD_ERROR_INJECTION = 0x400,     ///< status injected_media_errors and injected_non_media_errors
+  DEVICE_FIELD_POWER_BUDGET = 0x800,        ///< peak_power_budget and avg_power_budget
+  DEVICE_FIELD_FW_INFO = 0x1000,            ///< fw_info
+  DEVICE_FIELD_PERFORMANCE = 0x2000,        ///< performance
+  DEVICE_FIELD_SETTINGS = 0x4000,           ///< settings and status viral_state
+  DEVICE_FIELD_CAPACITIES = 0x8000,         ///< capacities, a platform-wide query of every device
+  DEVICE_FIELD_ALL = 0xFFFF                 ///< All the fields, as filled by #nvm_get_device_details
+};
+
 /**
  * Supported capabilities of a specific memory mode
  */
@@ -1380,24 +1406,42 @@ NVM_API int nvm_get_number_of_devices(unsigned int *count);
  */
 NVM_API int nvm_get_devices(struct device_discovery *p_devices, const NVM_UINT8 count);
 
+/**
+* @brief Retrieves the number of devices described by the platform tables.
+* @remarks No firmware command is sent to the devices. The count includes the
+* devices whose firmware does not respond, which #nvm_get_number_of_devices skips.
+* @param[out] count
+*              The number of devices.
+* @pre The caller must have administrative privileges.
+* @return
+*              ::NVM_SUCCESS @n
+*              ::NVM_ERR_INVALID_PARAMETER @n
+*              ::NVM_ERR_UNKNOWN @n
+*/
+NVM_API int nvm_get_number_of_devices_nfit(unsigned int *count);
+
 /**
 * @brief Retrieves -PARTIAL- #device_discovery information
 * about each device in the system whether they are fully compatible
 * with the current native API library version or not.
-* @remarks Only attributes that can be found from NVDIMM Firmware Interface Table (NFIT) will be populated on #device_discovery.
+* @remarks Only attributes that can be found from NVDIMM Firmware Interface Table (NFIT)
+* and SMBIOS will be populated on #device_discovery, no firmware command is sent
+* to the devices. The firmware version, SKU, security and manageability
+* fields are left zeroed. The capacity is the one reported by SMBIOS.
 * @param[in,out] p_devices
 *              Array of #device_discovery structures allocated by the caller.
 * @param[in] count
-*              The number of elements in the array.
+*              The number of elements in the array, unused elements are zeroed.
+*              Only the first count devices are returned when there are more.
 * @pre The caller must have administrative privileges.
 * @remarks To allocate the array of #device_discovery structures,
-* call #nvm_get_device_count before calling this method.
+* call #nvm_get_number_of_devices_nfit before calling this method, it also
+* counts the devices whose firmware does not respond.
 * @return
 *              ::NVM_SUCCESS @n
 *              ::NVM_ERR_UNKNOWN @n
 *              ::NVM_ERR_OPERATION_FAILED @n
 *              ::NVM_ERR_NOT_ENOUGH_FREE_SPACE @n
-*              ::NVM_ERR_BAD_SIZE @n
 */
 NVM_API int nvm_get_devices_nfit(struct device_discovery *p_devices, const NVM_UINT8 count);
 
@@ -1495,6 +1539,51 @@ NVM_API int nvm_get_device_settings(const NVM_UID device_uid, struct device_sett
  */
 NVM_API int nvm_get_device_details(const NVM_UID device_uid, struct device_details *p_details);
 
+/**
+ * @brief Retrieve #device_details information about every device in the system.
+ * @param[in,out] p_details
+ *              An array of #device_details structures allocated by the caller.
+ * @param[in] count
+ *              The number of elements in the array. Must be the number returned
+ *              by #nvm_get_number_of_devices.
+ * @pre The caller must have administrative privileges.
+ * @remarks Fills the array in a single pass over the devices. The device list,
+ * system capabilities and capacities are queried once, the boot status and the
+ * other per device FW commands once per device, which sends fewer FW commands
+ * than calling #nvm_get_device_details for each device.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_BAD_SIZE @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_devices_details(struct device_details *p_details, const NVM_UINT32 count);
+
+/**
+ * @brief Retrieve the selected #device_details fields of the device specified.
+ * @param[in] device_uid
+ *              The device identifier.
+ * @param[in] fields
+ *              A bitmask of #device_field values selecting the fields to retrieve.
+ * @param[in,out] p_details
+ *              A pointer to a #device_details structure allocated by the caller.
+ *              The fields not selected are zeroed.
+ * @pre The caller must have administrative privileges.
+ * @pre The device is manageable.
+ * @remarks Only the FW commands the selected fields need are sent, so polling
+ * a few fields (e.g. DEVICE_FIELD_HEALTH | DEVICE_FIELD_SENSORS for the health
+ * state, temperatures and error counts) costs much less than
+ * #nvm_get_device_details.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_device_fields(const NVM_UID device_uid, const NVM_DEVICE_FIELD_BITMASK fields,
+  struct device_details *p_details);
+
 /**
  * @brief Retrieve a current snapshot of the performance metrics for the device specified.
  * @param[in] device_uid
@@ -2076,6 +2165,27 @@ NVM_API int nvm_run_diagnostic(const NVM_UID device_uid, const struct diagnostic
  */
 NVM_API int nvm_set_user_preference(const NVM_PREFERENCE_KEY key, const NVM_PREFERENCE_VALUE value);
 
+/**
+ * @brief Override the DIMM_DISPATCH_WORKERS preference for the rest of the process, without
+ * changing the configuration file. The override survives nvm_uninit.
+ * @param[in] workers
+ *              Number of PMem modules worked on at the same time, 0 to use the preference again.
+ * @return
+ *            ::NVM_SUCCESS @n
+ */
+NVM_API int nvm_set_dispatch_workers(const NVM_UINT32 workers);
+
+/**
+ * @brief Set whether the NVDIMM Firmware Interface Table (NFIT) is indexed for lookups, for the
+ * rest of the process. Takes effect when the NFIT is parsed again, on the next nvm_init.
+ * @param[in] enabled
+ *              0: Look the NFIT subtables up by scanning them. @n
+ *              1: Look them up through an index, the default.
+ * @return
+ *            ::NVM_SUCCESS @n
+ */
+NVM_API int nvm_set_nfit_index(const NVM_BOOL enabled);
+
 /**
  * @}
  * @defgroup Logging Logging
@@ -2133,11 +2243,27 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count);
 
 /**
  * @brief Initialize a new context
+ * @remarks Calls made while a context is open reuse the PMem module
+ * state read by earlier calls instead of reading it again: the PCD
+ * (platform configuration data) and the responses to read-only firmware
+ * commands such as identify, security state and configured features.
+ * Readings the module updates on its own (SMART and health, memory info
+ * and error logs) are read again once they are more than a second old.
+ * Other state changed through this library is kept up to date, while
+ * changes made by other processes are only seen once the context is freed.
+ * Contexts nest, the state is kept until the last one is freed.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_UNKNOWN
  */
 NVM_API int nvm_create_context();
 
 /**
  * @brief Clean up the current context
+ * @param[in] force
+ *              Free every open context instead of the innermost one
+ * @return
+ *            ::NVM_SUCCESS
  */
 NVM_API int nvm_free_context(const NVM_BOOL force);
 
@@ -2181,6 +2307,180 @@ struct device_pt_cmd {
  */
 NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID device_uid, struct device_pt_cmd *p_cmd);
 
+/**
+ * Identifies a pass-through command submitted with
+ * nvm_submit_device_passthrough_cmd. Zero is never a valid ticket.
+ */
+typedef NVM_UINT64 NVM_PT_TICKET;
+
+/**
+ * @brief Queue a firmware command for the specified device and return
+ * without waiting for it. Commands to the same device run in submission
+ * order; commands to different devices run concurrently. The output
+ * payloads and the result field of p_cmd are filled in when the command
+ * completes, so p_cmd and its buffers must stay valid until the ticket is
+ * released with nvm_complete_device_passthrough_cmd. Queued commands take
+ * the same locks as nvm_send_device_passthrough_cmd and do not run while
+ * another thread holds nvm_sync_lock_api.
+ * @param device_uid
+ *              The device identifier.
+ * @param p_cmd
+ *              A pointer to a @link #device_pt_command @endlink structure defining the command to send.
+ * @param p_ticket
+ *              Receives the ticket identifying the command.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_NO_MEM @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_submit_device_passthrough_cmd(const NVM_UID device_uid, struct device_pt_cmd *p_cmd,
+  NVM_PT_TICKET *p_ticket);
+
+/**
+ * @brief Wait for submitted pass-through commands to complete.
+ * @param p_tickets
+ *              Array of tickets returned by nvm_submit_device_passthrough_cmd.
+ * @param count
+ *              Number of tickets in p_tickets.
+ * @param wait_all
+ *              Wait for every ticket when true, for any one of them otherwise.
+ * @param timeout_ms
+ *              Time to wait in milliseconds, 0 only polls, negative waits forever.
+ * @param p_completed_count
+ *              Optional, receives the number of tickets in p_tickets that have completed.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER An unknown or released ticket was given @n
+ *            ::NVM_ERR_TIMEOUT @n
+ */
+NVM_API int nvm_wait_device_passthrough_cmds(const NVM_PT_TICKET *p_tickets, const NVM_UINT32 count,
+  const NVM_BOOL wait_all, const int timeout_ms, NVM_UINT32 *p_completed_count);
+
+/**
+ * @brief Collect the result of a completed pass-through command and release
+ * its ticket. The result is the same as nvm_send_device_passthrough_cmd
+ * would have returned, and is also stored in the result field of the command.
+ * @param ticket
+ *              The ticket returned by nvm_submit_device_passthrough_cmd.
+ * @return
+ *            Result of the command @n
+ *            ::NVM_ERR_BUSY_DEVICE The command has not completed yet @n
+ *            ::NVM_ERR_INVALID_PARAMETER Unknown or released ticket @n
+ */
+NVM_API int nvm_complete_device_passthrough_cmd(const NVM_PT_TICKET ticket);
+
+/**
+ * @brief Get a file descriptor that becomes readable whenever a submitted
+ * pass-through command completes, for use in a poll/epoll loop. Reading it
+ * clears the notification. The descriptor is owned by the library.
+ * @param p_fd
+ *              Receives the file descriptor.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_API_NOT_SUPPORTED Not available on this OS @n
+ */
+NVM_API int nvm_get_device_passthrough_event_fd(int *p_fd);
+
+#define NVM_TRANSPORT_LATENCY_BUCKETS 16 ///< Number of latency histogram buckets in struct transport_stats
+
+/**
+ * Upper latency bound in microseconds of bucket i of transport_stats.latency_histogram.
+ * The last bucket counts everything slower than the bound of the one before it.
+ */
+#define NVM_TRANSPORT_LATENCY_BUCKET_LIMIT_US(i) (32ULL << (i))
+
+/**
+ * The path a firmware command took to the PMem module
+ */
+enum transport_method {
+  TRANSPORT_METHOD_DDRT_LARGE_PAYLOAD = 0, ///< DDRT with the large payload mailbox
+  TRANSPORT_METHOD_DDRT_SMALL_PAYLOAD = 1, ///< DDRT with the small payload mailbox only
+  TRANSPORT_METHOD_SMBUS = 2               ///< SMBUS through the BIOS emulated pass-through
+};
+
+/**
+ * Latency and outcome of the firmware commands this process has sent to one
+ * PMem module with one opcode/subopcode over one transport.
+ */
+struct transport_stats {
+  unsigned int           device_handle;   ///< Matches device_discovery.device_handle
+  NVM_UINT8              opcode;          ///< Firmware command opcode
+  NVM_UINT8              subopcode;       ///< Firmware command subopcode
+  enum transport_method  method;          ///< Transport used
+  NVM_UINT64             count;           ///< Commands sent
+  NVM_UINT64             errors;          ///< Commands the OS or driver failed
+  NVM_UINT64             retries;         ///< Retries suggested by the driver
+  NVM_UINT64             total_latency_us; ///< Sum of the command latencies
+  NVM_UINT64             max_latency_us;  ///< Slowest command
+  NVM_UINT64             latency_histogram[NVM_TRANSPORT_LATENCY_BUCKETS]; ///< Commands per latency bucket
+};
+
+/**
+ * @brief Retrieve the number of transport_stats entries collected so far.
+ * @param p_count
+ *              Receives the number of entries.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ */
+NVM_API int nvm_get_transport_stats_count(NVM_UINT32 *p_count);
+
+/**
+ * @brief Retrieve per PMem module, opcode and transport latency histograms,
+ * error and retry counts of the firmware commands this process has sent.
+ * Collection is always on.
+ * @param p_stats
+ *              Array to fill.
+ * @param count
+ *              Number of entries p_stats can hold.
+ * @param p_returned
+ *              Receives the number of entries filled.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_BAD_SIZE More entries are available than count @n
+ */
+NVM_API int nvm_get_transport_stats(struct transport_stats *p_stats, const NVM_UINT32 count,
+  NVM_UINT32 *p_returned);
+
+/**
+ * @brief Clear the transport statistics collected so far.
+ * @return
+ *            ::NVM_SUCCESS @n
+ */
+NVM_API int nvm_reset_transport_stats();
+
+/**
+ * Backoff outcome of the firmware commands the OS driver asked this process
+ * to retry on one PMem module.
+ */
+struct transport_retry_stats {
+  NVM_UINT64  commands_retried;   ///< Commands that got at least one retry suggested
+  NVM_UINT64  retries;            ///< Retries issued
+  NVM_UINT64  backoff_us;         ///< Time spent waiting between retries
+  NVM_UINT64  exhausted;          ///< Commands that ran out of retries
+  NVM_UINT64  deadline_expired;   ///< Commands given up on the retry deadline
+  NVM_UINT32  backoff_level;      ///< Current backoff level, grows while retries are suggested
+};
+
+/**
+ * @brief Retrieve the retry backoff counters of a PMem module, kept since the
+ * library was initialized.
+ * @param device_uid
+ *              The device identifier.
+ * @param p_stats
+ *              Receives the counters.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_OPERATION_NOT_SUPPORTED The OS driver does not retry through the library @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_transport_retry_stats(const NVM_UID device_uid,
+  struct transport_retry_stats *p_stats);
+
 /**
 * @brief Retrieve a firmware error log entry
 * @param[in] device_uid The device identifier
@@ -2292,8 +2592,22 @@ NVM_API int nvm_get_number_of_cap_entries(const NVM_UID   device_uid, NVM_UINT32
 
 /**
 * @brief Lock API
+* @remarks The API calls are thread safe: calls on different devices run
+*          concurrently, calls on the same device are serialized, and the calls
+*          changing the platform configuration wait for all of them. Other
+*          processes using the library or the CLI follow the same rules through
+*          a lock file, ipmctl.lock in /run/ipmctl or ProgramData. A call
+*          that waits more than two minutes for it fails with
+*          ::NVM_ERR_BUSY_DEVICE. This lock holds off the calls of every
+*          other thread and process until nvm_sync_unlock_api, for a sequence
+*          of calls that must see a consistent state. The calls of the locking
+*          thread still run. Do not take it while another call is running on
+*          the same thread. Only call nvm_sync_unlock_api when it succeeds.
+* @return
+*            ::NVM_SUCCESS @n
+*            ::NVM_ERR_BUSY_DEVICE Another process held the lock file for two minutes @n
 */
-NVM_API void nvm_sync_lock_api();
+NVM_API int nvm_sync_lock_api();
 
 /**
 * @brief Unlock API
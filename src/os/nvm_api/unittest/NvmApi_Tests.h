@@ -9,6 +9,10 @@
 #include <gtest/gtest.h>
 #include <nvm_management.h>
 #include <wchar.h> 
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
 
 class NvmApi_Tests : public ::testing::Test
 {
@@ -149,6 +153,185 @@ TEST_F(NvmApi_Tests, GetCommandAccessPolicy)
   free(p_cap);
 }
 
+TEST_F(NvmApi_Tests, GetDevicesNfit)
+{
+  unsigned int nfit_cnt = 0;
+  unsigned int dimm_cnt = 0;
+
+  EXPECT_EQ(nvm_get_number_of_devices_nfit(&nfit_cnt), NVM_SUCCESS);
+  device_discovery *p_nfit_devices = (device_discovery *)malloc(sizeof(device_discovery) * nfit_cnt);
+  EXPECT_EQ(nvm_get_devices_nfit(p_nfit_devices, nfit_cnt), NVM_SUCCESS);
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  EXPECT_LE(dimm_cnt, nfit_cnt);
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(p_devices, dimm_cnt), NVM_SUCCESS);
+
+  // The table-only data must agree with the full discovery
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    unsigned int j = 0;
+    while (j < nfit_cnt && p_nfit_devices[j].physical_id != p_devices[i].physical_id) {
+      j++;
+    }
+    ASSERT_LT(j, nfit_cnt);
+    EXPECT_STREQ(p_nfit_devices[j].uid, p_devices[i].uid);
+    EXPECT_EQ(p_nfit_devices[j].device_handle.handle, p_devices[i].device_handle.handle);
+    EXPECT_EQ(p_nfit_devices[j].socket_id, p_devices[i].socket_id);
+  }
+
+  free(p_devices);
+  free(p_nfit_devices);
+}
+
+#define ANY_FW_OPCODE -1
+#define FW_OPCODE_IDENTIFY 0x01
+#define FW_OPCODE_GET_LOG 0x08
+#define FW_SUBOP_SMART_HEALTH 0x00
+
+/*
+ * Number of firmware commands sent since the transport statistics were
+ * last reset, optionally only those with the given opcode/subopcode
+ */
+static NVM_UINT64 CountFwCommands(int opcode = ANY_FW_OPCODE, int subopcode = ANY_FW_OPCODE)
+{
+  NVM_UINT32 count = 0;
+  NVM_UINT32 returned = 0;
+  NVM_UINT64 commands = 0;
+
+  EXPECT_EQ(nvm_get_transport_stats_count(&count), NVM_SUCCESS);
+  if (count == 0) {
+    return 0;
+  }
+  struct transport_stats *p_stats = (struct transport_stats *)malloc(sizeof(struct transport_stats) * count);
+  EXPECT_EQ(nvm_get_transport_stats(p_stats, count, &returned), NVM_SUCCESS);
+  for (NVM_UINT32 i = 0; i < returned; i++) {
+    if ((opcode == ANY_FW_OPCODE || p_stats[i].opcode == opcode) &&
+        (subopcode == ANY_FW_OPCODE || p_stats[i].subopcode == subopcode)) {
+      commands += p_stats[i].count;
+    }
+  }
+  free(p_stats);
+  return commands;
+}
+
+TEST_F(NvmApi_Tests, ContextReusesDeviceState)
+{
+  unsigned int dimm_cnt = 0;
+  struct device_details details;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(p_devices, dimm_cnt), NVM_SUCCESS);
+
+  EXPECT_EQ(nvm_create_context(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_device_details(p_devices[0].uid, &details), NVM_SUCCESS);
+  NVM_UINT64 first_smart = CountFwCommands(FW_OPCODE_GET_LOG, FW_SUBOP_SMART_HEALTH);
+
+  // Identify data is reused, the SMART and health page is read again once
+  // it is older than a second
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_device_details(p_devices[0].uid, &details), NVM_SUCCESS);
+  NVM_UINT64 second_identify = CountFwCommands(FW_OPCODE_IDENTIFY);
+  NVM_UINT64 second_smart = CountFwCommands(FW_OPCODE_GET_LOG, FW_SUBOP_SMART_HEALTH);
+  EXPECT_EQ(nvm_free_context(0), NVM_SUCCESS);
+
+  EXPECT_GT(first_smart, 0u);
+  EXPECT_EQ(second_identify, 0u);
+  EXPECT_GT(second_smart, 0u);
+
+  free(p_devices);
+}
+
+TEST_F(NvmApi_Tests, GetDevicesDetailsSendsFewerFwCommandsThanLoop)
+{
+  unsigned int dimm_cnt = 0;
+  struct device_details details;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  device_details *p_details = (device_details *)malloc(sizeof(device_details) * dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(p_devices, dimm_cnt), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_devices_details(p_details, dimm_cnt - 1), NVM_ERR_BAD_SIZE);
+
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    EXPECT_EQ(nvm_get_device_details(p_devices[i].uid, &details), NVM_SUCCESS);
+  }
+  NVM_UINT64 loop_calls = CountFwCommands();
+
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_devices_details(p_details, dimm_cnt), NVM_SUCCESS);
+  NVM_UINT64 bulk_call = CountFwCommands();
+
+  EXPECT_GT(loop_calls, 0u);
+  EXPECT_LT(bulk_call, loop_calls);
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    EXPECT_STREQ(p_details[i].discovery.uid, p_devices[i].uid);
+  }
+
+  free(p_details);
+  free(p_devices);
+}
+
+TEST_F(NvmApi_Tests, GetDeviceFieldsSendsOnlyNeededFwCommands)
+{
+  unsigned int dimm_cnt = 0;
+  struct device_details details;
+  struct device_details fields;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(p_devices, dimm_cnt), NVM_SUCCESS);
+
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_device_details(p_devices[0].uid, &details), NVM_SUCCESS);
+  NVM_UINT64 details_call = CountFwCommands();
+
+  EXPECT_EQ(nvm_reset_transport_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_device_fields(p_devices[0].uid, DEVICE_FIELD_HEALTH | DEVICE_FIELD_SENSORS, &fields), NVM_SUCCESS);
+  NVM_UINT64 fields_call = CountFwCommands();
+
+  EXPECT_LT(fields_call, details_call);
+  EXPECT_EQ(fields.status.health, details.status.health);
+  EXPECT_EQ(fields.sensors[SENSOR_HEALTH].reading, details.sensors[SENSOR_HEALTH].reading);
+  EXPECT_EQ(fields.fw_info.FWImageMaxSize, 0u);
+
+  free(p_devices);
+}
+
+TEST_F(NvmApi_Tests, GetDimmIdResolvesEveryUid)
+{
+  unsigned int dimm_cnt = 0;
+  unsigned int dimm_id = 0;
+  unsigned int dimm_handle = 0;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(p_devices, dimm_cnt), NVM_SUCCESS);
+
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    EXPECT_EQ(nvm_get_dimm_id(p_devices[i].uid, &dimm_id, &dimm_handle), NVM_SUCCESS);
+    EXPECT_EQ(dimm_handle, p_devices[i].device_handle.handle);
+  }
+  EXPECT_NE(nvm_get_dimm_id("8089-zz-0000-00000000", &dimm_id, &dimm_handle), NVM_SUCCESS);
+
+  free(p_devices);
+}
+
 TEST_F(NvmApi_Tests, GetRegions)
 {
   NVM_UINT8 count;
@@ -217,4 +400,210 @@ TEST_F(NvmApi_Tests, SetMasterPassphrase)
 
   free(p_devices);
 }
+/*
+ * The DIMM inventory built one DIMM at a time and the one built in parallel
+ * must be the same. Set EMULATED_DIMM_COUNT in the ini file to run it
+ * without hardware.
+ */
+TEST_F(NvmApi_Tests, ParallelDimmInventoryMatchesSerial)
+{
+  const NVM_UINT32 workers[] = { 1, 0 };
+  unsigned int dimm_cnt = 0;
+  std::vector<device_discovery> devices[2];
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    // Only this process, the configuration file is left alone
+    EXPECT_EQ(nvm_set_dispatch_workers(workers[i]), NVM_SUCCESS);
+    nvm_uninit();
+    EXPECT_EQ(nvm_init(), NVM_SUCCESS);
+    devices[i].resize(dimm_cnt);
+    EXPECT_EQ(nvm_get_devices(devices[i].data(), dimm_cnt), NVM_SUCCESS);
+  }
+  nvm_set_dispatch_workers(0);
+
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    const device_discovery &serial = devices[0][i];
+    const device_discovery *p_parallel = NULL;
+
+    for (unsigned int j = 0; j < dimm_cnt; j++) {
+      if (devices[1][j].device_handle.handle == serial.device_handle.handle) {
+        p_parallel = &devices[1][j];
+        break;
+      }
+    }
+    ASSERT_TRUE(p_parallel != NULL);
+    EXPECT_STREQ(p_parallel->uid, serial.uid);
+    EXPECT_STREQ(p_parallel->fw_revision, serial.fw_revision);
+    EXPECT_STREQ(p_parallel->fw_api_version, serial.fw_api_version);
+    EXPECT_STREQ(p_parallel->part_number, serial.part_number);
+    EXPECT_EQ(memcmp(p_parallel->serial_number, serial.serial_number, sizeof(serial.serial_number)), 0);
+    EXPECT_EQ(p_parallel->capacity, serial.capacity);
+    EXPECT_EQ(p_parallel->dimm_sku, serial.dimm_sku);
+    EXPECT_EQ(p_parallel->lock_state, serial.lock_state);
+    EXPECT_EQ(p_parallel->manageability, serial.manageability);
+  }
+}
+
+/*
+ * The regions and interleave sets found through the NFIT indices must be the
+ * same as when the NFIT subtables are scanned. Regions are built both from
+ * the NFIT and from the PCD, each looks up the region mappings, SPA ranges
+ * and interleave tables of every DIMM. Set EMULATED_DIMM_COUNT in the ini
+ * file to run it on a synthetic NFIT with many DIMMs.
+ */
+TEST_F(NvmApi_Tests, IndexedNfitLookupsMatchLinearWalk)
+{
+  const NVM_BOOL indexed[] = { 0, 1 };
+  std::vector<region> regions[2][2];
+
+  for (int i = 0; i < 2; i++) {
+    // The indices are built when the NFIT is parsed, on init
+    EXPECT_EQ(nvm_set_nfit_index(indexed[i]), NVM_SUCCESS);
+    nvm_uninit();
+    EXPECT_EQ(nvm_init(), NVM_SUCCESS);
+    for (NVM_BOOL use_nfit = 0; use_nfit < 2; use_nfit++) {
+      NVM_UINT8 count = 0;
+
+      EXPECT_EQ(nvm_get_number_of_regions_ex(use_nfit, &count), NVM_SUCCESS);
+      regions[i][use_nfit].resize(count);
+      if (count > 0) {
+        EXPECT_EQ(nvm_get_regions_ex(use_nfit, regions[i][use_nfit].data(), &count), NVM_SUCCESS);
+      }
+      regions[i][use_nfit].resize(count);
+    }
+  }
+  nvm_set_nfit_index(1);
+
+  for (int use_nfit = 0; use_nfit < 2; use_nfit++) {
+    const std::vector<region> &linear = regions[0][use_nfit];
+    const std::vector<region> &lookup = regions[1][use_nfit];
+
+    ASSERT_EQ(lookup.size(), linear.size());
+    for (size_t i = 0; i < linear.size(); i++) {
+      EXPECT_EQ(lookup[i].isetId, linear[i].isetId);
+      EXPECT_EQ(lookup[i].type, linear[i].type);
+      EXPECT_EQ(lookup[i].capacity, linear[i].capacity);
+      EXPECT_EQ(lookup[i].free_capacity, linear[i].free_capacity);
+      EXPECT_EQ(lookup[i].socket_id, linear[i].socket_id);
+      EXPECT_EQ(lookup[i].health, linear[i].health);
+      ASSERT_EQ(lookup[i].dimm_count, linear[i].dimm_count);
+      for (NVM_UINT16 j = 0; j < linear[i].dimm_count; j++) {
+        EXPECT_EQ(lookup[i].dimms[j], linear[i].dimms[j]);
+      }
+    }
+  }
+}
+
+/*
+ * Concurrency stress: threads query the status and sensors of different
+ * modules at the same time, each module also shared by several threads.
+ * Every call must succeed and match the single threaded results. Set
+ * EMULATED_DIMM_COUNT (and EMULATED_CMD_LATENCY_US) in the ini file to run
+ * it without hardware.
+ */
+TEST_F(NvmApi_Tests, ConcurrentDeviceQueriesMatchSerialResults)
+{
+  const int iterations = 20;
+  const unsigned int thread_cnt = 8;
+  unsigned int dimm_cnt = 0;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  std::vector<device_discovery> devices(dimm_cnt);
+  std::vector<device_status> baseline(dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(devices.data(), dimm_cnt), NVM_SUCCESS);
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    EXPECT_EQ(nvm_get_device_status(devices[i].uid, &baseline[i]), NVM_SUCCESS);
+  }
+
+  for (int run = 0; run < 2; run++) {
+    unsigned int threads = (run == 0) ? 1 : thread_cnt;
+    std::vector<int> failures(threads, 0);
+    std::vector<std::thread> workers;
+
+    for (unsigned int t = 0; t < threads; t++) {
+      workers.push_back(std::thread([&, t]() {
+        for (int i = 0; i < iterations; i++) {
+          unsigned int index = (t + i) % dimm_cnt;
+          device_status status;
+          sensor sensors[NVM_MAX_DEVICE_SENSORS];
+
+          if (nvm_get_device_status(devices[index].uid, &status) != NVM_SUCCESS ||
+              status.health != baseline[index].health ||
+              status.is_configured != baseline[index].is_configured ||
+              status.boot_status != baseline[index].boot_status ||
+              nvm_get_sensors(devices[index].uid, sensors, NVM_MAX_DEVICE_SENSORS) != NVM_SUCCESS) {
+            failures[t]++;
+          }
+        }
+      }));
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+      workers[t].join();
+      EXPECT_EQ(failures[t], 0);
+    }
+  }
+}
+
+TEST_F(NvmApi_Tests, SubmittedPassThruWaitsForExclusiveCalls)
+{
+  const unsigned int cmd_cnt = 16;
+  unsigned int dimm_cnt = 0;
+  unsigned char expected[128];
+  NVM_PT_TICKET tickets[cmd_cnt];
+  std::vector<device_pt_cmd> cmds(cmd_cnt);
+  std::vector<std::vector<unsigned char> > outputs(cmd_cnt, std::vector<unsigned char>(sizeof(expected)));
+  device_pt_cmd identify;
+
+  EXPECT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (dimm_cnt == 0) {
+    return;
+  }
+  std::vector<device_discovery> devices(dimm_cnt);
+  EXPECT_EQ(nvm_get_devices(devices.data(), dimm_cnt), NVM_SUCCESS);
+
+  memset(&identify, 0, sizeof(identify));
+  identify.opcode = 0x1;
+  identify.output_payload_size = sizeof(expected);
+  identify.output_payload = expected;
+  EXPECT_EQ(nvm_send_device_passthrough_cmd(devices[0].uid, &identify), NVM_SUCCESS);
+  for (unsigned int i = 0; i < cmd_cnt; i++) {
+    cmds[i] = identify;
+    cmds[i].output_payload = outputs[i].data();
+  }
+
+  // Nothing queued runs while this thread holds the API exclusively
+  EXPECT_EQ(nvm_sync_lock_api(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_submit_device_passthrough_cmd(devices[0].uid, &cmds[0], &tickets[0]), NVM_SUCCESS);
+  EXPECT_EQ(nvm_wait_device_passthrough_cmds(tickets, 1, 1, 200, NULL), NVM_ERR_TIMEOUT);
+  nvm_sync_unlock_api();
+  EXPECT_EQ(nvm_wait_device_passthrough_cmds(tickets, 1, 1, -1, NULL), NVM_SUCCESS);
+
+  // Submissions interleaved with exclusive calls of another thread
+  std::thread writer([&]() {
+    for (unsigned int i = 0; i < cmd_cnt; i++) {
+      EXPECT_EQ(nvm_create_context(), NVM_SUCCESS);
+      EXPECT_EQ(nvm_free_context(0), NVM_SUCCESS);
+    }
+  });
+  for (unsigned int i = 1; i < cmd_cnt; i++) {
+    EXPECT_EQ(nvm_submit_device_passthrough_cmd(devices[i % dimm_cnt].uid, &cmds[i], &tickets[i]), NVM_SUCCESS);
+  }
+  writer.join();
+  EXPECT_EQ(nvm_wait_device_passthrough_cmds(tickets, cmd_cnt, 1, -1, NULL), NVM_SUCCESS);
+
+  for (unsigned int i = 0; i < cmd_cnt; i++) {
+    EXPECT_EQ(nvm_complete_device_passthrough_cmd(tickets[i]), NVM_SUCCESS);
+    if (i % dimm_cnt == 0) {
+      EXPECT_EQ(memcmp(outputs[i].data(), expected, sizeof(expected)), 0);
+    }
+  }
+}
 #endif //NVM_API_TESTS_H
@@ -7,6 +7,7 @@
 #define OS_H_
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #ifdef	_MSC_VER
 #include <stdlib.h>
@@ -31,6 +32,10 @@ typedef wchar_t OS_WPATH[OS_PATH_LEN];
 typedef char OS_PATH[OS_PATH_LEN];
 typedef void OS_MUTEX;
 typedef void OS_RWLOCK;
+typedef void OS_THREAD;
+typedef void OS_COND;
+typedef void OS_FILE_LOCK;
+typedef void *(*OS_THREAD_FUNC)(void *p_arg);
 
 
 
@@ -73,6 +78,12 @@ struct nvm_driver_capabilities
 extern void os_get_locale_dir(OS_PATH locale_dir);
 extern char * os_get_cwd(OS_PATH buffer, size_t size);
 extern int os_mkdir(char *path);
+/*
+ Create and open for writing a file no other caller gets, like mkstemp.
+ The trailing "XXXXXX" of path_template is replaced by the name used.
+ Returns NULL on failure.
+*/
+extern FILE *os_fopen_unique(char *path_template);
 
 extern OS_MUTEX *os_mutex_init(const char *name);
 extern int os_mutex_lock(OS_MUTEX *p_mutex);
@@ -86,10 +97,34 @@ extern int os_rwlock_w_lock(OS_RWLOCK *p_rwlock);
 extern int os_rwlock_w_unlock(OS_RWLOCK *p_rwlock);
 extern int os_rwlock_delete(OS_RWLOCK *p_rwlock);
 
+// Reader/writer lock shared by all processes opening the same name
+// Longest wait for the lock before giving up, in milliseconds
+#define OS_FILE_LOCK_TIMEOUT_MS 120000
+extern OS_FILE_LOCK *os_file_lock_init(const char *name);
+extern int os_file_lock_shared(OS_FILE_LOCK *p_lock);
+extern int os_file_lock_exclusive(OS_FILE_LOCK *p_lock);
+extern int os_file_unlock(OS_FILE_LOCK *p_lock);
+extern int os_file_lock_delete(OS_FILE_LOCK *p_lock);
+
+extern OS_THREAD *os_thread_create(OS_THREAD_FUNC p_func, void *p_arg);
+extern int os_thread_join(OS_THREAD *p_thread);
+
+extern OS_COND *os_cond_init();
+extern int os_cond_lock(OS_COND *p_cond);
+extern int os_cond_unlock(OS_COND *p_cond);
+extern int os_cond_wait(OS_COND *p_cond, int timeout_ms);
+extern int os_cond_broadcast(OS_COND *p_cond);
+extern int os_cond_delete(OS_COND *p_cond);
+
+extern int os_event_fd_create();
+extern void os_event_fd_signal(int fd);
+extern void os_event_fd_close(int fd);
+
 extern int os_get_host_name(char *name, const unsigned int name_len);
 extern int os_get_os_name(char *os_name, const unsigned int os_name_len);
 extern int os_get_os_version(char *os_version, const unsigned int os_version_len);
 extern int os_get_os_type();
+extern int os_get_boot_id(char *boot_id, const unsigned int boot_id_len);
 extern int os_get_driver_capabilities(struct nvm_driver_capabilities *p_capabilities);
 extern int os_check_admin_permissions();
 
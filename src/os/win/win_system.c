@@ -13,9 +13,11 @@
 #include <windows.h>
 #include <winnt.h>
 #include <stdio.h>
+#include <time.h>
 #include <nvm_management.h>
 #include <tchar.h> // todo: remove this header and replace associated functions
 #include <direct.h> // for _getcwd
+#include <io.h> // for _mktemp_s
 #include <s_str.h>
 #include <stdbool.h>
 
@@ -217,6 +219,276 @@ int os_rwlock_delete(OS_RWLOCK *p_rwlock)
 	return 1;
 }
 
+/*
+ * Opens the lock file of the given name in the ProgramData directory,
+ * created on first use. The lock is a byte range lock on it, released by
+ * the system when the process exits.
+ */
+OS_FILE_LOCK *os_file_lock_init(const char *name)
+{
+	char dir[OS_PATH_LEN];
+	char path[OS_PATH_LEN];
+	DWORD len;
+	HANDLE handle;
+
+	if (!name)
+	{
+		return NULL;
+	}
+	len = GetEnvironmentVariable("ProgramData", dir, sizeof(dir));
+	if (len == 0 || len >= sizeof(dir))
+	{
+		return NULL;
+	}
+	snprintf(path, sizeof(path), "%s\\%s.lock", dir, name);
+	handle = CreateFile(path, GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+	return (OS_FILE_LOCK *)handle;
+}
+
+#define LOCK_RETRY_MS 10
+
+/*
+ * Polls for the lock until OS_FILE_LOCK_TIMEOUT_MS, a holder that never
+ * lets go must not hang every other process
+ */
+static int file_lock(OS_FILE_LOCK *p_lock, DWORD flags)
+{
+	OVERLAPPED overlapped;
+	DWORD waited_ms = 0;
+
+	if (!p_lock)
+	{
+		return 0;
+	}
+	for (;;)
+	{
+		// the first byte of the file is the lock
+		memset(&overlapped, 0, sizeof(overlapped));
+		if (LockFileEx((HANDLE)p_lock, flags | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped))
+		{
+			return 1;
+		}
+		if (GetLastError() != ERROR_LOCK_VIOLATION || waited_ms >= OS_FILE_LOCK_TIMEOUT_MS)
+		{
+			return 0;
+		}
+		Sleep(LOCK_RETRY_MS);
+		waited_ms += LOCK_RETRY_MS;
+	}
+}
+
+/*
+ * Takes the lock shared with the other readers, waits for a writer
+ * up to OS_FILE_LOCK_TIMEOUT_MS
+ */
+int os_file_lock_shared(OS_FILE_LOCK *p_lock)
+{
+	return file_lock(p_lock, 0);
+}
+
+/*
+ * Takes the lock exclusively, waits for all the other holders
+ * up to OS_FILE_LOCK_TIMEOUT_MS
+ */
+int os_file_lock_exclusive(OS_FILE_LOCK *p_lock)
+{
+	return file_lock(p_lock, LOCKFILE_EXCLUSIVE_LOCK);
+}
+
+/*
+ * Releases the lock, shared or exclusive.
+ * The lock belongs to the process, not the thread taking it.
+ */
+int os_file_unlock(OS_FILE_LOCK *p_lock)
+{
+	OVERLAPPED overlapped;
+
+	if (!p_lock)
+	{
+		return 0;
+	}
+	memset(&overlapped, 0, sizeof(overlapped));
+	return (UnlockFileEx((HANDLE)p_lock, 0, 1, 0, &overlapped) != 0);
+}
+
+/*
+ * Closes the lock file, releasing the lock if held
+ */
+int os_file_lock_delete(OS_FILE_LOCK *p_lock)
+{
+	int rc = 1;
+	if (p_lock)
+	{
+		// failure when CloseHandle(..) == 0
+		rc = (CloseHandle((HANDLE)p_lock) != 0);
+	}
+	return rc;
+}
+
+struct win_thread
+{
+	HANDLE handle;
+	OS_THREAD_FUNC p_func;
+	void *p_arg;
+};
+
+static DWORD WINAPI win_thread_start(LPVOID p_param)
+{
+	struct win_thread *p_thread = (struct win_thread *)p_param;
+	p_thread->p_func(p_thread->p_arg);
+	return 0;
+}
+
+/*
+ * Starts a new thread running p_func(p_arg)
+ */
+OS_THREAD *os_thread_create(OS_THREAD_FUNC p_func, void *p_arg)
+{
+	struct win_thread *p_thread = (struct win_thread *)malloc(sizeof(struct win_thread));
+	if (p_thread)
+	{
+		p_thread->p_func = p_func;
+		p_thread->p_arg = p_arg;
+		// failure when CreateThread(..) == NULL
+		p_thread->handle = CreateThread(NULL, 0, win_thread_start, p_thread, 0, NULL);
+		if (p_thread->handle == NULL)
+		{
+			free(p_thread);
+			p_thread = NULL;
+		}
+	}
+	return (OS_THREAD *)p_thread;
+}
+
+/*
+ * Waits for a thread to finish and releases it
+ */
+int os_thread_join(OS_THREAD *p_thread)
+{
+	int rc = 0;
+	if (p_thread)
+	{
+		struct win_thread *p_handle = (struct win_thread *)p_thread;
+		rc = (WaitForSingleObject(p_handle->handle, INFINITE) == WAIT_OBJECT_0);
+		CloseHandle(p_handle->handle);
+		free(p_handle);
+	}
+	return rc;
+}
+
+struct win_cond
+{
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE cond;
+};
+
+/*
+ * Creates a condition variable together with the lock protecting it
+ */
+OS_COND *os_cond_init()
+{
+	struct win_cond *p_cond = (struct win_cond *)malloc(sizeof(struct win_cond));
+	if (p_cond)
+	{
+		// Win32 API provides no indication of success for these functions
+		InitializeCriticalSection(&p_cond->lock);
+		InitializeConditionVariable(&p_cond->cond);
+	}
+	return (OS_COND *)p_cond;
+}
+
+/*
+ * Locks the lock of a condition variable
+ */
+int os_cond_lock(OS_COND *p_cond)
+{
+	if (!p_cond)
+	{
+		return 0;
+	}
+	EnterCriticalSection(&((struct win_cond *)p_cond)->lock);
+	return 1;
+}
+
+/*
+ * Unlocks the lock of a condition variable
+ */
+int os_cond_unlock(OS_COND *p_cond)
+{
+	if (!p_cond)
+	{
+		return 0;
+	}
+	LeaveCriticalSection(&((struct win_cond *)p_cond)->lock);
+	return 1;
+}
+
+/*
+ * Waits for the condition to be signaled, the caller holds its lock.
+ * A negative timeout waits forever. Returns 0 on timeout or failure.
+ */
+int os_cond_wait(OS_COND *p_cond, int timeout_ms)
+{
+	int rc = 0;
+	if (p_cond)
+	{
+		struct win_cond *p_handle = (struct win_cond *)p_cond;
+		// failure when SleepConditionVariableCS(..) == 0
+		rc = (SleepConditionVariableCS(&p_handle->cond, &p_handle->lock,
+			timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms) != 0);
+	}
+	return rc;
+}
+
+/*
+ * Wakes up every thread waiting on the condition
+ */
+int os_cond_broadcast(OS_COND *p_cond)
+{
+	if (!p_cond)
+	{
+		return 0;
+	}
+	WakeAllConditionVariable(&((struct win_cond *)p_cond)->cond);
+	return 1;
+}
+
+/*
+ * Deletes the condition variable and its lock
+ */
+int os_cond_delete(OS_COND *p_cond)
+{
+	if (p_cond)
+	{
+		// condition variables do not need to be explicitly destroyed
+		DeleteCriticalSection(&((struct win_cond *)p_cond)->lock);
+		free(p_cond);
+	}
+	return 1;
+}
+
+/*
+ * Event file descriptors are not available on Windows
+ */
+int os_event_fd_create()
+{
+	return -1;
+}
+
+void os_event_fd_signal(int fd)
+{
+}
+
+void os_event_fd_close(int fd)
+{
+}
+
 /*
  * Retrieve the name of the host server.
  */
@@ -859,6 +1131,25 @@ int os_get_os_type()
 	return 1;
 }
 
+/*
+ * Retrieve an identifier that is unique per boot of the system.
+ * Windows has none, the boot time is used instead. It is rounded so that
+ * the time it takes to compute it doesn't change it.
+ */
+int os_get_boot_id(char *boot_id, const unsigned int boot_id_len)
+{
+	ULONGLONG boot_time_s = 0;
+
+	if (boot_id == NULL || boot_id_len == 0)
+	{
+		return -1;
+	}
+
+	boot_time_s = (ULONGLONG)time(NULL) - GetTickCount64() / 1000;
+	snprintf(boot_id, boot_id_len, "%llu", boot_time_s - boot_time_s % 16);
+	return 0;
+}
+
 /*
 * Recursive mkdir, return 0 on success, -1 on error
 */
@@ -883,6 +1174,20 @@ int os_mkdir(char *path)
   return 0;
 }
 
+FILE *os_fopen_unique(char *path_template)
+{
+  FILE *p_file = NULL;
+
+  if (0 != _mktemp_s(path_template, strlen(path_template) + 1)) {
+    return NULL;
+  }
+  // x fails if another caller created the same name in the meantime
+  if (0 != fopen_s(&p_file, path_template, "wbx")) {
+    return NULL;
+  }
+  return p_file;
+}
+
 /*
  Get CPUID info for windows. Depending on the inputRequestType,
   regs[0...3] will be populated with register values eax....edx